@@ -117,6 +117,7 @@ set (SLIB_CORE_FILES
  "${SLIB_PATH}/src/slib/core/rw_lock.cpp"
  "${SLIB_PATH}/src/slib/core/service.cpp"
  "${SLIB_PATH}/src/slib/core/setting.cpp"
+ "${SLIB_PATH}/src/slib/core/shared_memory_channel.cpp"
  "${SLIB_PATH}/src/slib/core/spin_lock.cpp"
  "${SLIB_PATH}/src/slib/core/string.cpp"
  "${SLIB_PATH}/src/slib/core/system.cpp"
@@ -170,8 +171,13 @@ set (SLIB_CORE_FILES
  "${SLIB_PATH}/src/slib/network/arp.cpp"
  "${SLIB_PATH}/src/slib/network/dns.cpp"
  "${SLIB_PATH}/src/slib/network/ethernet.cpp"
+ "${SLIB_PATH}/src/slib/network/http2.cpp"
+ "${SLIB_PATH}/src/slib/network/http2_server.cpp"
+ "${SLIB_PATH}/src/slib/network/http_admission.cpp"
  "${SLIB_PATH}/src/slib/network/http_common.cpp"
+ "${SLIB_PATH}/src/slib/network/http_file_cache.cpp"
  "${SLIB_PATH}/src/slib/network/http_io.cpp"
+ "${SLIB_PATH}/src/slib/network/http_response_cache.cpp"
  "${SLIB_PATH}/src/slib/network/http_server.cpp"
  "${SLIB_PATH}/src/slib/network/icmp.cpp"
  "${SLIB_PATH}/src/slib/network/ip_address.cpp"
@@ -192,6 +198,7 @@ set (SLIB_CORE_FILES
  "${SLIB_PATH}/src/slib/network/url.cpp"
  "${SLIB_PATH}/src/slib/network/url_request.cpp"
  "${SLIB_PATH}/src/slib/network/url_request_curl.cpp"
+ "${SLIB_PATH}/src/slib/network/websocket.cpp"
 )
 if(ANDROID)
  set (SLIB_CORE_PLATFORM_FILES
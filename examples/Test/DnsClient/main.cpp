@@ -0,0 +1,184 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Resolves the names by a local fake name server which sends a spoofed answer
+	before every real one, and checks:
+		- the spoofed answers (wrong question) are ignored
+		- the query ids are random and the source port is randomized
+		- the names not answered are resolved by the system
+*/
+
+#define TEST_PORT 18234
+#define TEST_PORT_SILENT 18235
+#define NAME_COUNT 8
+
+static Memory BuildAnswer(sl_uint16 id, const String& name, DnsRecordType type, const IPv4Address& addressA, const IPv6Address& addressAAAA)
+{
+	char buf[1024];
+	Base::zeroMemory(buf, sizeof(buf));
+	DnsHeader* header = (DnsHeader*)buf;
+	header->setId(id);
+	header->setQuestion(sl_false);
+	header->setOpcode(DnsOpcode::Query);
+	header->setResponseCode(DnsResponseCode::NoError);
+	header->setQuestionsCount(1);
+	sl_uint32 offset = sizeof(DnsHeader);
+	DnsQuestionRecord question;
+	question.setName(name);
+	question.setType(type);
+	offset = question.buildRecord(buf, offset, sizeof(buf));
+	if (!offset) {
+		return sl_null;
+	}
+	DnsResponseRecord answer;
+	answer.setName(name);
+	answer.setTTL(60);
+	if (type == DnsRecordType::A && addressA.isNotZero()) {
+		offset = answer.buildRecord_A(buf, offset, sizeof(buf), addressA);
+		header->setAnswersCount(1);
+	} else if (type == DnsRecordType::AAAA && addressAAAA.isNotZero()) {
+		offset = answer.buildRecord_AAAA(buf, offset, sizeof(buf), addressAAAA);
+		header->setAnswersCount(1);
+	}
+	if (!offset) {
+		return sl_null;
+	}
+	return Memory::create(buf, offset);
+}
+
+static sl_bool Resolve(const Ref<DnsClient>& client, const String& name, List<IPAddress>& result)
+{
+	Ref<Event> event = Event::create();
+	client->resolveHost(name, [&result, event](const List<IPAddress>& addresses) {
+		result = addresses;
+		event->set();
+	});
+	return event->wait(10000);
+}
+
+int main(int argc, const char * argv[])
+{
+	Ref<AsyncIoLoop> loop = AsyncIoLoop::create();
+	IPv4Address addressReal(10, 1, 2, 3);
+	IPv4Address addressSpoofed(6, 6, 6, 6);
+
+	CList<sl_uint16> ids;
+	CList<sl_uint16> ports;
+	AsyncUdpSocketParam serverParam;
+	serverParam.bindAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	serverParam.ioLoop = loop;
+	serverParam.onReceiveFrom = [&](AsyncUdpSocket* socket, const SocketAddress& address, void* data, sl_uint32 size) {
+		DnsPacket packet;
+		if (!(packet.parsePacket(data, size)) || !(packet.flagQuestion) || packet.questions.getCount() != 1) {
+			return;
+		}
+		DnsPacket::Question question = packet.questions.getValueAt(0);
+		ids.add(packet.id);
+		ports.add(address.port);
+		// spoofed: same id, another name
+		socket->sendTo(address, BuildAnswer(packet.id, "spoofed." + question.name, question.type, addressSpoofed, IPv6Address::zero()));
+		// spoofed: same id and name, another type
+		DnsRecordType typeOther = question.type == DnsRecordType::A ? DnsRecordType::AAAA : DnsRecordType::A;
+		sl_uint8 bytesSpoofed[16] = {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 6, 6};
+		socket->sendTo(address, BuildAnswer(packet.id, question.name, typeOther, addressSpoofed, IPv6Address(bytesSpoofed)));
+		// real answer: IPv4 only
+		socket->sendTo(address, BuildAnswer(packet.id, question.name, question.type, addressReal, IPv6Address::zero()));
+	};
+	Ref<AsyncUdpSocket> server = AsyncUdpSocket::create(serverParam);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the name server\n");
+		return 1;
+	}
+
+	sl_bool flagSuccess = sl_true;
+
+	DnsClientParam clientParam;
+	clientParam.ioLoop = loop;
+	clientParam.serverAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	Ref<DnsClient> client = DnsClient::create(clientParam);
+	for (sl_uint32 i = 0; i < NAME_COUNT; i++) {
+		String name = String::format("host%d.test", i);
+		List<IPAddress> result;
+		if (!(Resolve(client, name, result))) {
+			printf("FAIL: %s is not resolved\n", name.getData());
+			flagSuccess = sl_false;
+			continue;
+		}
+		if (result.getCount() != 1 || result.getValueAt(0) != IPAddress(addressReal)) {
+			printf("FAIL: %s is resolved to %d addresses, the first: %s\n", name.getData(), (int)(result.getCount()), result.getValueAt(0).toString().getData());
+			flagSuccess = sl_false;
+		}
+	}
+
+	{
+		ListLocker<sl_uint16> list(ids);
+		sl_uint32 nSequential = 0;
+		for (sl_size i = 1; i < list.count; i++) {
+			if ((sl_uint16)(list[i] - list[i - 1]) == 1) {
+				nSequential++;
+			}
+		}
+		if (list.count != NAME_COUNT * 2 || nSequential > 1) {
+			printf("FAIL: %d questions, %d sequential ids\n", (int)(list.count), nSequential);
+			flagSuccess = sl_false;
+		}
+	}
+	{
+		ListLocker<sl_uint16> list(ports);
+		for (sl_size i = 0; i < list.count; i++) {
+			if (list[i] < 49152) {
+				printf("FAIL: source port %d is not in the randomized range\n", list[i]);
+				flagSuccess = sl_false;
+				break;
+			}
+		}
+	}
+
+	// the name server does not answer: falls back to the system
+	clientParam.serverAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT_SILENT);
+	clientParam.resolveTimeout = 100;
+	clientParam.resolveRetryCount = 0;
+	client = DnsClient::create(clientParam);
+	{
+		List<IPAddress> result;
+		if (!(Resolve(client, "localhost", result)) || result.isEmpty()) {
+			printf("FAIL: localhost is not resolved by the system\n");
+			flagSuccess = sl_false;
+		}
+	}
+
+	server->close();
+	loop->release();
+
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
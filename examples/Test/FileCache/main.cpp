@@ -0,0 +1,254 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Serves the files through the file cache of HttpServer: checks the `If-None-Match`
+	validation, then sends the concurrent whole and range requests so that the shared
+	file handles are read by `readAt` from the I/O loop and from the thread pool at once
+*/
+
+#define TEST_PORT 18250
+#define TEST_CONNECTIONS 16
+#define TEST_REQUESTS_PER_CONNECTION 100
+
+static const char* g_files[] = { "small.txt", "mid.bin", "big.bin" };
+static sl_uint32 g_sizes[] = { 5000, 80000, 2000000 };
+
+static char GetContentByte(sl_uint32 index, sl_uint32 pos)
+{
+	return (char)('a' + (pos * 7 + pos / 251 + index) % 26);
+}
+
+class TestResponse
+{
+public:
+	String status;
+	String header;
+	String body;
+
+public:
+	String getHeader(const String& name)
+	{
+		ListElements<String> lines(header.split("\r\n"));
+		for (sl_size i = 1; i < lines.count; i++) {
+			sl_reg index = lines[i].indexOf(':');
+			if (index > 0 && lines[i].substring(0, index).trim().toLower() == name.toLower()) {
+				return lines[i].substring(index + 1).trim();
+			}
+		}
+		return sl_null;
+	}
+
+};
+
+class TestClient
+{
+public:
+	Ref<Socket> socket;
+	String buffer;
+
+public:
+	sl_bool connect()
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		socket->setOption_TcpNoDelay(sl_true);
+		return sl_true;
+	}
+
+	sl_bool request(const String& path, const String& headers, TestResponse& response)
+	{
+		String s = "GET " + path + " HTTP/1.1\r\nHost: test\r\n" + headers + "\r\n";
+		if (socket->send(s.getData(), (sl_uint32)(s.getLength())) != (sl_int32)(s.getLength())) {
+			return sl_false;
+		}
+		for (;;) {
+			sl_reg posEnd = buffer.indexOf("\r\n\r\n");
+			if (posEnd >= 0) {
+				response.header = buffer.substring(0, posEnd);
+				response.status = response.header.substring(9, 12);
+				sl_uint32 sizeBody = 0;
+				if (response.status != "304") {
+					sizeBody = response.getHeader("Content-Length").parseUint32();
+				}
+				sl_size sizeTotal = posEnd + 4 + sizeBody;
+				if (buffer.getLength() >= sizeTotal) {
+					response.body = buffer.substring(posEnd + 4, sizeTotal);
+					buffer = buffer.substring(sizeTotal);
+					return sl_true;
+				}
+			}
+			char tmp[65536];
+			sl_int32 n = socket->receive(tmp, sizeof(tmp));
+			if (n <= 0) {
+				return sl_false;
+			}
+			buffer += String(tmp, n);
+		}
+	}
+
+};
+
+static sl_bool CheckContent(sl_uint32 index, sl_uint32 start, const String& body)
+{
+	const char* data = body.getData();
+	sl_size size = body.getLength();
+	for (sl_size i = 0; i < size; i++) {
+		if (data[i] != GetContentByte(index, (sl_uint32)(start + i))) {
+			return sl_false;
+		}
+	}
+	return sl_true;
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestETag()
+{
+	TestClient client;
+	if (!(client.connect())) {
+		return Check("connect", sl_false);
+	}
+	TestResponse response;
+	if (!(client.request("/small.txt", sl_null, response)) || response.status != "200") {
+		return Check("first request", sl_false);
+	}
+	String eTag = response.getHeader("ETag");
+	String opaque = eTag.substring(1, eTag.getLength() - 1);
+	struct {
+		String value;
+		const char* status;
+	} cases[] = {
+		{ eTag, "304" },
+		{ "*", "304" },
+		{ "W/" + eTag, "304" },
+		{ "\"x\", " + eTag, "304" },
+		{ "\"x\",W/" + eTag + " , \"y\"", "304" },
+		{ "\"" + opaque.substring(1) + "\"", "200" },
+		{ "\"" + opaque.substring(0, opaque.getLength() - 1) + "\"", "200" },
+		{ "\"" + opaque + "0\"", "200" },
+		{ "\"x" + opaque + "\", \"y\"", "200" },
+		{ "\"x\", \"y\"", "200" }
+	};
+	sl_bool flagSuccess = sl_true;
+	for (sl_uint32 i = 0; i < CountOfArray(cases); i++) {
+		if (!(client.request("/small.txt", "If-None-Match: " + cases[i].value + "\r\n", response)) || response.status != cases[i].status) {
+			printf("If-None-Match: %s => %s, expected %s: FAIL\n", cases[i].value.getData(), response.status.getData(), cases[i].status);
+			flagSuccess = sl_false;
+		}
+	}
+	return Check("If-None-Match", flagSuccess);
+}
+
+static sl_bool TestConcurrentReads()
+{
+	sl_reg nErrors = 0;
+	List< Ref<Thread> > clients;
+	sl_uint64 timeStart = System::getTickCount();
+	for (sl_uint32 i = 0; i < TEST_CONNECTIONS; i++) {
+		clients.add(Thread::start([i, &nErrors]() {
+			TestClient client;
+			if (!(client.connect())) {
+				Base::interlockedIncrement(&nErrors);
+				return;
+			}
+			TestResponse response;
+			for (sl_uint32 k = 0; k < TEST_REQUESTS_PER_CONNECTION; k++) {
+				sl_uint32 index = (i + k) % CountOfArray(g_files);
+				sl_uint32 size = g_sizes[index];
+				String path = String("/") + g_files[index];
+				if ((i + k) & 1) {
+					sl_uint32 start = Math::randomInt() % size;
+					sl_uint32 end = start + Math::randomInt() % (size - start);
+					if (!(client.request(path, String::format("Range: bytes=%d-%d\r\n", start, end), response)) || response.status != "206" || response.body.getLength() != end - start + 1 || !(CheckContent(index, start, response.body))) {
+						Base::interlockedIncrement(&nErrors);
+						return;
+					}
+				} else {
+					if (!(client.request(path, sl_null, response)) || response.status != "200" || response.body.getLength() != size || !(CheckContent(index, 0, response.body))) {
+						Base::interlockedIncrement(&nErrors);
+						return;
+					}
+				}
+			}
+		}));
+	}
+	for (sl_size i = 0; i < clients.getCount(); i++) {
+		clients.getValueAt(i)->join();
+	}
+	sl_uint64 dt = System::getTickCount() - timeStart;
+	printf("concurrent reads: %d requests in %d ms\n", TEST_CONNECTIONS * TEST_REQUESTS_PER_CONNECTION, (int)dt);
+	return Check("concurrent reads", !nErrors);
+}
+
+int main(int argc, const char * argv[])
+{
+	String dir = System::getTempDirectory() + "/slib_test_file_cache";
+	File::deleteDirectoryRecursively(dir);
+	File::createDirectory(dir);
+	for (sl_uint32 i = 0; i < CountOfArray(g_files); i++) {
+		Memory mem = Memory::create(g_sizes[i]);
+		char* data = (char*)(mem.getData());
+		for (sl_uint32 k = 0; k < g_sizes[i]; k++) {
+			data[k] = GetContentByte(i, k);
+		}
+		File::writeAllBytes(dir + "/" + g_files[i], mem);
+	}
+
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.flagUseWebRoot = sl_true;
+	param.webRootPath = dir;
+	param.flagUseFileCache = sl_true;
+	// `small.txt` is kept in memory, `mid.bin` is read on the I/O loop, `big.bin` is streamed from the thread pool
+	param.fileCache.maxContentSize = 64000;
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+	sl_bool flagSuccess = TestETag();
+	flagSuccess &= TestConcurrentReads();
+	server->release();
+	File::deleteDirectoryRecursively(dir);
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,240 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+#include <slib/network/http2.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	HTTP/2 Rapid Reset (CVE-2023-44487): the streams reset by the client keep their slots of
+	SETTINGS_MAX_CONCURRENT_STREAMS until their handlers finish, and the flood of the resets
+	closes the connection by GOAWAY(ENHANCE_YOUR_CALM)
+*/
+
+#define TEST_PORT 18260
+#define TEST_MAX_CONCURRENT_STREAMS 10
+#define TEST_HANDLER_TIME 500
+
+class TestClient
+{
+public:
+	Ref<Socket> socket;
+	HpackEncoder encoder;
+	String buffer;
+
+public:
+	sl_bool connect()
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		socket->setOption_TcpNoDelay(sl_true);
+		if (!(send(SLIB_HTTP2_CONNECTION_PREFACE, SLIB_HTTP2_CONNECTION_PREFACE_SIZE))) {
+			return sl_false;
+		}
+		return sendFrame(Http2FrameType::Settings, 0, 0, sl_null, 0);
+	}
+
+	sl_bool send(const void* data, sl_size size)
+	{
+		const char* p = (const char*)data;
+		while (size) {
+			sl_int32 n = socket->send(p, (sl_uint32)size);
+			if (n <= 0) {
+				return sl_false;
+			}
+			p += n;
+			size -= n;
+		}
+		return sl_true;
+	}
+
+	sl_bool sendFrame(Http2FrameType type, sl_uint8 flags, sl_uint32 streamId, const void* payload, sl_uint32 size)
+	{
+		Memory mem = Memory::create(Http2FrameHeader::HeaderSize + size);
+		if (mem.isNull()) {
+			return sl_false;
+		}
+		Http2FrameHeader* frame = (Http2FrameHeader*)(mem.getData());
+		frame->setLength(size);
+		frame->setType(type);
+		frame->setFlags(flags);
+		frame->setStreamId(streamId);
+		if (size) {
+			Base::copyMemory(frame->getPayload(), payload, size);
+		}
+		return send(mem.getData(), mem.getSize());
+	}
+
+	sl_bool sendRequest(sl_uint32 streamId, const String& path)
+	{
+		HpackHeaderField fields[] = {
+			HpackHeaderField(":method", "GET"),
+			HpackHeaderField(":scheme", "http"),
+			HpackHeaderField(":authority", "test"),
+			HpackHeaderField(":path", path)
+		};
+		Memory block = encoder.encode(fields, CountOfArray(fields));
+		return sendFrame(Http2FrameType::Headers, Http2FrameHeader::FlagEndHeaders | Http2FrameHeader::FlagEndStream, streamId, block.getData(), (sl_uint32)(block.getSize()));
+	}
+
+	sl_bool sendReset(sl_uint32 streamId)
+	{
+		sl_uint8 payload[4];
+		MIO::writeUint32BE(payload, (sl_uint32)(Http2ErrorCode::Cancel));
+		return sendFrame(Http2FrameType::ResetStream, 0, streamId, payload, 4);
+	}
+
+	// reads the frames until the one of `streamId` (0: GOAWAY). Returns sl_false when the connection is closed
+	sl_bool readFrame(sl_uint32 streamId, Http2FrameType& type, sl_uint32& code)
+	{
+		for (;;) {
+			while (buffer.getLength() >= Http2FrameHeader::HeaderSize) {
+				Http2FrameHeader* frame = (Http2FrameHeader*)(buffer.getData());
+				sl_uint32 size = Http2FrameHeader::HeaderSize + frame->getLength();
+				if (buffer.getLength() < size) {
+					break;
+				}
+				sl_bool flagFound = sl_false;
+				type = frame->getType();
+				code = 0;
+				if (type == Http2FrameType::GoAway) {
+					code = MIO::readUint32BE(frame->getPayload() + 4);
+					flagFound = sl_true;
+				} else if (streamId && frame->getStreamId() == streamId) {
+					if (type == Http2FrameType::ResetStream) {
+						code = MIO::readUint32BE(frame->getPayload());
+					}
+					flagFound = sl_true;
+				}
+				buffer = buffer.substring(size);
+				if (flagFound) {
+					return sl_true;
+				}
+			}
+			char tmp[16384];
+			sl_int32 n = socket->receive(tmp, sizeof(tmp));
+			if (n <= 0) {
+				return sl_false;
+			}
+			buffer += String(tmp, n);
+		}
+	}
+
+};
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestSlotsOfResetStreams()
+{
+	TestClient client;
+	if (!(client.connect())) {
+		return Check("connect", sl_false);
+	}
+	sl_uint32 streamId = 1;
+	for (sl_uint32 i = 0; i < TEST_MAX_CONCURRENT_STREAMS; i++) {
+		client.sendRequest(streamId + i * 2, "/slow");
+	}
+	// the requests are dispatched to the handlers before the resets
+	System::sleep(100);
+	for (sl_uint32 i = 0; i < TEST_MAX_CONCURRENT_STREAMS; i++) {
+		client.sendReset(streamId + i * 2);
+	}
+	streamId += TEST_MAX_CONCURRENT_STREAMS * 2;
+
+	sl_bool flagSuccess = sl_true;
+	Http2FrameType type;
+	sl_uint32 code;
+	client.sendRequest(streamId, "/fast");
+	flagSuccess &= Check("refused while the handlers of the reset streams run", client.readFrame(streamId, type, code) && type == Http2FrameType::ResetStream && code == (sl_uint32)(Http2ErrorCode::RefusedStream));
+	streamId += 2;
+
+	System::sleep(TEST_HANDLER_TIME + 300);
+	client.sendRequest(streamId, "/fast");
+	flagSuccess &= Check("accepted after the handlers finish", client.readFrame(streamId, type, code) && type == Http2FrameType::Headers);
+	return flagSuccess;
+}
+
+static sl_bool TestResetFlood()
+{
+	TestClient client;
+	if (!(client.connect())) {
+		return Check("connect", sl_false);
+	}
+	// HEADERS and RST_STREAM in the same writes: the streams are reset before they are dispatched
+	sl_uint32 streamId = 1;
+	for (sl_uint32 i = 0; i < 50; i++) {
+		for (sl_uint32 k = 0; k < 20; k++) {
+			client.sendRequest(streamId, "/fast");
+			client.sendReset(streamId);
+			streamId += 2;
+		}
+	}
+	sl_uint8 ping[8] = { 0 };
+	client.sendFrame(Http2FrameType::Ping, 0, 0, ping, 8);
+	Http2FrameType type;
+	sl_uint32 code;
+	return Check("GOAWAY on the reset flood", client.readFrame(0, type, code) && type == Http2FrameType::GoAway && code == (sl_uint32)(Http2ErrorCode::EnhanceYourCalm));
+}
+
+int main(int argc, const char * argv[])
+{
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.flagUseHttp2 = sl_true;
+	param.http2MaxConcurrentStreams = TEST_MAX_CONCURRENT_STREAMS;
+	param.http2MaxResetStreamsPerSecond = 100;
+	param.flagProcessByThreads = sl_true;
+	param.maxThreadsCount = TEST_MAX_CONCURRENT_STREAMS * 2;
+	param.onRequest = [](HttpServer*, HttpServerContext* context) {
+		if (context->getPath() == "/slow") {
+			System::sleep(TEST_HANDLER_TIME);
+		}
+		context->write("ok");
+		return sl_true;
+	};
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+	sl_bool flagSuccess = TestSlotsOfResetStreams();
+	flagSuccess &= TestResetFlood();
+	server->release();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,377 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Checks HttpAdmissionControl by itself (token bucket, connections per address, CLOCK eviction
+	of the address table), then runs HttpServer with the admission control and drives the 429 and
+	503 responses: rate limit, connection cap, full queue and queue timeout
+*/
+
+#define TEST_PORT 18290
+
+#define QUEUE_TIME 1000
+
+class TestRequest
+{
+public:
+	Ref<Socket> socket;
+	String status;
+	String header;
+	String body;
+
+public:
+	sl_bool connect(sl_uint32 port)
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), port)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		return sl_true;
+	}
+
+	sl_bool send(sl_uint32 port, const String& path)
+	{
+		if (!(connect(port))) {
+			return sl_false;
+		}
+		String request = "GET " + path + " HTTP/1.1\r\nHost: test\r\nConnection: close\r\n\r\n";
+		return socket->send(request.getData(), request.getLength()) == (sl_int32)(request.getLength());
+	}
+
+	// reads until the server closes the connection
+	sl_bool receive()
+	{
+		String data;
+		char buf[4096];
+		for (;;) {
+			sl_int32 n = socket->receive(buf, sizeof(buf));
+			if (n <= 0) {
+				break;
+			}
+			data += String(buf, n);
+		}
+		socket.setNull();
+		sl_reg posEnd = data.indexOf("\r\n\r\n");
+		if (posEnd < 12) {
+			return sl_false;
+		}
+		header = data.substring(0, posEnd);
+		status = header.substring(9, 12);
+		body = data.substring(posEnd + 4);
+		return sl_true;
+	}
+
+};
+
+// returns the status code, or "error"
+static String Get(sl_uint32 port, const String& path, String* pHeader = sl_null)
+{
+	TestRequest request;
+	if (request.send(port, path) && request.receive()) {
+		if (pHeader) {
+			*pHeader = request.header;
+		}
+		return request.status;
+	}
+	return "error";
+}
+
+static CList< Ref<HttpServerContext> > g_contextsHeld;
+
+static void CompleteHeldContexts()
+{
+	ListElements< Ref<HttpServerContext> > contexts(g_contextsHeld.duplicate());
+	g_contextsHeld.removeAll();
+	for (sl_size i = 0; i < contexts.count; i++) {
+		contexts[i]->write("held");
+		contexts[i]->completeResponse();
+	}
+}
+
+static Ref<HttpServer> StartServer(sl_uint32 port, const HttpAdmissionParam& admission)
+{
+	HttpServerParam param;
+	param.port = port;
+	param.flagProcessByThreads = sl_true;
+	param.maxThreadsCount = 8;
+	param.flagUseAdmissionControl = sl_true;
+	param.admission = admission;
+	param.onRequest = [](HttpServer*, HttpServerContext* context) {
+		if (context->getPath() == "/hold") {
+			// completed by `CompleteHeldContexts`
+			context->setAsynchronousResponse(sl_true);
+			g_contextsHeld.add(context);
+		} else {
+			context->write("ok");
+		}
+		return sl_true;
+	};
+	return HttpServer::create(param);
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestTokenBucket()
+{
+	HttpAdmissionParam param;
+	param.requestRate = 10;
+	param.requestBurst = 5;
+	Ref<HttpAdmissionControl> admission = HttpAdmissionControl::create(param);
+	if (admission.isNull()) {
+		return sl_false;
+	}
+	IPAddress address(IPv4Address(10, 0, 0, 1));
+	sl_uint32 n = 0;
+	for (sl_uint32 i = 0; i < 8; i++) {
+		if (admission->takeRequestToken(address)) {
+			n++;
+		}
+	}
+	sl_bool flag = n == 5 && admission->getStatistics().rejectedRequestsByRate == 3;
+	// the other address has its own bucket
+	flag = flag && admission->takeRequestToken(IPAddress(IPv4Address(10, 0, 0, 2)));
+	// refilled by 10 tokens per second
+	System::sleep(300);
+	n = 0;
+	for (sl_uint32 i = 0; i < 8; i++) {
+		if (admission->takeRequestToken(address)) {
+			n++;
+		}
+	}
+	flag = flag && n >= 2 && n <= 4;
+	return Check("token bucket", flag);
+}
+
+static sl_bool TestConnectionCap()
+{
+	HttpAdmissionParam param;
+	param.maxConnectionsPerAddress = 2;
+	Ref<HttpAdmissionControl> admission = HttpAdmissionControl::create(param);
+	if (admission.isNull()) {
+		return sl_false;
+	}
+	IPAddress address(IPv4Address(10, 0, 0, 1));
+	sl_bool flag = admission->addConnection(address) && admission->addConnection(address) && !(admission->addConnection(address));
+	flag = flag && admission->addConnection(IPAddress(IPv4Address(10, 0, 0, 2)));
+	admission->removeConnection(address);
+	flag = flag && admission->addConnection(address) && admission->getStatistics().rejectedConnections == 1;
+	return Check("connections per address", flag);
+}
+
+static sl_bool TestEviction()
+{
+	sl_bool flagSuccess = sl_true;
+	HttpAdmissionParam param;
+	param.maxAddressesCount = 256;
+	param.requestRate = 10;
+	param.maxConnectionsPerAddress = 2;
+	{
+		Ref<HttpAdmissionControl> admission = HttpAdmissionControl::create(param);
+		if (admission.isNull()) {
+			return sl_false;
+		}
+		// the address in use keeps its (empty) bucket while many other addresses pass through the table
+		IPAddress hot(IPv4Address(10, 0, 0, 1));
+		while (admission->takeRequestToken(hot)) {
+		}
+		sl_uint32 nRejected = 0;
+		for (sl_uint32 i = 0; i < 100000; i++) {
+			if (!(admission->takeRequestToken(IPAddress(IPv4Address(0x0b000000 + i))))) {
+				nRejected++;
+			}
+			if (!(i % 10)) {
+				admission->takeRequestToken(hot);
+			}
+		}
+		HttpAdmissionStatistics statistics = admission->getStatistics();
+		flagSuccess &= Check("CLOCK eviction", nRejected == 0 && statistics.addressesCount <= param.maxAddressesCount && !(admission->takeRequestToken(hot)));
+	}
+	{
+		Ref<HttpAdmissionControl> admission = HttpAdmissionControl::create(param);
+		if (admission.isNull()) {
+			return sl_false;
+		}
+		// the addresses having connections are not evicted: the new addresses are refused when the table is full of them
+		sl_uint32 nAdmitted = 0;
+		for (sl_uint32 i = 0; i < 2000; i++) {
+			if (admission->addConnection(IPAddress(IPv4Address(0x0c000000 + i)))) {
+				nAdmitted++;
+			}
+		}
+		HttpAdmissionStatistics statistics = admission->getStatistics();
+		sl_bool flag = nAdmitted <= param.maxAddressesCount && nAdmitted >= param.maxAddressesCount / 2 && statistics.addressesCount == nAdmitted && statistics.rejectedConnections == 2000 - nAdmitted;
+		for (sl_uint32 i = 0; i < 2000; i++) {
+			admission->removeConnection(IPAddress(IPv4Address(0x0c000000 + i)));
+		}
+		flag = flag && admission->addConnection(IPAddress(IPv4Address(0x0d000000)));
+		flagSuccess &= Check("table full of connections", flag);
+	}
+	return flagSuccess;
+}
+
+static sl_bool TestRateLimit()
+{
+	sl_uint32 port = TEST_PORT;
+	HttpAdmissionParam param;
+	param.requestRate = 2;
+	param.requestBurst = 10;
+	param.retryAfter = 3;
+	Ref<HttpServer> server = StartServer(port, param);
+	if (server.isNull()) {
+		return sl_false;
+	}
+	sl_uint32 nOk = 0;
+	sl_uint32 nRejected = 0;
+	sl_bool flagRetryAfter = sl_true;
+	for (sl_uint32 i = 0; i < 15; i++) {
+		String header;
+		String status = Get(port, "/", &header);
+		if (status == "200") {
+			nOk++;
+		} else if (status == "429") {
+			nRejected++;
+			flagRetryAfter = flagRetryAfter && header.contains("\r\nRetry-After: 3");
+		}
+	}
+	HttpAdmissionStatistics statistics = server->getAdmissionControl()->getStatistics();
+	server->release();
+	return Check("429 by the rate", nOk == 10 && nRejected == 5 && flagRetryAfter && statistics.rejectedRequestsByRate == 5);
+}
+
+static sl_bool TestConnectionLimit()
+{
+	sl_uint32 port = TEST_PORT + 1;
+	HttpAdmissionParam param;
+	param.maxConnectionsPerAddress = 3;
+	Ref<HttpServer> server = StartServer(port, param);
+	if (server.isNull()) {
+		return sl_false;
+	}
+	TestRequest idle[3];
+	sl_bool flag = sl_true;
+	for (sl_uint32 i = 0; i < 3; i++) {
+		flag = flag && idle[i].connect(port);
+	}
+	System::sleep(200);
+	// answered without sending the request
+	TestRequest over;
+	flag = flag && over.connect(port) && over.receive() && over.status == "503";
+	idle[0].socket->close();
+	idle[0].socket.setNull();
+	System::sleep(200);
+	flag = flag && Get(port, "/") == "200";
+	HttpAdmissionStatistics statistics = server->getAdmissionControl()->getStatistics();
+	server->release();
+	return Check("503 by the connections", flag && statistics.rejectedConnections == 1);
+}
+
+static sl_bool TestQueue()
+{
+	sl_uint32 port = TEST_PORT + 2;
+	HttpAdmissionParam param;
+	param.maxConcurrentRequests = 2;
+	param.maxQueuedRequests = 3;
+	param.maxQueueTime = QUEUE_TIME;
+	Ref<HttpServer> server = StartServer(port, param);
+	if (server.isNull()) {
+		return sl_false;
+	}
+	Ref<HttpAdmissionControl> admission = server->getAdmissionControl();
+	sl_bool flagSuccess = sl_true;
+	{
+		// the held requests take the slots, and the others wait in the queue until the timeout
+		TestRequest held[2];
+		TestRequest queued[3];
+		sl_bool flag = held[0].send(port, "/hold") && held[1].send(port, "/hold");
+		System::sleep(200);
+		sl_uint32 timeStart = System::getTickCount();
+		for (sl_uint32 i = 0; i < 3; i++) {
+			flag = flag && queued[i].send(port, "/");
+		}
+		System::sleep(200);
+		HttpAdmissionStatistics statistics = admission->getStatistics();
+		flag = flag && statistics.activeRequests == 2 && statistics.waitingRequests == 3;
+		flag = flag && Get(port, "/") == "503" && admission->getStatistics().rejectedRequestsByQueue == 1;
+		flagSuccess &= Check("503 by the full queue", flag);
+		flag = sl_true;
+		for (sl_uint32 i = 0; i < 3; i++) {
+			flag = flag && queued[i].receive() && queued[i].status == "503";
+		}
+		sl_uint32 dt = System::getTickCount() - timeStart;
+		statistics = admission->getStatistics();
+		flag = flag && dt >= QUEUE_TIME - 100 && dt < QUEUE_TIME * 2;
+		flag = flag && statistics.rejectedRequestsByTimeout == 3 && statistics.queuedRequests == 3 && statistics.waitingRequests == 0 && statistics.activeRequests == 2;
+		flagSuccess &= Check("503 by the queue timeout", flag);
+		CompleteHeldContexts();
+		flag = held[0].receive() && held[0].status == "200" && held[1].receive() && held[1].status == "200";
+		flagSuccess &= Check("held requests", flag);
+	}
+	{
+		// the slot of the completed request is passed to the waiting request
+		TestRequest held[2];
+		TestRequest queued;
+		sl_bool flag = held[0].send(port, "/hold") && held[1].send(port, "/hold");
+		System::sleep(200);
+		flag = flag && queued.send(port, "/");
+		System::sleep(200);
+		flag = flag && admission->getStatistics().waitingRequests == 1;
+		CompleteHeldContexts();
+		flag = flag && queued.receive() && queued.status == "200" && queued.body == "ok";
+		flag = flag && held[0].receive() && held[1].receive();
+		System::sleep(100);
+		HttpAdmissionStatistics statistics = admission->getStatistics();
+		flag = flag && statistics.activeRequests == 0 && statistics.waitingRequests == 0 && statistics.queuedRequests == 4;
+		flagSuccess &= Check("admitted from the queue", flag);
+	}
+	server->release();
+	return flagSuccess;
+}
+
+int main(int argc, const char * argv[])
+{
+	sl_bool flagSuccess = TestTokenBucket();
+	flagSuccess &= TestConnectionCap();
+	flagSuccess &= TestEviction();
+	flagSuccess &= TestRateLimit();
+	flagSuccess &= TestConnectionLimit();
+	flagSuccess &= TestQueue();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,341 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Runs HttpServer with the compression of the responses, and checks the bodies decoded by zlib,
+	the negotiation of `Accept-Encoding` by the quality values, the bodies sent without compression
+	(small, not compressible, opted out, files and streams appended to the body) and the headers
+*/
+
+#define TEST_PORT 18280
+
+#define LINES_COUNT 300
+
+static String g_pathFile;
+static Memory g_contentFile;
+static Ref<ThreadPool> g_threadPool;
+static Atomic<sl_int32> g_counter(0);
+
+class TestResponse
+{
+public:
+	String status;
+	HttpHeaderMap headers;
+	Memory body;
+
+public:
+	String getHeader(const String& name)
+	{
+		return headers.getValue_NoLock(name);
+	}
+
+	String getBodyString()
+	{
+		return String((char*)(body.getData()), body.getSize());
+	}
+
+	// body decoded by `Content-Encoding`
+	String getContent()
+	{
+		String encoding = getHeader("Content-Encoding");
+		if (encoding.isEmpty()) {
+			return getBodyString();
+		}
+		Memory content = Zlib::decompress(body.getData(), body.getSize());
+		if (content.isNull()) {
+			return "error";
+		}
+		return String((char*)(content.getData()), content.getSize());
+	}
+
+};
+
+static sl_bool Get(const String& path, const String& acceptEncoding, TestResponse& response)
+{
+	Ref<Socket> socket = Socket::openTcp();
+	if (socket.isNull()) {
+		return sl_false;
+	}
+	if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+		return sl_false;
+	}
+	socket->setNonBlockingMode(sl_false);
+	String request = "GET " + path + " HTTP/1.1\r\nHost: test\r\nConnection: close\r\n";
+	if (acceptEncoding.isNotNull()) {
+		request += "Accept-Encoding: " + acceptEncoding + "\r\n";
+	}
+	request += "\r\n";
+	if (socket->send(request.getData(), request.getLength()) != (sl_int32)(request.getLength())) {
+		return sl_false;
+	}
+	MemoryBuffer buffer;
+	char buf[16384];
+	for (;;) {
+		sl_int32 n = socket->receive(buf, sizeof(buf));
+		if (n <= 0) {
+			break;
+		}
+		buffer.add(Memory::create(buf, n));
+	}
+	Memory data = buffer.merge();
+	String s((char*)(data.getData()), data.getSize());
+	sl_reg posEnd = s.indexOf("\r\n\r\n");
+	if (posEnd < 12) {
+		return sl_false;
+	}
+	ListElements<String> lines(s.substring(0, posEnd).split("\r\n"));
+	response.status = lines[0].substring(9, 12);
+	response.headers.removeAll_NoLock();
+	for (sl_size i = 1; i < lines.count; i++) {
+		sl_reg pos = lines[i].indexOf(':');
+		if (pos > 0) {
+			response.headers.add_NoLock(lines[i].substring(0, pos), lines[i].substring(pos + 1).trim());
+		}
+	}
+	response.body = data.sub(posEnd + 4);
+	return response.getHeader("Content-Length").parseUint64() == response.body.getSize();
+}
+
+static String MakeLines(sl_uint32 count)
+{
+	String s;
+	for (sl_uint32 i = 0; i < count; i++) {
+		s += String::format("line %d\n", i);
+	}
+	return s;
+}
+
+static void WriteLines(HttpServerContext* context, sl_uint32 count)
+{
+	for (sl_uint32 i = 0; i < count; i++) {
+		context->write(String::format("line %d\n", i));
+	}
+}
+
+static String MakeJson()
+{
+	Json list;
+	for (sl_uint32 i = 0; i < 2000; i++) {
+		Json item;
+		item.putItem("id", i);
+		item.putItem("name", String::format("item %d", i));
+		list.addElement(item);
+	}
+	return list.toJsonString();
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool RunTests()
+{
+	sl_bool flagSuccess = sl_true;
+	String json = MakeJson();
+	String lines = MakeLines(LINES_COUNT);
+	String file((char*)(g_contentFile.getData()), g_contentFile.getSize());
+	{
+		TestResponse response;
+		sl_bool flag = Get("/json", "gzip", response) && response.getHeader("Content-Encoding") == "gzip";
+		flag = flag && response.body.getSize() < json.getLength() / 4 && ((sl_uint8*)(response.body.getData()))[0] == 0x1f && response.getContent() == json;
+		flag = flag && response.getHeader("Vary") == "Accept-Encoding";
+		flagSuccess &= Check("gzip", flag);
+	}
+	{
+		TestResponse response;
+		sl_bool flag = Get("/json", "deflate", response) && response.getHeader("Content-Encoding") == "deflate";
+		flag = flag && ((sl_uint8*)(response.body.getData()))[0] == 0x78 && response.getContent() == json;
+		flagSuccess &= Check("deflate", flag);
+	}
+	{
+		TestResponse response;
+		sl_bool flag = Get("/many", "gzip", response) && response.getHeader("Content-Encoding") == "gzip" && response.getContent() == MakeLines(20000);
+		flag = flag && Get("/async", "gzip", response) && response.getHeader("Content-Encoding") == "gzip" && response.getContent() == MakeLines(3000);
+		flagSuccess &= Check("many writes and asynchronous response", flag);
+	}
+	{
+		const char* cases[][2] = {
+			{ "gzip, deflate", "gzip" },
+			{ "deflate, gzip", "gzip" },
+			{ "gzip;q=0, deflate", "deflate" },
+			{ "deflate;q=0.5, gzip;q=0.8", "gzip" },
+			{ "gzip;q=0.5, deflate;q=0.9", "deflate" },
+			{ "GZIP", "gzip" },
+			{ "*;q=0.5", "gzip" },
+			{ "*, gzip;q=0", "deflate" },
+			{ "identity", "" },
+			{ "gzip;q=0", "" },
+			{ "br", "" }
+		};
+		sl_bool flag = sl_true;
+		for (sl_size i = 0; i < CountOfArray(cases); i++) {
+			TestResponse response;
+			sl_bool f = Get("/json", cases[i][0], response) && response.getHeader("Content-Encoding") == cases[i][1] && response.getContent() == json && response.getHeader("Vary") == "Accept-Encoding";
+			if (!f) {
+				printf("  Accept-Encoding: %s => %s\n", cases[i][0], response.getHeader("Content-Encoding").getData());
+			}
+			flag = flag && f;
+		}
+		TestResponse response;
+		flag = flag && Get("/json", sl_null, response) && response.getHeader("Content-Encoding").isEmpty() && response.getContent() == json;
+		flagSuccess &= Check("negotiation by the quality values", flag);
+	}
+	{
+		TestResponse response;
+		sl_bool flag = Get("/small", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getHeader("Vary").isEmpty() && response.getBodyString() == "small body";
+		flagSuccess &= Check("small body", flag);
+		flag = Get("/png", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.body.getSize() == 5000;
+		flagSuccess &= Check("not compressible type", flag);
+		flag = Get("/off", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == lines;
+		flagSuccess &= Check("opted out", flag);
+	}
+	{
+		TestResponse response;
+		sl_bool flag = Get("/etag", "gzip", response) && response.getHeader("ETag") == "\"abc-gzip\"" && response.getContent() == lines;
+		flag = flag && Get("/etag", "deflate", response) && response.getHeader("ETag") == "\"abc-deflate\"" && response.getContent() == lines;
+		flag = flag && Get("/etag", sl_null, response) && response.getHeader("ETag") == "\"abc\"" && response.getBodyString() == lines;
+		flagSuccess &= Check("ETag", flag);
+	}
+	{
+		TestResponse response;
+		sl_bool flag = Get("/filefirst", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == file + "tail";
+		flagSuccess &= Check("file before write", flag);
+		flag = Get("/fileafter", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == lines + file + "tail";
+		flag = flag && Get("/fileafter?dispatcher=1", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == lines + file + "tail";
+		flagSuccess &= Check("file after write", flag);
+		flag = Get("/streamafter", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == lines + file.substring(0, 100);
+		flagSuccess &= Check("stream after write", flag);
+		flag = Get("/clear", "gzip", response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == "cleared";
+		flagSuccess &= Check("cleared output", flag);
+	}
+	{
+		// the response cache keeps an entry for each encoding
+		TestResponse response;
+		sl_bool flag = Get("/cached", "gzip", response) && response.getHeader("Content-Encoding") == "gzip" && response.getContent() == "n=1 " + lines;
+		flag = flag && Get("/cached", "gzip", response) && response.getHeader("Content-Encoding") == "gzip" && response.getContent() == "n=1 " + lines;
+		flag = flag && Get("/cached", sl_null, response) && response.getHeader("Content-Encoding").isEmpty() && response.getBodyString() == "n=2 " + lines;
+		flag = flag && Get("/cached", sl_null, response) && response.getBodyString() == "n=2 " + lines;
+		flagSuccess &= Check("response cache", flag);
+	}
+	return flagSuccess;
+}
+
+int main(int argc, const char * argv[])
+{
+	g_pathFile = System::getTempDirectory() + "/slib_test_http_compression.txt";
+	g_contentFile = MakeLines(5000).toMemory();
+	if (File::writeAllBytes(g_pathFile, g_contentFile) != g_contentFile.getSize()) {
+		printf("FAIL: cannot write %s\n", g_pathFile.getData());
+		return 1;
+	}
+	g_threadPool = ThreadPool::create();
+
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.flagProcessByThreads = sl_true;
+	param.maxThreadsCount = 4;
+	param.flagUseCompression = sl_true;
+	param.flagUseResponseCache = sl_true;
+	param.onRequest = [](HttpServer*, HttpServerContext* context) {
+		String path = context->getPath();
+		if (path == "/json") {
+			context->setResponseContentType(ContentTypes::Json);
+			context->write(MakeJson());
+			return sl_true;
+		}
+		if (path == "/png") {
+			context->setResponseContentType(ContentTypes::ImagePng);
+			Memory mem = Memory::create(5000);
+			Base::resetMemory(mem.getData(), 'a', 5000);
+			context->write(mem);
+			return sl_true;
+		}
+		context->setResponseContentType(ContentTypes::TextPlain);
+		if (path == "/small") {
+			context->write("small body");
+		} else if (path == "/many") {
+			WriteLines(context, 20000);
+		} else if (path == "/async") {
+			context->setAsynchronousResponse(sl_true);
+			Ref<HttpServerContext> ref = context;
+			Dispatch::setTimeout([ref]() {
+				WriteLines(ref.get(), 3000);
+				ref->completeResponse();
+			}, 50);
+		} else if (path == "/off") {
+			context->setCompressingResponse(sl_false);
+			WriteLines(context, LINES_COUNT);
+		} else if (path == "/etag") {
+			context->setResponseHeader("ETag", "\"abc\"");
+			WriteLines(context, LINES_COUNT);
+		} else if (path == "/filefirst") {
+			context->copyFromFile(g_pathFile);
+			context->write("tail");
+		} else if (path == "/fileafter") {
+			WriteLines(context, LINES_COUNT);
+			if (context->getParameter("dispatcher").isNotEmpty()) {
+				context->copyFromFile(g_pathFile, g_threadPool);
+			} else {
+				context->copyFromFile(g_pathFile);
+			}
+			context->write("tail");
+		} else if (path == "/streamafter") {
+			WriteLines(context, LINES_COUNT);
+			Ref<AsyncFile> file = AsyncFile::openForRead(g_pathFile);
+			context->copyFrom(file.get(), 100);
+		} else if (path == "/clear") {
+			WriteLines(context, LINES_COUNT);
+			context->clearOutput();
+			context->write("cleared");
+		} else if (path == "/cached") {
+			context->setResponseCacheTime(60000);
+			context->write(String::format("n=%d ", g_counter.increase()));
+			WriteLines(context, LINES_COUNT);
+		} else {
+			return sl_false;
+		}
+		return sl_true;
+	};
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+	sl_bool flagSuccess = RunTests();
+	server->release();
+	g_threadPool->release();
+	File::deleteFile(g_pathFile);
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,340 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Edge cases and the randomized tests of the HTTP/1.x request parser:
+	the in-place header slices (`parseRequestPacket(const Memory&)`) are compared with
+	the header map of the fallback parser, every prefix of the packet must be incomplete,
+	and the mutated packets must give the same result on both overloads.
+	Ends with the parsing speed of the typical browser request
+*/
+
+#define FUZZ_ITERATIONS 20000
+#define FALLBACK_HEADERS_COUNT 48
+
+static const char* g_headerNames[] = {
+	"Host", "Connection", "Accept", "Accept-Encoding", "Accept-Language", "Cookie", "User-Agent",
+	"If-None-Match", "Content-Length", "Content-Type", "X-Custom", "X-Empty", "Range", "Referer"
+};
+
+static const char* g_headerValues[] = {
+	"", "keep-alive", "www.example.com", "gzip, deflate, br", "\"6ad58ff3-15a0\"", "a%20b", "a+b", "%E2%9C%93",
+	"text/html,application/xhtml+xml;q=0.9,*/*;q=0.8", "bytes=0-99", "  padded  ", "\ttabbed\t", "x:y:z", "%zz", "100%"
+};
+
+static String GetRandomCase(const String& s)
+{
+	String ret = s.duplicate();
+	sl_char8* data = ret.getData();
+	for (sl_size i = 0; i < ret.getLength(); i++) {
+		if (Math::randomInt() & 1) {
+			data[i] = SLIB_CHAR_LOWER_TO_UPPER(data[i]);
+		} else {
+			data[i] = SLIB_CHAR_UPPER_TO_LOWER(data[i]);
+		}
+	}
+	return ret;
+}
+
+static String MakeRandomHeaders(List<String>& names)
+{
+	String headers;
+	sl_uint32 n = Math::randomInt() % 12;
+	for (sl_uint32 i = 0; i < n; i++) {
+		String name = g_headerNames[Math::randomInt() % CountOfArray(g_headerNames)];
+		String value = g_headerValues[Math::randomInt() % CountOfArray(g_headerValues)];
+		names.add_NoLock(name);
+		switch (Math::randomInt() % 8) {
+			case 0:
+				// no colon
+				headers += GetRandomCase(name) + "\r\n";
+				break;
+			case 1:
+				headers += GetRandomCase(name) + ":" + value + "\r\n";
+				break;
+			case 2:
+				headers += GetRandomCase(name) + ": \t " + value + " \t\r\n";
+				break;
+			default:
+				headers += name + ": " + value + "\r\n";
+				break;
+		}
+	}
+	return headers;
+}
+
+static String MakeRandomRequestLine()
+{
+	static const char* methods[] = { "GET", "POST", "HEAD", "PUT", "DELETE", "OPTIONS", "PATCH", "get", "PROPFIND" };
+	static const char* uris[] = { "/", "/index.html", "/a/b?c=d&e=f", "/%E2%9C%93?x", "/?", "*", "http://host/path?q" };
+	static const char* versions[] = { "HTTP/1.1", "HTTP/1.0", "HTTP/2.0", "" };
+	return String(methods[Math::randomInt() % CountOfArray(methods)]) + " " + uris[Math::randomInt() % CountOfArray(uris)] + " " + versions[Math::randomInt() % CountOfArray(versions)] + "\r\n";
+}
+
+static String DescribeRequest(HttpRequest& request, sl_reg iRet, const List<String>& names)
+{
+	String s = String::format("%d|%s|%s|%s|%s", (sl_int32)iRet, request.getMethodText(), request.getPath(), request.getQuery(), request.getRequestVersion());
+	if (iRet <= 0) {
+		return s;
+	}
+	ListElements<String> items(names);
+	// single lookups first: `getRequestHeaderValues` builds the header map.
+	// The value of the repeated header is not compared, because the map may return any of them
+	for (sl_size i = 0; i < items.count; i++) {
+		String name = GetRandomCase(items[i]);
+		s += String::format("|%s=%d", items[i], request.containsRequestHeader(name) ? 1 : 0);
+		sl_uint32 nRepeated = 0;
+		for (sl_size k = 0; k < items.count; k++) {
+			if (items[k] == items[i]) {
+				nRepeated++;
+			}
+		}
+		if (nRepeated == 1) {
+			s += String::format("[%s]", request.getRequestHeader(name));
+		}
+	}
+	for (sl_size i = 0; i < items.count; i++) {
+		List<String> values = request.getRequestHeaderValues(GetRandomCase(items[i]));
+		values.sort_NoLock();
+		s += "|" + StringBuffer::join(",", values);
+	}
+	return s;
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestEdgeCases()
+{
+	struct {
+		const char* packet;
+		sl_reg result; // -1: error, 0: incomplete, 1: parsed
+		const char* header;
+		const char* value;
+	} cases[] = {
+		{ "GET / HTTP/1.1\r\nHost: a\r\n\r\n", 1, "host", "a" },
+		{ "GET / HTTP/1.1\r\nHost:a\r\n\r\n", 1, "HOST", "a" },
+		{ "GET / HTTP/1.1\r\nHost: \t a b \t\r\n\r\n", 1, "Host", "a b" },
+		{ "GET / HTTP/1.1\r\nHost: a\r\nHost: b\r\n\r\n", 1, "Host", "a" },
+		{ "GET / HTTP/1.1\r\nX-Empty:\r\n\r\n", 1, "X-Empty", "" },
+		{ "GET / HTTP/1.1\r\nNoColon\r\n\r\n", 1, "NoColon", "" },
+		{ "GET / HTTP/1.1\r\nX: \"quoted\"\r\n\r\n", 1, "X", "quoted" },
+		{ "GET / HTTP/1.1\r\nX: a%20b\r\n\r\n", 1, "X", "a b" },
+		{ "GET / HTTP/1.1\r\nX: a:b\r\n\r\n", 1, "X", "a:b" },
+		{ "GET / HTTP/1.1\r\n\r\n", 1, sl_null, sl_null },
+		{ "GET / HTTP/1.1\r\nHost: a\r\n", 0, sl_null, sl_null },
+		{ "GET / HTTP/1.1\r\nHost: a\r\n\r", 0, sl_null, sl_null },
+		{ "GET / HTTP/1.1", 0, sl_null, sl_null },
+		{ "GET", 0, sl_null, sl_null },
+		{ "", 0, sl_null, sl_null },
+		{ "GET / HTTP/1.1\rX\r\n\r\n", -1, sl_null, sl_null },
+		{ "GET / HTTP/1.1\r\nHost: a\rb\r\n\r\n", -1, sl_null, sl_null },
+		{ "GET\r\n\r\n", -1, sl_null, sl_null },
+		{ "GET /a\r\nb HTTP/1.1\r\n\r\n", -1, sl_null, sl_null }
+	};
+	sl_bool flagSuccess = sl_true;
+	for (sl_uint32 i = 0; i < CountOfArray(cases); i++) {
+		for (sl_uint32 k = 0; k < 2; k++) {
+			HttpRequest request;
+			sl_size len = Base::getStringLength(cases[i].packet);
+			sl_reg iRet;
+			if (k) {
+				iRet = request.parseRequestPacket(Memory::create(cases[i].packet, len));
+			} else {
+				iRet = request.parseRequestPacket(cases[i].packet, len);
+			}
+			sl_bool flagPass;
+			if (cases[i].result > 0) {
+				flagPass = iRet == (sl_reg)len;
+				if (flagPass && cases[i].header) {
+					flagPass = request.getRequestHeader(cases[i].header) == cases[i].value;
+				}
+			} else if (cases[i].result < 0) {
+				flagPass = iRet < 0;
+			} else {
+				flagPass = !iRet;
+			}
+			if (!flagPass) {
+				printf("edge case %d (%s): returned %d: FAIL\n", i, k ? "slices" : "map", (sl_int32)iRet);
+				flagSuccess = sl_false;
+			}
+		}
+	}
+	return Check("edge cases", flagSuccess);
+}
+
+static sl_bool TestRandomized()
+{
+	sl_uint32 nErrors = 0;
+	for (sl_uint32 iter = 0; iter < FUZZ_ITERATIONS && nErrors < 10; iter++) {
+		List<String> names;
+		String requestLine = MakeRandomRequestLine();
+		String headers = MakeRandomHeaders(names);
+		String packet = requestLine + headers + "\r\n";
+
+		// slices, the map built by `parseRequestPacket(const void*, sl_size)`, and the fallback parser used for many headers
+		String fill;
+		for (sl_uint32 i = 0; i < FALLBACK_HEADERS_COUNT; i++) {
+			fill += String::format("X-Fill-%d: %d\r\n", i, i);
+		}
+		String packetFallback = requestLine + fill + headers + "\r\n";
+		HttpRequest r1, r2, r3;
+		sl_reg iRet1 = r1.parseRequestPacket(Memory::create(packet.getData(), packet.getLength()));
+		sl_reg iRet2 = r2.parseRequestPacket(packet.getData(), packet.getLength());
+		sl_reg iRet3 = r3.parseRequestPacket(Memory::create(packetFallback.getData(), packetFallback.getLength()));
+		String s1 = DescribeRequest(r1, iRet1, names);
+		String s2 = DescribeRequest(r2, iRet2, names);
+		String s3 = DescribeRequest(r3, iRet3 > 0 ? iRet3 - fill.getLength() : iRet3, names);
+		if (iRet1 != (sl_reg)(packet.getLength()) || s1 != s2 || s1 != s3) {
+			printf("randomized: FAIL\n  packet: %s\n  slices:   %s\n  map:      %s\n  fallback: %s\n", packet.getData(), s1.getData(), s2.getData(), s3.getData());
+			nErrors++;
+			continue;
+		}
+
+		// every prefix is incomplete
+		sl_size len = packet.getLength();
+		for (sl_size n = 0; n < len; n += 1 + Math::randomInt() % 5) {
+			HttpRequest request;
+			sl_reg iRet = request.parseRequestPacket(Memory::create(packet.getData(), n));
+			if (iRet) {
+				printf("randomized: prefix %d/%d returned %d: FAIL\n", (sl_int32)n, (sl_int32)len, (sl_int32)iRet);
+				nErrors++;
+				break;
+			}
+		}
+
+		// mutated packets: the same result on both overloads, never beyond the packet
+		Memory mem = Memory::create(packet.getData(), len);
+		sl_uint8* data = (sl_uint8*)(mem.getData());
+		sl_uint32 nMutations = 1 + Math::randomInt() % 4;
+		for (sl_uint32 i = 0; i < nMutations; i++) {
+			static const sl_uint8 bytes[] = { '\r', '\n', ' ', ':', '%', '\t', 0, 0x80, 0xFF };
+			data[Math::randomInt() % len] = bytes[Math::randomInt() % CountOfArray(bytes)];
+		}
+		sl_size sizeMutated = len - Math::randomInt() % 3;
+		HttpRequest m1, m2;
+		iRet1 = m1.parseRequestPacket(mem.sub(0, sizeMutated));
+		iRet2 = m2.parseRequestPacket(data, sizeMutated);
+		if (iRet1 > (sl_reg)sizeMutated || DescribeRequest(m1, iRet1, names) != DescribeRequest(m2, iRet2, names)) {
+			printf("randomized: mutated packet: FAIL\n  slices: %s\n  map:    %s\n", DescribeRequest(m1, iRet1, names).getData(), DescribeRequest(m2, iRet2, names).getData());
+			nErrors++;
+		}
+	}
+	return Check("randomized", !nErrors);
+}
+
+static sl_bool TestHeaderReader()
+{
+	sl_uint32 nErrors = 0;
+	for (sl_uint32 iter = 0; iter < FUZZ_ITERATIONS / 10 && nErrors < 10; iter++) {
+		List<String> names;
+		String header = MakeRandomRequestLine() + MakeRandomHeaders(names) + "\r\n";
+		String stream = header + "BODY\r\n\r\nGET / HTTP/1.1\r\n\r\n";
+		HttpHeaderReader reader;
+		sl_size posStream = 0;
+		sl_size posFound = 0;
+		sl_bool flagFound = sl_false;
+		while (posStream < stream.getLength()) {
+			sl_size n = 1 + Math::randomInt() % 8;
+			if (posStream + n > stream.getLength()) {
+				n = stream.getLength() - posStream;
+			}
+			sl_size posBody = 0;
+			if (reader.add(stream.getData() + posStream, n, posBody)) {
+				flagFound = sl_true;
+				posFound = posStream + posBody;
+				break;
+			}
+			posStream += n;
+		}
+		if (!flagFound || posFound != header.getLength() || reader.getHeaderSize() != header.getLength()) {
+			printf("header reader: found=%d at %d, expected %d: FAIL\n", (int)flagFound, (sl_int32)posFound, (sl_int32)(header.getLength()));
+			nErrors++;
+		}
+	}
+	return Check("header reader", !nErrors);
+}
+
+static void RunBenchmark()
+{
+	String packet =
+		"GET /static/js/app.bundle.js?v=1234&lang=en HTTP/1.1\r\n"
+		"Host: www.example.com\r\n"
+		"Connection: keep-alive\r\n"
+		"sec-ch-ua: \"Chromium\";v=\"118\", \"Google Chrome\";v=\"118\", \"Not=A?Brand\";v=\"99\"\r\n"
+		"sec-ch-ua-mobile: ?0\r\n"
+		"User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/118.0.0.0 Safari/537.36\r\n"
+		"sec-ch-ua-platform: \"Windows\"\r\n"
+		"Accept: */*\r\n"
+		"Sec-Fetch-Site: same-origin\r\n"
+		"Sec-Fetch-Mode: no-cors\r\n"
+		"Sec-Fetch-Dest: script\r\n"
+		"Referer: https://www.example.com/\r\n"
+		"Accept-Encoding: gzip, deflate, br\r\n"
+		"Accept-Language: en-US,en;q=0.9,ko;q=0.8\r\n"
+		"Cookie: _ga=GA1.2.1234567890.1690000000; session=abcdef0123456789abcdef0123456789; theme=dark\r\n"
+		"If-None-Match: \"6ad58ff3-15a0\"\r\n"
+		"\r\n";
+	Memory mem = Memory::create(packet.getData(), packet.getLength());
+	const sl_uint32 n = 200000;
+	for (sl_uint32 k = 0; k < 2; k++) {
+		sl_size sum = 0;
+		sl_uint64 timeStart = System::getTickCount();
+		for (sl_uint32 i = 0; i < n; i++) {
+			HttpRequest request;
+			if (k) {
+				request.parseRequestPacket(mem);
+			} else {
+				request.parseRequestPacket(packet.getData(), packet.getLength());
+			}
+			// the headers read by the server on the typical request
+			sum += request.getRequestHeader(HttpHeaders::Connection).getLength();
+			sum += request.getRequestHeader(HttpHeaders::AcceptEncoding).getLength();
+			sum += request.getRequestHeader(HttpHeaders::IfNoneMatch).getLength();
+			sum += request.getRequestHeader(HttpHeaders::ContentLength).getLength();
+		}
+		sl_uint64 dt = System::getTickCount() - timeStart;
+		printf("benchmark (%s): %.0f ns/request (%d)\n", k ? "slices" : "map", (double)dt * 1000000 / n, (sl_int32)sum);
+	}
+}
+
+int main(int argc, const char * argv[])
+{
+	sl_bool flagSuccess = TestEdgeCases();
+	flagSuccess &= TestRandomized();
+	flagSuccess &= TestHeaderReader();
+	if (!flagSuccess) {
+		return 1;
+	}
+	RunBenchmark();
+	printf("PASS\n");
+	return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Sends the pipelined requests to HttpServer and checks that the responses come back
+	complete and in the order of the requests, then measures the throughput by the
+	pipeline depth
+*/
+
+#define TEST_PORT 18236
+
+class TestClient
+{
+public:
+	Ref<Socket> socket;
+	String buffer;
+
+public:
+	sl_bool connect()
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		socket->setOption_TcpNoDelay(sl_true);
+		return sl_true;
+	}
+
+	sl_bool send(const String& s, sl_uint32 sizeSplit = 0)
+	{
+		const char* p = s.getData();
+		sl_uint32 size = (sl_uint32)(s.getLength());
+		while (size) {
+			sl_uint32 n = size;
+			if (sizeSplit && n > sizeSplit) {
+				n = sizeSplit;
+			}
+			sl_int32 m = socket->send(p, n);
+			if (m <= 0) {
+				return sl_false;
+			}
+			p += m;
+			size -= m;
+		}
+		return sl_true;
+	}
+
+	// reads `count` responses, and returns the bodies joined by ','. `statuses` receives the status codes
+	String readResponses(sl_uint32 count, sl_uint32& nResponses, String* statuses = sl_null)
+	{
+		String bodies;
+		nResponses = 0;
+		while (nResponses < count) {
+			sl_reg posEnd = buffer.indexOf("\r\n\r\n");
+			if (posEnd >= 0) {
+				String header = buffer.substring(0, posEnd);
+				sl_uint32 sizeBody = 0;
+				sl_reg posLength = header.toLower().indexOf("content-length:");
+				if (posLength >= 0) {
+					sizeBody = header.substring(posLength + 15).split("\r\n").getValueAt(0).trim().parseUint32();
+				}
+				sl_size sizeTotal = posEnd + 4 + sizeBody;
+				if (buffer.getLength() >= sizeTotal) {
+					if (statuses) {
+						*statuses += header.substring(9, 13);
+					}
+					bodies += buffer.substring(posEnd + 4, sizeTotal) + ",";
+					buffer = buffer.substring(sizeTotal);
+					nResponses++;
+					continue;
+				}
+			}
+			char tmp[65536];
+			sl_int32 n = socket->receive(tmp, sizeof(tmp));
+			if (n <= 0) {
+				break;
+			}
+			buffer += String(tmp, n);
+		}
+		return bodies;
+	}
+
+	sl_bool isClosedByPeer()
+	{
+		char c;
+		return socket->receive(&c, 1) < 0;
+	}
+
+};
+
+static String MakeGets(sl_uint32 count, sl_uint32 start = 0)
+{
+	String s;
+	for (sl_uint32 i = start; i < start + count; i++) {
+		s += String::format("GET /slow?i=%d HTTP/1.1\r\nHost: test\r\n\r\n", i);
+	}
+	return s;
+}
+
+static String MakeExpected(sl_uint32 count, sl_uint32 start = 0)
+{
+	String s;
+	for (sl_uint32 i = start; i < start + count; i++) {
+		s += String::fromUint32(i) + ",";
+	}
+	return s;
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool RunTests()
+{
+	sl_bool flagSuccess = sl_true;
+	{
+		// burst of pipelined GETs in one write, handlers with random delays
+		TestClient client;
+		sl_uint32 n = 0;
+		flagSuccess &= client.connect() && client.send(MakeGets(50)) && Check("burst of 50", client.readResponses(50, n) == MakeExpected(50));
+	}
+	{
+		// GETs and POSTs, split at every 7 bytes
+		TestClient client;
+		String requests, expected;
+		for (sl_uint32 i = 0; i < 20; i++) {
+			if (i % 3 == 0) {
+				requests += String::format("POST /post?i=%d HTTP/1.1\r\nHost: test\r\nContent-Length: %d\r\n\r\n", i, i * 10);
+				for (sl_uint32 k = 0; k < i * 10; k++) {
+					requests += "b";
+				}
+				expected += String::format("%d:%d,", i, i * 10);
+			} else {
+				requests += MakeGets(1, i);
+				expected += MakeExpected(1, i);
+			}
+		}
+		sl_uint32 n = 0;
+		flagSuccess &= client.connect() && client.send(requests, 7) && Check("split GET/POST", client.readResponses(20, n) == expected);
+	}
+	{
+		// `Connection: close` in the middle: the following requests are not answered
+		TestClient client;
+		String requests;
+		for (sl_uint32 i = 0; i < 5; i++) {
+			requests += String::format("GET /slow?i=%d HTTP/1.1\r\nHost: test\r\n%s\r\n", i, i == 2 ? "Connection: close\r\n" : "");
+		}
+		sl_uint32 n = 0;
+		flagSuccess &= client.connect() && client.send(requests) && Check("close in the middle", client.readResponses(5, n) == MakeExpected(3) && n == 3 && client.isClosedByPeer());
+	}
+	{
+		// malformed request in the middle: answered by 400 in order, then closed
+		TestClient client;
+		String requests = MakeGets(3) + "GET /x HTTP/1.1\r\nBad\rHeader\r\n\r\n" + MakeGets(1, 4);
+		sl_uint32 n = 0;
+		String statuses;
+		flagSuccess &= client.connect() && client.send(requests);
+		String bodies = client.readResponses(5, n, &statuses);
+		flagSuccess &= Check("malformed in the middle", n == 4 && bodies.startsWith(MakeExpected(3)) && statuses == "200 200 200 400 " && client.isClosedByPeer());
+	}
+	{
+		// more requests than `maxPipelinedRequests`, the client half-closes after writing
+		TestClient client;
+		sl_uint32 n = 0;
+		flagSuccess &= client.connect() && client.send(MakeGets(200));
+		client.socket->shutdown(SocketShutdownMode::Send);
+		flagSuccess &= Check("200 with half-close", client.readResponses(200, n) == MakeExpected(200));
+	}
+	{
+		// HTTP/1.0 without keep-alive: only the first is answered
+		TestClient client;
+		sl_uint32 n = 0;
+		flagSuccess &= client.connect() && client.send("GET /a?i=7 HTTP/1.0\r\n\r\nGET /a?i=8 HTTP/1.0\r\n\r\n") && Check("HTTP/1.0", client.readResponses(2, n) == "7," && n == 1);
+	}
+	return flagSuccess;
+}
+
+static void RunBenchmark(sl_uint32 nConnections, sl_uint32 depth, sl_uint32 duration)
+{
+	volatile sl_bool flagStop = sl_false;
+	sl_reg nTotal = 0;
+	String requests;
+	for (sl_uint32 i = 0; i < depth; i++) {
+		requests += "GET /bench HTTP/1.1\r\nHost: test\r\n\r\n";
+	}
+	List< Ref<Thread> > threads;
+	for (sl_uint32 i = 0; i < nConnections; i++) {
+		threads.add(Thread::start([&flagStop, &nTotal, requests, depth]() {
+			TestClient client;
+			if (!(client.connect())) {
+				return;
+			}
+			while (!flagStop) {
+				sl_uint32 n = 0;
+				if (!(client.send(requests))) {
+					break;
+				}
+				client.readResponses(depth, n);
+				if (n != depth) {
+					break;
+				}
+				Base::interlockedAdd(&nTotal, (sl_reg)n);
+			}
+		}));
+	}
+	sl_uint64 timeStart = System::getTickCount();
+	System::sleep(duration);
+	flagStop = sl_true;
+	for (sl_size i = 0; i < threads.getCount(); i++) {
+		threads.getValueAt(i)->join();
+	}
+	sl_uint64 dt = System::getTickCount() - timeStart;
+	printf("benchmark: connections=%u depth=%u: %.0f requests/s\n", nConnections, depth, (double)nTotal * 1000 / (double)dt);
+}
+
+int main(int argc, const char * argv[])
+{
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.flagProcessByThreads = sl_true;
+	param.maxThreadsCount = 4;
+	param.onRequest = [](HttpServer*, HttpServerContext* context) {
+		String index = context->getParameter("i");
+		if (context->getPath() == "/slow") {
+			System::sleep(Math::randomInt() % 4);
+		}
+		if (context->getMethod() == HttpMethod::POST) {
+			context->write(index + ":" + String::fromUint64(context->getRequestBody().getSize()));
+		} else if (context->getPath() == "/bench") {
+			context->write("ok");
+		} else {
+			context->write(index);
+		}
+		return sl_true;
+	};
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+	sl_bool flagSuccess = RunTests();
+	if (flagSuccess) {
+		RunBenchmark(4, 1, 2000);
+		RunBenchmark(4, 16, 2000);
+	}
+	server->release();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,239 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Runs HttpServer on 1, 2, 4 I/O loops (with and without the thread pool), checks every
+	response of the concurrent keep-alive clients and the number of the handler threads,
+	then measures the throughput by the loop count
+*/
+
+#define TEST_PORT_BASE 18240
+#define TEST_CONNECTIONS 16
+#define TEST_REQUESTS_PER_CONNECTION 200
+#define TEST_MAX_THREADS 8
+
+class TestClient
+{
+public:
+	Ref<Socket> socket;
+	String buffer;
+
+public:
+	sl_bool connect(sl_uint16 port)
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), port)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		socket->setOption_TcpNoDelay(sl_true);
+		return sl_true;
+	}
+
+	// sends one GET, and returns the body of the response
+	String request(const String& path)
+	{
+		String s = "GET " + path + " HTTP/1.1\r\nHost: test\r\n\r\n";
+		if (socket->send(s.getData(), (sl_uint32)(s.getLength())) != (sl_int32)(s.getLength())) {
+			return sl_null;
+		}
+		for (;;) {
+			sl_reg posEnd = buffer.indexOf("\r\n\r\n");
+			if (posEnd >= 0) {
+				String header = buffer.substring(0, posEnd);
+				sl_uint32 sizeBody = 0;
+				sl_reg posLength = header.toLower().indexOf("content-length:");
+				if (posLength >= 0) {
+					sizeBody = header.substring(posLength + 15).split("\r\n").getValueAt(0).trim().parseUint32();
+				}
+				sl_size sizeTotal = posEnd + 4 + sizeBody;
+				if (buffer.getLength() >= sizeTotal) {
+					String body = buffer.substring(posEnd + 4, sizeTotal);
+					buffer = buffer.substring(sizeTotal);
+					return body;
+				}
+			}
+			char tmp[4096];
+			sl_int32 n = socket->receive(tmp, sizeof(tmp));
+			if (n <= 0) {
+				return sl_null;
+			}
+			buffer += String(tmp, n);
+		}
+	}
+
+};
+
+class TestServer
+{
+public:
+	Ref<HttpServer> server;
+	sl_uint16 port;
+	Mutex lock;
+	HashMap<sl_uint64, sl_bool> threads;
+	sl_uint32 nActive = 0;
+	sl_uint32 nMaxActive = 0;
+
+public:
+	sl_bool start(sl_uint32 nLoops, sl_bool flagProcessByThreads)
+	{
+		port = (sl_uint16)(TEST_PORT_BASE + nLoops * 2 + (flagProcessByThreads ? 1 : 0));
+		HttpServerParam param;
+		param.port = port;
+		param.ioLoopCount = nLoops;
+		param.flagProcessByThreads = flagProcessByThreads;
+		param.maxThreadsCount = TEST_MAX_THREADS;
+		param.onRequest = [this](HttpServer*, HttpServerContext* context) {
+			{
+				MutexLocker locker(&lock);
+				threads.put_NoLock(System::getThreadId(), sl_true);
+				nActive++;
+				if (nActive > nMaxActive) {
+					nMaxActive = nActive;
+				}
+			}
+			context->write(context->getParameter("c") + ":" + context->getParameter("i"));
+			{
+				MutexLocker locker(&lock);
+				nActive--;
+			}
+			return sl_true;
+		};
+		server = HttpServer::create(param);
+		return server.isNotNull();
+	}
+
+	void stop()
+	{
+		if (server.isNotNull()) {
+			server->release();
+			server.setNull();
+		}
+	}
+
+};
+
+static sl_bool RunTest(sl_uint32 nLoops, sl_bool flagProcessByThreads)
+{
+	TestServer server;
+	if (!(server.start(nLoops, flagProcessByThreads))) {
+		printf("loops=%u threads=%d: FAIL (cannot start the server)\n", nLoops, flagProcessByThreads ? 1 : 0);
+		return sl_false;
+	}
+	sl_reg nErrors = 0;
+	sl_uint16 port = server.port;
+	List< Ref<Thread> > clients;
+	for (sl_uint32 i = 0; i < TEST_CONNECTIONS; i++) {
+		clients.add(Thread::start([i, port, &nErrors]() {
+			TestClient client;
+			if (!(client.connect(port))) {
+				Base::interlockedIncrement(&nErrors);
+				return;
+			}
+			for (sl_uint32 k = 0; k < TEST_REQUESTS_PER_CONNECTION; k++) {
+				String expected = String::format("%d:%d", i, k);
+				if (client.request(String::format("/?c=%d&i=%d", i, k)) != expected) {
+					Base::interlockedIncrement(&nErrors);
+					return;
+				}
+			}
+		}));
+	}
+	for (sl_size i = 0; i < clients.getCount(); i++) {
+		clients.getValueAt(i)->join();
+	}
+	server.stop();
+	sl_size nThreads = server.threads.getCount();
+	sl_bool flagSuccess = !nErrors && nThreads;
+	if (flagProcessByThreads) {
+		// the thread pool never runs more handlers than `maxThreadsCount`
+		flagSuccess = flagSuccess && server.nMaxActive <= TEST_MAX_THREADS;
+	} else {
+		// without the thread pool, the requests are handled on the I/O loop threads
+		flagSuccess = flagSuccess && nThreads <= nLoops;
+	}
+	printf("loops=%u threads=%d: errors=%d handler threads=%d concurrent handlers=%u: %s\n", nLoops, flagProcessByThreads ? 1 : 0, (int)nErrors, (int)nThreads, server.nMaxActive, flagSuccess ? "ok" : "FAIL");
+	return flagSuccess;
+}
+
+static void RunBenchmark(sl_uint32 nLoops, sl_bool flagProcessByThreads, sl_uint32 nConnections, sl_uint32 duration)
+{
+	TestServer server;
+	if (!(server.start(nLoops, flagProcessByThreads))) {
+		return;
+	}
+	sl_uint16 port = server.port;
+	volatile sl_bool flagStop = sl_false;
+	sl_reg nTotal = 0;
+	List< Ref<Thread> > clients;
+	for (sl_uint32 i = 0; i < nConnections; i++) {
+		clients.add(Thread::start([port, &flagStop, &nTotal]() {
+			TestClient client;
+			if (!(client.connect(port))) {
+				return;
+			}
+			while (!flagStop) {
+				if (client.request("/?c=0&i=0") != "0:0") {
+					break;
+				}
+				Base::interlockedIncrement(&nTotal);
+			}
+		}));
+	}
+	sl_uint64 timeStart = System::getTickCount();
+	System::sleep(duration);
+	flagStop = sl_true;
+	for (sl_size i = 0; i < clients.getCount(); i++) {
+		clients.getValueAt(i)->join();
+	}
+	sl_uint64 dt = System::getTickCount() - timeStart;
+	server.stop();
+	printf("benchmark: loops=%u threads=%d connections=%u: %.0f requests/s\n", nLoops, flagProcessByThreads ? 1 : 0, nConnections, (double)nTotal * 1000 / (double)dt);
+}
+
+int main(int argc, const char * argv[])
+{
+	sl_bool flagSuccess = sl_true;
+	sl_uint32 loops[] = {1, 2, 4};
+	for (sl_uint32 i = 0; i < CountOfArray(loops); i++) {
+		flagSuccess &= RunTest(loops[i], sl_false);
+		flagSuccess &= RunTest(loops[i], sl_true);
+	}
+	if (!flagSuccess) {
+		return 1;
+	}
+	for (sl_uint32 i = 0; i < CountOfArray(loops); i++) {
+		RunBenchmark(loops[i], sl_false, 32, 2000);
+	}
+	RunBenchmark(System::getProcessorCount(), sl_true, 32, 2000);
+	printf("PASS\n");
+	return 0;
+}
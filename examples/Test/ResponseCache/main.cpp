@@ -0,0 +1,310 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Runs HttpServer with the response cache and checks the coalescing of the concurrent misses,
+	stale-while-revalidate, the responses and requests bypassing the cache, the pass entries,
+	the hand-off of an abandoned fill to a waiting request, and the keys by `Host` and `Vary`
+*/
+
+#define TEST_PORT 18300
+
+#define SLOW_HANDLER_TIME 300
+#define STALE_TTL 300
+
+static Atomic<sl_int32> g_counter(0);
+
+class TestRequest
+{
+public:
+	Ref<Socket> socket;
+	String status;
+	String header;
+	String body;
+
+public:
+	sl_bool send(const String& path, const String& headers = String::null())
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		String request = "GET " + path + " HTTP/1.1\r\nConnection: close\r\n" + headers;
+		if (!(headers.startsWith("Host:"))) {
+			request += "Host: test\r\n";
+		}
+		request += "\r\n";
+		return socket->send(request.getData(), request.getLength()) == (sl_int32)(request.getLength());
+	}
+
+	// reads until the server closes the connection
+	sl_bool receive()
+	{
+		String data;
+		char buf[4096];
+		for (;;) {
+			sl_int32 n = socket->receive(buf, sizeof(buf));
+			if (n <= 0) {
+				break;
+			}
+			data += String(buf, n);
+		}
+		socket.setNull();
+		sl_reg posEnd = data.indexOf("\r\n\r\n");
+		if (posEnd < 12) {
+			return sl_false;
+		}
+		header = data.substring(0, posEnd);
+		status = header.substring(9, 12);
+		body = data.substring(posEnd + 4);
+		return sl_true;
+	}
+
+};
+
+// returns the body, or "error"
+static String Get(const String& path, const String& headers = String::null())
+{
+	TestRequest request;
+	if (request.send(path, headers) && request.receive()) {
+		return request.body;
+	}
+	return "error";
+}
+
+// sends the requests at the same time, and returns the bodies in the order of the requests
+static List<String> GetConcurrently(const String& path, sl_uint32 count, sl_uint32 interval = 0)
+{
+	Ref<Thread> threads[16];
+	String bodies[16];
+	for (sl_uint32 i = 0; i < count; i++) {
+		String* pBody = bodies + i;
+		threads[i] = Thread::start([path, pBody]() {
+			*pBody = Get(path);
+		});
+		if (interval) {
+			System::sleep(interval);
+		}
+	}
+	List<String> ret;
+	for (sl_uint32 i = 0; i < count; i++) {
+		threads[i]->join();
+		ret.add(bodies[i]);
+	}
+	return ret;
+}
+
+static sl_uint32 Count(const List<String>& list, const String& value)
+{
+	sl_uint32 n = 0;
+	ListElements<String> items(list);
+	for (sl_size i = 0; i < items.count; i++) {
+		if (items[i] == value) {
+			n++;
+		}
+	}
+	return n;
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool RunTests(HttpResponseCache* cache)
+{
+	sl_bool flagSuccess = sl_true;
+	{
+		// concurrent identical misses: one runs the handler, the others wait for its response
+		g_counter = 0;
+		List<String> bodies = GetConcurrently("/slow", 8);
+		flagSuccess &= Check("coalesced misses", Count(bodies, "slow 1") == 8 && g_counter == 1);
+		flagSuccess &= Check("hit", Get("/slow") == "slow 1" && g_counter == 1);
+	}
+	{
+		// after the lifetime, one request refreshes the entry and the others are answered by the stale entry
+		g_counter = 0;
+		sl_bool flag = Get("/stale") == "stale 1";
+		System::sleep(STALE_TTL + 100);
+		List<String> bodies = GetConcurrently("/stale", 4, 50);
+		flag = flag && Count(bodies, "stale 2") == 1 && Count(bodies, "stale 1") == 3 && g_counter == 2;
+		flag = flag && Get("/stale") == "stale 2" && g_counter == 2;
+		flagSuccess &= Check("stale-while-revalidate", flag);
+	}
+	{
+		// not cached: `Set-Cookie` in the response, the request with `Cookie`
+		g_counter = 0;
+		sl_bool flag = Get("/cookie") == "cookie 1" && Get("/cookie") == "cookie 2";
+		flagSuccess &= Check("Set-Cookie bypass", flag);
+		flag = Get("/text", "Cookie: a=b\r\n") == "text 3" && Get("/text", "Cookie: a=b\r\n") == "text 4";
+		flag = flag && Get("/text") == "text 5" && Get("/text") == "text 5";
+		flagSuccess &= Check("Cookie bypass", flag);
+	}
+	{
+		// `Vary`: keyed by the listed header, not cached by the others
+		g_counter = 0;
+		sl_bool flag = Get("/vary", "Accept-Language: en\r\n") == "vary 1 en";
+		flag = flag && Get("/vary", "Accept-Language: en\r\n") == "vary 1 en";
+		flag = flag && Get("/vary", "Accept-Language: fr\r\n") == "vary 2 fr";
+		flag = flag && Get("/vary", "Accept-Language: en\r\n") == "vary 1 en";
+		flagSuccess &= Check("Vary on the listed header", flag);
+		flag = Get("/varyother") == "varyother 3" && Get("/varyother") == "varyother 4";
+		flagSuccess &= Check("Vary bypass", flag);
+	}
+	{
+		// `Cache-Control` of the response
+		g_counter = 0;
+		sl_bool flag = Get("/cc?d=no-store") == "cc 1" && Get("/cc?d=no-store") == "cc 2";
+		flag = flag && Get("/cc?d=private") == "cc 3" && Get("/cc?d=private") == "cc 4";
+		flag = flag && Get("/cc?d=max-age%3D0") == "cc 5" && Get("/cc?d=max-age%3D0") == "cc 6";
+		flag = flag && Get("/cc?d=public") == "cc 7" && Get("/cc?d=public") == "cc 7";
+		flagSuccess &= Check("Cache-Control", flag);
+	}
+	{
+		// keyed by the host
+		g_counter = 0;
+		sl_bool flag = Get("/host", "Host: a.test\r\n") == "host a.test 1";
+		flag = flag && Get("/host", "Host: b.test\r\n") == "host b.test 2";
+		flag = flag && Get("/host", "Host: A.TEST\r\n") == "host a.test 1";
+		flagSuccess &= Check("keyed by the host", flag);
+	}
+	{
+		// not cacheable: the waiting requests run the handler by themselves, then the key is passed without coalescing
+		g_counter = 0;
+		List<String> bodies = GetConcurrently("/pass", 4);
+		sl_bool flag = g_counter == 4 && Count(bodies, "error") == 0;
+		sl_uint32 timeStart = System::getTickCount();
+		bodies = GetConcurrently("/pass", 4);
+		sl_uint32 dt = System::getTickCount() - timeStart;
+		flag = flag && g_counter == 8 && Count(bodies, "error") == 0 && dt < SLOW_HANDLER_TIME * 2;
+		flagSuccess &= Check("pass entry", flag);
+	}
+	{
+		// the handler of the filling request aborts its connection: a waiting request fills the entry instead
+		g_counter = 0;
+		TestRequest first;
+		sl_bool flag = first.send("/drop");
+		System::sleep(50);
+		sl_uint32 timeStart = System::getTickCount();
+		TestRequest second;
+		flag = flag && second.send("/drop") && second.receive() && second.body == "drop 2";
+		sl_uint32 dt = System::getTickCount() - timeStart;
+		flag = flag && !(first.receive()) && dt < 1000 && Get("/drop") == "drop 2" && g_counter == 2;
+		flagSuccess &= Check("abandoned fill", flag);
+	}
+	flagSuccess &= Check("entries", cache->getEntriesCount() > 0 && cache->getMemorySize() > 0);
+	return flagSuccess;
+}
+
+int main(int argc, const char * argv[])
+{
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.flagProcessByThreads = sl_true;
+	param.maxThreadsCount = 16;
+	param.flagUseResponseCache = sl_true;
+	param.responseCache.varyHeaders.add("Accept-Language");
+	param.responseCache.maxWaitTime = 5000;
+	param.onRequest = [](HttpServer*, HttpServerContext* context) {
+		String path = context->getPath();
+		if (path == "/slow") {
+			sl_int32 n = g_counter.increase();
+			System::sleep(SLOW_HANDLER_TIME);
+			context->setResponseCacheTime(60000);
+			context->write(String::format("slow %d", n));
+		} else if (path == "/stale") {
+			sl_int32 n = g_counter.increase();
+			if (n > 1) {
+				System::sleep(SLOW_HANDLER_TIME);
+			}
+			context->setResponseCacheTime(STALE_TTL, 5000);
+			context->write(String::format("stale %d", n));
+		} else if (path == "/cookie") {
+			context->setResponseCacheTime(60000);
+			context->setResponseHeader("Set-Cookie", "a=b");
+			context->write(String::format("cookie %d", g_counter.increase()));
+		} else if (path == "/text") {
+			context->setResponseCacheTime(60000);
+			context->write(String::format("text %d", g_counter.increase()));
+		} else if (path == "/vary") {
+			context->setResponseCacheTime(60000);
+			context->setResponseHeader("Vary", "Accept-Language");
+			context->write(String::format("vary %d %s", g_counter.increase(), context->getRequestHeader("Accept-Language")));
+		} else if (path == "/varyother") {
+			context->setResponseCacheTime(60000);
+			context->setResponseHeader("Vary", "Accept-Encoding");
+			context->write(String::format("varyother %d", g_counter.increase()));
+		} else if (path == "/cc") {
+			context->setResponseCacheTime(60000);
+			context->setResponseHeader("Cache-Control", context->getParameter("d"));
+			context->write(String::format("cc %d", g_counter.increase()));
+		} else if (path == "/host") {
+			context->setResponseCacheTime(60000);
+			context->write(String::format("host %s %d", context->getHost().toLower(), g_counter.increase()));
+		} else if (path == "/pass") {
+			g_counter.increase();
+			System::sleep(SLOW_HANDLER_TIME);
+			context->write("pass");
+		} else if (path == "/drop") {
+			sl_int32 n = g_counter.increase();
+			context->setResponseCacheTime(60000);
+			if (n == 1) {
+				// not completed, the connection is closed a while later
+				context->setAsynchronousResponse(sl_true);
+				Ref<HttpServerConnection> connection = context->getConnection();
+				Dispatch::setTimeout([connection]() {
+					connection->close();
+				}, 200);
+			} else {
+				context->write(String::format("drop %d", n));
+			}
+		} else {
+			return sl_false;
+		}
+		return sl_true;
+	};
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+	Ref<HttpResponseCache> cache = server->getResponseCache();
+	sl_bool flagSuccess = cache.isNotNull() && RunTests(cache.get());
+	server->release();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
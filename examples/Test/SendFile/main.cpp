@@ -0,0 +1,147 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Transfers a file range over a loopback connection with `AsyncStream::sendFile`
+	and checks that the range is counted by the write watermarks of the stream
+*/
+
+#define TEST_PORT 18231
+#define FILE_SIZE (8 << 20)
+#define RANGE_OFFSET 12345
+#define RANGE_SIZE (FILE_SIZE - 2 * RANGE_OFFSET)
+#define HIGH_WATERMARK (1 << 20)
+
+int main(int argc, const char * argv[])
+{
+	String path = System::getTempDirectory() + "/slib_test_sendfile.bin";
+	Memory content = Memory::create(FILE_SIZE);
+	{
+		sl_uint8* p = (sl_uint8*)(content.getData());
+		sl_uint32 seed = 0x12345678;
+		for (sl_uint32 i = 0; i < FILE_SIZE; i++) {
+			seed = seed * 1103515245 + 12345;
+			p[i] = (sl_uint8)(seed >> 16);
+		}
+	}
+	if (File::writeAllBytes(path, content) != FILE_SIZE) {
+		printf("FAIL: cannot write %s\n", path.getData());
+		return 1;
+	}
+
+	Ref<AsyncIoLoop> loop = AsyncIoLoop::create();
+	CList< Ref<AsyncTcpSocket> > connections;
+
+	volatile sl_bool flagPausedAfterSend = sl_false;
+	volatile sl_uint64 sizePendingAfterSend = 0;
+	volatile sl_uint64 sizeSent = 0;
+	volatile sl_bool flagSendError = sl_true;
+	volatile sl_bool flagDrained = sl_false;
+	volatile sl_bool flagWritable = sl_false;
+
+	AsyncTcpServerParam serverParam;
+	serverParam.bindAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	serverParam.ioLoop = loop;
+	serverParam.onAccept = [&](AsyncTcpServer* server, Socket* socket, const SocketAddress& address) {
+		AsyncTcpSocketParam param;
+		param.socket = socket;
+		param.ioLoop = loop;
+		Ref<AsyncTcpSocket> stream = AsyncTcpSocket::create(param);
+		if (stream.isNull()) {
+			return;
+		}
+		connections.add(stream);
+		stream->setWriteWatermarks(HIGH_WATERMARK);
+		stream->setOnDrain([&](AsyncStream*) {
+			flagDrained = sl_true;
+		});
+		stream->setOnWritable([&](AsyncStream*) {
+			flagWritable = sl_true;
+		});
+		Ref<File> file = File::openForRead(path);
+		stream->sendFile(file, RANGE_OFFSET, RANGE_SIZE, [&](AsyncStream*, sl_uint64 size, sl_bool flagError) {
+			sizeSent = size;
+			flagSendError = flagError;
+		});
+		flagPausedAfterSend = !(stream->isWritable());
+		sizePendingAfterSend = stream->getPendingWriteSize();
+	};
+	Ref<AsyncTcpServer> server = AsyncTcpServer::create(serverParam);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+
+	Ref<Socket> client = Socket::openTcp();
+	if (client.isNull() || !(client->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+		printf("FAIL: cannot connect\n");
+		return 1;
+	}
+	client->setNonBlockingMode(sl_false);
+	// read slowly at first, so that the range stays queued for a while
+	System::sleep(300);
+	Memory received = Memory::create(RANGE_SIZE);
+	sl_uint8* buf = (sl_uint8*)(received.getData());
+	sl_uint32 sizeReceived = 0;
+	while (sizeReceived < RANGE_SIZE) {
+		sl_int32 n = client->receive(buf + sizeReceived, RANGE_SIZE - sizeReceived);
+		if (n <= 0) {
+			break;
+		}
+		sizeReceived += n;
+	}
+	System::sleep(200);
+
+	sl_bool flagSuccess = sl_true;
+	if (sizeReceived != RANGE_SIZE || Base::compareMemory(buf, (sl_uint8*)(content.getData()) + RANGE_OFFSET, RANGE_SIZE)) {
+		printf("FAIL: received %u bytes, content mismatch\n", sizeReceived);
+		flagSuccess = sl_false;
+	}
+	if (flagSendError || sizeSent != RANGE_SIZE) {
+		printf("FAIL: sendFile completed with %u bytes, error=%d\n", (sl_uint32)sizeSent, (int)flagSendError);
+		flagSuccess = sl_false;
+	}
+	if (!flagPausedAfterSend || sizePendingAfterSend != RANGE_SIZE) {
+		printf("FAIL: file range is not counted by the watermarks (pending=%u)\n", (sl_uint32)sizePendingAfterSend);
+		flagSuccess = sl_false;
+	}
+	if (!flagDrained || !flagWritable) {
+		printf("FAIL: drain=%d writable=%d after the transfer\n", (int)flagDrained, (int)flagWritable);
+		flagSuccess = sl_false;
+	}
+
+	server->close();
+	loop->release();
+	File::deleteFile(path);
+
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
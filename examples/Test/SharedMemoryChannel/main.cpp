@@ -0,0 +1,242 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+#if defined(SLIB_PLATFORM_IS_LINUX)
+#include <unistd.h>
+#include <sched.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#endif
+
+using namespace slib;
+
+/*
+	Passes the messages from the forked producers to the reader through a named channel,
+	then corrupts the size of a record from another process and checks that the reader
+	rejects the record instead of reading out of the ring
+*/
+
+#define CHANNEL_NAME "slib_test_channel"
+#define PRODUCER_COUNT 4
+#define MESSAGE_COUNT 100000
+
+#if defined(SLIB_PLATFORM_IS_LINUX)
+
+struct Message
+{
+	sl_uint32 producer;
+	sl_uint32 sequence;
+	sl_uint32 size;
+	sl_uint32 checksum;
+};
+
+static sl_uint32 GetMessageSize(sl_uint32 sequence)
+{
+	return sizeof(Message) + (sequence * 37) % 700;
+}
+
+static sl_uint32 GetChecksum(const sl_uint8* data, sl_uint32 size)
+{
+	sl_uint32 sum = 0;
+	for (sl_uint32 i = 0; i < size; i++) {
+		sum = sum * 31 + data[i];
+	}
+	return sum;
+}
+
+static void RunProducer(sl_uint32 producer)
+{
+	Ref<SharedMemoryChannel> channel = SharedMemoryChannel::open(CHANNEL_NAME);
+	if (channel.isNull()) {
+		_exit(2);
+	}
+	sl_uint8 buf[1024];
+	for (sl_uint32 i = 0; i < MESSAGE_COUNT; i++) {
+		sl_uint32 size = GetMessageSize(i);
+		for (sl_uint32 k = sizeof(Message); k < size; k++) {
+			buf[k] = (sl_uint8)(producer + i + k);
+		}
+		Message* msg = (Message*)buf;
+		msg->producer = producer;
+		msg->sequence = i;
+		msg->size = size;
+		msg->checksum = GetChecksum(buf + sizeof(Message), size - sizeof(Message));
+		while (!(channel->write(buf, size))) {
+			sched_yield();
+		}
+	}
+	_exit(0);
+}
+
+static sl_bool TestProducers(sl_bool flagMultipleProducers)
+{
+	sl_uint32 nProducers = flagMultipleProducers ? PRODUCER_COUNT : 1;
+	SharedMemoryChannel::remove(CHANNEL_NAME);
+	Ref<SharedMemoryChannel> channel = SharedMemoryChannel::create(CHANNEL_NAME, 65536, flagMultipleProducers);
+	if (channel.isNull()) {
+		printf("FAIL: cannot create the channel\n");
+		return sl_false;
+	}
+	for (sl_uint32 i = 0; i < nProducers; i++) {
+		if (!fork()) {
+			RunProducer(i);
+		}
+	}
+	sl_uint32 sequences[PRODUCER_COUNT] = {0};
+	sl_uint32 nReceived = 0;
+	sl_uint32 nInvalid = 0;
+	sl_uint64 timeStart = System::getTickCount();
+	while (nReceived < nProducers * MESSAGE_COUNT) {
+		sl_uint32 size;
+		sl_uint8* data = (sl_uint8*)(channel->peek(size));
+		if (!data) {
+			if (!(channel->wait(2000))) {
+				break;
+			}
+			continue;
+		}
+		Message* msg = (Message*)data;
+		if (size < sizeof(Message) || msg->producer >= nProducers || msg->size != size || msg->sequence != sequences[msg->producer] || msg->checksum != GetChecksum(data + sizeof(Message), size - sizeof(Message))) {
+			nInvalid++;
+		} else {
+			sequences[msg->producer]++;
+		}
+		channel->pop();
+		nReceived++;
+	}
+	sl_uint64 dt = System::getTickCount() - timeStart;
+	sl_bool flagSuccess = sl_true;
+	for (sl_uint32 i = 0; i < nProducers; i++) {
+		int status = 0;
+		::wait(&status);
+		if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+			flagSuccess = sl_false;
+		}
+	}
+	SharedMemoryChannel::remove(CHANNEL_NAME);
+	if (!flagSuccess || nInvalid || nReceived != nProducers * MESSAGE_COUNT || channel->isBroken()) {
+		printf("FAIL: producers=%u received=%u invalid=%u broken=%d\n", nProducers, nReceived, nInvalid, (int)(channel->isBroken()));
+		return sl_false;
+	}
+	if (!dt) {
+		dt = 1;
+	}
+	printf("producers=%u: %u messages, %.0f messages/s\n", nProducers, nReceived, (double)nReceived * 1000 / dt);
+	return sl_true;
+}
+
+// the record header `{size, flags}` at the position `offset` of the ring is overwritten by another process
+static sl_bool TestCorruptedRecord(sl_bool flagPadding)
+{
+	SharedMemoryChannel::remove(CHANNEL_NAME);
+	Ref<SharedMemoryChannel> channel = SharedMemoryChannel::create(CHANNEL_NAME, 4096, sl_false);
+	if (channel.isNull()) {
+		printf("FAIL: cannot create the channel\n");
+		return sl_false;
+	}
+	sl_uint32 capacity = channel->getCapacity();
+	sl_uint32 offset = 0;
+	if (flagPadding) {
+		// fills the ring up to near the end, so that the next message needs the padding record
+		sl_uint8 buf[2048] = {0};
+		sl_uint32 sizeMessage = capacity / 4 - 8;
+		for (sl_uint32 i = 0; i < 3; i++) {
+			channel->write(buf, sizeMessage);
+			channel->pop();
+		}
+		offset = capacity / 4 * 3;
+		channel->write(buf, capacity / 4 + 8);
+	} else {
+		channel->write("hello", 5);
+	}
+	pid_t pid = fork();
+	if (!pid) {
+		Ref<SharedMemoryChannel> peer = SharedMemoryChannel::open(CHANNEL_NAME);
+		if (peer.isNull()) {
+			_exit(2);
+		}
+		int fd = (int)(peer->getHandle());
+		struct stat st;
+		if (::fstat(fd, &st)) {
+			_exit(3);
+		}
+		void* p = ::mmap(sl_null, (size_t)(st.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (p == MAP_FAILED) {
+			_exit(4);
+		}
+		// the ring is placed at the end of the mapping
+		sl_uint32* record = (sl_uint32*)((sl_uint8*)p + (st.st_size - capacity) + offset);
+		record[0] = 0x7ffffff0;
+		_exit(0);
+	}
+	int status = 0;
+	::waitpid(pid, &status, 0);
+	sl_uint32 size = 0;
+	void* data = channel->peek(size);
+	Memory mem = channel->read();
+	sl_bool flagBroken = channel->isBroken();
+	SharedMemoryChannel::remove(CHANNEL_NAME);
+	if (!WIFEXITED(status) || WEXITSTATUS(status)) {
+		printf("FAIL: the peer process failed (%d)\n", WEXITSTATUS(status));
+		return sl_false;
+	}
+	if (data || mem.isNotNull() || !flagBroken) {
+		printf("FAIL: corrupted %s record is accepted (size=%u)\n", flagPadding ? "padding" : "message", size);
+		return sl_false;
+	}
+	printf("corrupted %s record is rejected\n", flagPadding ? "padding" : "message");
+	return sl_true;
+}
+
+#endif
+
+int main(int argc, const char * argv[])
+{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+	sl_bool flagSuccess = sl_true;
+	if (!(TestProducers(sl_false))) {
+		flagSuccess = sl_false;
+	}
+	if (!(TestProducers(sl_true))) {
+		flagSuccess = sl_false;
+	}
+	if (!(TestCorruptedRecord(sl_false))) {
+		flagSuccess = sl_false;
+	}
+	if (!(TestCorruptedRecord(sl_true))) {
+		flagSuccess = sl_false;
+	}
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+#else
+	printf("SharedMemoryChannel is supported on Linux only\n");
+	return 0;
+#endif
+}
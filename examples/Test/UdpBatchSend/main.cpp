@@ -0,0 +1,133 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Sends a batch of datagrams containing the ones which cannot be sent
+	(too large, invalid address), and checks that only those are dropped
+	and the others are delivered in order
+*/
+
+#define TEST_PORT 18232
+#define DATAGRAM_COUNT 1000
+#define DATAGRAM_SIZE 200
+#define OVERSIZED_SIZE 65520
+
+static sl_bool IsBadDatagram(sl_uint32 index)
+{
+	return index % 97 == 13;
+}
+
+int main(int argc, const char * argv[])
+{
+	Ref<AsyncIoLoop> loop = AsyncIoLoop::create();
+
+	volatile sl_uint32 nReceived = 0;
+	volatile sl_uint32 nOutOfOrder = 0;
+	volatile sl_uint32 nInvalid = 0;
+	sl_uint32 indexLast = 0;
+
+	AsyncUdpSocketParam receiverParam;
+	receiverParam.bindAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	receiverParam.ioLoop = loop;
+	receiverParam.onReceiveFrom = [&](AsyncUdpSocket*, const SocketAddress&, void* data, sl_uint32 size) {
+		if (size != DATAGRAM_SIZE) {
+			nInvalid++;
+			return;
+		}
+		sl_uint32 index = MIO::readUint32LE(data);
+		if (IsBadDatagram(index)) {
+			nInvalid++;
+		}
+		if (nReceived && index <= indexLast) {
+			nOutOfOrder++;
+		}
+		indexLast = index;
+		nReceived++;
+	};
+	Ref<AsyncUdpSocket> receiver = AsyncUdpSocket::create(receiverParam);
+	if (receiver.isNull()) {
+		printf("FAIL: cannot bind the receiver\n");
+		return 1;
+	}
+	receiver->setReceiveBufferSize(16 << 20);
+
+	AsyncUdpSocketParam senderParam;
+	senderParam.ioLoop = loop;
+	Ref<AsyncUdpSocket> sender = AsyncUdpSocket::create(senderParam);
+	if (sender.isNull()) {
+		printf("FAIL: cannot create the sender\n");
+		return 1;
+	}
+
+	SocketAddress addressTo(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	SocketAddress addressInvalid(IPv6Address::getLoopback(), TEST_PORT);
+	Memory content = Memory::create(DATAGRAM_COUNT * DATAGRAM_SIZE + OVERSIZED_SIZE);
+	sl_uint8* buf = (sl_uint8*)(content.getData());
+	Base::zeroMemory(buf, content.getSize());
+	SocketDatagram datagrams[DATAGRAM_COUNT];
+	sl_uint32 nExpected = 0;
+	for (sl_uint32 i = 0; i < DATAGRAM_COUNT; i++) {
+		SocketDatagram& datagram = datagrams[i];
+		datagram.address = addressTo;
+		datagram.data = buf + i * DATAGRAM_SIZE;
+		datagram.size = DATAGRAM_SIZE;
+		MIO::writeUint32LE(datagram.data, i);
+		if (IsBadDatagram(i)) {
+			if (i & 1) {
+				datagram.address = addressInvalid;
+			} else {
+				MIO::writeUint32LE(buf + DATAGRAM_COUNT * DATAGRAM_SIZE, i);
+				datagram.data = buf + DATAGRAM_COUNT * DATAGRAM_SIZE;
+				datagram.size = OVERSIZED_SIZE;
+			}
+		} else {
+			nExpected++;
+		}
+	}
+	if (!(sender->sendToBatch(datagrams, DATAGRAM_COUNT))) {
+		printf("FAIL: cannot queue the datagrams\n");
+		return 1;
+	}
+	System::sleep(500);
+
+	sl_bool flagSuccess = sl_true;
+	if (nReceived != nExpected || nOutOfOrder || nInvalid) {
+		printf("FAIL: received=%u expected=%u outOfOrder=%u invalid=%u\n", nReceived, nExpected, nOutOfOrder, nInvalid);
+		flagSuccess = sl_false;
+	}
+
+	sender->close();
+	receiver->close();
+	loop->release();
+
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,184 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+#include <slib/web/controller.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Matching cases of WebRouter (static runs, `{name}` parameters, `*name` wildcards,
+	the priority and the backtracking between them, invalid and conflicting patterns),
+	then the lookup speed on 1000 static routes and 100 parameterized routes
+*/
+
+#define TEST_HANDLER(n) [](SWEB_HANDLER_PARAMS_LIST) -> Variant { return n; }
+
+static sl_bool CheckMatch(WebRouter& router, HttpMethod method, const char* path, sl_int32 expectedHandler, const char* expectedParameters)
+{
+	WebRouteMatch match;
+	String strPath = path;
+	sl_int32 handler = -1;
+	String parameters;
+	if (router.match(method, strPath.getData(), strPath.getLength(), match)) {
+		handler = match.handler(sl_null, method, strPath).getInt32();
+		for (sl_uint32 i = 0; i < match.countParameters; i++) {
+			parameters += *(match.parameters[i].name) + "=" + String(match.parameters[i].value, match.parameters[i].length) + ";";
+		}
+	}
+	if (handler != expectedHandler || parameters != expectedParameters) {
+		printf("%s %s => %d [%s], expected %d [%s]: FAIL\n", HttpMethods::toString(method).getData(), path, handler, parameters.getData(), expectedHandler, expectedParameters);
+		return sl_false;
+	}
+	return sl_true;
+}
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestMatching()
+{
+	WebRouter router;
+	sl_bool flagSuccess = sl_true;
+	flagSuccess &= router.add(HttpMethod::GET, "/", TEST_HANDLER(1));
+	flagSuccess &= router.add(HttpMethod::GET, "/users", TEST_HANDLER(2));
+	flagSuccess &= router.add(HttpMethod::GET, "/users/{id}", TEST_HANDLER(3));
+	flagSuccess &= router.add(HttpMethod::GET, "/users/{id}/posts/{post}", TEST_HANDLER(4));
+	flagSuccess &= router.add(HttpMethod::GET, "/users/me", TEST_HANDLER(5));
+	flagSuccess &= router.add(HttpMethod::GET, "/static/*file", TEST_HANDLER(6));
+	flagSuccess &= router.add(HttpMethod::GET, "/use", TEST_HANDLER(7));
+	flagSuccess &= router.add(HttpMethod::POST, "/users/{id}", TEST_HANDLER(8));
+	flagSuccess &= router.add(HttpMethod::GET, "/users/{id}/x", TEST_HANDLER(9));
+	flagSuccess &= router.add(HttpMethod::GET, "/file-{name}", TEST_HANDLER(10));
+	flagSuccess &= router.add(HttpMethod::GET, "/users/me/x", TEST_HANDLER(11));
+	flagSuccess &= router.add(HttpMethod::GET, "/a/*", TEST_HANDLER(12));
+	flagSuccess &= Check("registration", flagSuccess);
+
+	// conflicting and invalid patterns
+	sl_bool flagRejected = !(router.add(HttpMethod::GET, "/users/{uid}", TEST_HANDLER(0)));
+	flagRejected &= !(router.add(HttpMethod::GET, "/x/{a}b", TEST_HANDLER(0)));
+	flagRejected &= !(router.add(HttpMethod::GET, "/x/{}", TEST_HANDLER(0)));
+	flagRejected &= !(router.add(HttpMethod::GET, "/x/{a", TEST_HANDLER(0)));
+	flagRejected &= !(router.add(HttpMethod::GET, "/x/*a/b", TEST_HANDLER(0)));
+	flagSuccess &= Check("invalid patterns", flagRejected);
+
+	sl_bool flagMatched = sl_true;
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/", 1, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users", 2, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/42", 3, "id=42;");
+	// static is preferred to the parameter, and the parameter is used when the static run doesn't match the whole segment
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/me", 5, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/mex", 3, "id=mex;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/m", 3, "id=m;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/me/x", 11, "");
+	// backtracks from the static `me` to the parameter
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/me/posts/7", 4, "id=me;post=7;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/42/posts/7", 4, "id=42;post=7;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/42/x", 9, "id=42;");
+	// the parameter doesn't match the empty segment
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/42/", -1, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/users/", -1, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/us", -1, "");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/use", 7, "");
+	// the wildcard matches the rest of the path, including the empty one
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/static/a/b.css", 6, "file=a/b.css;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/static/", 6, "file=;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/file-abc", 10, "name=abc;");
+	flagMatched &= CheckMatch(router, HttpMethod::GET, "/a/q/w", 12, "=q/w;");
+	// one tree per method
+	flagMatched &= CheckMatch(router, HttpMethod::POST, "/users/5", 8, "id=5;");
+	flagMatched &= CheckMatch(router, HttpMethod::PUT, "/users/5", -1, "");
+	flagMatched &= CheckMatch(router, HttpMethod::POST, "/users", -1, "");
+	flagSuccess &= Check("matching", flagMatched);
+	return flagSuccess;
+}
+
+static double MeasureLookups(WebRouter& router, const List<String>& paths, sl_uint32 n, sl_uint32& nFound)
+{
+	ListElements<String> items(paths);
+	sl_uint64 timeStart = System::getTickCount();
+	for (sl_uint32 i = 0; i < n; i++) {
+		const String& path = items[i % items.count];
+		WebRouteMatch match;
+		if (router.match(HttpMethod::GET, path.getData(), path.getLength(), match)) {
+			nFound++;
+		}
+	}
+	return (double)(System::getTickCount() - timeStart) * 1000000 / n;
+}
+
+static sl_bool RunBenchmark()
+{
+	WebRouter router;
+	List<String> pathsStatic;
+	for (sl_uint32 i = 0; i < 1000; i++) {
+		String path;
+		switch (i % 4) {
+			case 0:
+				path = String::format("/api/v1/resource%d", i);
+				break;
+			case 1:
+				path = String::format("/api/v1/resource%d/items", i);
+				break;
+			case 2:
+				path = String::format("/api/v2/group%d/list", i);
+				break;
+			default:
+				path = String::format("/site/page%d.html", i);
+				break;
+		}
+		router.add(HttpMethod::GET, path, TEST_HANDLER(1));
+		pathsStatic.add_NoLock(path);
+	}
+	List<String> pathsParameter;
+	for (sl_uint32 i = 0; i < 100; i++) {
+		router.add(HttpMethod::GET, String::format("/api/v3/user%d/{id}/detail", i), TEST_HANDLER(2));
+		pathsParameter.add_NoLock(String::format("/api/v3/user%d/%d/detail", i, i * 7919));
+	}
+	List<String> pathsMissing;
+	for (sl_uint32 i = 0; i < 100; i++) {
+		pathsMissing.add_NoLock(String::format("/api/v1/resource%d/missing", i * 4));
+	}
+	const sl_uint32 n = 1000000;
+	sl_uint32 nStatic = 0, nParameter = 0, nMissing = 0;
+	double tStatic = MeasureLookups(router, pathsStatic, n, nStatic);
+	double tParameter = MeasureLookups(router, pathsParameter, n, nParameter);
+	double tMissing = MeasureLookups(router, pathsMissing, n, nMissing);
+	printf("benchmark (1000 static + 100 parameterized routes): static %.0f ns, parameter %.0f ns, missing %.0f ns\n", tStatic, tParameter, tMissing);
+	return Check("benchmark lookups", nStatic == n && nParameter == n && !nMissing);
+}
+
+int main(int argc, const char * argv[])
+{
+	sl_bool flagSuccess = TestMatching();
+	flagSuccess &= RunBenchmark();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,491 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Checks `WebSocket::mask` against the byte loop for the unaligned buffers and every offset,
+	then talks to an echo server by the raw frames: fragmented messages with the control frames
+	between the fragments, permessage-deflate, the protocol errors and the closing handshake
+*/
+
+#define TEST_PORT 18270
+
+static sl_bool Check(const char* name, sl_bool flag)
+{
+	printf("%s: %s\n", name, flag ? "ok" : "FAIL");
+	return flag;
+}
+
+static sl_bool TestMask()
+{
+	const sl_size maxSize = 300;
+	Memory memSrc = Memory::create(maxSize + 64);
+	Memory memDst = Memory::create(maxSize + 64);
+	Memory memExpected = Memory::create(maxSize);
+	sl_uint8* bufSrc = (sl_uint8*)(memSrc.getData());
+	sl_uint8* bufDst = (sl_uint8*)(memDst.getData());
+	sl_uint8* expected = (sl_uint8*)(memExpected.getData());
+	const sl_uint8 key[4] = { 0x37, 0xfa, 0x21, 0x3d };
+	const sl_uint64 offsets[] = { 0, 1, 2, 3, 4, 5, 6, 7, SLIB_UINT64(0x100000003) };
+	sl_uint32 nErrors = 0;
+	for (sl_uint32 iOffset = 0; iOffset < CountOfArray(offsets); iOffset++) {
+		sl_uint64 offset = offsets[iOffset];
+		for (sl_size size = 0; size <= maxSize; size += (size < 80 ? 1 : 13)) {
+			for (sl_uint32 shiftSrc = 0; shiftSrc < 16; shiftSrc++) {
+				sl_uint8* src = bufSrc + shiftSrc;
+				for (sl_size i = 0; i < size; i++) {
+					src[i] = (sl_uint8)(i * 131 + shiftSrc * 7 + 1);
+					expected[i] = src[i] ^ key[(offset + i) & 3];
+				}
+				for (sl_uint32 shiftDst = 0; shiftDst < 16; shiftDst++) {
+					sl_uint8* dst = bufDst + shiftDst;
+					dst[size] = 0xcc;
+					WebSocket::mask(src, dst, size, key, offset);
+					if (!(Base::equalsMemory(dst, expected, size)) || dst[size] != 0xcc) {
+						nErrors++;
+					}
+				}
+				// in place
+				WebSocket::mask(src, size, key, offset);
+				if (!(Base::equalsMemory(src, expected, size))) {
+					nErrors++;
+				}
+			}
+		}
+	}
+	// masked in pieces at the arbitrary positions, as the payload arrives
+	{
+		sl_uint8* src = bufSrc;
+		for (sl_size i = 0; i < maxSize; i++) {
+			src[i] = (sl_uint8)(i * 17);
+			expected[i] = src[i] ^ key[i & 3];
+		}
+		sl_size pos = 0, step = 1;
+		while (pos < maxSize) {
+			sl_size n = SLIB_MIN(step, maxSize - pos);
+			WebSocket::mask(src + pos, n, key, pos);
+			pos += n;
+			step = step * 3 + 1;
+		}
+		if (!(Base::equalsMemory(src, expected, maxSize))) {
+			nErrors++;
+		}
+	}
+	if (nErrors) {
+		printf("mask: %u mismatches\n", nErrors);
+	}
+	return Check("mask", !nErrors);
+}
+
+class TestClient
+{
+public:
+	Ref<Socket> socket;
+	Memory buffer;
+	sl_size sizeBuffer = 0;
+	sl_bool flagDeflate = sl_false;
+	sl_bool flagLastCompressed = sl_false; // RSV1 of the last message read
+	ZlibCompress deflater;
+	ZlibDecompress inflater;
+
+public:
+	sl_bool connect(sl_bool flagOfferDeflate)
+	{
+		socket = Socket::openTcp();
+		if (socket.isNull()) {
+			return sl_false;
+		}
+		if (!(socket->connectAndWait(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+			return sl_false;
+		}
+		socket->setNonBlockingMode(sl_false);
+		socket->setOption_TcpNoDelay(sl_true);
+		String request = "GET /echo HTTP/1.1\r\nHost: test\r\nUpgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n";
+		if (flagOfferDeflate) {
+			request += "Sec-WebSocket-Extensions: permessage-deflate\r\n";
+		}
+		request += "\r\n";
+		if (!(send(request.getData(), request.getLength()))) {
+			return sl_false;
+		}
+		// the response header
+		String header;
+		for (;;) {
+			char c;
+			if (socket->receive(&c, 1) != 1) {
+				return sl_false;
+			}
+			header += String(&c, 1);
+			if (header.endsWith("\r\n\r\n")) {
+				break;
+			}
+		}
+		if (!(header.startsWith("HTTP/1.1 101"))) {
+			return sl_false;
+		}
+		if (!(header.contains(WebSocket::getAcceptKey("dGhlIHNhbXBsZSBub25jZQ==")))) {
+			return sl_false;
+		}
+		flagDeflate = header.toLower().contains("permessage-deflate");
+		if (flagDeflate) {
+			deflater.startRaw();
+			inflater.startRaw();
+		}
+		buffer = Memory::create(1 << 20);
+		sizeBuffer = 0;
+		return sl_true;
+	}
+
+	sl_bool send(const void* data, sl_size size)
+	{
+		const char* p = (const char*)data;
+		while (size) {
+			sl_int32 n = socket->send(p, (sl_uint32)(SLIB_MIN(size, 65536)));
+			if (n <= 0) {
+				return sl_false;
+			}
+			p += n;
+			size -= n;
+		}
+		return sl_true;
+	}
+
+	// masked frame (client to server)
+	sl_bool sendFrame(WebSocketOpcode opcode, const void* payload, sl_size size, sl_bool flagFinal = sl_true, sl_bool flagCompressed = sl_false, sl_bool flagMasked = sl_true)
+	{
+		Memory frame = WebSocket::buildFrame(opcode, payload, size, flagFinal, flagCompressed);
+		if (frame.isNull()) {
+			return sl_false;
+		}
+		if (!flagMasked) {
+			return send(frame.getData(), frame.getSize());
+		}
+		sl_uint8* f = (sl_uint8*)(frame.getData());
+		sl_size sizeHeader = frame.getSize() - size;
+		Memory masked = Memory::create(frame.getSize() + 4);
+		sl_uint8* m = (sl_uint8*)(masked.getData());
+		Base::copyMemory(m, f, sizeHeader);
+		m[1] |= 0x80;
+		sl_uint8 key[4];
+		Math::randomMemory(key, 4);
+		Base::copyMemory(m + sizeHeader, key, 4);
+		WebSocket::mask(f + sizeHeader, m + sizeHeader + 4, size, key);
+		return send(m, masked.getSize());
+	}
+
+	sl_bool sendText(const String& text, sl_bool flagFinal = sl_true)
+	{
+		return sendFrame(WebSocketOpcode::Text, text.getData(), text.getLength(), flagFinal);
+	}
+
+	// compressed by the context shared between the messages, split into `nFragments` frames
+	sl_bool sendCompressed(WebSocketOpcode opcode, const Memory& data, sl_uint32 nFragments, sl_bool flagPingBetween)
+	{
+		Memory compressed = deflater.flush(data.getData(), data.getSize());
+		sl_size size = compressed.getSize();
+		if (size < 4) {
+			return sl_false;
+		}
+		// the empty block at the end is removed (RFC 7692)
+		size -= 4;
+		const sl_uint8* p = (const sl_uint8*)(compressed.getData());
+		sl_size pos = 0;
+		for (sl_uint32 i = 0; i < nFragments; i++) {
+			sl_size n = i + 1 == nFragments ? size - pos : size / nFragments;
+			if (!(sendFrame(i ? WebSocketOpcode::Continuation : opcode, p + pos, n, i + 1 == nFragments, !i))) {
+				return sl_false;
+			}
+			pos += n;
+			if (flagPingBetween && i + 1 < nFragments) {
+				if (!(sendFrame(WebSocketOpcode::Ping, "between", 7))) {
+					return sl_false;
+				}
+			}
+		}
+		return sl_true;
+	}
+
+	// reads one frame of the server (unmasked). Returns sl_false when the connection is closed
+	sl_bool readFrame(WebSocketOpcode& opcode, sl_bool& flagFinal, sl_bool& flagCompressed, Memory& payload)
+	{
+		for (;;) {
+			sl_uint8* b = (sl_uint8*)(buffer.getData());
+			if (sizeBuffer >= 2) {
+				sl_size sizeHeader = 2;
+				sl_uint64 len = b[1] & 0x7f;
+				if (len == 126) {
+					sizeHeader = 4;
+				} else if (len == 127) {
+					sizeHeader = 10;
+				}
+				if (sizeBuffer >= sizeHeader) {
+					if (len == 126) {
+						len = MIO::readUint16BE(b + 2);
+					} else if (len == 127) {
+						len = MIO::readUint64BE(b + 2);
+					}
+					if (sizeBuffer >= sizeHeader + len) {
+						opcode = (WebSocketOpcode)(b[0] & 0x0f);
+						flagFinal = (b[0] & 0x80) != 0;
+						flagCompressed = (b[0] & 0x40) != 0;
+						payload = Memory::create(b + sizeHeader, (sl_size)len);
+						sl_size sizeFrame = sizeHeader + (sl_size)len;
+						Base::moveMemory(b, b + sizeFrame, sizeBuffer - sizeFrame);
+						sizeBuffer -= sizeFrame;
+						return sl_true;
+					}
+				}
+			}
+			if (sizeBuffer == buffer.getSize()) {
+				return sl_false;
+			}
+			sl_int32 n = socket->receive(b + sizeBuffer, (sl_uint32)(buffer.getSize() - sizeBuffer));
+			if (n <= 0) {
+				return sl_false;
+			}
+			sizeBuffer += n;
+		}
+	}
+
+	// reads the data frames of one message (the control frames are collected to `controls`)
+	sl_bool readMessage(WebSocketOpcode& opcode, Memory& data, List<String>* controls = sl_null)
+	{
+		MemoryBuffer buf;
+		sl_bool flagStarted = sl_false;
+		sl_bool flagCompressedMessage = sl_false;
+		for (;;) {
+			WebSocketOpcode op;
+			sl_bool flagFinal, flagCompressed;
+			Memory payload;
+			if (!(readFrame(op, flagFinal, flagCompressed, payload))) {
+				return sl_false;
+			}
+			if ((sl_uint32)op & 8) {
+				if (controls) {
+					controls->add(String::format("%d:%s", (sl_uint32)op, String((const char*)(payload.getData()), payload.getSize())));
+				}
+				continue;
+			}
+			if (!flagStarted) {
+				opcode = op;
+				flagCompressedMessage = flagCompressed;
+				flagStarted = sl_true;
+			}
+			buf.add(payload);
+			if (flagFinal) {
+				break;
+			}
+		}
+		data = buf.merge();
+		flagLastCompressed = flagCompressedMessage;
+		if (flagCompressedMessage) {
+			static const sl_uint8 tail[4] = { 0, 0, 0xff, 0xff };
+			MemoryBuffer input;
+			input.add(data);
+			input.add(Memory::create(tail, 4));
+			Memory m = input.merge();
+			data = inflater.decompress(m.getData(), m.getSize());
+		}
+		return sl_true;
+	}
+
+	// waits the close frame of the server, then the end of the connection
+	sl_bool readClose(sl_uint32& code)
+	{
+		for (;;) {
+			WebSocketOpcode op;
+			sl_bool flagFinal, flagCompressed;
+			Memory payload;
+			if (!(readFrame(op, flagFinal, flagCompressed, payload))) {
+				return sl_false;
+			}
+			if (op == WebSocketOpcode::Close) {
+				code = payload.getSize() >= 2 ? MIO::readUint16BE(payload.getData()) : 0;
+				char c;
+				return socket->receive(&c, 1) <= 0;
+			}
+		}
+	}
+
+};
+
+static Memory MakeText(sl_size size, sl_uint32 seed)
+{
+	Memory mem = Memory::create(size);
+	char* s = (char*)(mem.getData());
+	static const char* words[] = { "alpha ", "beta ", "gamma ", "delta ", "epsilon ", "zeta " };
+	sl_size pos = 0;
+	while (pos < size) {
+		const char* w = words[(pos / 7 + seed) % 6];
+		while (*w && pos < size) {
+			s[pos++] = *(w++);
+		}
+	}
+	return mem;
+}
+
+static Memory MakeBinary(sl_size size)
+{
+	Memory mem = Memory::create(size);
+	Math::randomMemory(mem.getData(), size);
+	return mem;
+}
+
+int main(int argc, const char * argv[])
+{
+	sl_bool flagSuccess = TestMask();
+
+	volatile sl_uint32 nClosed = 0;
+	volatile sl_uint32 codeClosed = 0;
+	HttpServerParam param;
+	param.port = TEST_PORT;
+	param.onRequest = [&](HttpServer*, HttpServerContext* context) {
+		if (!(context->isWebSocketRequest())) {
+			return sl_false;
+		}
+		WebSocketParam wsp;
+		wsp.onMessage = [](WebSocketConnection* connection, WebSocketMessage& message) {
+			if (message.flagText) {
+				connection->sendText(String((const char*)(message.data.getData()), message.data.getSize()));
+			} else {
+				connection->sendBinary(message.data);
+			}
+		};
+		wsp.onClose = [&](WebSocketConnection*, WebSocketCloseCode code, const String&) {
+			codeClosed = (sl_uint32)code;
+			nClosed++;
+		};
+		return context->acceptWebSocket(wsp).isNotNull();
+	};
+	Ref<HttpServer> server = HttpServer::create(param);
+	if (server.isNull()) {
+		printf("FAIL: cannot start the server\n");
+		return 1;
+	}
+
+	// fragmented text with a ping between the fragments, answered before the message
+	{
+		TestClient client;
+		sl_bool flag = client.connect(sl_false) && !(client.flagDeflate);
+		if (flag) {
+			flag = client.sendText("Hello, ", sl_false) && client.sendFrame(WebSocketOpcode::Ping, "p1", 2) && client.sendFrame(WebSocketOpcode::Continuation, "World", 5);
+		}
+		if (flag) {
+			List<String> controls;
+			WebSocketOpcode opcode;
+			Memory data;
+			flag = client.readMessage(opcode, data, &controls) && opcode == WebSocketOpcode::Text && String((char*)(data.getData()), data.getSize()) == "Hello, World";
+			flag = flag && controls.getCount() == 1 && controls.getValueAt(0) == "10:p1";
+		}
+		flagSuccess &= Check("fragmented text with ping", flag);
+
+		// large binary in fragments of the various sizes, across the payload chunks of the server
+		Memory big = MakeBinary(300000);
+		const sl_size sizes[] = { 1, 70000, 65535, 65536, 3, 0 }; // the last is the rest
+		sl_size pos = 0;
+		flag = sl_true;
+		for (sl_uint32 i = 0; flag && i < CountOfArray(sizes); i++) {
+			sl_size n = i + 1 == CountOfArray(sizes) ? big.getSize() - pos : sizes[i];
+			flag = client.sendFrame(i ? WebSocketOpcode::Continuation : WebSocketOpcode::Binary, (sl_uint8*)(big.getData()) + pos, n, i + 1 == CountOfArray(sizes));
+			pos += n;
+		}
+		if (flag) {
+			WebSocketOpcode opcode;
+			Memory data;
+			flag = client.readMessage(opcode, data) && opcode == WebSocketOpcode::Binary && data.getSize() == big.getSize() && Base::equalsMemory(data.getData(), big.getData(), big.getSize());
+		}
+		flagSuccess &= Check("fragmented binary (300000 bytes)", flag);
+
+		// closing handshake
+		sl_uint8 payload[5];
+		MIO::writeUint16BE(payload, 1000);
+		Base::copyMemory(payload + 2, "bye", 3);
+		sl_uint32 code = 0;
+		flag = client.sendFrame(WebSocketOpcode::Close, payload, 5) && client.readClose(code) && code == 1000;
+		for (sl_uint32 i = 0; i < 100 && nClosed < 1; i++) {
+			System::sleep(10);
+		}
+		flagSuccess &= Check("closing handshake", flag && nClosed == 1 && codeClosed == (sl_uint32)(WebSocketCloseCode::Normal));
+	}
+
+	// permessage-deflate: the compressed messages in fragments with the pings between, and the context kept between the messages
+	{
+		TestClient client;
+		sl_bool flag = client.connect(sl_true) && client.flagDeflate;
+		flagSuccess &= Check("permessage-deflate negotiated", flag);
+		for (sl_uint32 i = 0; flag && i < 3; i++) {
+			Memory text = MakeText(20000 + i * 1000, i);
+			flag = client.sendCompressed(WebSocketOpcode::Text, text, 3, sl_true);
+			if (flag) {
+				List<String> controls;
+				WebSocketOpcode opcode;
+				Memory data;
+				flag = client.readMessage(opcode, data, &controls) && opcode == WebSocketOpcode::Text && data.getSize() == text.getSize() && Base::equalsMemory(data.getData(), text.getData(), text.getSize());
+				flag = flag && client.flagLastCompressed && controls.getCount() == 2;
+			}
+		}
+		// uncompressed message on the same connection, and the small message sent back uncompressed
+		if (flag) {
+			WebSocketOpcode opcode;
+			Memory data;
+			flag = client.sendText("short") && client.readMessage(opcode, data) && !(client.flagLastCompressed) && String((char*)(data.getData()), data.getSize()) == "short";
+		}
+		flagSuccess &= Check("compressed messages", flag);
+		sl_uint8 payload[2];
+		MIO::writeUint16BE(payload, 1000);
+		sl_uint32 code = 0;
+		flagSuccess &= Check("closing handshake (deflate)", client.sendFrame(WebSocketOpcode::Close, payload, 2) && client.readClose(code) && code == 1000);
+	}
+
+	// protocol errors: closed by 1002
+	{
+		TestClient client;
+		sl_uint32 code = 0;
+		sl_bool flag = client.connect(sl_false) && client.sendFrame(WebSocketOpcode::Text, "unmasked", 8, sl_true, sl_false, sl_false) && client.readClose(code) && code == 1002;
+		flagSuccess &= Check("unmasked frame", flag);
+	}
+	{
+		TestClient client;
+		sl_uint32 code = 0;
+		sl_bool flag = client.connect(sl_false) && client.sendFrame(WebSocketOpcode::Ping, "x", 1, sl_false) && client.readClose(code) && code == 1002;
+		flagSuccess &= Check("fragmented control frame", flag);
+	}
+	{
+		TestClient client;
+		sl_uint32 code = 0;
+		sl_bool flag = client.connect(sl_false) && client.sendFrame(WebSocketOpcode::Continuation, "x", 1) && client.readClose(code) && code == 1002;
+		flagSuccess &= Check("continuation without the message", flag);
+	}
+
+	server->release();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
@@ -0,0 +1,234 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include <slib.h>
+
+#include <stdio.h>
+
+using namespace slib;
+
+/*
+	Measures the loopback throughput of `AsyncTcpSocket` with and without
+	zero-copy writes, then closes a socket while zero-copy writes are waiting
+	for the kernel and checks that every write is completed
+*/
+
+#define TEST_PORT 18233
+#define WRITE_SIZE (4 << 20)
+#define WRITE_COUNT 200
+#define WRITES_IN_FLIGHT 4
+#define PENDING_WRITE_SIZE (64 << 10)
+#define PENDING_WRITE_COUNT 64
+
+static Ref<Socket> Listen()
+{
+	Ref<Socket> server = Socket::openTcp();
+	if (server.isNull()) {
+		return sl_null;
+	}
+	server->setOption_ReuseAddress(sl_true);
+	if (!(server->bind(SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT)))) {
+		return sl_null;
+	}
+	if (!(server->listen())) {
+		return sl_null;
+	}
+	return server;
+}
+
+static Ref<Socket> Accept(const Ref<Socket>& server)
+{
+	Ref<Socket> client;
+	SocketAddress address;
+	for (sl_uint32 i = 0; i < 5000; i++) {
+		if (server->accept(client, address)) {
+			client->setNonBlockingMode(sl_false);
+			return client;
+		}
+		System::sleep(1);
+	}
+	return sl_null;
+}
+
+static sl_bool TestThroughput(const Ref<AsyncIoLoop>& loop, sl_uint32 threshold)
+{
+	Ref<Socket> server = Listen();
+	if (server.isNull()) {
+		printf("FAIL: cannot listen\n");
+		return sl_false;
+	}
+	volatile sl_uint64 sizeReceived = 0;
+	Ref<Thread> thread = Thread::start([server, &sizeReceived]() {
+		Ref<Socket> client = Accept(server);
+		if (client.isNull()) {
+			return;
+		}
+		Memory buf = Memory::create(1 << 20);
+		for (;;) {
+			sl_int32 n = client->receive(buf.getData(), (sl_uint32)(buf.getSize()));
+			if (n <= 0) {
+				break;
+			}
+			sizeReceived += n;
+		}
+	});
+
+	Memory mem = Memory::create(WRITE_SIZE);
+	Base::zeroMemory(mem.getData(), WRITE_SIZE);
+	volatile sl_uint32 nIssued = 0;
+	volatile sl_uint32 nDone = 0;
+	volatile sl_bool flagError = sl_false;
+	Ref<Event> event = Event::create();
+	Function<void(AsyncStreamResult*)> onWrite;
+	onWrite = [&](AsyncStreamResult* result) {
+		if (result->flagError) {
+			flagError = sl_true;
+			event->set();
+			return;
+		}
+		nDone++;
+		if (nIssued < WRITE_COUNT) {
+			nIssued++;
+			((AsyncTcpSocket*)(result->stream))->send(mem, onWrite);
+		}
+		if (nDone == WRITE_COUNT) {
+			event->set();
+		}
+	};
+	sl_uint64 timeStart = 0;
+	AsyncTcpSocketParam param;
+	param.ioLoop = loop;
+	param.zeroCopyThreshold = threshold;
+	param.connectAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	param.onConnect = [&](AsyncTcpSocket* socket, const SocketAddress&, sl_bool flagConnectError) {
+		if (flagConnectError) {
+			flagError = sl_true;
+			event->set();
+			return;
+		}
+		timeStart = System::getTickCount();
+		for (sl_uint32 i = 0; i < WRITES_IN_FLIGHT; i++) {
+			nIssued++;
+			socket->send(mem, onWrite);
+		}
+	};
+	Ref<AsyncTcpSocket> socket = AsyncTcpSocket::create(param);
+	if (socket.isNull()) {
+		printf("FAIL: cannot create the socket\n");
+		return sl_false;
+	}
+	sl_bool flagZeroCopy = threshold && socket->getSocket()->getOption_ZeroCopy();
+	event->wait(60000);
+	sl_uint64 dt = System::getTickCount() - timeStart;
+	socket->close();
+	thread->finishAndWait(5000);
+	server->close();
+
+	if (flagError || nDone != WRITE_COUNT) {
+		printf("FAIL: zerocopy=%d completed %u/%u writes, error=%d\n", (int)flagZeroCopy, nDone, WRITE_COUNT, (int)flagError);
+		return sl_false;
+	}
+	if (sizeReceived != (sl_uint64)WRITE_SIZE * WRITE_COUNT) {
+		printf("FAIL: zerocopy=%d received %u MB\n", (int)flagZeroCopy, (sl_uint32)(sizeReceived >> 20));
+		return sl_false;
+	}
+	if (!dt) {
+		dt = 1;
+	}
+	printf("zerocopy=%d: %.2f GB/s\n", (int)flagZeroCopy, (double)WRITE_SIZE * WRITE_COUNT / 1e9 / ((double)dt / 1000));
+	return sl_true;
+}
+
+static sl_bool TestCloseWithPendingWrites(const Ref<AsyncIoLoop>& loop)
+{
+	Ref<Socket> server = Listen();
+	if (server.isNull()) {
+		printf("FAIL: cannot listen\n");
+		return sl_false;
+	}
+	Memory mem = Memory::create(PENDING_WRITE_SIZE);
+	Base::zeroMemory(mem.getData(), PENDING_WRITE_SIZE);
+	volatile sl_uint32 nCompleted = 0;
+	volatile sl_uint32 nFailed = 0;
+	auto onWrite = [&](AsyncStreamResult* result) {
+		nCompleted++;
+		if (result->flagError) {
+			nFailed++;
+		}
+	};
+	AsyncTcpSocketParam param;
+	param.ioLoop = loop;
+	param.zeroCopyThreshold = 1;
+	param.connectAddress = SocketAddress(IPv4Address(127, 0, 0, 1), TEST_PORT);
+	param.onConnect = [&](AsyncTcpSocket* socket, const SocketAddress&, sl_bool flagConnectError) {
+		for (sl_uint32 i = 0; i < PENDING_WRITE_COUNT; i++) {
+			socket->send(mem, onWrite);
+		}
+	};
+	Ref<AsyncTcpSocket> socket = AsyncTcpSocket::create(param);
+	if (socket.isNull()) {
+		printf("FAIL: cannot create the socket\n");
+		return sl_false;
+	}
+	if (!(socket->getSocket()->getOption_ZeroCopy())) {
+		printf("zero-copy is not supported, skipping the close test\n");
+		socket->close();
+		return sl_true;
+	}
+	// the peer does not read, so the written data stays in the send queue of the kernel and the zero-copy notifications do not arrive
+	Ref<Socket> peer = Accept(server);
+	System::sleep(500);
+	sl_uint32 nCompletedBeforeClose = nCompleted;
+	socket->close();
+	System::sleep(500);
+	server->close();
+
+	// the writes handed to the kernel must be failed by closing
+	sl_uint32 nCompletedByClose = nCompleted - nCompletedBeforeClose;
+	if (!nCompletedByClose || nFailed != nCompletedByClose) {
+		printf("FAIL: %u writes are completed by closing (%u failed)\n", nCompletedByClose, nFailed);
+		return sl_false;
+	}
+	printf("close: %u writes failed\n", nFailed);
+	return sl_true;
+}
+
+int main(int argc, const char * argv[])
+{
+	Ref<AsyncIoLoop> loop = AsyncIoLoop::create();
+	sl_bool flagSuccess = sl_true;
+	if (!(TestThroughput(loop, 0))) {
+		flagSuccess = sl_false;
+	}
+	if (!(TestThroughput(loop, 65536))) {
+		flagSuccess = sl_false;
+	}
+	if (!(TestCloseWithPendingWrites(loop))) {
+		flagSuccess = sl_false;
+	}
+	loop->release();
+	if (flagSuccess) {
+		printf("PASS\n");
+		return 0;
+	}
+	return 1;
+}
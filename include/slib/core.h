@@ -93,6 +93,7 @@
 #include "core/io.h"
 #include "core/file.h"
 #include "core/pipe.h"
+#include "core/shared_memory_channel.h"
 #include "core/async.h"
 #include "core/dispatch.h"
 #include "core/dispatch_loop.h"
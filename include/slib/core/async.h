@@ -86,10 +86,18 @@ namespace slib
 
 		sl_bool dispatch(const Function<void()>& callback, sl_uint64 delay_ms) override;
 
+		// runs `task` in the loop thread after `delay_ms`. The timers are kept in a timing wheel of the loop, so they are cheap enough to be used per connection
+		sl_bool setTimeout(const Function<void()>& task, sl_uint32 delay_ms);
+
+		// number of the instances attached to this loop
+		sl_uint32 getInstanceCount();
+
 	protected:
 		sl_bool m_flagInit;
 		sl_bool m_flagRunning;
 		void* m_handle;
+		sl_int32 m_nInstances;
+		void* m_timers;
 
 		Ref<Thread> m_thread;
 
@@ -111,6 +119,61 @@ namespace slib
 		void _stepBegin();
 		void _stepEnd();
 	
+		void _processTimers();
+
+		// returns -1 if there is no timer, otherwise the milliseconds until the nearest timer is due
+		sl_int32 _getTimerWaitTimeout();
+
+		void _detachInstance(AsyncIoInstance* instance);
+	
+		friend class AsyncIoObject;
+	};
+	
+	enum class AsyncIoLoopBalancing
+	{
+		RoundRobin = 0,
+		LeastLoaded = 1
+	};
+	
+	class SLIB_EXPORT AsyncIoLoopGroup : public Object
+	{
+		SLIB_DECLARE_OBJECT
+		
+	private:
+		AsyncIoLoopGroup();
+		
+		~AsyncIoLoopGroup();
+		
+	public:
+		// `count`=0: number of the processors
+		static Ref<AsyncIoLoopGroup> create(sl_uint32 count = 0, sl_bool flagAutoStart = sl_true);
+		
+	public:
+		void release();
+		
+		void start();
+		
+		sl_uint32 getCount();
+		
+		Ref<AsyncIoLoop> getLoop(sl_uint32 index);
+		
+		AsyncIoLoopBalancing getBalancing();
+		
+		void setBalancing(AsyncIoLoopBalancing balancing);
+		
+		// returns the loop for a new connection by the balancing policy
+		Ref<AsyncIoLoop> selectLoop();
+		
+		Ref<AsyncIoLoop> getNextLoop();
+		
+		// the loop having the least attached instances
+		Ref<AsyncIoLoop> getLeastLoadedLoop();
+		
+	protected:
+		Array< Ref<AsyncIoLoop> > m_loops;
+		AsyncIoLoopBalancing m_balancing;
+		sl_reg m_indexNext;
+		
 	};
 	
 	
@@ -178,6 +241,7 @@ namespace slib
 		AsyncIoMode m_mode;
 	
 		sl_bool m_flagClosing;
+		sl_bool m_flagAttached;
 
 		sl_bool m_flagOrdering;
 		Mutex m_lockOrdering;
@@ -202,6 +266,12 @@ namespace slib
 
 		void closeIoInstance();
 	
+		/*
+			Moves the I/O instance to `loop`. The instance is detached in the thread of the current loop and attached to the new loop.
+			Use it only while no I/O request is running on the object (for example, just after accepting a connection).
+		*/
+		sl_bool moveToLoop(const Ref<AsyncIoLoop>& loop);
+	
 
 		Variant getUserData();
 
@@ -256,6 +326,9 @@ namespace slib
 	public:
 		void runCallback(AsyncStream* stream, sl_uint32 resultSize, sl_bool flagError);
 
+		// bytes counted in the waiting size of the write queue
+		virtual sl_uint64 getWriteSize();
+
 	};
 	
 	
@@ -279,8 +352,13 @@ namespace slib
 
 		virtual sl_uint64 getSize();
 
+		virtual sl_bool sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64 sizeSent, sl_bool flagError)>& callback);
+
 		sl_size getWaitingSizeForWrite();
 
+		// fails the pending requests (called in the loop thread)
+		virtual void cancelRequests();
+
 	protected:
 		sl_bool addReadRequest(const Ref<AsyncStreamRequest>& request);
 
@@ -301,6 +379,13 @@ namespace slib
 
 	};
 	
+	enum class AsyncStreamTimeout
+	{
+		Read = 1,
+		Write = 2,
+		Idle = 3
+	};
+	
 	class SLIB_EXPORT AsyncStream : public AsyncIoObject
 	{
 		SLIB_DECLARE_OBJECT
@@ -334,8 +419,29 @@ namespace slib
 	
 		sl_bool writeFromMemory(const Memory& mem, const Function<void(AsyncStreamResult*)>& callback);
 
+		// zero-copy transfer of the file region (returns false when the stream does not support it)
+		virtual sl_bool sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64 sizeSent, sl_bool flagError)>& callback);
+
 		virtual sl_bool addTask(const Function<void()>& callback) = 0;
 
+		// returns false while the pending write size is over the high watermark (producers should pause)
+		virtual sl_bool isWritable();
+
+		// `callback` is called once when the stream becomes writable. returns false if the stream is already writable
+		virtual sl_bool notifyWhenWritable(const Function<void()>& callback);
+
+		/*
+			Timeouts in milliseconds (0: disabled), returns false if the stream does not support timeouts.
+			Read/Write: a pending request is not completed for `timeout`
+			Idle: no request is completed for `timeout`
+			On timeout, the stream is closed (pending requests are failed) unless `onTimeout` is set.
+		*/
+		virtual sl_bool setReadTimeout(sl_uint32 timeout);
+
+		virtual sl_bool setWriteTimeout(sl_uint32 timeout);
+
+		virtual sl_bool setIdleTimeout(sl_uint32 timeout);
+
 	};
 	
 	class SLIB_EXPORT AsyncStreamBase : public AsyncStream
@@ -362,15 +468,89 @@ namespace slib
 
 		sl_uint64 getSize() override;
 
+		sl_bool sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64 sizeSent, sl_bool flagError)>& callback) override;
+
 		sl_bool addTask(const Function<void()>& callback) override;
 
 		sl_size getWaitingSizeForWrite();
-	
+
+	public:
+		// `highWatermark`=0 disables the limit, `lowWatermark` defaults to the half of `highWatermark`
+		void setWriteWatermarks(sl_size highWatermark, sl_size lowWatermark = 0);
+
+		sl_size getWriteHighWatermark();
+
+		sl_size getWriteLowWatermark();
+
+		// size of the written data which is not completed yet
+		sl_size getPendingWriteSize();
+
+		sl_bool isWritable() override;
+
+		sl_bool notifyWhenWritable(const Function<void()>& callback) override;
+
+		void setOnWritable(const Function<void(AsyncStream*)>& callback);
+
+		void setOnDrain(const Function<void(AsyncStream*)>& callback);
+
+	public:
+		sl_bool setReadTimeout(sl_uint32 timeout) override;
+
+		sl_bool setWriteTimeout(sl_uint32 timeout) override;
+
+		sl_bool setIdleTimeout(sl_uint32 timeout) override;
+
+		sl_uint32 getReadTimeout();
+
+		sl_uint32 getWriteTimeout();
+
+		sl_uint32 getIdleTimeout();
+
+		// replaces the default action (closing the stream). The timer restarts after `callback` returns
+		void setOnTimeout(const Function<void(AsyncStream*, AsyncStreamTimeout)>& callback);
+
 	protected:
 		Ref<AsyncStreamInstance> getIoInstance();
 
 		sl_bool _initialize(AsyncStreamInstance* instance, AsyncIoMode mode, const Ref<AsyncIoLoop>& loop);
+
+		void _onWriteCompleted(sl_uint64 size);
 	
+		sl_bool _isTimeoutEnabled();
+
+		void _onRequestStarted(sl_bool flagRead);
+
+		void _onRequestCompleted(sl_bool flagRead);
+
+		void _scheduleTimeoutCheck(sl_uint32 delay);
+
+		void _onTimeoutCheck(sl_uint32 id);
+
+		void _checkTimeouts();
+
+
+	protected:
+		sl_reg m_sizeWritePending;
+		sl_size m_sizeWriteHighWatermark;
+		sl_size m_sizeWriteLowWatermark;
+		sl_bool m_flagWritingPaused;
+		AtomicFunction<void(AsyncStream*)> m_onWritable;
+		AtomicFunction<void(AsyncStream*)> m_onDrain;
+		LinkedQueue< Function<void()> > m_queueWritableCallbacks;
+
+		sl_uint32 m_timeoutRead;
+		sl_uint32 m_timeoutWrite;
+		sl_uint32 m_timeoutIdle;
+		sl_int32 m_nReadsPending;
+		sl_int32 m_nWritesPending;
+		sl_uint32 m_tickRead; // start or last progress of the pending reads
+		sl_uint32 m_tickWrite; // start or last progress of the pending writes
+		sl_uint32 m_tickActive;
+		sl_bool m_flagTimeoutChecking;
+		sl_uint32 m_tickTimeoutCheck;
+		sl_uint32 m_idTimeoutCheck;
+		AtomicFunction<void(AsyncStream*, AsyncStreamTimeout)> m_onTimeout;
+
 		friend class AsyncStream;
 
 	};
@@ -492,6 +672,9 @@ namespace slib
 
 		static Ref<AsyncFile> create(const Ref<File>& file, const Ref<Dispatcher>& dispatcher);
 
+		// the requests use positional I/O starting at `offset`, and don't change the position of `file`, so the opened file can be shared by several streams
+		static Ref<AsyncFile> createShared(const Ref<File>& file, sl_uint64 offset, const Ref<Dispatcher>& dispatcher);
+
 
 		static Ref<AsyncFile> open(const String& path, FileMode mode);
 	
@@ -532,12 +715,16 @@ namespace slib
 	
 	public:
 		Ref<File> getFile();
+
+		sl_uint64 getPosition();
 	
 	protected:
 		void processRequest(AsyncStreamRequest* request) override;
 	
 	private:
 		AtomicRef<File> m_file;
+		sl_bool m_flagShared;
+		sl_uint64 m_position;
 
 	};
 	
@@ -555,6 +742,7 @@ namespace slib
 		sl_uint32 bufferSize; // default: 0x10000
 		sl_uint32 bufferCount; // default: 8
 		sl_bool flagAutoStart; // default: true
+		sl_bool flagUseSendFile; // default: true, transfers file source by `AsyncStream::sendFile` when `onRead` is not set
 
 		Function<Memory(AsyncCopy*, const Memory& input)> onRead;
 		Function<void(AsyncCopy*)> onWrite;
@@ -612,6 +800,12 @@ namespace slib
 		void onReadStream(AsyncStreamResult* result);
 
 		void onWriteStream(AsyncStreamResult* result);
+
+		void onSendFile(AsyncStream* stream, sl_uint64 sizeSent, sl_bool flagError);
+
+		void onTargetWritable();
+
+		sl_bool _startSendFile();
 	
 		void enqueue();
 		
@@ -635,6 +829,9 @@ namespace slib
 		sl_bool m_flagStarted;
 		sl_bool m_flagRunning;
 		sl_bool m_flagEnqueue;
+		sl_bool m_flagUseSendFile;
+		sl_bool m_flagSendingFile;
+		sl_bool m_flagWaitingTarget;
 	
 		class Buffer : public Referable
 		{
@@ -709,9 +906,13 @@ namespace slib
 		sl_bool copyFromFile(const String& path, const Ref<Dispatcher>& dispatcher);
 
 		sl_uint64 getOutputLength() const;
+
+		// merges the output into one memory, which is kept as the only element of the output (shared, not copied again). Returns sl_false when the output contains a stream
+		sl_bool mergeOutput(Memory& output);
 	
 	protected:
 		sl_uint64 m_lengthOutput;
+		sl_uint64 m_sizeBufferedMemory;
 		LinkedQueue< Ref<AsyncOutputBufferElement> > m_queueOutput;
 
 		friend class AsyncOutput;
@@ -727,8 +928,13 @@ namespace slib
 		// optional
 		sl_uint32 bufferSize;
 		sl_uint32 bufferCount;
+		sl_bool flagUseSendFile; // default: true
+		sl_size highWatermark; // default: 0 (unlimited), limit of the buffered memory size
+		sl_size lowWatermark; // default: half of `highWatermark`
 
 		Function<void(AsyncOutput*, sl_bool flagError)> onEnd;
+		Function<void(AsyncOutput*)> onWritable; // called when the buffered size falls to `lowWatermark` after exceeding `highWatermark`
+		Function<void(AsyncOutput*)> onDrain; // called when all the queued output is written
 
 	public:
 		AsyncOutputParam();
@@ -756,6 +962,11 @@ namespace slib
 
 		void close();
 
+		// buffered memory size which is not written yet
+		sl_uint64 getBufferedSize();
+
+		sl_bool isWritable();
+
 	private:
 		void onAsyncCopyEnd(AsyncCopy* task, sl_bool flagError);
 		
@@ -768,12 +979,20 @@ namespace slib
 
 		void _write(sl_bool flagCompleted);
 
+		void _onWritten(sl_uint64 size);
+
 	protected:
 		Ref<AsyncStream> m_streamOutput;
 		sl_uint32 m_bufferSize;
 		sl_uint32 m_bufferCount;
+		sl_bool m_flagUseSendFile;
+		sl_size m_sizeHighWatermark;
+		sl_size m_sizeLowWatermark;
+		sl_bool m_flagWritingPaused;
 	
 		Function<void(AsyncOutput*, sl_bool)> m_onEnd;
+		Function<void(AsyncOutput*)> m_onWritable;
+		Function<void(AsyncOutput*)> m_onDrain;
 
 		Ref<AsyncOutputBufferElement> m_elementWriting;
 		Ref<AsyncCopy> m_copy;
@@ -785,6 +1004,8 @@ namespace slib
 	
 	
 #define SLIB_ASYNC_STREAM_FILTER_DEFAULT_BUFFER_SIZE 16384
+// read requests of this size or larger are filled by reading the source stream directly into the request buffer
+#define SLIB_ASYNC_STREAM_FILTER_MIN_IN_PLACE_READ_SIZE 4096
 	
 	class SLIB_EXPORT AsyncStreamFilter : public AsyncStream
 	{
@@ -830,6 +1051,17 @@ namespace slib
 
 		sl_bool isWritingEnded();
 	
+	public:
+		/*
+			Zero-copy contract of the filters: adds the transformed data to `output` as slices.
+			The slices may reference `data` (kept alive by `userObject`), and a read filter may overwrite `data` in place when its output is not longer than the input.
+			The source data of a read may be placed in the buffer of the caller's read request, so the slices referencing `data` should not be kept after the call except in `output`.
+			The default implementations add the result of `filterRead()` and `filterWrite()`.
+		*/
+		virtual void transformRead(void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output);
+
+		virtual void transformWrite(const void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output);
+
 	protected:
 		virtual Memory filterRead(void* data, sl_uint32 size, Referable* userObject);
 
@@ -856,6 +1088,7 @@ namespace slib
 		sl_bool m_flagReadingError;
 		sl_bool m_flagReadingEnded;
 		AtomicMemory m_memReading;
+		Ref<AsyncStreamRequest> m_requestReadingInPlace;
 	
 		Mutex m_lockWriting;
 		sl_bool m_flagWritingError;
@@ -866,12 +1099,42 @@ namespace slib
 
 		void _closeAllReadRequests();
 	
+		sl_uint32 _completeReadInPlace(AsyncStreamRequest* request, void* data, sl_uint32 size, Referable* userObject);
+
 	protected:
 		virtual void onReadStream(AsyncStreamResult* result);
 	
 		virtual void onWriteStream(AsyncStreamResult* result);
 
 	};
+	
+	// passes the data through the filters in order when reading, and in reverse order when writing, without the intermediate buffers of the stacked streams
+	class SLIB_EXPORT AsyncStreamFilterChain : public AsyncStreamFilter
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		AsyncStreamFilterChain();
+
+		~AsyncStreamFilterChain();
+
+	public:
+		// the filters are used only for their transforms, so they should not have any source stream
+		static Ref<AsyncStreamFilterChain> create(const Ref<AsyncStream>& source, const List< Ref<AsyncStreamFilter> >& filters);
+
+	public:
+		void addFilter(const Ref<AsyncStreamFilter>& filter);
+
+		List< Ref<AsyncStreamFilter> > getFilters();
+
+		void transformRead(void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output) override;
+
+		void transformWrite(const void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output) override;
+
+	protected:
+		CList< Ref<AsyncStreamFilter> > m_filters;
+
+	};
 
 }
 
@@ -170,6 +170,14 @@ namespace slib
 
 		sl_int32 write32(const void* buf, sl_uint32 size) override;
 	
+
+		// positional I/O: the file position is not used and not changed (on Unix), so the opened file can be shared by several readers
+		sl_int32 readAt32(sl_uint64 offset, void* buf, sl_uint32 size);
+
+		sl_int32 writeAt32(sl_uint64 offset, const void* buf, sl_uint32 size);
+
+		sl_reg readAt(sl_uint64 offset, void* buf, sl_size size);
+	
 	
 		// works only if the file is already opened
 		sl_bool setSize(sl_uint64 size) override;
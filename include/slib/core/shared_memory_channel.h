@@ -0,0 +1,208 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_CORE_SHARED_MEMORY_CHANNEL
+#define CHECKHEADER_SLIB_CORE_SHARED_MEMORY_CHANNEL
+
+#include "definition.h"
+
+#include "async.h"
+
+/*
+	Message channel between the processes on the same host, on a ring buffer in the shared memory.
+
+	- The messages are copied into the ring without system calls, and the reader gets the views into the ring.
+	- One reader and one writer by default, or several writers reserving the space lock-free (`flagMultipleProducers`).
+	- The writers make a system call only when the reader is waiting: the threads wait on a futex, and `AsyncSharedMemoryChannel` waits on the event handle (eventfd for the anonymous channel, FIFO for the named channel) in `AsyncIoLoop`.
+
+	Implemented on Linux.
+*/
+
+namespace slib
+{
+
+	class SLIB_EXPORT SharedMemoryChannelParam
+	{
+	public:
+		// optional, name of the shared memory object (`shm_open`). If it is empty, an anonymous memory (`memfd_create`) is used, and it is shared with the child processes by inheriting `getHandle()` and `getEventHandle()`
+		String name;
+		sl_bool flagCreate; // default: true, opens the existing channel if false
+		sl_uint32 capacity; // default: 1MB, size of the ring (rounded up to a power of 2) on creation
+		sl_bool flagMultipleProducers; // default: false, allows several writers on creation
+
+		// used to open an inherited anonymous channel (`flagCreate` is false and `name` is empty)
+		sl_file handle;
+		sl_file eventHandle;
+
+	public:
+		SharedMemoryChannelParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(SharedMemoryChannelParam)
+
+	};
+
+	class SLIB_EXPORT SharedMemoryChannel : public Object
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		SharedMemoryChannel();
+
+		~SharedMemoryChannel();
+
+	public:
+		static Ref<SharedMemoryChannel> create(const SharedMemoryChannelParam& param);
+
+		// anonymous channel
+		static Ref<SharedMemoryChannel> create(sl_uint32 capacity = 0, sl_bool flagMultipleProducers = sl_false);
+
+		static Ref<SharedMemoryChannel> create(const String& name, sl_uint32 capacity = 0, sl_bool flagMultipleProducers = sl_false);
+
+		static Ref<SharedMemoryChannel> open(const String& name);
+
+		static void remove(const String& name);
+
+	public:
+		void close();
+
+		sl_bool isOpened();
+
+		sl_file getHandle();
+
+		sl_file getEventHandle();
+
+		sl_uint32 getCapacity();
+
+		sl_uint32 getMaxMessageSize();
+
+		sl_bool isMultipleProducers();
+
+		// returns `sl_false` if the ring is full or `size` exceeds `getMaxMessageSize()`
+		sl_bool write(const void* data, sl_uint32 size);
+
+		sl_bool write(const Memory& mem);
+
+		// returns the view of the first message in the ring, valid until `pop()` is called
+		void* peek(sl_uint32& size);
+
+		// the returned memory refers the ring (not copied), and its content is valid until `pop()` is called
+		Memory peek();
+
+		// removes the first message
+		sl_bool pop();
+
+		// returns the copy of the first message and removes it
+		Memory read();
+
+		sl_bool isEmpty();
+
+		// a record in the ring was out of bounds (corrupted by the peer): no message is read anymore
+		sl_bool isBroken();
+
+		// waits on the futex until a message is written. `timeout`: milliseconds, negative means infinite
+		sl_bool wait(sl_int32 timeout = -1);
+
+	public:
+		// used by the asynchronous reader: requests the notification on `getEventHandle()`, and returns `sl_false` if a message is already available
+		sl_bool requestEvent();
+
+		// used by the asynchronous reader: consumes the notification on `getEventHandle()`
+		void clearEvent();
+
+	protected:
+		void* _peek(sl_uint32& size, sl_bool flagPop);
+
+		void _notify();
+
+	protected:
+		void* m_header;
+		sl_uint8* m_ring;
+		sl_uint32 m_capacity;
+		sl_size m_sizeMapped;
+		sl_bool m_flagMultipleProducers;
+		sl_bool m_flagBroken;
+
+		sl_file m_handle;
+		sl_file m_handleEvent;
+		sl_bool m_flagEventFd;
+
+	};
+
+	class AsyncSharedMemoryChannel;
+
+	class SLIB_EXPORT AsyncSharedMemoryChannelParam
+	{
+	public:
+		Ref<SharedMemoryChannel> channel;
+
+		// optional
+		Ref<AsyncIoLoop> ioLoop;
+		sl_bool flagAutoStart; // default: true
+
+		// `data` is the view into the ring, valid in the callback
+		Function<void(AsyncSharedMemoryChannel*, void* data, sl_uint32 size)> onReceive;
+
+	public:
+		AsyncSharedMemoryChannelParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(AsyncSharedMemoryChannelParam)
+
+	};
+
+	// reads the messages of `SharedMemoryChannel` in `AsyncIoLoop`
+	class SLIB_EXPORT AsyncSharedMemoryChannel : public AsyncIoObject
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		AsyncSharedMemoryChannel();
+
+		~AsyncSharedMemoryChannel();
+
+	public:
+		static Ref<AsyncSharedMemoryChannel> create(const AsyncSharedMemoryChannelParam& param);
+
+	public:
+		void close();
+
+		sl_bool isOpened();
+
+		void start();
+
+		sl_bool isRunning();
+
+		Ref<SharedMemoryChannel> getChannel();
+
+	protected:
+		void _onReceive(void* data, sl_uint32 size);
+
+	protected:
+		Ref<SharedMemoryChannel> m_channel;
+		Function<void(AsyncSharedMemoryChannel*, void* data, sl_uint32 size)> m_onReceive;
+
+		friend class _priv_AsyncSharedMemoryChannelInstance;
+
+	};
+
+}
+
+#endif
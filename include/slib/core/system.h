@@ -59,6 +59,9 @@ namespace slib
 		static sl_uint32 getProcessId();
 
 		static sl_uint32 getThreadId();
+		
+		// number of the online logical processors
+		static sl_uint32 getProcessorCount();
 
 		static sl_bool createProcess(const String& pathExecutable, const String* command, sl_uint32 nCommands);
 
@@ -91,8 +91,30 @@ namespace slib
 	
 		Memory compress(const void* data, sl_size size, sl_bool flagFinish);
 	
+		/*
+			compresses the input and flushes all the pending output to a byte boundary (sync flush), without finishing the stream.
+			The flushed output ends with an empty stored block (00 00 FF FF)
+		*/
+		sl_int32 flush(
+			const void* input, sl_uint32 sizeInputAvailable, sl_uint32& sizeInputPassed,
+			void* output, sl_uint32 sizeOutputAvailable, sl_uint32& sizeOutputUsed);
+	
+		Memory flush(const void* data, sl_size size);
+	
+		/*
+			restarts the stream with the same format and level, reusing the state allocated by `start` (no reallocation).
+			The state of the finished stream is kept until `abort` is called, so that the compressor can be pooled
+		*/
+		sl_bool reset();
+	
 		void abort();
 	
+	private:
+		sl_int32 _compress(
+			const void* input, sl_uint32 sizeInputAvailable, sl_uint32& sizeInputPassed,
+			void* output, sl_uint32 sizeOutputAvailable, sl_uint32& sizeOutputUsed,
+			sl_int32 flush);
+	
 	private:
 		sl_uint8 m_stream[128]; // bigger than sizeof(z_stream)
 
@@ -101,6 +123,7 @@ namespace slib
 		String m_gzipComment;
 	
 		sl_bool m_flagStarted;
+		sl_bool m_flagFinished;
 
 	};
 	
@@ -34,6 +34,8 @@ namespace slib
 
 	class AsyncTcpSocket;
 	class AsyncTcpSocketInstance;
+	class AsyncTcpSocketSendFileRequest;
+	class DnsClient;
 	
 	class SLIB_EXPORT AsyncTcpSocketParam
 	{
@@ -44,7 +46,12 @@ namespace slib
 		SocketAddress connectAddress;
 		sl_bool flagIPv6; // default: false
 		sl_bool flagLogError; // default: true
+		sl_uint32 zeroCopyThreshold; // default: 0 (disabled), writes of this size or larger are sent without copying (MSG_ZEROCOPY on Linux)
 		Ref<AsyncIoLoop> ioLoop;
+		Ref<DnsClient> dnsClient; // used by `connectHost()`, default: `DnsClient::getDefault()`
+		sl_uint32 readTimeout; // default: 0 (disabled), see `AsyncStream::setReadTimeout()`
+		sl_uint32 writeTimeout; // default: 0 (disabled)
+		sl_uint32 idleTimeout; // default: 0 (disabled)
 		
 		Function<void(AsyncTcpSocket*, const SocketAddress&, sl_bool)> onConnect;
 		Function<void(AsyncTcpSocket*)> onError;
@@ -73,6 +80,13 @@ namespace slib
 		
 		sl_bool connect(const SocketAddress& address);
 		
+		/*
+			Resolves `host` without blocking (see `DnsClient::resolveHost`), and connects to the resolved addresses.
+			IPv6 and IPv4 addresses are tried alternately, and the next attempt starts if the current one is not finished in 250ms (Happy Eyeballs, RFC 8305).
+			`onConnect` is called once when the first attempt succeeds or all of them fail. Request reads and writes after `onConnect`, because the socket of the winning attempt replaces the current one.
+		*/
+		sl_bool connectHost(const String& host, sl_uint16 port);
+		
 		sl_bool receive(void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject = sl_null);
 		
 		sl_bool receive(const Memory& mem, const Function<void(AsyncStreamResult*)>& callback);
@@ -81,6 +95,9 @@ namespace slib
 		
 		sl_bool send(const Memory& mem, const Function<void(AsyncStreamResult*)>& callback);
 		
+		// the callbacks of the zero-copy writes are called after the kernel releases the data. returns false if not supported
+		sl_bool setZeroCopyThreshold(sl_uint32 size);
+		
 	protected:
 		Ref<AsyncTcpSocketInstance> _getIoInstance();
 		
@@ -88,18 +105,24 @@ namespace slib
 		
 		void _onSend(AsyncStreamRequest* req, sl_uint32 size, sl_bool flagError);
 		
+		void _onSendFile(AsyncTcpSocketSendFileRequest* req, sl_bool flagError);
+		
 		void _onConnect(const SocketAddress& address, sl_bool flagError);
 		
 		void _onError();
 		
+		sl_bool _takeIoInstance(AsyncTcpSocket* other);
+		
 	private:
 		static Ref<AsyncTcpSocketInstance> _createInstance(const Ref<Socket>& socket);
 		
 	protected:
 		Function<void(AsyncTcpSocket*, const SocketAddress&, sl_bool flagError)> m_onConnect;
 		Function<void(AsyncTcpSocket*)> m_onError;
+		Ref<DnsClient> m_dnsClient;
 		
 		friend class AsyncTcpSocketInstance;
+		friend class _priv_AsyncTcpHostConnector;
 		
 	};
 	
@@ -117,8 +140,15 @@ namespace slib
 		sl_bool flagIPv6; // default: false
 		sl_bool flagAutoStart; // default: true
 		sl_bool flagLogError; // default: true
+		sl_bool flagNonBlockingAccept; // default: false, accepted sockets are in non-blocking mode (`accept4` on Linux)
 		Ref<AsyncIoLoop> ioLoop;
 		
+		// listeners bound to the same address by SO_REUSEPORT. default: 1, 0 means one listener per loop of `ioLoopGroup`
+		sl_uint32 listenerCount;
+		Ref<AsyncIoLoopGroup> ioLoopGroup; // the listeners are distributed on the loops, and `onAccept` can assign the connections by `AsyncTcpServer::selectIoLoop()`
+		sl_bool flagReusePortCpuSteering; // default: false, steers the connections to the listener of the receiving CPU (Linux)
+		
+		// called with the listener that accepted the connection (one of the SO_REUSEPORT listeners)
 		Function<void(AsyncTcpServer*, Socket*, const SocketAddress&)> onAccept;
 		Function<void(AsyncTcpServer*)> onError;
 		
@@ -152,6 +182,14 @@ namespace slib
 		
 		Ref<Socket> getSocket();
 		
+		// number of the SO_REUSEPORT listeners including this
+		sl_uint32 getListenerCount();
+		
+		Ref<AsyncIoLoopGroup> getIoLoopGroup();
+		
+		// returns the loop for an accepted connection: selected by the balancing policy of `ioLoopGroup`, or the loop of this listener
+		Ref<AsyncIoLoop> selectIoLoop();
+		
 	protected:
 		Ref<AsyncTcpServerInstance> _getIoInstance();
 		
@@ -162,10 +200,17 @@ namespace slib
 	protected:
 		static Ref<AsyncTcpServerInstance> _createInstance(const Ref<Socket>& socket);
 		
+		static Ref<Socket> _openSocket(const AsyncTcpServerParam& param, sl_bool flagReusePort);
+		
+		static Ref<AsyncTcpServer> _createListeners(const AsyncTcpServerParam& param);
+		
 	protected:
 		Function<void(AsyncTcpServer*, Socket*, const SocketAddress&)> m_onAccept;
 		Function<void(AsyncTcpServer*)> m_onError;
 		
+		CList< Ref<AsyncTcpServer> > m_listenersReusePort;
+		Ref<AsyncIoLoopGroup> m_ioLoopGroup;
+		
 		friend class AsyncTcpServerInstance;
 		
 	};
@@ -182,12 +227,17 @@ namespace slib
 		SocketAddress bindAddress;
 		sl_bool flagIPv6; // default: false
 		sl_bool flagBroadcast; // default: false
+		sl_bool flagReusePort; // default: false, allows several sockets to bind to the same port (SO_REUSEPORT), so that the datagrams are distributed over them
 		sl_bool flagAutoStart; // default: true
 		sl_bool flagLogError; // default: true
 		sl_uint32 packetSize; // default: 65536
+		sl_uint32 batchCount; // default: 1, maximum number of the datagrams received by a system call (`recvmmsg` on Linux)
+		sl_bool flagGro; // default: false, receives the datagrams coalesced by the kernel (UDP_GRO on Linux) and splits them into a batch. `batchCount` is ignored when it is enabled
 		Ref<AsyncIoLoop> ioLoop;
 		
 		Function<void(AsyncUdpSocket*, const SocketAddress&, void* data, sl_uint32 sizeReceived)> onReceiveFrom;
+		// called instead of `onReceiveFrom` for every received batch if set
+		Function<void(AsyncUdpSocket*, SocketDatagram* datagrams, sl_uint32 count)> onReceiveBatch;
 		
 	public:
 		AsyncUdpSocketParam();
@@ -230,21 +280,155 @@ namespace slib
 		
 		sl_bool sendTo(const SocketAddress& addressTo, const Memory& mem);
 		
+		// queued datagrams are sent by batches (`sendmmsg` on Linux)
+		sl_bool sendToBatch(const SocketDatagram* datagrams, sl_uint32 count);
+		
+		// sends `size` bytes as the datagrams of `sizeSegment` bytes, segmented by the kernel if supported (UDP_SEGMENT on Linux)
+		sl_bool sendToSegmented(const SocketAddress& addressTo, const void* data, sl_uint32 size, sl_uint32 sizeSegment);
+		
+		sl_bool sendToSegmented(const SocketAddress& addressTo, const Memory& mem, sl_uint32 sizeSegment);
+		
 	protected:
 		Ref<AsyncUdpSocketInstance> _getIoInstance();
 		
 		void _onReceive(const SocketAddress& address, void* data, sl_uint32 sizeReceived);
 		
+		void _onReceiveBatch(SocketDatagram* datagrams, sl_uint32 count);
+		
 	protected:
-		static Ref<AsyncUdpSocketInstance> _createInstance(const Ref<Socket>& socket, sl_uint32 packetSize);
+		static Ref<AsyncUdpSocketInstance> _createInstance(const Ref<Socket>& socket, sl_uint32 packetSize, sl_uint32 batchCount);
 		
 	protected:
 		Function<void(AsyncUdpSocket*, const SocketAddress&, void* data, sl_uint32 sizeReceived)> m_onReceiveFrom;
+		Function<void(AsyncUdpSocket*, SocketDatagram* datagrams, sl_uint32 count)> m_onReceiveBatch;
 		
 		friend class AsyncUdpSocketInstance;
 		
 	};
-
+	
+	class AsyncTcpConnectionPool;
+	
+	class SLIB_EXPORT AsyncTcpConnectionPoolParam
+	{
+	public:
+		// optional, the new connections are distributed on the loops of `ioLoopGroup` if it is set
+		Ref<AsyncIoLoop> ioLoop;
+		Ref<AsyncIoLoopGroup> ioLoopGroup;
+		Ref<DnsClient> dnsClient;
+		
+		sl_uint32 maxActiveConnections; // default: 64, per endpoint: the connections being used or connecting
+		sl_uint32 maxIdleConnections; // default: 8, per endpoint
+		sl_uint32 idleTimeout; // default: 60000 ms, 0 means unlimited
+		sl_uint32 connectTimeout; // default: 10000 ms, 0 means unlimited
+		sl_uint32 waitTimeout; // default: 10000 ms, 0 means unlimited
+		sl_uint32 maxWaiters; // default: 1024, per endpoint
+		
+		// default: true, an idle connection is checked if it is closed by the peer or has unread data before it is given
+		sl_bool flagCheckOnCheckout;
+		// optional, additional check for an idle connection on checkout
+		Function<sl_bool(AsyncTcpConnectionPool*, AsyncTcpSocket*)> onCheckConnection;
+		
+	public:
+		AsyncTcpConnectionPoolParam();
+		
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(AsyncTcpConnectionPoolParam)
+		
+	};
+	
+	class SLIB_EXPORT AsyncTcpConnectionPoolStats
+	{
+	public:
+		sl_uint64 hitCount; // requests served by idle connections
+		sl_uint64 missCount; // requests which waited for new or released connections
+		sl_uint64 timeoutCount; // requests failed by `waitTimeout` or `maxWaiters`
+		sl_uint64 connectCount;
+		sl_uint64 connectFailureCount;
+		sl_uint64 totalWaitTime; // milliseconds, sum over the missed requests
+		sl_uint32 maxWaitTime; // milliseconds
+		sl_uint32 activeConnections;
+		sl_uint32 idleConnections;
+		sl_uint32 waiters;
+		
+	public:
+		AsyncTcpConnectionPoolStats();
+		
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(AsyncTcpConnectionPoolStats)
+		
+	public:
+		sl_uint32 getAverageWaitTime() const;
+		
+	};
+	
+	class SLIB_EXPORT AsyncTcpConnectionPool : public Object
+	{
+		SLIB_DECLARE_OBJECT
+		
+	protected:
+		AsyncTcpConnectionPool();
+		
+		~AsyncTcpConnectionPool();
+		
+	public:
+		static Ref<AsyncTcpConnectionPool> create(const AsyncTcpConnectionPoolParam& param);
+		
+	public:
+		void close();
+		
+		/*
+			`callback` is called with a connected socket, or null on failure, on the loop of the socket (or the loop of the pool on failure).
+			The requests exceeding `maxActiveConnections` wait in the order of arrival.
+			Return the socket by `release()` when the exchange is finished, without pending reads or writes.
+		*/
+		void acquire(const String& host, sl_uint16 port, const Function<void(AsyncTcpSocket*)>& callback);
+		
+		void acquire(const SocketAddress& address, const Function<void(AsyncTcpSocket*)>& callback);
+		
+		// `flagReusable`=false closes the socket (for example, on protocol errors)
+		void release(AsyncTcpSocket* socket, sl_bool flagReusable = sl_true);
+		
+		// opens the idle connections to the endpoint up to `count` (limited by `maxIdleConnections`)
+		void warmUp(const String& host, sl_uint16 port, sl_uint32 count);
+		
+		AsyncTcpConnectionPoolStats getStats();
+		
+		AsyncTcpConnectionPoolStats getStats(const String& host, sl_uint16 port);
+		
+	protected:
+		class Endpoint;
+		
+		struct ActiveConnection
+		{
+			Ref<AsyncTcpSocket> socket;
+			Ref<Endpoint> endpoint;
+		};
+		
+		Ref<Endpoint> _getEndpoint(const String& host, sl_uint16 port, sl_bool flagCreate);
+		
+		void _connect(Endpoint* endpoint, sl_bool flagWarmUp);
+		
+		void _onConnect(Endpoint* endpoint, AsyncTcpSocket* socket, sl_bool flagError, sl_bool flagWarmUp);
+		
+		// called in locking the pool
+		void _addActiveConnection(AsyncTcpSocket* socket, Endpoint* endpoint);
+		
+		sl_bool _checkIdleConnection(AsyncTcpSocket* socket);
+		
+		void _onTimer();
+		
+		Ref<AsyncIoLoop> _selectLoop();
+		
+	protected:
+		AsyncTcpConnectionPoolParam m_param;
+		sl_bool m_flagClosed;
+		
+		HashMap< String, Ref<Endpoint> > m_endpoints;
+		// checked out connections are retained by the pool until released
+		HashMap< AsyncTcpSocket*, ActiveConnection > m_mapActive;
+		
+		Ref<Timer> m_timer;
+		
+	};
+	
 }
 
 #endif
@@ -405,6 +405,8 @@ namespace slib
 		
 		sl_uint16 id;
 		
+		DnsResponseCode responseCode;
+		
 		struct Question
 		{
 			String name;
@@ -416,6 +418,7 @@ namespace slib
 		{
 			String name;
 			IPAddress address;
+			sl_uint32 TTL; // seconds
 		};
 		List<Address> addresses;
 		
@@ -445,6 +448,8 @@ namespace slib
 		
 		static Memory buildQuestionPacket(sl_uint16 id, const String& host);
 		
+		static Memory buildQuestionPacket(sl_uint16 id, const String& host, DnsRecordType type);
+		
 		static Memory buildHostAddressAnswerPacket(sl_uint16 id, const String& hostName, const IPv4Address& hostAddress);
 		
 	};
@@ -459,6 +464,13 @@ namespace slib
 
 		Ref<AsyncIoLoop> ioLoop;
 		
+		// used by `resolveHost`. default: the first name server of the system
+		SocketAddress serverAddress;
+		sl_uint32 resolveTimeout; // default: 1000 ms, the questions are sent again on timeout
+		sl_uint32 resolveRetryCount; // default: 2
+		sl_uint32 maxCacheTTL; // default: 3600 seconds
+		sl_uint32 negativeCacheTTL; // default: 30 seconds, for the names which are not resolved
+		
 	public:
 		DnsClientParam();
 		
@@ -478,21 +490,78 @@ namespace slib
 	public:
 		static Ref<DnsClient> create(const DnsClientParam& param);
 		
+		static Ref<DnsClient> getDefault();
+		
 	public:
 		void sendQuestion(const SocketAddress& serverAddress, const String& hostName);
 		
 		void sendQuestion(const IPv4Address& serverIp, const String& hostName);
 		
+		/*
+			Resolves the IPv6 and IPv4 addresses of `hostName` without blocking, and caches the result for the TTL of the answers.
+			The requests for the same name share the questions. If the name server does not answer the name, it is resolved by the system (hosts file, ...) in a thread pool shared by the clients.
+			`callback` is called once: in the calling thread for the cached result, otherwise on the loop of this client. IPv6 addresses come first, and the empty list means failure.
+		*/
+		void resolveHost(const String& hostName, const Function<void(const List<IPAddress>& addresses)>& callback);
+		
+		void clearCache();
+		
 	protected:
 		void _onReceiveFrom(AsyncUdpSocket* socket, const SocketAddress& address, void* data, sl_uint32 sizeReceive);
 
 		void _onAnswer(const SocketAddress& serverAddress, const DnsPacket& packet);
 		
+	protected:
+		class ResolveRequest : public Referable
+		{
+		public:
+			String hostName;
+			SocketAddress serverAddress;
+			sl_uint16 idA;
+			sl_uint16 idAAAA;
+			sl_bool flagAnsweredA;
+			sl_bool flagAnsweredAAAA;
+			List<IPAddress> addressesA;
+			List<IPAddress> addressesAAAA;
+			sl_uint32 TTL;
+			sl_uint32 nRetry;
+			sl_bool flagFinished;
+			List< Function<void(const List<IPAddress>&)> > callbacks;
+		};
+		
+		void _sendResolveQuestions(ResolveRequest* request);
+		
+		void _onResolveTimeout(const Ref<ResolveRequest>& request, sl_uint32 nRetry);
+		
+		sl_bool _onResolveAnswer(const SocketAddress& serverAddress, const DnsPacket& packet);
+		
+		void _resolveBySystem(const Ref<ResolveRequest>& request);
+		
+		void _finishResolve(ResolveRequest* request, const List<IPAddress>& addresses, sl_uint32 TTL);
+		
+		sl_uint16 _generateId_NoLock();
+		
 	protected:
 		Ref<AsyncUdpSocket> m_udp;
-		sl_uint16 m_idLast;
 		
 		Function<void(DnsClient*, const SocketAddress&, const DnsPacket&)> m_onAnswer;
+		
+		SocketAddress m_serverAddress;
+		sl_uint32 m_resolveTimeout;
+		sl_uint32 m_resolveRetryCount;
+		sl_uint32 m_maxCacheTTL;
+		sl_uint32 m_negativeCacheTTL;
+		
+		HashMap< String, Ref<ResolveRequest> > m_mapResolving;
+		HashMap< sl_uint16, Ref<ResolveRequest> > m_mapResolvingIds;
+		
+		struct CacheElement
+		{
+			List<IPAddress> addresses;
+			sl_uint32 tickUpdated;
+			sl_uint32 TTL; // milliseconds
+		};
+		HashMap<String, CacheElement> m_cache;
 
 	};
 	
@@ -541,7 +610,11 @@ namespace slib
 		
 		sl_bool flagAutoStart;
 		
+		sl_uint32 batchCount; // default: 32, maximum number of the packets received by a system call
+		
 		Ref<AsyncIoLoop> ioLoop;
+		// optional, opens the sockets per loop of the group on the same ports (SO_REUSEPORT)
+		Ref<AsyncIoLoopGroup> ioLoopGroup;
 		
 		Function<void(DnsServer*, DnsResolveHostParam&)> onResolve;
 		Function<void(DnsServer*, const String& hostName, const IPAddress& hostAddress)> onCache;
@@ -602,8 +675,10 @@ namespace slib
 		sl_bool m_flagRunning;
 		
 		Ref<AsyncUdpSocket> m_udpDns;
+		List< Ref<AsyncUdpSocket> > m_udpsDns;
 		
 		Ref<AsyncUdpSocket> m_udpEncrypt;
+		List< Ref<AsyncUdpSocket> > m_udpsEncrypt;
 		AES m_encrypt;
 		
 		sl_bool m_flagProxy;
@@ -611,7 +686,7 @@ namespace slib
 		SocketAddress m_defaultForwardAddress;
 		sl_bool m_flagEncryptDefaultForward;
 		
-		sl_uint16 m_lastForwardId;
+		sl_int32 m_lastForwardId;
 		
 		struct ForwardElement
 		{
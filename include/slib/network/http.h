@@ -40,6 +40,7 @@
 
 #include "http_common.h"
 #include "http_server.h"
+#include "websocket.h"
 
 #endif
 
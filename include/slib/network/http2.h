@@ -0,0 +1,306 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_HTTP2
+#define CHECKHEADER_SLIB_NETWORK_HTTP2
+
+#include "definition.h"
+
+/****************************************************************************
+
+			Hypertext Transfer Protocol Version 2 (HTTP/2)
+
+	https://tools.ietf.org/html/rfc7540 (HTTP/2)
+	https://tools.ietf.org/html/rfc7541 (HPACK: Header Compression for HTTP/2)
+
+ - Frame Layout
+
+ +-----------------------------------------------+
+ |                 Length (24)                   |
+ +---------------+---------------+---------------+
+ |   Type (8)    |   Flags (8)   |
+ +-+-------------+---------------+-------------------------------+
+ |R|                 Stream Identifier (31)                      |
+ +=+=============================================================+
+ |                   Frame Payload (0...)                      ...
+ +---------------------------------------------------------------+
+
+*****************************************************************************/
+
+#include "../core/string.h"
+#include "../core/list.h"
+#include "../core/memory.h"
+
+#define SLIB_HTTP2_CONNECTION_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+#define SLIB_HTTP2_CONNECTION_PREFACE_SIZE 24
+
+#define SLIB_HTTP2_DEFAULT_HEADER_TABLE_SIZE 4096
+#define SLIB_HTTP2_DEFAULT_WINDOW_SIZE 65535
+#define SLIB_HTTP2_DEFAULT_FRAME_SIZE 16384
+#define SLIB_HTTP2_MAX_WINDOW_SIZE 0x7fffffff
+#define SLIB_HTTP2_MAX_FRAME_SIZE 0xffffff
+
+namespace slib
+{
+
+	enum class Http2FrameType
+	{
+		Data = 0x0,
+		Headers = 0x1,
+		Priority = 0x2,
+		ResetStream = 0x3,
+		Settings = 0x4,
+		PushPromise = 0x5,
+		Ping = 0x6,
+		GoAway = 0x7,
+		WindowUpdate = 0x8,
+		Continuation = 0x9
+	};
+
+	enum class Http2ErrorCode
+	{
+		NoError = 0x0,
+		ProtocolError = 0x1,
+		InternalError = 0x2,
+		FlowControlError = 0x3,
+		SettingsTimeout = 0x4,
+		StreamClosed = 0x5,
+		FrameSizeError = 0x6,
+		RefusedStream = 0x7,
+		Cancel = 0x8,
+		CompressionError = 0x9,
+		ConnectError = 0xa,
+		EnhanceYourCalm = 0xb,
+		InadequateSecurity = 0xc,
+		Http11Required = 0xd
+	};
+
+	enum class Http2SettingsId
+	{
+		HeaderTableSize = 0x1,
+		EnablePush = 0x2,
+		MaxConcurrentStreams = 0x3,
+		InitialWindowSize = 0x4,
+		MaxFrameSize = 0x5,
+		MaxHeaderListSize = 0x6
+	};
+
+	class SLIB_EXPORT Http2FrameHeader
+	{
+	public:
+		enum
+		{
+			HeaderSize = 9
+		};
+
+		enum
+		{
+			FlagEndStream = 0x1, // DATA, HEADERS
+			FlagAck = 0x1, // SETTINGS, PING
+			FlagEndHeaders = 0x4, // HEADERS, PUSH_PROMISE, CONTINUATION
+			FlagPadded = 0x8, // DATA, HEADERS, PUSH_PROMISE
+			FlagPriority = 0x20 // HEADERS
+		};
+
+	public:
+		// 24 bits, size of the payload
+		sl_uint32 getLength() const;
+
+		// 24 bits, size of the payload
+		void setLength(sl_uint32 length);
+
+		Http2FrameType getType() const;
+
+		void setType(Http2FrameType type);
+
+		sl_uint8 getFlags() const;
+
+		void setFlags(sl_uint8 flags);
+
+		// 31 bits
+		sl_uint32 getStreamId() const;
+
+		// 31 bits
+		void setStreamId(sl_uint32 streamId);
+
+		const sl_uint8* getPayload() const;
+
+		sl_uint8* getPayload();
+
+	private:
+		sl_uint8 _length[3];
+		sl_uint8 _type;
+		sl_uint8 _flags;
+		sl_uint8 _streamId[4];
+
+	};
+
+	class SLIB_EXPORT Http2Settings
+	{
+	public:
+		sl_uint32 headerTableSize; // default: 4096
+		sl_bool flagEnablePush; // default: true
+		sl_uint32 maxConcurrentStreams; // default: unlimited
+		sl_uint32 initialWindowSize; // default: 65535
+		sl_uint32 maxFrameSize; // default: 16384
+		sl_uint32 maxHeaderListSize; // default: unlimited
+
+	public:
+		Http2Settings();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(Http2Settings)
+
+	public:
+		// applies the parameters in the payload of SETTINGS frame, returns sl_false on the invalid parameter
+		sl_bool parse(const void* payload, sl_size size, Http2ErrorCode* outError = sl_null);
+
+		// returns the payload of SETTINGS frame, containing the parameters different from the default values
+		Memory build() const;
+
+	};
+
+	class SLIB_EXPORT HpackHeaderField
+	{
+	public:
+		String name;
+		String value;
+
+	public:
+		HpackHeaderField();
+
+		HpackHeaderField(const String& name, const String& value);
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HpackHeaderField)
+
+	};
+
+	// dynamic table of HPACK, shared by the encoder and the decoder of one direction
+	class SLIB_EXPORT HpackTable
+	{
+	public:
+		HpackTable();
+
+		~HpackTable();
+
+		SLIB_DELETE_CLASS_DEFAULT_MEMBERS(HpackTable)
+
+	public:
+		sl_uint32 getMaximumSize() const;
+
+		// evicts the entries exceeding the new size
+		void setMaximumSize(sl_uint32 size);
+
+		sl_uint32 getSize() const;
+
+		sl_uint32 getCount() const;
+
+		// `index` is 0 for the newest entry
+		const HpackHeaderField* getEntry(sl_uint32 index) const;
+
+		void add(const String& name, const String& value);
+
+		// returns the index of the entry matching both of the name and the value, or -1
+		sl_int32 find(const String& name, const String& value) const;
+
+		// returns the index of the entry matching the name, or -1
+		sl_int32 findName(const String& name) const;
+
+	protected:
+		void _evict(sl_uint32 sizeLimit);
+
+	protected:
+		// the newest entry is at the front
+		List<HpackHeaderField> m_entries;
+		sl_uint32 m_size;
+		sl_uint32 m_sizeMax;
+
+	};
+
+	class SLIB_EXPORT HpackDecoder
+	{
+	public:
+		HpackDecoder();
+
+		~HpackDecoder();
+
+		SLIB_DELETE_CLASS_DEFAULT_MEMBERS(HpackDecoder)
+
+	public:
+		// size limit of the dynamic table (SETTINGS_HEADER_TABLE_SIZE sent to the peer)
+		void setMaximumTableSize(sl_uint32 size);
+
+		// decodes a complete header block, returns sl_false on the compression error (the connection should be closed)
+		sl_bool decode(const void* data, sl_size size, List<HpackHeaderField>& output);
+
+	protected:
+		sl_bool _getField(sl_uint32 index, HpackHeaderField& field) const;
+
+	protected:
+		HpackTable m_table;
+		sl_uint32 m_sizeTableLimit;
+
+	};
+
+	class SLIB_EXPORT HpackEncoder
+	{
+	public:
+		HpackEncoder();
+
+		~HpackEncoder();
+
+		SLIB_DELETE_CLASS_DEFAULT_MEMBERS(HpackEncoder)
+
+	public:
+		// size limit of the dynamic table (SETTINGS_HEADER_TABLE_SIZE received from the peer). The encoder uses 4096 bytes at most
+		void setMaximumTableSize(sl_uint32 size);
+
+		// Encodes a header block, leaving `offset` bytes at the beginning of the returned memory (for the frame header).
+		// The fields should be in the order of sending, with the lowercase names
+		Memory encode(const HpackHeaderField* fields, sl_size count, sl_size offset = 0);
+
+	protected:
+		sl_uint8* _encodeField(sl_uint8* output, const HpackHeaderField& field);
+
+	protected:
+		HpackTable m_table;
+		sl_bool m_flagUpdateTableSize;
+
+	};
+
+	class SLIB_EXPORT Hpack
+	{
+	public:
+		// returns the size of the decoded string, or -1 on the invalid code. `output` should be larger than `size * 8 / 5`
+		static sl_reg decodeHuffman(const void* data, sl_size size, void* output);
+
+		static sl_size getHuffmanEncodedSize(const void* data, sl_size size);
+
+		// returns the size of the encoded string
+		static sl_size encodeHuffman(const void* data, sl_size size, void* output);
+
+	};
+
+}
+
+#include "detail/http2.inc"
+
+#endif
@@ -0,0 +1,170 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_HTTP_ADMISSION
+#define CHECKHEADER_SLIB_NETWORK_HTTP_ADMISSION
+
+#include "definition.h"
+
+#include "ip_address.h"
+
+#include "../core/object.h"
+#include "../core/function.h"
+#include "../core/linked_list.h"
+
+/*
+	Admission control of `HttpServer`, enabled by `HttpServerParam::flagUseAdmissionControl`.
+
+	- Connections: the connections of an address over `maxConnectionsPerAddress` are answered by `503 Service Unavailable` and closed without reading the request.
+	- Request rate: each address has a token bucket refilled by `requestRate` tokens per second up to `requestBurst`, and the request finding the bucket empty is answered by `429 Too Many Requests`.
+	- Concurrency: at most `maxConcurrentRequests` requests are processed by the handlers at once (from the dispatch to the completion of the response), and the others wait in a FIFO queue of `maxQueuedRequests`. When the queue is full, the requests are answered by 503.
+	- The rate and the queue are checked as soon as the request header is parsed, so the rejected requests are answered before their bodies are received (the connection is closed after the response when the body follows).
+	- The waiting request is answered by 503 after `maxQueueTime`, by the timer armed for the deadline of the front of the queue.
+	- The addresses are kept in a table sharded by the hash of the address, each shard locked by its own spin lock and holding at most its share of `maxAddressesCount`. When a shard is full, a few addresses are checked in CLOCK order, and the idle one (no connection and a full bucket) or the one without connections not used since the last check is replaced. When all of them have connections, the connection and the requests of the new address are rejected.
+*/
+
+namespace slib
+{
+
+	class SLIB_EXPORT HttpAdmissionParam
+	{
+	public:
+		sl_uint32 maxConnectionsPerAddress; // default: 0 (unlimited)
+
+		sl_uint32 requestRate; // default: 0 (unlimited), requests per second of an address
+		sl_uint32 requestBurst; // default: 0 (same as `requestRate`), capacity of the token bucket
+
+		sl_uint32 maxAddressesCount; // default: 65536, limit of the addresses kept in the table
+
+		sl_uint32 maxConcurrentRequests; // default: 0 (unlimited)
+		sl_uint32 maxQueuedRequests; // default: 256, requests waiting for the processing
+		sl_uint32 maxQueueTime; // default: 5000 ms, the waiting request is answered by 503 after this time
+
+		sl_uint32 retryAfter; // default: 1 second, `Retry-After` of the rejections (0: not sent)
+
+	public:
+		HttpAdmissionParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HttpAdmissionParam)
+
+	};
+
+	class SLIB_EXPORT HttpAdmissionStatistics
+	{
+	public:
+		sl_uint64 rejectedConnections; // over `maxConnectionsPerAddress`
+		sl_uint64 rejectedRequestsByRate; // 429
+		sl_uint64 rejectedRequestsByQueue; // 503, the queue is full
+		sl_uint64 rejectedRequestsByTimeout; // 503, waited longer than `maxQueueTime`
+		sl_uint64 queuedRequests; // requests which waited for the processing
+
+		sl_uint32 activeRequests;
+		sl_uint32 waitingRequests;
+		sl_uint32 addressesCount;
+
+	public:
+		HttpAdmissionStatistics();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HttpAdmissionStatistics)
+
+	};
+
+	enum class HttpAdmissionStatus
+	{
+		Admitted = 0,
+		Queued = 1, // the callback is called when the request is admitted or timed out
+		Rejected = 2
+	};
+
+	class AsyncIoLoop;
+	class _priv_HttpAdmissionShard;
+	class _priv_HttpAdmissionWaiter;
+
+	class SLIB_EXPORT HttpAdmissionControl : public Object
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		HttpAdmissionControl();
+
+		~HttpAdmissionControl();
+
+	public:
+		// `loop`: runs the timer of the queue (null: the default dispatch loop)
+		static Ref<HttpAdmissionControl> create(const HttpAdmissionParam& param, const Ref<AsyncIoLoop>& loop);
+
+		static Ref<HttpAdmissionControl> create(const HttpAdmissionParam& param);
+
+	public:
+		// returns sl_false if the address has `maxConnectionsPerAddress` connections, or the table is full. Call `removeConnection` when the admitted connection is closed
+		sl_bool addConnection(const IPAddress& address);
+
+		void removeConnection(const IPAddress& address);
+
+		// takes a token of the address, returns sl_false if the bucket is empty or the table is full
+		sl_bool takeRequestToken(const IPAddress& address);
+
+		// returns sl_false (counted as rejected) if the queue is full, so that the request is rejected before its body is received
+		sl_bool checkQueue();
+
+		// `Admitted`: call `leaveProcessing` when the response is completed. `Queued`: `callback` is called with `sl_true` when a slot is passed to the request (then call `leaveProcessing` as well), or with `sl_false` when it is timed out
+		HttpAdmissionStatus enterProcessing(const Function<void(sl_bool flagAdmitted)>& callback);
+
+		void leaveProcessing();
+
+		HttpAdmissionStatistics getStatistics();
+
+		const HttpAdmissionParam& getParam();
+
+	protected:
+		_priv_HttpAdmissionShard* _getShard(const IPAddress& address);
+
+		void _startQueueTimer(sl_uint32 delay);
+
+		void _onQueueTimer();
+
+		// removes the timed out requests at the front of the queue
+		void _popExpired_NoLock(List< Ref<_priv_HttpAdmissionWaiter> >& expired);
+
+	protected:
+		HttpAdmissionParam m_param;
+		sl_uint64 m_capacityBucket; // in 1/1000 tokens
+
+		_priv_HttpAdmissionShard* m_shards;
+
+		WeakRef<AsyncIoLoop> m_ioLoop;
+
+		sl_uint32 m_countActive;
+		CLinkedList< Ref<_priv_HttpAdmissionWaiter> > m_queue;
+		sl_bool m_flagQueueTimer;
+
+		sl_int64 m_countRejectedConnections;
+		sl_int64 m_countRejectedByRate;
+		sl_int64 m_countRejectedByQueue;
+		sl_int64 m_countRejectedByTimeout;
+		sl_int64 m_countQueued;
+
+	};
+
+}
+
+#endif
@@ -107,6 +107,7 @@ namespace slib
 		UnsupportedMediaType = 415,
 		RequestRangeNotSatisfiable = 416,
 		ExpectationFailed = 417,
+		TooManyRequests = 429,
 		
 		// Server Error
 		InternalServerError = 500,
@@ -161,6 +162,7 @@ namespace slib
 		static const String& Connection;
 		static const String& CacheControl;
 		static const String& ContentDisposition;
+		static const String& Vary;
 		
 		// Entity Headers
 		static const String& ContentLength;
@@ -174,6 +176,8 @@ namespace slib
 		static const String& Cookie;
 		static const String& Range;
 		static const String& IfModifiedSince;
+		static const String& IfNoneMatch;
+		static const String& Authorization;
 		
 		// Response Headers
 		static const String& TransferEncoding;
@@ -182,6 +186,8 @@ namespace slib
 		static const String& AcceptRanges;
 		static const String& ContentRange;
 		static const String& LastModified;
+		static const String& ETag;
+		static const String& RetryAfter;
 		
 	public:
 		
@@ -272,6 +278,9 @@ namespace slib
 	public:
 		HttpUploadFile(const String& fileName, const HttpHeaderMap& headers, void* data, sl_size size, const Ref<Referable>& ref);
 		
+		// the part spooled to the temporary file at `filePath`, which is deleted with the last object unless it is moved by `saveToFile`
+		HttpUploadFile(const String& fileName, const HttpHeaderMap& headers, const String& filePath, sl_size size);
+		
 		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HttpUploadFile)
 		
 	public:
@@ -283,10 +292,15 @@ namespace slib
 		
 		String getContentType();
 		
+		// returns null when the part is not kept in memory (spooled to the file, or written to the writer of the handler)
 		void* getData();
 		
 		sl_size getSize();
 		
+		// path of the spooled file, empty when the part is kept in memory
+		String getFilePath();
+		
+		// the spooled file is moved to `path` when possible
 		sl_bool saveToFile(const String& path);
 		
 	public:
@@ -294,11 +308,23 @@ namespace slib
 		HttpHeaderMap m_headers;
 		void* m_data;
 		sl_size m_size;
+		String m_filePath;
 		Ref<Referable> m_ref;
 		
 	};
 	
 	
+	// header line in the packet parsed by `HttpRequest::parseRequestPacket`, as the offsets from the beginning of the packet
+	struct SLIB_EXPORT HttpHeaderSlice
+	{
+		sl_uint32 name;
+		sl_uint32 lengthName;
+		sl_uint32 value;
+		sl_uint32 lengthValue;
+	};
+	
+#define SLIB_HTTP_REQUEST_HEADER_SLICES_MAX 40
+	
 	class SLIB_EXPORT HttpRequest
 	{
 	public:
@@ -430,6 +456,9 @@ namespace slib
 		
 		sl_bool containsParameter(const String& name) const;
 		
+		// replaces the values of the parameter (for example, by the path parameters of the router)
+		void setParameter(const String& name, const String& value);
+		
 		const HashMap<String, String>& getQueryParameters() const;
 		
 		String getQueryParameter(const String& name) const;
@@ -476,12 +505,25 @@ namespace slib
 		 */
 		sl_reg parseRequestPacket(const void* packet, sl_size size);
 		
+		// keeps the headers as the slices of `packet`, and creates the strings only when they are accessed
+		sl_reg parseRequestPacket(const Memory& packet);
+		
 		template <class KT, class VT, class KEY_COMPARE>
 		static String buildFormUrlEncodedFromMap(const Map<KT, VT, KEY_COMPARE>& map);
 		
 		template <class KT, class VT, class HASH, class KEY_COMPARE>
 		static String buildFormUrlEncodedFromHashMap(const HashMap<KT, VT, HASH, KEY_COMPARE>& map);
 		
+	protected:
+		sl_reg _parseRequestPacket(const sl_char8* data, sl_size size);
+		
+		sl_reg _findRequestHeaderSlice(const String& name) const;
+		
+		String _getRequestHeaderSliceValue(sl_size index) const;
+		
+		// moves the header slices into `m_requestHeaders`
+		void _materializeRequestHeaders() const;
+		
 	protected:
 		HttpMethod m_method;
 		String m_methodText;
@@ -490,7 +532,11 @@ namespace slib
 		String m_query;
 		String m_requestVersion;
 		
-		HttpHeaderMap m_requestHeaders;
+		mutable HttpHeaderMap m_requestHeaders;
+		// the headers not yet moved into `m_requestHeaders`
+		mutable Memory m_requestHeaderPacket;
+		mutable sl_uint32 m_countRequestHeaderSlices;
+		HttpHeaderSlice m_requestHeaderSlices[SLIB_HTTP_REQUEST_HEADER_SLICES_MAX];
 		HashMap<String, String> m_parameters;
 		HashMap<String, String> m_queryParameters;
 		HashMap<String, String> m_postParameters;
@@ -0,0 +1,180 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_HTTP_FILE_CACHE
+#define CHECKHEADER_SLIB_NETWORK_HTTP_FILE_CACHE
+
+#include "definition.h"
+
+#include "../core/object.h"
+#include "../core/file.h"
+#include "../core/time.h"
+#include "../core/hash_map.h"
+#include "../core/linked_list.h"
+#include "../core/content_type.h"
+#include "../core/memory.h"
+
+/*
+	Cache of the opened files and their metadata for serving the static files.
+
+	- The entries keep the file descriptor opened and shared by the responses (read by positional I/O and `sendfile`), with the precomputed `ETag`, `Last-Modified` and content type.
+	- The small files and the assets are kept in memory with their gzip variants (compressed once, or loaded from the sibling `.gz` file), and the responses refer the cached `Memory` without copying.
+	- The missing paths are cached as the negative entries for `negativeTimeout`.
+	- The entries are revalidated by `stat` after `revalidateInterval`, or invalidated by the `inotify` events of their directories (Linux).
+	- The count of the entries and the memory used by them are bounded, and the entries are evicted in CLOCK (second chance) order.
+*/
+
+namespace slib
+{
+
+	class SLIB_EXPORT HttpFileCacheParam
+	{
+	public:
+		sl_uint32 maxEntriesCount; // default: 1024, also limits the opened file descriptors
+		sl_size maxMemorySize; // default: 32MB, memory used by the entries (including the cached contents)
+
+		sl_size maxContentSize; // default: 256KB, the files not larger than this are kept in memory (0: contents are not cached)
+		sl_bool flagCompressGzip; // default: true, creates the gzip variants of the compressible contents (text, script, json, xml, svg) in memory
+		sl_int32 gzipLevel; // default: 6
+		sl_bool flagUseGzipFile; // default: true, uses the sibling `.gz` file (not older than the original) as the gzip variant
+
+		sl_uint32 revalidateInterval; // default: 1000 ms, the entry is revalidated by `stat` after this time (0: every access)
+		sl_uint32 negativeTimeout; // default: 1000 ms, lifetime of the entry for the missing path (0: missing paths are not cached)
+
+		// default: false, invalidates the entries by the `inotify` events of their directories instead of `stat` (Linux).
+		// The events are checked on the access, at most once in `revalidateInterval`. Falls back to `stat` when the directory can't be watched
+		sl_bool flagUseInotify;
+
+	public:
+		HttpFileCacheParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HttpFileCacheParam)
+
+	};
+
+	class SLIB_EXPORT HttpFileCacheEntry : public Referable
+	{
+	public:
+		String path;
+		sl_bool flagExists; // false for the negative entry
+
+		// opened for reading, shared by the responses. Use positional I/O (`File::readAt`, `AsyncFile::createShared`) to read it
+		Ref<File> file;
+		sl_uint64 size;
+		Time lastModifiedTime; // truncated to seconds
+		String lastModified; // HTTP-date of `lastModifiedTime`
+		String eTag;
+		ContentType contentType;
+
+		// cached contents, null if not kept in memory
+		Memory content;
+		Memory contentGzip;
+		String eTagGzip;
+
+	public:
+		HttpFileCacheEntry();
+
+		~HttpFileCacheEntry();
+
+	public:
+		sl_size getMemorySize();
+
+	protected:
+		sl_uint32 m_tickValidated;
+		sl_bool m_flagAccessed;
+		sl_int32 m_watch;
+		sl_bool m_flagAsset;
+		Link< Ref<HttpFileCacheEntry> >* m_link;
+
+		friend class HttpFileCache;
+
+	};
+
+	class SLIB_EXPORT HttpFileCache : public Object
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		HttpFileCache();
+
+		~HttpFileCache();
+
+	public:
+		static Ref<HttpFileCache> create(const HttpFileCacheParam& param);
+
+		static Ref<HttpFileCache> create();
+
+	public:
+		// returns the negative entry (`flagExists` is false) if `path` is missing or a directory, or null on error
+		Ref<HttpFileCacheEntry> get(const String& path);
+
+		// caches the content of the asset (`Assets::readAllBytes`) in memory. The assets are never revalidated
+		Ref<HttpFileCacheEntry> getAsset(const String& path);
+
+		void invalidate(const String& path);
+
+		void removeAll();
+
+		sl_size getEntriesCount();
+
+		sl_size getMemorySize();
+
+		const HttpFileCacheParam& getParam();
+
+	protected:
+		Ref<HttpFileCacheEntry> _load(const String& path);
+
+		void _loadContent(HttpFileCacheEntry* entry, const Memory& content, const Memory& contentGzip);
+
+		sl_bool _validate(HttpFileCacheEntry* entry);
+
+		void _put(const Ref<HttpFileCacheEntry>& entry);
+
+		void _removeAll_NoLock();
+
+		void _remove_NoLock(HttpFileCacheEntry* entry);
+
+		void _evict_NoLock();
+
+		sl_int32 _watch(const String& path);
+
+		void _processEvents();
+
+		void _removeWatch_NoLock(sl_int32 watch, const String& fileName);
+
+	protected:
+		HttpFileCacheParam m_param;
+
+		CHashMap< String, Ref<HttpFileCacheEntry> > m_map;
+		CHashMap< String, Ref<HttpFileCacheEntry> > m_mapAssets;
+		CLinkedList< Ref<HttpFileCacheEntry> > m_clock;
+		sl_size m_sizeMemory;
+
+		sl_int32 m_fdInotify;
+		CHashMap<String, sl_int32> m_mapWatches; // directory -> watch descriptor
+		sl_uint32 m_tickLastEvents;
+
+	};
+
+}
+
+#endif
@@ -25,6 +25,8 @@
 
 #include "definition.h"
 
+#include "http_common.h"
+
 #include "../core/string.h"
 #include "../crypto/zlib.h"
 
@@ -38,12 +40,13 @@ namespace slib
 	public:
 		HttpOutputBuffer();
 		
-		~HttpOutputBuffer();
+		virtual ~HttpOutputBuffer();
 		
 		SLIB_DELETE_CLASS_DEFAULT_MEMBERS(HttpOutputBuffer)
 		
 	public:
-		void clearOutput();
+		// `clearOutput` and the stream output can be overridden to track the output (for example, the stream output disables the compression of the response)
+		virtual void clearOutput();
 		
 		void write(const void* buf, sl_size size);
 		
@@ -51,11 +54,11 @@ namespace slib
 		
 		void write(const Memory& mem);
 		
-		void copyFrom(AsyncStream* stream, sl_uint64 size);
+		virtual void copyFrom(AsyncStream* stream, sl_uint64 size);
 		
-		void copyFromFile(const String& path);
+		virtual void copyFromFile(const String& path);
 		
-		void copyFromFile(const String& path, const Ref<Dispatcher>& dispatcher);
+		virtual void copyFromFile(const String& path, const Ref<Dispatcher>& dispatcher);
 		
 		sl_uint64 getOutputLength() const;
 		
@@ -89,6 +92,44 @@ namespace slib
 		
 	};
 	
+	// parses the `multipart/form-data` body incrementally, passing the parts to the callbacks as the data arrives
+	class SLIB_EXPORT HttpMultipartReader
+	{
+	public:
+		HttpMultipartReader();
+		
+		virtual ~HttpMultipartReader();
+		
+		SLIB_DELETE_CLASS_DEFAULT_MEMBERS(HttpMultipartReader)
+		
+	public:
+		void setBoundary(const String& boundary);
+		
+		// returns sl_false on the malformed body or when a callback fails
+		sl_bool add(const void* data, sl_size size);
+		
+		// returns sl_true when the closing boundary is found
+		sl_bool isCompleted();
+		
+	protected:
+		virtual sl_bool onPartBegin(const HttpHeaderMap& headers) = 0;
+		
+		virtual sl_bool onPartData(const void* data, sl_size size) = 0;
+		
+		virtual sl_bool onPartEnd() = 0;
+		
+	protected:
+		sl_bool _process(const sl_char8* data, sl_size size);
+		
+	protected:
+		// `\r\n--` + boundary
+		String m_delimiter;
+		sl_uint32 m_state;
+		// the bytes which can not be processed until the next input (partial delimiter or part header)
+		Memory m_remained;
+		
+	};
+	
 	typedef Function<void(void* dataRemained, sl_uint32 sizeRemained, sl_bool flagError)> HttpContentReaderOnComplete;
 	
 	class SLIB_EXPORT HttpContentReader : public AsyncStreamFilter
@@ -131,7 +172,8 @@ namespace slib
 		
 		sl_bool setDecompressing();
 		
-		Memory decompressData(void* data, sl_uint32 size, Referable* refData);
+		// adds the data (as a slice referencing `data` if not decompressing) to `output`
+		void decompressData(void* data, sl_uint32 size, Referable* refData, MemoryQueue& output);
 		
 	protected:
 		sl_bool m_flagDecompressing;
@@ -0,0 +1,182 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_HTTP_RESPONSE_CACHE
+#define CHECKHEADER_SLIB_NETWORK_HTTP_RESPONSE_CACHE
+
+#include "definition.h"
+
+#include "http_common.h"
+
+#include "../core/object.h"
+#include "../core/hash_map.h"
+#include "../core/linked_list.h"
+#include "../core/memory.h"
+
+/*
+	Cache of the responses of the request handlers (micro-cache), enabled by `HttpServerParam::flagUseResponseCache`.
+
+	- The responses of `GET` and `HEAD` are keyed by the method, host, path, query and the request headers listed in `varyHeaders`. The requests with `Authorization` or `Cookie` are not cached unless the header is listed.
+	- The handler sets the lifetime of its response by `HttpServerContext::setResponseCacheTime`, and `s-maxage` or `max-age` of `Cache-Control` shortens it. The responses of the other status codes than the heuristically cacheable ones (200, 203, 204, 300, 301, 404, 405, 410, 414, 501), with `Set-Cookie`, with `Cache-Control` of `private`, `no-store`, `no-cache` or zero lifetime, with `Vary` naming the header not listed in `varyHeaders`, sent from a file, or larger than `maxBodySize` are not cached.
+	- The concurrent misses of a key are coalesced: one request runs the handler and the others wait for its response. When the response is not cacheable, the waiting requests are processed by themselves, and the requests of the key are not coalesced for `passTimeout`.
+	- Stale-while-revalidate: in `staleWhileRevalidate` after the expiration, the first request runs the handler to refresh the entry and the concurrent requests are answered by the stale entry meanwhile.
+	- The response header block (HTTP/1.x) and the body are kept as `Memory` and written to the connections without serializing again. HTTP/2 streams encode the cached header fields by their own HPACK contexts.
+	- The count of the entries and the memory used by them are bounded, and the entries are evicted in CLOCK (second chance) order.
+*/
+
+namespace slib
+{
+
+	class HttpServerContext;
+
+	class SLIB_EXPORT HttpResponseCacheParam
+	{
+	public:
+		sl_uint32 maxEntriesCount; // default: 1024
+		sl_size maxMemorySize; // default: 32MB, memory used by the entries (including the bodies)
+		sl_size maxBodySize; // default: 1MB, the larger responses are not cached
+
+		// default: 0 ms, lifetime of the responses whose handlers don't call `HttpServerContext::setResponseCacheTime` (0: only the responses given the lifetime by the handlers are cached)
+		sl_uint32 defaultTimeToLive;
+		sl_uint32 defaultStaleWhileRevalidate; // default: 0 ms
+
+		sl_uint32 passTimeout; // default: 1000 ms, the requests of the key whose response was not cacheable are processed without coalescing for this time
+		sl_uint32 maxWaitTime; // default: 10000 ms, the waiting request is processed by itself when the response of the filling request is not completed in this time (0: unlimited)
+
+		// default: empty, request headers selecting the variant of the response (`Accept-Encoding`, `Accept-Language`, `Host`, ...). The requests with `Authorization` or `Cookie` are not cached unless it is listed
+		List<String> varyHeaders;
+
+	public:
+		HttpResponseCacheParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(HttpResponseCacheParam)
+
+	};
+
+	class SLIB_EXPORT HttpResponseCacheEntry : public Referable
+	{
+	public:
+		String key;
+		sl_bool flagPass; // the response was not cacheable, the requests are processed without coalescing until expired
+
+		HttpStatus responseCode;
+		String responseMessage;
+		HttpHeaderMap responseHeaders; // for HTTP/2, not modified after created
+		Memory responseHeaderPacket; // HTTP/1.x status line and header block
+		Memory body;
+
+		sl_uint32 timeToLive;
+		sl_uint32 staleWhileRevalidate;
+
+	public:
+		HttpResponseCacheEntry();
+
+		~HttpResponseCacheEntry();
+
+	public:
+		sl_size getMemorySize();
+
+	protected:
+		sl_uint32 m_tickCreated;
+		sl_bool m_flagAccessed;
+		Link< Ref<HttpResponseCacheEntry> >* m_link;
+
+		friend class HttpResponseCache;
+
+	};
+
+	enum class HttpResponseCacheStatus
+	{
+		Miss = 0, // the request runs the handler and fills the entry
+		Hit = 1,
+		Stale = 2, // answered by the stale entry while another request is revalidating it
+		Wait = 3, // waiting for the response of another request
+		Pass = 4 // not cached
+	};
+
+	class SLIB_EXPORT HttpResponseCache : public Object
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		HttpResponseCache();
+
+		~HttpResponseCache();
+
+	public:
+		static Ref<HttpResponseCache> create(const HttpResponseCacheParam& param);
+
+		static Ref<HttpResponseCache> create();
+
+	public:
+		// returns null if the request is not cacheable
+		String getKey(HttpServerContext* context);
+
+		// `outEntry` is set on `Hit` and `Stale`. On `Miss`, the caller should call `complete` or `abandon` with `key`. On `Wait`, `context` is kept until the filling request is completed
+		HttpResponseCacheStatus lookup(const String& key, HttpServerContext* context, Ref<HttpResponseCacheEntry>& outEntry);
+
+		// stores the response of the filling request (null when it is not cacheable), and returns the waiting requests
+		List< Ref<HttpServerContext> > complete(const String& key, const Ref<HttpResponseCacheEntry>& entry);
+
+		// the filling request is aborted, returns the waiting request which should fill the entry instead (the others keep waiting)
+		Ref<HttpServerContext> abandon(const String& key);
+
+		// returns sl_false if `context` is not waiting (already completed)
+		sl_bool removeWaiting(const String& key, HttpServerContext* context);
+
+		// returns sl_false if the response should not be cached. `pTimeToLive`: lifetime given by the handler, shortened to `s-maxage` or `max-age` of the response
+		sl_bool isCacheableResponse(HttpServerContext* context, sl_uint32* pTimeToLive = sl_null);
+
+		void invalidate(const String& key);
+
+		void removeAll();
+
+		sl_size getEntriesCount();
+
+		sl_size getMemorySize();
+
+		const HttpResponseCacheParam& getParam();
+
+	protected:
+		void _put_NoLock(const Ref<HttpResponseCacheEntry>& entry);
+
+		void _remove_NoLock(HttpResponseCacheEntry* entry);
+
+		void _removeAll_NoLock();
+
+		void _evict_NoLock();
+
+	protected:
+		HttpResponseCacheParam m_param;
+
+		CHashMap< String, Ref<HttpResponseCacheEntry> > m_map;
+		CLinkedList< Ref<HttpResponseCacheEntry> > m_clock;
+		sl_size m_sizeMemory;
+
+		// the keys being filled, with the waiting requests
+		CHashMap< String, List< Ref<HttpServerContext> > > m_mapFilling;
+
+	};
+
+}
+
+#endif
@@ -27,15 +27,25 @@
 
 #include "http_common.h"
 #include "http_io.h"
+#include "http_file_cache.h"
+#include "http_response_cache.h"
+#include "http_admission.h"
 #include "socket_address.h"
 
 #include "../core/thread_pool.h"
+#include "../crypto/zlib.h"
 
 namespace slib
 {
 
 	class HttpServer;
 	class HttpServerConnection;
+	class HttpServerContext;
+	class WebSocketConnection;
+	class WebSocketParam;
+	
+	// returns sl_false to abort the request
+	typedef Function<sl_bool(HttpServerContext* context, const Memory& chunk)> HttpServerRequestBodyHandler;
 	
 	class SLIB_EXPORT HttpServerContext : public Object, public HttpRequest, public HttpResponse, public HttpOutputBuffer
 	{
@@ -54,10 +64,24 @@ namespace slib
 		
 		sl_uint64 getRequestContentLength() const;
 		
+		// returns null when the body is streamed by `setRequestBodyHandler` or `setSpoolingMultipartFormData`
 		Memory getRequestBody() const;
 		
 		Variant getRequestBodyAsJson() const;
 		
+		// Call in `onRequestHeader`. The body is passed to `handler` by chunks as it arrives on the I/O loop, instead of being kept in memory, and the request is dispatched after the last chunk. The chunk refers the read buffer of the connection, which is valid until the reading resumes
+		void setRequestBodyHandler(const HttpServerRequestBodyHandler& handler);
+		
+		// Call in `onRequestHeader`. The file parts of `multipart/form-data` body are written to the temporary files (or to the writers returned by `HttpServerParam::onUploadFile`) as they arrive, and only the other fields are kept in memory
+		void setSpoolingMultipartFormData(sl_bool flag = sl_true);
+		
+		sl_bool isStreamingRequestBody();
+		
+		// stops reading the streamed body until `resumeRequestBody` is called (backpressure of the body handler)
+		void suspendRequestBody();
+		
+		void resumeRequestBody();
+		
 		sl_uint64 getResponseContentLength() const;
 		
 		Ref<HttpServer> getServer();
@@ -78,10 +102,39 @@ namespace slib
 		
 		void completeResponse();
 		
+		// the response is compressed by the encoding accepted by the client, when its content type is compressible (text, script, json, xml) and its body is not smaller than `HttpServerParam::minimumCompressionSize`
+		sl_bool isCompressingResponse();
+		
+		// Call before the response is completed. default: `HttpServerParam::flagUseCompression`
+		void setCompressingResponse(sl_bool flag);
+		
+		// `gzip` or `deflate` negotiated by `Accept-Encoding` for the compression, null if the client accepts neither
+		String getResponseCompressionEncoding();
+		
+		// Call in the request handler. Sets the lifetime (milliseconds) of the response in the response cache of the server (`HttpServerParam::flagUseResponseCache`). The stale response is still served for `staleWhileRevalidate` after expired, while one request refreshes it (0: the response is not cached)
+		void setResponseCacheTime(sl_uint32 timeToLive, sl_uint32 staleWhileRevalidate = 0);
+		
+		// the request is the opening handshake of WebSocket (`Upgrade: websocket`)
+		sl_bool isWebSocketRequest();
+		
+		// Call in the request handler. Sets the response to `101 Switching Protocols`, and the connection is switched to WebSocket after the response is sent. Returns null (with `400 Bad Request`) when the request is not a valid handshake
+		Ref<WebSocketConnection> acceptWebSocket(const WebSocketParam& param);
+		
 	public:
 		SLIB_BOOLEAN_PROPERTY(ClosingConnection);
 		SLIB_BOOLEAN_PROPERTY(ProcessingByThread);
 		
+	public:
+		// The body is kept uncompressed while it is written, and compressed when the response is completed.
+		// The stream output (`copyFrom`, `copyFromFile`) is not compressed: the response is sent without compression when a stream is appended to it
+		void clearOutput() override;
+		
+		void copyFrom(AsyncStream* stream, sl_uint64 size) override;
+		
+		void copyFromFile(const String& path) override;
+		
+		void copyFromFile(const String& path, const Ref<Dispatcher>& dispatcher) override;
+		
 	protected:
 		HttpHeaderReader m_requestHeaderReader;
 		AtomicMemory m_requestHeader;
@@ -90,10 +143,55 @@ namespace slib
 		AtomicMemory m_requestBody;
 		sl_bool m_flagAsynchronousResponse;
 		
+		HttpServerRequestBodyHandler m_requestBodyHandler;
+		sl_bool m_flagSpoolingMultipartFormData;
+		Ref<Referable> m_multipartSpooler;
+		sl_uint64 m_sizeRequestBodyReceived;
+		sl_bool m_flagRequestBodySuspended;
+		
+		sl_bool m_flagResponseCompleted;
+		Memory m_responseHeaderPacket;
+		
+		// the HTTP/2 stream carrying the request
+		Ref<Referable> m_http2Stream;
+		
+		// accepted WebSocket, until the handshake response is sent
+		Ref<Referable> m_webSocket;
+		
+		// set while the request is filling the entry of the response cache
+		Ref<HttpResponseCache> m_responseCache;
+		String m_responseCacheKey;
+		sl_bool m_flagResponseCacheChecked;
+		sl_uint32 m_responseCacheTimeToLive;
+		sl_uint32 m_responseCacheStaleWhileRevalidate;
+		
+		// holding a processing slot of the admission control when `m_flagAdmitted` is set
+		Ref<HttpAdmissionControl> m_admission;
+		sl_int32 m_flagAdmitted;
+		
+		// compression of the response
+		sl_bool m_flagCompressingResponse;
+		String m_compressionEncoding;
+		sl_bool m_flagStreamOutput; // a stream is appended to the output, and the response is not compressed
+		
+	protected:
+		void _startFillingResponseCache(HttpResponseCache* cache, const String& key);
+		
+		// returns the processing slot of the admission control
+		void _leaveProcessing();
+		
+		void _onAdmitted(sl_bool flagAdmitted);
+		
+		// compresses the body and sets the headers, called when the response is completed
+		void _finishCompression();
+		
 	private:
 		WeakRef<HttpServerConnection> m_connection;
 		
 		friend class HttpServerConnection;
+		friend class _priv_HttpServer_MultipartSpooler;
+		friend class _priv_Http2ServerSession;
+		friend class WebSocketConnection;
 		
 	};
 	
@@ -130,6 +228,8 @@ namespace slib
 		
 		void sendResponse_ServerError();
 		
+		void sendResponse_ServiceUnavailable();
+		
 		void sendConnectResponse_Successed();
 		
 		void sendConnectResponse_Failed();
@@ -153,22 +253,102 @@ namespace slib
 		Memory m_bufRead;
 		sl_bool m_flagReading;
 		sl_bool m_flagKeepAlive;
+		sl_int32 m_idDeadline;
+		
+		// the dispatched requests waiting for their responses to be sent, in the order of the requests
+		CLinkedList< Ref<HttpServerContext> > m_queueResponses;
+		Memory m_bufPending;
+		sl_bool m_flagInputEnded;
+		sl_bool m_flagStreamEnded;
+		sl_bool m_flagSendingResponses;
+		Mutex m_lockSending;
+		
+		// the HTTP/2 session after the connection preface or the h2c upgrade
+		AtomicRef<Referable> m_http2Session;
+		
+		// the WebSocket after the handshake response is sent
+		AtomicRef<Referable> m_webSocket;
+		
+		// counted in the connections of the remote address by the admission control
+		sl_bool m_flagAddressCounted;
 		
 	protected:
 		void _read();
 		
+		// closes the connection after `timeout` milliseconds unless another deadline is set (0: cancels the deadline)
+		void _setDeadline(sl_uint32 timeout);
+		
+		void _onDeadline(sl_int32 id);
+		
 		void _processInput(const void* data, sl_uint32 size);
 		
+		// responds to the failed request in order, and stops processing the input
+		void _processInputError(HttpServerContext* context, sl_bool flagServerError);
+		
+		// keeps the input which can not be processed now (full pipeline or suspended body)
+		void _keepPendingInput(const void* data, sl_uint32 size);
+		
+		// processes the pending input and continues reading on the I/O loop
+		void _resumeInput();
+		
+		void _processPendingInput();
+		
+		// dispatches `onRequestHeader` and prepares the spooling of the body, returns sl_false on the server error
+		sl_bool _processRequestHeader(HttpServerContext* context);
+		
+		// returns the used size, or -1 when the request is aborted
+		sl_reg _processRequestBody(HttpServerContext* context, const void* data, sl_size size);
+		
+		// passes the chunk of the streamed body to the spooler and the body handler, returns the error status on failure
+		HttpStatus _writeRequestBody(HttpServerContext* context, const void* data, sl_size size);
+		
+		// parses the received body (form and multipart fields), returns sl_false on the server error
+		sl_bool _completeRequestBody(HttpServerContext* context);
+		
+		// switches to HTTP/2 on the connection preface or the h2c upgrade request, returns sl_false when `context` is a HTTP/1.x request
+		sl_bool _startHttp2(HttpServerContext* context, const void* data, sl_uint32 size);
+		
+		// checks the request rate and the queue of the admission control. Returns the rejection status set to the response, or `OK`
+		HttpStatus _admitRequest(HttpServerContext* context);
+		
+		// responds the rejection in order without processing the request. Returns sl_false when the connection is closed after the response (the body is not received)
+		sl_bool _rejectRequest(HttpServerContext* context);
+		
+		void _dispatchContext(HttpServerContext* context);
+		
+		// takes a processing slot of the admission control (or waits for it), and processes the request on the thread pool, or on the I/O loop (posted when `flagPost` is set)
+		void _startProcessing(HttpServerContext* context, sl_bool flagPost);
+		
 		void _processContext(const Ref<HttpServerContext>& context);
 		
 		void _completeResponse(HttpServerContext* context);
 		
+		// returns sl_true when the request is answered by the response cache, or waits for the response of another request
+		sl_bool _processResponseCache(HttpResponseCache* cache, HttpServerContext* context);
+		
+		// stores the response of the request filling the cache entry, and completes the waiting requests. Returns the response header packet if it is made
+		Memory _fillResponseCache(HttpServerContext* context);
+		
+		// answers by the cached response, without making the response packet
+		void _completeCachedResponse(HttpServerContext* context, HttpResponseCacheEntry* entry);
+		
+		// processes the request which was waiting for the response of another request
+		void _resumeCoalescedContext(HttpServerContext* context);
+		
+		void _onCoalescedWaitTimeout(const Ref<HttpServerContext>& context, const String& key);
+		
+		// writes the completed responses at the front of the queue
+		void _sendResponses();
+		
 	protected:
 		void onReadStream(AsyncStreamResult* result);
 
 		void onAsyncOutputEnd(AsyncOutput* output, sl_bool flagError);
 		
+		friend class HttpServer;
 		friend class HttpServerContext;
+		friend class _priv_Http2ServerSession;
+		friend class WebSocketConnection;
 		
 	};
 	
@@ -213,6 +393,25 @@ namespace slib
 		sl_uint64 maxRequestHeadersSize;
 		sl_uint64 maxRequestBodySize;
 		
+		sl_bool flagSpoolMultipartFormData; // default: false, spools the file parts of every `multipart/form-data` request (see `HttpServerContext::setSpoolingMultipartFormData`)
+		sl_uint64 maxStreamingRequestBodySize; // default: 1GB, applied to the streamed and spooled bodies instead of `maxRequestBodySize` (0: unlimited)
+		sl_uint32 maxMultipartFieldSize; // default: 1MB, size limit of the form field kept in memory while spooling
+		String uploadTempDirectory; // default: empty (system temporary directory)
+		
+		sl_uint32 keepAliveTimeout; // milliseconds, an idle connection waiting for the next request is closed after this time (0: unlimited)
+		sl_uint32 requestHeaderTimeout; // milliseconds, the request header should be received in this time after its first byte (0: unlimited)
+		
+		// default: 16, number of the pipelined requests of a connection processed at once (1: one by one). The responses are sent in the order of the requests
+		sl_uint32 maxPipelinedRequests;
+		
+		// accepts HTTP/2 over cleartext TCP, by the prior knowledge (connection preface) or the `Upgrade: h2c` request. The requests of the streams are processed as the HTTP/1.x requests
+		sl_bool flagUseHttp2; // default: false
+		sl_uint32 http2MaxConcurrentStreams; // default: 100
+		sl_uint32 http2InitialWindowSize; // default: 1MB, flow control window of each stream and the connection for the request bodies
+		sl_uint32 http2MaxFrameSize; // default: 16384
+		// default: 200, streams reset by the client in a second before the connection is closed by GOAWAY(ENHANCE_YOUR_CALM) (0: unlimited)
+		sl_uint32 http2MaxResetStreamsPerSecond;
+		
 		sl_bool flagAllowCrossOrigin;
 		
 		List<String> allowedFileExtensions;
@@ -222,8 +421,37 @@ namespace slib
 		sl_bool flagCacheControlNoCache;
 		sl_uint32 cacheControlMaxAge;
 		
+		sl_bool flagUseSendFile; // sends static files by zero-copy `sendfile` where supported
+		
+		// caches the opened static files with their metadata (`ETag`, `Last-Modified`, content type) and the missing paths, and keeps the small files and the assets in memory with their gzip variants
+		sl_bool flagUseFileCache; // default: false
+		HttpFileCacheParam fileCache;
+		
+		// caches the responses of the request handlers (`GET`, `HEAD`) for the lifetime set by `HttpServerContext::setResponseCacheTime`, coalescing the concurrent misses
+		sl_bool flagUseResponseCache; // default: false
+		HttpResponseCacheParam responseCache;
+		
+		// limits the connections and the request rate of each remote address, and the requests processed at once by the handlers
+		sl_bool flagUseAdmissionControl; // default: false
+		HttpAdmissionParam admission;
+		
+		// compresses the responses written by the handlers (`gzip` or `deflate`, negotiated by `Accept-Encoding`)
+		sl_bool flagUseCompression; // default: false
+		sl_int32 compressionLevel; // default: 6 (1 ~ 9)
+		sl_uint32 minimumCompressionSize; // default: 1024, the smaller bodies are sent uncompressed
+		
+		// optional, the accepted connections are distributed on the loops of the group
+		Ref<AsyncIoLoopGroup> ioLoopGroup;
+		// default: 1, number of the I/O loops created by the server when `ioLoopGroup` is not set (0: number of the processors).
+		// With several loops, every loop accepts on its own SO_REUSEPORT listener, and the connection is parsed and processed on the loop that accepted it. Set `flagProcessByThreads` to false to run the non-blocking handlers on the loop threads
+		sl_uint32 ioLoopCount;
+		
 		sl_bool flagLogDebug;
 		
+		// called when the request header is received, before the body
+		Function<void(HttpServer*, HttpServerContext*)> onRequestHeader;
+		// returns the writer receiving the spooled file part, or null to write it to a temporary file
+		Function<Ptr<IWriter>(HttpServer*, HttpServerContext*, const String& name, const String& fileName, const HttpHeaderMap& headers)> onUploadFile;
 		Function<sl_bool(HttpServer*, HttpServerContext*)> onRequest;
 		Function<void(HttpServer*, HttpServerContext*, sl_bool flagProcessed)> onPostRequest;
 
@@ -258,14 +486,30 @@ namespace slib
 		
 		Ref<AsyncIoLoop> getAsyncIoLoop();
 		
+		Ref<AsyncIoLoopGroup> getAsyncIoLoopGroup();
+		
+		// returns the loop on which a new connection should run
+		Ref<AsyncIoLoop> selectAsyncIoLoop();
+		
 		Ref<ThreadPool> getThreadPool();
 		
+		Ref<HttpFileCache> getFileCache();
+		
+		Ref<HttpResponseCache> getResponseCache();
+		
+		Ref<HttpAdmissionControl> getAdmissionControl();
+		
 		const HttpServerParam& getParam();
 		
 	public:
 		// called before processing body, returns true if the server is trying to process the connection itself.
 		virtual sl_bool preprocessRequest(const Ref<HttpServerContext>& context);
 		
+		// called when the request header is received, before the body. The body can be streamed by `HttpServerContext::setRequestBodyHandler` or `setSpoolingMultipartFormData` here
+		virtual void onRequestHeader(HttpServerContext* context);
+		
+		void dispatchRequestHeader(HttpServerContext* context);
+		
 		// called after inputing body
 		virtual void processRequest(const Ref<HttpServerContext>& context);
 		
@@ -306,9 +550,17 @@ namespace slib
 		
 		void _processCacheControl(const Ref<HttpServerContext>& context);
 		
+		sl_bool _processCachedFile(const Ref<HttpServerContext>& context, const String& path);
+		
+		sl_bool _processFileCacheEntry(const Ref<HttpServerContext>& context, HttpFileCacheEntry* entry);
+		
 	protected:
 		AtomicRef<AsyncIoLoop> m_ioLoop;
+		AtomicRef<AsyncIoLoopGroup> m_ioLoopGroup;
 		AtomicRef<ThreadPool> m_threadPool;
+		Ref<HttpFileCache> m_fileCache;
+		Ref<HttpResponseCache> m_responseCache;
+		Ref<HttpAdmissionControl> m_admission;
 		sl_bool m_flagRunning;
 		
 		CHashMap< HttpServerConnection*, Ref<HttpServerConnection> > m_connections;
@@ -79,6 +79,9 @@ namespace slib
 		
 		static IPv6Address getIPv6AddressFromHostName(const String& hostName);
 		
+		// name servers configured in the system (`/etc/resolv.conf` on Unix)
+		static List<IPAddress> getDnsServers();
+		
 	};
 
 }
@@ -65,6 +65,16 @@ namespace slib
 		
 	};
 	
+	// element of the batched datagram I/O (`sendToBatch`, `receiveFromBatch`)
+	class SLIB_EXPORT SocketDatagram
+	{
+	public:
+		SocketAddress address;
+		void* data;
+		sl_uint32 size; // receive: size of the buffer on input, received size on output
+		
+	};
+	
 	enum class SocketType
 	{
 		None = 0,
@@ -210,6 +220,9 @@ namespace slib
 		
 		sl_bool accept(Ref<Socket>& socket, SocketAddress& address);
 		
+		// accepted socket is in non-blocking mode (uses `accept4` on Linux)
+		sl_bool acceptNonBlocking(Ref<Socket>& socket, SocketAddress& address);
+		
 		sl_bool connect(const SocketAddress& address);
 		
 		sl_bool connectAndWait(const SocketAddress& address, sl_int32 timeout = -1);
@@ -218,10 +231,25 @@ namespace slib
 		
 		sl_int32 receive(void* buf, sl_uint32 size);
 		
+		// receives without removing the data from the queue (MSG_PEEK). returns 0 if no data is available on non-blocking socket, and -1 if the connection is closed
+		sl_int32 peek(void* buf, sl_uint32 size);
+		
 		sl_int32 sendTo(const SocketAddress& address, const void* buf, sl_uint32 size);
 		
 		sl_int32 receiveFrom(SocketAddress& address, void* buf, sl_uint32 size);
 		
+		// returns the number of the sent datagrams (0 if it would block, -1 on error). uses `sendmmsg` on Linux
+		sl_int32 sendToBatch(SocketDatagram* datagrams, sl_uint32 count);
+		
+		// returns the number of the received datagrams (0 if it would block, -1 on error). uses `recvmmsg` on Linux
+		sl_int32 receiveFromBatch(SocketDatagram* datagrams, sl_uint32 count);
+		
+		// sends `size` bytes as the datagrams of `sizeSegment` bytes (the last one may be shorter), segmented by the kernel (UDP_SEGMENT on Linux). returns the sent size
+		sl_int32 sendToSegmented(const SocketAddress& address, const void* buf, sl_uint32 size, sl_uint32 sizeSegment);
+		
+		// `sizeSegment` receives the size of the coalesced datagrams (after `setOption_UdpGro`), or the received size if not coalesced
+		sl_int32 receiveFromSegmented(SocketAddress& address, void* buf, sl_uint32 size, sl_uint32& sizeSegment);
+		
 		sl_int32 sendPacket(const void* buf, sl_uint32 size, const L2PacketInfo& info);
 		
 		sl_int32 receivePacket(const void* buf, sl_uint32 size, L2PacketInfo& info);
@@ -280,6 +308,19 @@ namespace slib
 		
 		sl_bool setOption_bindToDevice(const String& ifname);
 		
+		// receives the coalesced datagrams (UDP_GRO on Linux), use `receiveFromSegmented` to split them
+		sl_bool setOption_UdpGro(sl_bool flagEnable);
+		
+		sl_bool getOption_UdpGro() const;
+		
+		// steers the connections of the SO_REUSEPORT group to the `(receiving CPU) % count`-th socket, in the binding order (Linux)
+		sl_bool setOption_ReusePortCpuSteering(sl_uint32 count);
+		
+		// allows `MSG_ZEROCOPY` sends (SO_ZEROCOPY on Linux)
+		sl_bool setOption_ZeroCopy(sl_bool flagEnable);
+		
+		sl_bool getOption_ZeroCopy() const;
+		
 		/****** multicast ******/
 		// interface address may be null
 		sl_bool setOption_IpAddMembership(const IPv4Address& ipMulticast, const IPv4Address& ipInterface);
@@ -274,8 +274,11 @@ namespace slib
 		sl_uint16 port;
 		sl_bool flagAutoStart;
 		sl_bool flagLogging;
+		sl_uint32 batchCount; // default: 32, maximum number of the packets received by a system call
 		
 		Ref<AsyncIoLoop> ioLoop;
+		// optional, opens a socket per loop of the group on the same port (SO_REUSEPORT)
+		Ref<AsyncIoLoopGroup> ioLoopGroup;
 		
 	public:
 		StunServerParam();
@@ -304,14 +307,16 @@ namespace slib
 		sl_bool isRunning();
 		
 	protected:
-		void _onReceiveFrom(AsyncUdpSocket* socket, const SocketAddress& address, void* data, sl_uint32 sizeReceive);
+		void _onReceiveBatch(AsyncUdpSocket* socket, SocketDatagram* datagrams, sl_uint32 count);
+		
+		Memory _processBindingRequest(const SocketAddress& address, void* data, sl_uint32 size);
 		
 	private:
 		sl_bool m_flagInit;
 		sl_bool m_flagRunning;
 		sl_bool m_flagLogging;
 		
-		Ref<AsyncUdpSocket> m_udp;
+		List< Ref<AsyncUdpSocket> > m_udps;
 		
 	};
 	
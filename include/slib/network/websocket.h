@@ -0,0 +1,283 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_WEBSOCKET
+#define CHECKHEADER_SLIB_NETWORK_WEBSOCKET
+
+#include "definition.h"
+
+/****************************************************************************
+
+					The WebSocket Protocol
+
+	https://tools.ietf.org/html/rfc6455 (The WebSocket Protocol)
+	https://tools.ietf.org/html/rfc7692 (Compression Extensions for WebSocket)
+
+ - Frame Layout
+
+  0                   1                   2                   3
+  0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1 2 3 4 5 6 7 8 9 0 1
+ +-+-+-+-+-------+-+-------------+-------------------------------+
+ |F|R|R|R| opcode|M| Payload len |    Extended payload length    |
+ |I|S|S|S|  (4)  |A|     (7)     |             (16/64)           |
+ |N|V|V|V|       |S|             |   (if payload len==126/127)   |
+ | |1|2|3|       |K|             |                               |
+ +-+-+-+-+-------+-+-------------+ - - - - - - - - - - - - - - - +
+ |     Extended payload length continued, if payload len == 127  |
+ + - - - - - - - - - - - - - - - +-------------------------------+
+ |                               |Masking-key, if MASK set to 1  |
+ +-------------------------------+-------------------------------+
+ | Masking-key (continued)       |          Payload Data         |
+ +-------------------------------- - - - - - - - - - - - - - - - +
+
+*****************************************************************************/
+
+#include "http_server.h"
+
+#include "../crypto/zlib.h"
+
+namespace slib
+{
+
+	enum class WebSocketOpcode
+	{
+		Continuation = 0x0,
+		Text = 0x1,
+		Binary = 0x2,
+		Close = 0x8,
+		Ping = 0x9,
+		Pong = 0xA
+	};
+
+	enum class WebSocketCloseCode
+	{
+		Normal = 1000,
+		GoingAway = 1001,
+		ProtocolError = 1002,
+		UnsupportedData = 1003,
+		NoStatus = 1005, // not sent, the close frame has no code
+		Abnormal = 1006, // not sent, the connection is closed without the close frame
+		InvalidPayload = 1007,
+		PolicyViolation = 1008,
+		MessageTooBig = 1009,
+		InternalError = 1011
+	};
+
+	class SLIB_EXPORT WebSocket
+	{
+	public:
+		enum
+		{
+			MaxFrameHeaderSize = 14,
+			MaxControlPayloadSize = 125
+		};
+
+	public:
+		// value of `Sec-WebSocket-Accept` for `Sec-WebSocket-Key` of the opening handshake
+		static String getAcceptKey(const String& key);
+
+		// XORs the payload with the 4-byte masking key (`dst` can be same as `src`). `offset` is the position of `src` in the payload
+		static void mask(const void* src, void* dst, sl_size size, const sl_uint8* key, sl_uint64 offset = 0);
+
+		static void mask(void* data, sl_size size, const sl_uint8* key, sl_uint64 offset = 0);
+
+		// builds a unmasked frame (server to client). `flagCompressed` sets RSV1 on the first frame of the message compressed by permessage-deflate
+		static Memory buildFrame(WebSocketOpcode opcode, const void* payload, sl_size size, sl_bool flagFinal = sl_true, sl_bool flagCompressed = sl_false);
+
+		static Memory buildFrame(WebSocketOpcode opcode, const Memory& payload);
+
+	};
+
+	class WebSocketConnection;
+
+	class SLIB_EXPORT WebSocketMessage
+	{
+	public:
+		sl_bool flagText;
+		Memory data;
+
+	public:
+		WebSocketMessage();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(WebSocketMessage)
+
+	public:
+		String getText() const;
+
+	};
+
+	class SLIB_EXPORT WebSocketParam
+	{
+	public:
+		sl_bool flagUsePerMessageDeflate; // default: true, accepts `permessage-deflate` offered by the client
+		sl_int32 compressionLevel; // default: 6
+		sl_uint32 minimumCompressionSize; // default: 128, the smaller messages are sent uncompressed
+		sl_uint64 maxMessageSize; // default: 16MB, size limit of the received message (after decompression)
+		sl_uint32 closeTimeout; // default: 5000, milliseconds waiting for the close frame of the peer after sending the close frame
+
+		Function<void(WebSocketConnection*)> onOpen;
+		// called on the I/O loop of the connection, in the order of the messages
+		Function<void(WebSocketConnection*, WebSocketMessage& message)> onMessage;
+		// called once when the TCP connection is closed. `code` is `Abnormal` when the close frame is not received
+		Function<void(WebSocketConnection*, WebSocketCloseCode code, const String& reason)> onClose;
+
+	public:
+		WebSocketParam();
+
+		SLIB_DECLARE_CLASS_DEFAULT_MEMBERS(WebSocketParam)
+
+	};
+
+	/*
+		WebSocket connection accepted by `HttpServerContext::acceptWebSocket`.
+		The connection is switched to WebSocket after the `101 Switching Protocols` response is sent, and the messages sent before are kept until then.
+		The send functions can be called on any thread.
+	*/
+	class SLIB_EXPORT WebSocketConnection : public Object
+	{
+		SLIB_DECLARE_OBJECT
+
+	protected:
+		WebSocketConnection();
+
+		~WebSocketConnection();
+
+	public:
+		// the request of the opening handshake (path, parameters, headers, addresses)
+		Ref<HttpServerContext> getContext();
+
+		Ref<HttpServerConnection> getConnection();
+
+		// the handshake response is sent and the closing handshake is not started
+		sl_bool isOpened();
+
+		sl_bool isPerMessageDeflate();
+
+		sl_bool sendText(const String& text);
+
+		sl_bool sendBinary(const void* data, sl_size size);
+
+		sl_bool sendBinary(const Memory& data);
+
+		// sends the frame built by `WebSocket::buildFrame`. The memory is shared (not copied), so one frame can be sent to many connections
+		sl_bool sendFrame(const Memory& frame);
+
+		sl_bool ping(const Memory& payload = sl_null);
+
+		// starts the closing handshake. The TCP connection is closed when the peer answers, or after `closeTimeout`
+		void close(WebSocketCloseCode code = WebSocketCloseCode::Normal, const String& reason = sl_null);
+
+		// size of the output not written to the socket yet, to skip or drop the slow clients
+		sl_uint64 getBufferedSize();
+
+		// frames the message once and sends the same memory to the connections, returns the number of the connections the message is queued to. The message is not compressed
+		static sl_size broadcastText(const List< Ref<WebSocketConnection> >& connections, const String& text);
+
+		static sl_size broadcastBinary(const List< Ref<WebSocketConnection> >& connections, const Memory& data);
+
+		static sl_size broadcastFrame(const List< Ref<WebSocketConnection> >& connections, const Memory& frame);
+
+	protected:
+		static Ref<WebSocketConnection> _accept(HttpServerContext* context, const WebSocketParam& param);
+
+		// the handshake response is written to the output of the connection
+		void _start(HttpServerContext* context);
+
+		void _dispatchOpen();
+
+		void _processInput(const void* data, sl_size size);
+
+		void _onOutputEnd(sl_bool flagError);
+
+		void _onClosed();
+
+		sl_bool _sendMessage(WebSocketOpcode opcode, const void* data, sl_size size);
+
+		sl_bool _sendFrame_NoLock(const Memory& frame);
+
+		void _sendClose_NoLock(WebSocketCloseCode code, const String& reason);
+
+		// fails the connection by the close frame with `code`, and stops processing the input
+		void _fail(WebSocketCloseCode code);
+
+		sl_bool _processFrameHeader();
+
+		sl_bool _processFramePayload(const sl_uint8* data, sl_size size);
+
+		sl_bool _processFrameEnd();
+
+		sl_bool _processControlFrame();
+
+		sl_bool _processMessage();
+
+		sl_bool _inflate(const Memory& input, Memory& output);
+
+	protected:
+		WeakRef<HttpServerConnection> m_connection;
+		AtomicRef<HttpServerContext> m_context;
+		Ref<AsyncStream> m_io;
+		Ref<AsyncOutput> m_output;
+		WebSocketParam m_param;
+
+		sl_bool m_flagStarted;
+		sl_bool m_flagOpenDispatched;
+		sl_bool m_flagCloseSent;
+		sl_bool m_flagCloseReceived;
+		sl_bool m_flagClosed;
+		WebSocketCloseCode m_codeClose;
+		String m_reasonClose;
+		// frames sent before the handshake response
+		MemoryQueue m_queueFramesPending;
+
+		// permessage-deflate
+		sl_bool m_flagDeflate;
+		sl_bool m_flagServerNoContextTakeover;
+		ZlibCompress m_deflater;
+		ZlibDecompress m_inflater;
+
+		// input frame
+		sl_uint8 m_frameHeader[WebSocket::MaxFrameHeaderSize];
+		sl_uint32 m_sizeFrameHeader;
+		sl_uint32 m_sizeFrameHeaderReceived;
+		WebSocketOpcode m_opcodeFrame;
+		sl_bool m_flagFinalFrame;
+		sl_uint8 m_maskFrame[4];
+		sl_uint64 m_sizeFramePayload;
+		sl_uint64 m_sizeFramePayloadReceived;
+		Memory m_payloadFrame; // chunk of the data frame being received
+		sl_uint64 m_offsetPayloadFrame; // offset of `m_payloadFrame` in the payload
+		sl_uint8 m_payloadControl[WebSocket::MaxControlPayloadSize];
+
+		// input message
+		sl_bool m_flagMessageStarted;
+		sl_bool m_flagMessageText;
+		sl_bool m_flagMessageCompressed;
+		MemoryBuffer m_bufMessage;
+
+		friend class HttpServerContext;
+		friend class HttpServerConnection;
+
+	};
+
+}
+
+#endif
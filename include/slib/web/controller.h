@@ -27,6 +27,7 @@
 
 #include "../core/function.h"
 #include "../core/variant.h"
+#include "../core/rw_lock.h"
 #include "../network/http_server.h"
 
 #define SWEB_HANDLER_PARAMS_LIST const slib::Ref<slib::HttpServerContext>& context, HttpMethod method, const slib::String& path
@@ -36,6 +37,65 @@ namespace slib
 
 	typedef Function<Variant(SWEB_HANDLER_PARAMS_LIST)> WebHandler;
 
+	class WebRouteMatch
+	{
+	public:
+		enum
+		{
+			MaxParameters = 16
+		};
+		
+		struct Parameter
+		{
+			// owned by the router, and never changed after added
+			const String* name;
+			// slice of the matched path
+			const sl_char8* value;
+			sl_size length;
+		};
+		
+		WebHandler handler;
+		Parameter parameters[MaxParameters];
+		sl_uint32 countParameters;
+		
+	public:
+		WebRouteMatch();
+		
+		~WebRouteMatch();
+		
+	};
+	
+	class _priv_WebRouterNode;
+	
+	/*
+		Compressed radix tree of the route patterns, one tree for each method.
+	 
+		`{name}` matches one or more characters up to the next `/`, and `*name` (or `*`) at the end of the pattern matches the rest of the path. On the same position, the static characters are preferred to the parameter, and the parameter to the wildcard.
+	*/
+	class WebRouter
+	{
+	public:
+		WebRouter();
+		
+		~WebRouter();
+		
+	public:
+		// returns `sl_false` when the pattern is invalid, or conflicts with the registered one (different parameter names on the same position)
+		sl_bool add(HttpMethod method, const String& pattern, const WebHandler& handler);
+		
+		// matches without allocation. The parameter values are the slices of `path`
+		sl_bool match(HttpMethod method, const sl_char8* path, sl_size length, WebRouteMatch& result) const;
+		
+	protected:
+		enum
+		{
+			MethodCount = (int)(HttpMethod::PATCH) + 1
+		};
+		Ref<_priv_WebRouterNode> m_trees[MethodCount];
+		ReadWriteLock m_lock;
+		
+	};
+
 	class WebController : public Object
 	{
 		SLIB_DECLARE_OBJECT
@@ -47,15 +107,13 @@ namespace slib
 		static Ref<WebController> create();
 		
 	public:
-		void registerHandler(HttpMethod method, const String& path, const WebHandler& handler);
+		// `path` can be a pattern of `WebRouter` (for example, `/users/{id}/*file`). The path parameters are set to the parameters of the context
+		sl_bool registerHandler(HttpMethod method, const String& path, const WebHandler& handler);
 		
 		sl_bool processHttpRequest(HttpServerContext* context);
 		
 	protected:
-		static String _getHandlerSignature(HttpMethod method, const String& path);
-		
-	protected:
-		CMap<String, WebHandler> m_handlers;
+		WebRouter m_router;
 		
 		friend class WebModule;
 		
@@ -95,6 +153,7 @@ namespace SWEB_MODULE_##NAME { \
 
 #define SWEB_END_MODULE }
 
+// `PATH` is a pattern of `WebRouter` following the path of the module, and the path parameters are read by `SWEB_STRING_PARAM` and others
 #define SWEB_HANDLER(METHOD, PATH, NAME) \
 	slib::Variant NAME(SWEB_HANDLER_PARAMS_LIST); \
 	class _priv_slib_WebHandlerRegisterer_##NAME { public: _priv_slib_WebHandlerRegisterer_##NAME() { getModule()->addHandler(slib::HttpMethod::METHOD, PATH, &NAME); } } _priv_slib_WebHandlerRegisterer_instance_##NAME; \
@@ -26,16 +26,79 @@
 #include "definition.h"
 
 #include "../core/json.h"
+#include "../core/string_buffer.h"
+
+/*
+	Template syntax
+
+	${name.member}	value of the variable (`$${` outputs `${`)
+	$for x in list {{ ... }}
+	$if value {{ ... }} $elseif value == text {{ ... }} $else {{ ... }}
+	$include {{ file path }}	renders the template file with the same data
+	$inline {{ file path }}	inserts the file without rendering
+	$# comment to the end of the line
+	$$, ${{, $}}	outputs `$`, `{{`, `}}`
+*/
 
 namespace slib
 {
 	
+	class AsyncOutputBuffer;
+	class _priv_GingerNode;
+	
+	// compiled template, which can be rendered on many threads at the same time
+	class SLIB_EXPORT GingerTemplate : public Referable
+	{
+	public:
+		GingerTemplate();
+		
+		~GingerTemplate();
+		
+	public:
+		// returns null on the syntax error
+		static Ref<GingerTemplate> compile(const String& source);
+		
+	public:
+		const String& getSource();
+		
+		// returns null on the error (for example, the variable is not found)
+		String render(const Json& data);
+		
+		// the short pieces are merged before being added, and the long static text is added without being copied
+		sl_bool render(StringBuffer& output, const Json& data);
+		
+		sl_bool render(AsyncOutputBuffer* output, const Json& data);
+		
+	protected:
+		String m_source;
+		List< Ref<_priv_GingerNode> > m_nodes;
+		
+		friend class _priv_GingerCompiler;
+		friend class _priv_GingerRenderer;
+		
+	};
+	
+	/*
+		The templates are compiled once and cached, by the content for the template strings, and by the path for the files.
+		The cached file is compiled again when its modified time or size is changed, checked at most once in a second.
+		When the cache is full, the entries not used since the last sweep are removed first (CLOCK).
+	*/
 	class SLIB_EXPORT Ginger
 	{
 	public:
 		static String render(const String& _template, const Json& data);
 		
+		static sl_bool render(StringBuffer& output, const String& _template, const Json& data);
+		
 		static String renderFile(const String& filePath, const Json& data);
+		
+		static sl_bool renderFile(StringBuffer& output, const String& filePath, const Json& data);
+		
+		static Ref<GingerTemplate> getTemplate(const String& _template);
+		
+		static Ref<GingerTemplate> getTemplateFile(const String& filePath);
+		
+		static void clearCache();
 
 	};
 	
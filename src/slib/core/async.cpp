@@ -22,7 +22,10 @@
 
 #include "slib/core/async.h"
 
+#include "async_config.h"
+
 #include "slib/core/safe_static.h"
+#include "slib/core/system.h"
 
 namespace slib
 {
@@ -31,6 +34,189 @@ namespace slib
 			AsyncIoLoop
 *************************************/
 
+	struct _priv_AsyncIoTimer
+	{
+		Function<void()> task;
+		sl_uint32 rounds;
+		_priv_AsyncIoTimer* next;
+	};
+
+	class _priv_AsyncIoTimerWheel
+	{
+	public:
+		SpinLock lock;
+		_priv_AsyncIoTimer* slots[ASYNC_TIMER_WHEEL_SIZE];
+		sl_uint32 roundsMin[ASYNC_TIMER_WHEEL_SIZE]; // the smallest rounds of the timers in the slot
+		sl_uint32 indexCurrent;
+		sl_uint32 tickCurrent;
+		sl_uint32 tickNearest; // the time when the nearest timer is due (valid while `count` is not zero)
+		sl_uint32 count;
+		
+	public:
+		_priv_AsyncIoTimerWheel()
+		{
+			Base::zeroMemory(slots, sizeof(slots));
+			Base::zeroMemory(roundsMin, sizeof(roundsMin));
+			indexCurrent = 0;
+			tickCurrent = System::getTickCount();
+			tickNearest = tickCurrent;
+			count = 0;
+		}
+		
+		~_priv_AsyncIoTimerWheel()
+		{
+			clear();
+		}
+		
+	public:
+		void clear()
+		{
+			_priv_AsyncIoTimer* list = sl_null;
+			{
+				SpinLocker locker(&lock);
+				for (sl_uint32 i = 0; i < ASYNC_TIMER_WHEEL_SIZE; i++) {
+					_priv_AsyncIoTimer* timer = slots[i];
+					while (timer) {
+						_priv_AsyncIoTimer* next = timer->next;
+						timer->next = list;
+						list = timer;
+						timer = next;
+					}
+					slots[i] = sl_null;
+				}
+				count = 0;
+			}
+			while (list) {
+				_priv_AsyncIoTimer* next = list->next;
+				delete list;
+				list = next;
+			}
+		}
+		
+
+		// returns true if the timer is due earlier than the others (the loop should be woken to wait for it)
+		sl_bool add(const Function<void()>& task, sl_uint32 delay)
+		{
+			_priv_AsyncIoTimer* timer = new _priv_AsyncIoTimer;
+			if (!timer) {
+				return sl_false;
+			}
+			timer->task = task;
+			SpinLocker locker(&lock);
+			// the wheel may be behind of the current time while the loop is busy
+			sl_uint32 ticks = (System::getTickCount() - tickCurrent + delay + ASYNC_TIMER_RESOLUTION - 1) / ASYNC_TIMER_RESOLUTION;
+			if (!ticks) {
+				ticks = 1;
+			}
+			timer->rounds = (ticks - 1) / ASYNC_TIMER_WHEEL_SIZE;
+			sl_uint32 index = (indexCurrent + ticks) % ASYNC_TIMER_WHEEL_SIZE;
+			if (!(slots[index]) || timer->rounds < roundsMin[index]) {
+				roundsMin[index] = timer->rounds;
+			}
+			timer->next = slots[index];
+			slots[index] = timer;
+			count++;
+			sl_uint32 tickDue = tickCurrent + ticks * ASYNC_TIMER_RESOLUTION;
+			if (count == 1 || (sl_int32)(tickDue - tickNearest) < 0) {
+				tickNearest = tickDue;
+				return sl_true;
+			}
+			return sl_false;
+		}
+		
+		// returns the expired timers
+		_priv_AsyncIoTimer* advance()
+		{
+			_priv_AsyncIoTimer* expired = sl_null;
+			SpinLocker locker(&lock);
+			sl_uint32 tick = System::getTickCount();
+			if (!count) {
+				tickCurrent = tick;
+				return sl_null;
+			}
+			sl_uint32 n = (tick - tickCurrent) / ASYNC_TIMER_RESOLUTION;
+			if (!n) {
+				return sl_null;
+			}
+			if (n > ASYNC_TIMER_WHEEL_SIZE) {
+				// passes the whole revolutions missed by the busy loop at once
+				sl_uint32 nRounds = (n - 1) / ASYNC_TIMER_WHEEL_SIZE;
+				for (sl_uint32 i = 0; i < ASYNC_TIMER_WHEEL_SIZE; i++) {
+					_passSlot(i, nRounds, expired);
+				}
+				n -= nRounds * ASYNC_TIMER_WHEEL_SIZE;
+				tickCurrent += nRounds * ASYNC_TIMER_WHEEL_SIZE * ASYNC_TIMER_RESOLUTION;
+			}
+			for (sl_uint32 i = 0; i < n && count; i++) {
+				tickCurrent += ASYNC_TIMER_RESOLUTION;
+				indexCurrent = (indexCurrent + 1) % ASYNC_TIMER_WHEEL_SIZE;
+				_passSlot(indexCurrent, 1, expired);
+			}
+			if (count) {
+				_updateNearest();
+			} else {
+				tickCurrent = tick;
+			}
+			return expired;
+		}
+		
+		// returns -1 if there is no timer, otherwise the milliseconds until the nearest timer is due
+		sl_int32 getWaitTimeout()
+		{
+			SpinLocker locker(&lock);
+			if (!count) {
+				return -1;
+			}
+			sl_int32 dt = (sl_int32)(tickNearest - System::getTickCount());
+			if (dt > 0) {
+				return dt;
+			}
+			return 0;
+		}
+		
+	private:
+		// the timers whose rounds are less than `nPasses` are expired
+		void _passSlot(sl_uint32 index, sl_uint32 nPasses, _priv_AsyncIoTimer*& expired)
+		{
+			_priv_AsyncIoTimer** link = slots + index;
+			_priv_AsyncIoTimer* timer = *link;
+			sl_uint32 minRounds = 0xffffffff;
+			while (timer) {
+				_priv_AsyncIoTimer* next = timer->next;
+				if (timer->rounds >= nPasses) {
+					timer->rounds -= nPasses;
+					if (timer->rounds < minRounds) {
+						minRounds = timer->rounds;
+					}
+					link = &(timer->next);
+				} else {
+					*link = next;
+					timer->next = expired;
+					expired = timer;
+					count--;
+				}
+				timer = next;
+			}
+			roundsMin[index] = minRounds;
+		}
+		
+		void _updateNearest()
+		{
+			sl_uint32 ticksNearest = 0xffffffff;
+			for (sl_uint32 d = 1; d <= ASYNC_TIMER_WHEEL_SIZE && d < ticksNearest; d++) {
+				sl_uint32 index = (indexCurrent + d) % ASYNC_TIMER_WHEEL_SIZE;
+				if (slots[index]) {
+					sl_uint32 ticks = d + roundsMin[index] * ASYNC_TIMER_WHEEL_SIZE;
+					if (ticks < ticksNearest) {
+						ticksNearest = ticks;
+					}
+				}
+			}
+			tickNearest = tickCurrent + ticksNearest * ASYNC_TIMER_RESOLUTION;
+		}
+		
+	};
+
 	SLIB_DEFINE_OBJECT(AsyncIoLoop, Dispatcher)
 
 	AsyncIoLoop::AsyncIoLoop()
@@ -38,11 +224,16 @@ namespace slib
 		m_flagInit = sl_false;
 		m_flagRunning = sl_false;
 		m_handle = sl_null;
+		m_nInstances = 0;
+		m_timers = sl_null;
 	}
 
 	AsyncIoLoop::~AsyncIoLoop()
 	{
 		release();
+		if (m_timers) {
+			delete (_priv_AsyncIoTimerWheel*)m_timers;
+		}
 	}
 
 	Ref<AsyncIoLoop> AsyncIoLoop::getDefault()
@@ -69,6 +260,7 @@ namespace slib
 			Ref<AsyncIoLoop> ret = new AsyncIoLoop;
 			if (ret.isNotNull()) {
 				ret->m_handle = handle;
+				ret->m_timers = new _priv_AsyncIoTimerWheel;
 				ret->m_thread = Thread::create(SLIB_FUNCTION_CLASS(AsyncIoLoop, _native_runLoop, ret.get()));
 				if (ret->m_thread.isNotNull()) {
 					ret->m_flagInit = sl_true;
@@ -101,6 +293,10 @@ namespace slib
 		
 		_native_closeHandle(m_handle);
 		
+		if (m_timers) {
+			((_priv_AsyncIoTimerWheel*)m_timers)->clear();
+		}
+
 		m_queueInstancesOrder.removeAll();
 		m_queueInstancesClosing.removeAll();
 		m_queueInstancesClosed.removeAll();
@@ -141,9 +337,31 @@ namespace slib
 
 	sl_bool AsyncIoLoop::dispatch(const Function<void()>& callback, sl_uint64 delay_ms)
 	{
+		if (delay_ms) {
+			if (delay_ms > 0x7fffffff) {
+				delay_ms = 0x7fffffff;
+			}
+			return setTimeout(callback, (sl_uint32)delay_ms);
+		}
 		return addTask(callback);
 	}
 
+	sl_bool AsyncIoLoop::setTimeout(const Function<void()>& task, sl_uint32 delay_ms)
+	{
+		if (task.isNull()) {
+			return sl_false;
+		}
+		_priv_AsyncIoTimerWheel* timers = (_priv_AsyncIoTimerWheel*)m_timers;
+		if (!timers) {
+			return sl_false;
+		}
+		if (timers->add(task, delay_ms)) {
+			// the loop may be sleeping until the later timer
+			wake();
+		}
+		return sl_true;
+	}
+
 	void AsyncIoLoop::wake()
 	{
 		ObjectLocker lock(this);
@@ -158,7 +376,13 @@ namespace slib
 		if (m_handle) {
 			if (instance && instance->isOpened()) {
 				ObjectLocker lock(this);
-				return _native_attachInstance(instance, mode);
+				if (_native_attachInstance(instance, mode)) {
+					if (!(instance->m_flagAttached)) {
+						instance->m_flagAttached = sl_true;
+						Base::interlockedIncrement32(&m_nInstances);
+					}
+					return sl_true;
+				}
 			}
 		}
 		return sl_false;
@@ -187,14 +411,25 @@ namespace slib
 		}
 	}
 
+	sl_uint32 AsyncIoLoop::getInstanceCount()
+	{
+		sl_int32 n = m_nInstances;
+		if (n > 0) {
+			return (sl_uint32)n;
+		}
+		return 0;
+	}
+
 	void AsyncIoLoop::_stepBegin()
 	{
+		_processTimers();
+
 		// Async Tasks
 		{
 			LinkedQueue< Function<void()> > tasks;
 			tasks.merge(&m_queueTasks);
 			Function<void()> task;
-			while (m_queueTasks.pop(&task)) {
+			while (tasks.pop(&task)) {
 				task();
 			}
 		}
@@ -206,7 +441,9 @@ namespace slib
 			Ref<AsyncIoInstance> instance;
 			while (instances.pop(&instance)) {
 				if (instance.isNotNull() && instance->isOpened()) {
-					instance->processOrder();
+					if (instance->getLoop() == this) {
+						instance->processOrder();
+					}
 				}
 			}
 		}
@@ -217,13 +454,170 @@ namespace slib
 		Ref<AsyncIoInstance> instance;
 		while (m_queueInstancesClosing.pop(&instance)) {
 			if (instance.isNotNull() && instance->isOpened()) {
-				_native_detachInstance(instance.get());
+				_detachInstance(instance.get());
 				instance->close();
 				m_queueInstancesClosed.push(instance);
 			}
 		}
 	}
 
+	void AsyncIoLoop::_processTimers()
+	{
+		_priv_AsyncIoTimerWheel* timers = (_priv_AsyncIoTimerWheel*)m_timers;
+		if (!timers) {
+			return;
+		}
+		_priv_AsyncIoTimer* timer = timers->advance();
+		while (timer) {
+			_priv_AsyncIoTimer* next = timer->next;
+			timer->task();
+			delete timer;
+			timer = next;
+		}
+	}
+
+	sl_int32 AsyncIoLoop::_getTimerWaitTimeout()
+	{
+		_priv_AsyncIoTimerWheel* timers = (_priv_AsyncIoTimerWheel*)m_timers;
+		if (timers) {
+			return timers->getWaitTimeout();
+		}
+		return -1;
+	}
+
+	void AsyncIoLoop::_detachInstance(AsyncIoInstance* instance)
+	{
+		_native_detachInstance(instance);
+		if (instance->m_flagAttached) {
+			instance->m_flagAttached = sl_false;
+			Base::interlockedDecrement32(&m_nInstances);
+		}
+	}
+
+/*************************************
+		AsyncIoLoopGroup
+**************************************/
+
+	SLIB_DEFINE_OBJECT(AsyncIoLoopGroup, Object)
+
+	AsyncIoLoopGroup::AsyncIoLoopGroup()
+	{
+		m_balancing = AsyncIoLoopBalancing::RoundRobin;
+		m_indexNext = 0;
+	}
+
+	AsyncIoLoopGroup::~AsyncIoLoopGroup()
+	{
+		release();
+	}
+
+	Ref<AsyncIoLoopGroup> AsyncIoLoopGroup::create(sl_uint32 count, sl_bool flagAutoStart)
+	{
+		if (!count) {
+			count = System::getProcessorCount();
+		}
+		Array< Ref<AsyncIoLoop> > loops = Array< Ref<AsyncIoLoop> >::create(count);
+		if (loops.isNull()) {
+			return sl_null;
+		}
+		for (sl_uint32 i = 0; i < count; i++) {
+			Ref<AsyncIoLoop> loop = AsyncIoLoop::create(flagAutoStart);
+			if (loop.isNull()) {
+				for (sl_uint32 k = 0; k < i; k++) {
+					loops[k]->release();
+				}
+				return sl_null;
+			}
+			loops[i] = loop;
+		}
+		Ref<AsyncIoLoopGroup> ret = new AsyncIoLoopGroup;
+		if (ret.isNotNull()) {
+			ret->m_loops = loops;
+			return ret;
+		}
+		return sl_null;
+	}
+
+	void AsyncIoLoopGroup::release()
+	{
+		ObjectLocker lock(this);
+		Ref<AsyncIoLoop>* loops = m_loops.getData();
+		sl_size n = m_loops.getCount();
+		for (sl_size i = 0; i < n; i++) {
+			loops[i]->release();
+		}
+	}
+
+	void AsyncIoLoopGroup::start()
+	{
+		ObjectLocker lock(this);
+		Ref<AsyncIoLoop>* loops = m_loops.getData();
+		sl_size n = m_loops.getCount();
+		for (sl_size i = 0; i < n; i++) {
+			loops[i]->start();
+		}
+	}
+
+	sl_uint32 AsyncIoLoopGroup::getCount()
+	{
+		return (sl_uint32)(m_loops.getCount());
+	}
+
+	Ref<AsyncIoLoop> AsyncIoLoopGroup::getLoop(sl_uint32 index)
+	{
+		return m_loops.getValueAt(index);
+	}
+
+	AsyncIoLoopBalancing AsyncIoLoopGroup::getBalancing()
+	{
+		return m_balancing;
+	}
+
+	void AsyncIoLoopGroup::setBalancing(AsyncIoLoopBalancing balancing)
+	{
+		m_balancing = balancing;
+	}
+
+	Ref<AsyncIoLoop> AsyncIoLoopGroup::selectLoop()
+	{
+		if (m_balancing == AsyncIoLoopBalancing::LeastLoaded) {
+			return getLeastLoadedLoop();
+		}
+		return getNextLoop();
+	}
+
+	Ref<AsyncIoLoop> AsyncIoLoopGroup::getNextLoop()
+	{
+		sl_size n = m_loops.getCount();
+		if (!n) {
+			return sl_null;
+		}
+		sl_size index = (sl_size)(Base::interlockedIncrement(&m_indexNext));
+		return m_loops.getValueAt(index % n);
+	}
+
+	Ref<AsyncIoLoop> AsyncIoLoopGroup::getLeastLoadedLoop()
+	{
+		Ref<AsyncIoLoop>* loops = m_loops.getData();
+		sl_size n = m_loops.getCount();
+		if (!n) {
+			return sl_null;
+		}
+		// starts from the round-robin position, so that the ties are spread over the loops
+		sl_size start = (sl_size)(Base::interlockedIncrement(&m_indexNext));
+		sl_size indexMin = start % n;
+		sl_uint32 countMin = loops[indexMin]->getInstanceCount();
+		for (sl_size i = 1; i < n && countMin; i++) {
+			sl_size index = (start + i) % n;
+			sl_uint32 count = loops[index]->getInstanceCount();
+			if (count < countMin) {
+				countMin = count;
+				indexMin = index;
+			}
+		}
+		return loops[indexMin];
+	}
+
 /*************************************
 		AsyncIoInstance
 **************************************/
@@ -234,6 +628,7 @@ namespace slib
 	{
 		m_handle = 0;
 		m_flagClosing = sl_false;
+		m_flagAttached = sl_false;
 		m_flagOrdering = sl_false;
 		m_mode = AsyncIoMode::InOut;
 	}
@@ -363,6 +758,39 @@ namespace slib
 		}
 	}
 
+	sl_bool AsyncIoObject::moveToLoop(const Ref<AsyncIoLoop>& loopNew)
+	{
+#if defined(SLIB_PLATFORM_IS_WIN32)
+		// an I/O completion port can not be changed after the handle is associated
+		return loopNew == getIoLoop();
+#else
+		if (loopNew.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncIoInstance> instance = getIoInstance();
+		if (instance.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncIoLoop> loopOld = getIoLoop();
+		if (loopOld.isNull() || loopOld == loopNew) {
+			return loopOld.isNotNull();
+		}
+		Ref<AsyncIoObject> thiz = this;
+		return loopOld->addTask([thiz, instance, loopOld, loopNew]() {
+			if (!(instance->isOpened()) || instance->isClosing()) {
+				return;
+			}
+			loopOld->_detachInstance(instance.get());
+			thiz->setIoLoop(loopNew);
+			if (loopNew->attachInstance(instance.get(), instance->getMode())) {
+				loopNew->requestOrder(instance.get());
+			} else {
+				thiz->closeIoInstance();
+			}
+		});
+#endif
+	}
+
 	Variant AsyncIoObject::getUserData()
 	{
 		return m_userData;
@@ -436,6 +864,11 @@ namespace slib
 		}
 	}
 
+	sl_uint64 AsyncStreamRequest::getWriteSize()
+	{
+		return size;
+	}
+
 	SLIB_DEFINE_OBJECT(AsyncStreamInstance, AsyncIoInstance)
 
 	AsyncStreamInstance::AsyncStreamInstance()
@@ -461,8 +894,7 @@ namespace slib
 	{
 		Ref<AsyncStreamRequest> req = AsyncStreamRequest::createWrite(data, size, userObject, callback);
 		if (req.isNotNull()) {
-			m_requestsWrite.push(req);
-			return sl_true;
+			return addWriteRequest(req);
 		}
 		return sl_false;
 	}
@@ -482,11 +914,32 @@ namespace slib
 		return 0;
 	}
 
+	sl_bool AsyncStreamInstance::sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& callback)
+	{
+		return sl_false;
+	}
+
 	sl_size AsyncStreamInstance::getWaitingSizeForWrite()
 	{
 		return m_sizeWriteWaiting;
 	}
 
+	void AsyncStreamInstance::cancelRequests()
+	{
+		Ref<AsyncStream> stream = Ref<AsyncStream>::from(getObject());
+		Ref<AsyncStreamRequest> request;
+		while (popReadRequest(request)) {
+			if (request.isNotNull()) {
+				request->runCallback(stream.get(), 0, sl_true);
+			}
+		}
+		while (popWriteRequest(request)) {
+			if (request.isNotNull()) {
+				request->runCallback(stream.get(), 0, sl_true);
+			}
+		}
+	}
+
 	sl_bool AsyncStreamInstance::addReadRequest(const Ref<AsyncStreamRequest>& request)
 	{
 		return m_requestsRead.push(request);
@@ -505,7 +958,7 @@ namespace slib
 	sl_bool AsyncStreamInstance::addWriteRequest(const Ref<AsyncStreamRequest>& request)
 	{
 		if (m_requestsWrite.push(request)) {
-			Base::interlockedAdd(&m_sizeWriteWaiting, request->size);
+			Base::interlockedAdd(&m_sizeWriteWaiting, (sl_reg)(request->getWriteSize()));
 			return sl_true;
 		}
 		return sl_false;
@@ -514,7 +967,7 @@ namespace slib
 	sl_bool AsyncStreamInstance::popWriteRequest(Ref<AsyncStreamRequest>& request)
 	{
 		if (m_requestsWrite.pop(&request)) {
-			Base::interlockedAdd(&m_sizeWriteWaiting, -((sl_reg)(request->size)));
+			Base::interlockedAdd(&m_sizeWriteWaiting, -((sl_reg)(request->getWriteSize())));
 			return sl_true;
 		}
 		return sl_false;
@@ -594,6 +1047,36 @@ namespace slib
 		return write(mem.getData(), (sl_uint32)(size), callback, mem.ref.get());
 	}
 
+	sl_bool AsyncStream::sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& callback)
+	{
+		return sl_false;
+	}
+
+	sl_bool AsyncStream::isWritable()
+	{
+		return sl_true;
+	}
+
+	sl_bool AsyncStream::notifyWhenWritable(const Function<void()>& callback)
+	{
+		return sl_false;
+	}
+
+	sl_bool AsyncStream::setReadTimeout(sl_uint32 timeout)
+	{
+		return sl_false;
+	}
+
+	sl_bool AsyncStream::setWriteTimeout(sl_uint32 timeout)
+	{
+		return sl_false;
+	}
+
+	sl_bool AsyncStream::setIdleTimeout(sl_uint32 timeout)
+	{
+		return sl_false;
+	}
+
 /*************************************
 		AsyncStreamBase
 **************************************/
@@ -602,6 +1085,22 @@ namespace slib
 
 	AsyncStreamBase::AsyncStreamBase()
 	{
+		m_sizeWritePending = 0;
+		m_sizeWriteHighWatermark = 0;
+		m_sizeWriteLowWatermark = 0;
+		m_flagWritingPaused = sl_false;
+
+		m_timeoutRead = 0;
+		m_timeoutWrite = 0;
+		m_timeoutIdle = 0;
+		m_nReadsPending = 0;
+		m_nWritesPending = 0;
+		m_tickRead = 0;
+		m_tickWrite = 0;
+		m_tickActive = 0;
+		m_flagTimeoutChecking = sl_false;
+		m_tickTimeoutCheck = 0;
+		m_idTimeoutCheck = 0;
 	}
 
 	AsyncStreamBase::~AsyncStreamBase()
@@ -652,6 +1151,23 @@ namespace slib
 		}
 		Ref<AsyncStreamInstance> instance = getIoInstance();
 		if (instance.isNotNull()) {
+			if (_isTimeoutEnabled()) {
+				WeakRef<AsyncStreamBase> weak = this;
+				auto callbackTracking = [weak, callback](AsyncStreamResult* result) {
+					Ref<AsyncStreamBase> stream = weak;
+					if (stream.isNotNull()) {
+						stream->_onRequestCompleted(sl_true);
+					}
+					callback(result);
+				};
+				_onRequestStarted(sl_true);
+				if (instance->read(data, size, callbackTracking, userObject)) {
+					loop->requestOrder(instance.get());
+					return sl_true;
+				}
+				_onRequestCompleted(sl_true);
+				return sl_false;
+			}
 			if (instance->read(data, size, callback, userObject)) {
 				loop->requestOrder(instance.get());
 				return sl_true;
@@ -660,66 +1176,420 @@ namespace slib
 		return sl_false;
 	}
 
-	sl_bool AsyncStreamBase::write(const void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject)
+	sl_bool AsyncStreamBase::write(const void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject)
+	{
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			sl_bool flagTimeout = _isTimeoutEnabled();
+			if (m_sizeWriteHighWatermark || m_onDrain.isNotNull() || flagTimeout) {
+				sl_reg sizePending = Base::interlockedAdd(&m_sizeWritePending, size);
+				if (m_sizeWriteHighWatermark && (sl_size)sizePending >= m_sizeWriteHighWatermark) {
+					ObjectLocker lock(this);
+					m_flagWritingPaused = sl_true;
+				}
+				WeakRef<AsyncStreamBase> weak = this;
+				auto callbackTracking = [weak, callback, size, flagTimeout](AsyncStreamResult* result) {
+					Ref<AsyncStreamBase> stream = weak;
+					if (flagTimeout && stream.isNotNull()) {
+						stream->_onRequestCompleted(sl_false);
+					}
+					callback(result);
+					if (stream.isNotNull()) {
+						stream->_onWriteCompleted(size);
+					}
+				};
+				if (flagTimeout) {
+					_onRequestStarted(sl_false);
+				}
+				if (instance->write(data, size, callbackTracking, userObject)) {
+					loop->requestOrder(instance.get());
+					return sl_true;
+				}
+				if (flagTimeout) {
+					_onRequestCompleted(sl_false);
+				}
+				_onWriteCompleted(size);
+				return sl_false;
+			}
+			if (instance->write(data, size, callback, userObject)) {
+				loop->requestOrder(instance.get());
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	sl_bool AsyncStreamBase::isSeekable()
+	{
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			return instance->isSeekable();
+		}
+		return sl_false;
+	}
+
+	sl_bool AsyncStreamBase::seek(sl_uint64 pos)
+	{
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			instance->seek(pos);
+			return sl_true;
+		}
+		return sl_false;
+	}
+
+	sl_uint64 AsyncStreamBase::getSize()
+	{
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			return instance->getSize();
+		}
+		return sl_false;
+	}
+
+	sl_bool AsyncStreamBase::sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& callback)
+	{
+		if (file.isNull() || size == 0) {
+			return sl_false;
+		}
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			sl_bool flagTimeout = _isTimeoutEnabled();
+			if (m_sizeWriteHighWatermark || m_onDrain.isNotNull() || flagTimeout) {
+				sl_reg sizePending = Base::interlockedAdd(&m_sizeWritePending, (sl_reg)size);
+				if (m_sizeWriteHighWatermark && (sl_size)sizePending >= m_sizeWriteHighWatermark) {
+					ObjectLocker lock(this);
+					m_flagWritingPaused = sl_true;
+				}
+				WeakRef<AsyncStreamBase> weak = this;
+				auto callbackTracking = [weak, callback, size, flagTimeout](AsyncStream* stream, sl_uint64 sizeSent, sl_bool flagError) {
+					Ref<AsyncStreamBase> base = weak;
+					if (flagTimeout && base.isNotNull()) {
+						base->_onRequestCompleted(sl_false);
+					}
+					callback(stream, sizeSent, flagError);
+					if (base.isNotNull()) {
+						base->_onWriteCompleted(size);
+					}
+				};
+				if (flagTimeout) {
+					_onRequestStarted(sl_false);
+				}
+				if (instance->sendFile(file, offset, size, callbackTracking)) {
+					loop->requestOrder(instance.get());
+					return sl_true;
+				}
+				if (flagTimeout) {
+					_onRequestCompleted(sl_false);
+				}
+				_onWriteCompleted(size);
+				return sl_false;
+			}
+			if (instance->sendFile(file, offset, size, callback)) {
+				loop->requestOrder(instance.get());
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	sl_bool AsyncStreamBase::addTask(const Function<void()>& callback)
+	{
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNotNull()) {
+			return loop->addTask(callback);
+		}
+		return sl_false;
+	}
+
+	sl_size AsyncStreamBase::getWaitingSizeForWrite()
+	{
+		Ref<AsyncStreamInstance> instance = getIoInstance();
+		if (instance.isNotNull()) {
+			return instance->getWaitingSizeForWrite();
+		}
+		return 0;
+	}
+
+	void AsyncStreamBase::setWriteWatermarks(sl_size highWatermark, sl_size lowWatermark)
+	{
+		if (lowWatermark == 0 || lowWatermark >= highWatermark) {
+			lowWatermark = highWatermark / 2;
+		}
+		ObjectLocker lock(this);
+		m_sizeWriteHighWatermark = highWatermark;
+		m_sizeWriteLowWatermark = lowWatermark;
+		lock.unlock();
+		_onWriteCompleted(0);
+	}
+
+	sl_size AsyncStreamBase::getWriteHighWatermark()
+	{
+		return m_sizeWriteHighWatermark;
+	}
+
+	sl_size AsyncStreamBase::getWriteLowWatermark()
+	{
+		return m_sizeWriteLowWatermark;
+	}
+
+	sl_size AsyncStreamBase::getPendingWriteSize()
+	{
+		sl_reg n = m_sizeWritePending;
+		if (n > 0) {
+			return n;
+		}
+		return 0;
+	}
+
+	sl_bool AsyncStreamBase::isWritable()
+	{
+		return !m_flagWritingPaused;
+	}
+
+	sl_bool AsyncStreamBase::notifyWhenWritable(const Function<void()>& callback)
+	{
+		ObjectLocker lock(this);
+		if (m_flagWritingPaused) {
+			return m_queueWritableCallbacks.push(callback);
+		}
+		return sl_false;
+	}
+
+	void AsyncStreamBase::setOnWritable(const Function<void(AsyncStream*)>& callback)
+	{
+		m_onWritable = callback;
+	}
+
+	void AsyncStreamBase::setOnDrain(const Function<void(AsyncStream*)>& callback)
+	{
+		m_onDrain = callback;
+	}
+
+	sl_bool AsyncStreamBase::setReadTimeout(sl_uint32 timeout)
+	{
+		m_timeoutRead = timeout;
+		m_tickRead = System::getTickCount();
+		if (timeout && m_nReadsPending > 0) {
+			_scheduleTimeoutCheck(timeout);
+		}
+		return sl_true;
+	}
+
+	sl_bool AsyncStreamBase::setWriteTimeout(sl_uint32 timeout)
+	{
+		m_timeoutWrite = timeout;
+		m_tickWrite = System::getTickCount();
+		if (timeout && m_nWritesPending > 0) {
+			_scheduleTimeoutCheck(timeout);
+		}
+		return sl_true;
+	}
+
+	sl_bool AsyncStreamBase::setIdleTimeout(sl_uint32 timeout)
+	{
+		m_timeoutIdle = timeout;
+		m_tickActive = System::getTickCount();
+		if (timeout) {
+			_scheduleTimeoutCheck(timeout);
+		}
+		return sl_true;
+	}
+
+	sl_uint32 AsyncStreamBase::getReadTimeout()
+	{
+		return m_timeoutRead;
+	}
+
+	sl_uint32 AsyncStreamBase::getWriteTimeout()
+	{
+		return m_timeoutWrite;
+	}
+
+	sl_uint32 AsyncStreamBase::getIdleTimeout()
+	{
+		return m_timeoutIdle;
+	}
+
+	void AsyncStreamBase::setOnTimeout(const Function<void(AsyncStream*, AsyncStreamTimeout)>& callback)
+	{
+		m_onTimeout = callback;
+	}
+
+	sl_bool AsyncStreamBase::_isTimeoutEnabled()
 	{
-		Ref<AsyncIoLoop> loop = getIoLoop();
-		if (loop.isNull()) {
-			return sl_false;
-		}
-		Ref<AsyncStreamInstance> instance = getIoInstance();
-		if (instance.isNotNull()) {
-			if (instance->write(data, size, callback, userObject)) {
-				loop->requestOrder(instance.get());
-				return sl_true;
+		return m_timeoutRead || m_timeoutWrite || m_timeoutIdle;
+	}
+
+	void AsyncStreamBase::_onRequestStarted(sl_bool flagRead)
+	{
+		sl_uint32 now = System::getTickCount();
+		if (flagRead) {
+			if (Base::interlockedIncrement32(&m_nReadsPending) == 1) {
+				m_tickRead = now;
+			}
+			if (m_timeoutRead) {
+				_scheduleTimeoutCheck(m_timeoutRead);
+			}
+		} else {
+			if (Base::interlockedIncrement32(&m_nWritesPending) == 1) {
+				m_tickWrite = now;
+			}
+			if (m_timeoutWrite) {
+				_scheduleTimeoutCheck(m_timeoutWrite);
 			}
 		}
-		return sl_false;
 	}
 
-	sl_bool AsyncStreamBase::isSeekable()
+	void AsyncStreamBase::_onRequestCompleted(sl_bool flagRead)
 	{
-		Ref<AsyncStreamInstance> instance = getIoInstance();
-		if (instance.isNotNull()) {
-			return instance->isSeekable();
+		sl_uint32 now = System::getTickCount();
+		if (flagRead) {
+			m_tickRead = now;
+			Base::interlockedDecrement32(&m_nReadsPending);
+		} else {
+			m_tickWrite = now;
+			Base::interlockedDecrement32(&m_nWritesPending);
 		}
-		return sl_false;
+		m_tickActive = now;
 	}
 
-	sl_bool AsyncStreamBase::seek(sl_uint64 pos)
+	void AsyncStreamBase::_scheduleTimeoutCheck(sl_uint32 delay)
 	{
-		Ref<AsyncStreamInstance> instance = getIoInstance();
-		if (instance.isNotNull()) {
-			instance->seek(pos);
-			return sl_true;
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return;
 		}
-		return sl_false;
+		sl_uint32 tickCheck = System::getTickCount() + delay;
+		sl_uint32 id;
+		{
+			ObjectLocker lock(this);
+			// the scheduled check runs earlier
+			if (m_flagTimeoutChecking && (sl_int32)(m_tickTimeoutCheck - tickCheck) <= 0) {
+				return;
+			}
+			m_flagTimeoutChecking = sl_true;
+			m_tickTimeoutCheck = tickCheck;
+			id = ++m_idTimeoutCheck;
+		}
+		WeakRef<AsyncStreamBase> weak = this;
+		loop->setTimeout([weak, id]() {
+			Ref<AsyncStreamBase> stream = weak;
+			if (stream.isNotNull()) {
+				stream->_onTimeoutCheck(id);
+			}
+		}, delay);
 	}
 
-	sl_uint64 AsyncStreamBase::getSize()
+	void AsyncStreamBase::_onTimeoutCheck(sl_uint32 id)
 	{
-		Ref<AsyncStreamInstance> instance = getIoInstance();
-		if (instance.isNotNull()) {
-			return instance->getSize();
+		{
+			ObjectLocker lock(this);
+			if (id != m_idTimeoutCheck) {
+				// replaced by an earlier check
+				return;
+			}
+			m_flagTimeoutChecking = sl_false;
 		}
-		return sl_false;
+		_checkTimeouts();
 	}
 
-	sl_bool AsyncStreamBase::addTask(const Function<void()>& callback)
+	void AsyncStreamBase::_checkTimeouts()
 	{
-		Ref<AsyncIoLoop> loop = getIoLoop();
-		if (loop.isNotNull()) {
-			return loop->addTask(callback);
+		if (!(isOpened())) {
+			return;
+		}
+		sl_uint32 now = System::getTickCount();
+		sl_uint32 wait = 0;
+		AsyncStreamTimeout type = AsyncStreamTimeout::Idle;
+		sl_bool flagTimeout = sl_false;
+		sl_uint32 elapsed;
+		if (m_timeoutIdle) {
+			elapsed = now - m_tickActive;
+			if (elapsed >= m_timeoutIdle) {
+				flagTimeout = sl_true;
+				type = AsyncStreamTimeout::Idle;
+				m_tickActive = now;
+				wait = m_timeoutIdle;
+			} else {
+				wait = m_timeoutIdle - elapsed;
+			}
+		}
+		if (!flagTimeout && m_timeoutRead && m_nReadsPending > 0) {
+			elapsed = now - m_tickRead;
+			if (elapsed >= m_timeoutRead) {
+				flagTimeout = sl_true;
+				type = AsyncStreamTimeout::Read;
+				m_tickRead = now;
+				elapsed = 0;
+			}
+			if (!wait || m_timeoutRead - elapsed < wait) {
+				wait = m_timeoutRead - elapsed;
+			}
+		}
+		if (!flagTimeout && m_timeoutWrite && m_nWritesPending > 0) {
+			elapsed = now - m_tickWrite;
+			if (elapsed >= m_timeoutWrite) {
+				flagTimeout = sl_true;
+				type = AsyncStreamTimeout::Write;
+				m_tickWrite = now;
+				elapsed = 0;
+			}
+			if (!wait || m_timeoutWrite - elapsed < wait) {
+				wait = m_timeoutWrite - elapsed;
+			}
+		}
+		if (flagTimeout) {
+			Function<void(AsyncStream*, AsyncStreamTimeout)> callback(m_onTimeout);
+			if (callback.isNotNull()) {
+				callback(this, type);
+			} else {
+				Ref<AsyncStreamInstance> instance = getIoInstance();
+				close();
+				if (instance.isNotNull()) {
+					instance->cancelRequests();
+				}
+				return;
+			}
+			if (!(isOpened())) {
+				return;
+			}
+		}
+		if (wait) {
+			_scheduleTimeoutCheck(wait);
 		}
-		return sl_false;
 	}
 
-	sl_size AsyncStreamBase::getWaitingSizeForWrite()
+	void AsyncStreamBase::_onWriteCompleted(sl_uint64 size)
 	{
-		Ref<AsyncStreamInstance> instance = getIoInstance();
-		if (instance.isNotNull()) {
-			return instance->getWaitingSizeForWrite();
+		sl_reg sizePending = Base::interlockedAdd(&m_sizeWritePending, -((sl_reg)size));
+		LinkedQueue< Function<void()> > callbacks;
+		{
+			ObjectLocker lock(this);
+			if (!m_flagWritingPaused) {
+				lock.unlock();
+			} else if (!m_sizeWriteHighWatermark || sizePending <= (sl_reg)m_sizeWriteLowWatermark) {
+				m_flagWritingPaused = sl_false;
+				callbacks.merge(&m_queueWritableCallbacks);
+				lock.unlock();
+				m_onWritable(this);
+				Function<void()> callback;
+				while (callbacks.pop(&callback)) {
+					callback();
+				}
+			}
+		}
+		if (size && sizePending == 0) {
+			m_onDrain(this);
 		}
-		return 0;
 	}
 
 /*************************************
@@ -985,6 +1855,8 @@ namespace slib
 
 	AsyncFile::AsyncFile()
 	{
+		m_flagShared = sl_false;
+		m_position = 0;
 	}
 
 	AsyncFile::~AsyncFile()
@@ -1018,6 +1890,21 @@ namespace slib
 		return sl_null;
 	}
 
+	Ref<AsyncFile> AsyncFile::createShared(const Ref<File>& file, sl_uint64 offset, const Ref<Dispatcher>& dispatcher)
+	{
+		if (file.isNotNull()) {
+			Ref<AsyncFile> ret = new AsyncFile;
+			if (ret.isNotNull()) {
+				ret->m_file = file;
+				ret->m_flagShared = sl_true;
+				ret->m_position = offset;
+				ret->init(dispatcher);
+				return ret;
+			}
+		}
+		return sl_null;
+	}
+
 	Ref<AsyncFile> AsyncFile::open(const String& path, FileMode mode)
 	{
 		Ref<File> file = File::open(path, mode);
@@ -1071,6 +1958,18 @@ namespace slib
 		return m_file;
 	}
 
+	sl_uint64 AsyncFile::getPosition()
+	{
+		if (m_flagShared) {
+			return m_position;
+		}
+		Ref<File> file = m_file;
+		if (file.isNotNull()) {
+			return file->getPosition();
+		}
+		return 0;
+	}
+
 	void AsyncFile::close()
 	{
 		m_file.setNull();
@@ -1088,14 +1987,24 @@ namespace slib
 			if (request->data && request->size) {
 				sl_reg size;
 				sl_bool flagError = sl_false;
-				if (request->flagRead) {
-					size = file->read(request->data, request->size);
+				if (m_flagShared) {
+					if (request->flagRead) {
+						size = file->readAt(m_position, request->data, request->size);
+					} else {
+						size = file->writeAt32(m_position, request->data, request->size);
+					}
 				} else {
-					size = file->write(request->data, request->size);
+					if (request->flagRead) {
+						size = file->read(request->data, request->size);
+					} else {
+						size = file->write(request->data, request->size);
+					}
 				}
 				if (size <= 0) {
 					flagError = sl_true;
 					size = 0;
+				} else if (m_flagShared) {
+					m_position += size;
 				}
 				request->runCallback(this, (sl_uint32)size, flagError);
 			} else {
@@ -1111,6 +2020,10 @@ namespace slib
 
 	sl_bool AsyncFile::seek(sl_uint64 pos)
 	{
+		if (m_flagShared) {
+			m_position = pos;
+			return sl_true;
+		}
 		Ref<File> file = m_file;
 		if (file.isNotNull()) {
 			return file->seek(pos, SeekPosition::Begin);
@@ -1140,6 +2053,7 @@ namespace slib
 		bufferSize = 0x10000;
 		bufferCount = 8;
 		flagAutoStart = sl_true;
+		flagUseSendFile = sl_true;
 	}
 
 	SLIB_DEFINE_OBJECT(AsyncCopy, Object)
@@ -1153,6 +2067,9 @@ namespace slib
 		m_flagRunning = sl_true;
 		m_flagStarted = sl_false;
 		m_flagEnqueue = sl_false;
+		m_flagUseSendFile = sl_false;
+		m_flagSendingFile = sl_false;
+		m_flagWaitingTarget = sl_false;
 
 		m_sizeTotal = 0;
 	}
@@ -1184,6 +2101,7 @@ namespace slib
 			ret->m_onWrite = param.onWrite;
 			ret->m_onEnd = param.onEnd;
 			ret->m_sizeTotal = param.size;
+			ret->m_flagUseSendFile = param.flagUseSendFile && param.onRead.isNull();
 			for (sl_uint32 i = 0; i < param.bufferCount; i++) {
 				Memory mem = Memory::create(param.bufferSize);
 				if (mem.isNotNull()) {
@@ -1212,6 +2130,11 @@ namespace slib
 		ObjectLocker lock(this);
 		if (!m_flagStarted) {
 			m_flagStarted = sl_true;
+			if (m_flagUseSendFile) {
+				if (_startSendFile()) {
+					return sl_true;
+				}
+			}
 			enqueue();
 			return sl_true;
 		}
@@ -1290,7 +2213,7 @@ namespace slib
 
 	sl_bool AsyncCopy::isWriting()
 	{
-		return m_bufferWriting.isNotNull();
+		return m_bufferWriting.isNotNull() || m_flagSendingFile;
 	}
 
 	void AsyncCopy::onReadStream(AsyncStreamResult* result)
@@ -1351,6 +2274,61 @@ namespace slib
 		enqueue();
 	}
 	
+	sl_bool AsyncCopy::_startSendFile()
+	{
+		AsyncFile* source = CastInstance<AsyncFile>(m_source.get());
+		if (!source) {
+			return sl_false;
+		}
+		Ref<File> file = source->getFile();
+		if (file.isNull()) {
+			return sl_false;
+		}
+		sl_uint64 offset = source->getPosition();
+		sl_uint64 sizeFile = file->getSize();
+		if (offset >= sizeFile) {
+			return sl_false;
+		}
+		sl_uint64 size = sizeFile - offset;
+		if (size > m_sizeTotal) {
+			size = m_sizeTotal;
+		}
+		Ref<AsyncStream> target = m_target;
+		if (target.isNull()) {
+			return sl_false;
+		}
+		m_flagSendingFile = sl_true;
+		if (target->sendFile(file, offset, size, SLIB_FUNCTION_WEAKREF(AsyncCopy, onSendFile, this))) {
+			m_sizeTotal = size;
+			return sl_true;
+		}
+		m_flagSendingFile = sl_false;
+		return sl_false;
+	}
+
+	void AsyncCopy::onSendFile(AsyncStream* stream, sl_uint64 sizeSent, sl_bool flagError)
+	{
+		ObjectLocker lock(this);
+		m_flagSendingFile = sl_false;
+		if (!m_flagRunning) {
+			return;
+		}
+		if (flagError) {
+			m_flagWriteError = sl_true;
+		}
+		m_sizeRead = sizeSent;
+		m_sizeWritten = sizeSent;
+		dispatchWrite();
+		close();
+	}
+
+	void AsyncCopy::onTargetWritable()
+	{
+		ObjectLocker lock(this);
+		m_flagWaitingTarget = sl_false;
+		enqueue();
+	}
+
 	void AsyncCopy::enqueue()
 	{
 		if (!m_flagRunning) {
@@ -1373,6 +2351,17 @@ namespace slib
 			if (m_bufferReading.isNotNull()) {
 				break;
 			}
+			if (m_flagWaitingTarget) {
+				break;
+			}
+			// pauses reading while the target is over its high watermark
+			Ref<AsyncStream> target = m_target;
+			if (target.isNotNull() && !(target->isWritable())) {
+				if (target->notifyWhenWritable(SLIB_FUNCTION_WEAKREF(AsyncCopy, onTargetWritable, this))) {
+					m_flagWaitingTarget = sl_true;
+					break;
+				}
+			}
 			Ref<Buffer> buffer;
 			if (m_buffersRead.popFront(&buffer)) {
 				sl_uint32 size = (sl_uint32)(buffer->mem.getSize());
@@ -1419,7 +2408,7 @@ namespace slib
 			}
 		} while (0);
 
-		if (m_bufferReading.isNull() && m_bufferWriting.isNull()) {
+		if (m_bufferReading.isNull() && m_bufferWriting.isNull() && !m_flagWaitingTarget) {
 			close();
 		}
 
@@ -1524,6 +2513,7 @@ namespace slib
 	AsyncOutputBuffer::AsyncOutputBuffer()
 	{
 		m_lengthOutput = 0;
+		m_sizeBufferedMemory = 0;
 	}
 
 	AsyncOutputBuffer::~AsyncOutputBuffer()
@@ -1533,6 +2523,7 @@ namespace slib
 	void AsyncOutputBuffer::clearOutput()
 	{
 		m_lengthOutput = 0;
+		m_sizeBufferedMemory = 0;
 		m_queueOutput.removeAll();
 	}
 
@@ -1551,6 +2542,7 @@ namespace slib
 		if (link && link->value->isEmptyBody()) {
 			if (link->value->addHeader(mem)) {
 				m_lengthOutput += mem.getSize();
+				m_sizeBufferedMemory += mem.getSize();
 			} else {
 				return sl_false;
 			}
@@ -1559,6 +2551,7 @@ namespace slib
 			if (data.isNotNull()) {
 				m_queueOutput.push(data);
 				m_lengthOutput += mem.getSize();
+				m_sizeBufferedMemory += mem.getSize();
 			} else {
 				return sl_false;
 			}
@@ -1634,6 +2627,31 @@ namespace slib
 		return m_lengthOutput;
 	}
 
+	sl_bool AsyncOutputBuffer::mergeOutput(Memory& output)
+	{
+		ObjectLocker lock(this);
+		Link< Ref<AsyncOutputBufferElement> >* link = m_queueOutput.getFront();
+		if (!link) {
+			output.setNull();
+			return sl_true;
+		}
+		// a new element is started only after a stream
+		if (link->next || !(link->value->isEmptyBody())) {
+			return sl_false;
+		}
+		MemoryQueue& header = link->value->getHeader();
+		Memory mem = header.merge();
+		if (mem.getSize() != header.getSize()) {
+			return sl_false;
+		}
+		header.clear();
+		if (mem.isNotNull()) {
+			header.add(mem);
+		}
+		output = mem;
+		return sl_true;
+	}
+
 /**********************************************
 				AsyncOutput
 **********************************************/
@@ -1644,6 +2662,9 @@ namespace slib
 	{
 		bufferSize = 0x10000;
 		bufferCount = 3;
+		flagUseSendFile = sl_true;
+		highWatermark = 0;
+		lowWatermark = 0;
 	}
 
 	SLIB_DEFINE_OBJECT(AsyncOutput, AsyncOutputBuffer)
@@ -1655,6 +2676,10 @@ namespace slib
 
 		m_bufferCount = 1;
 		m_bufferSize = 0x10000;
+		m_flagUseSendFile = sl_true;
+		m_sizeHighWatermark = 0;
+		m_sizeLowWatermark = 0;
+		m_flagWritingPaused = sl_false;
 	}
 
 	AsyncOutput::~AsyncOutput()
@@ -1691,7 +2716,16 @@ namespace slib
 			ret->m_streamOutput = param.stream;
 			ret->m_bufferSize = param.bufferSize;
 			ret->m_bufferCount = param.bufferCount;
+			ret->m_flagUseSendFile = param.flagUseSendFile;
+			ret->m_sizeHighWatermark = param.highWatermark;
+			if (param.lowWatermark && param.lowWatermark < param.highWatermark) {
+				ret->m_sizeLowWatermark = param.lowWatermark;
+			} else {
+				ret->m_sizeLowWatermark = param.highWatermark / 2;
+			}
 			ret->m_onEnd = param.onEnd;
+			ret->m_onWritable = param.onWritable;
+			ret->m_onDrain = param.onDrain;
 			ret->m_bufWrite = buffer;
 			return ret;
 		}
@@ -1703,6 +2737,39 @@ namespace slib
 		ObjectLocker lock(this);
 		m_queueOutput.merge(&(buffer->m_queueOutput));
 		m_lengthOutput += buffer->m_lengthOutput;
+		m_sizeBufferedMemory += buffer->m_sizeBufferedMemory;
+	}
+
+	sl_uint64 AsyncOutput::getBufferedSize()
+	{
+		return m_sizeBufferedMemory;
+	}
+
+	sl_bool AsyncOutput::isWritable()
+	{
+		if (!m_sizeHighWatermark) {
+			return sl_true;
+		}
+		ObjectLocker lock(this);
+		if (!m_flagWritingPaused && m_sizeBufferedMemory >= m_sizeHighWatermark) {
+			m_flagWritingPaused = sl_true;
+		}
+		return !m_flagWritingPaused;
+	}
+
+	void AsyncOutput::_onWritten(sl_uint64 size)
+	{
+		ObjectLocker lock(this);
+		if (m_sizeBufferedMemory > size) {
+			m_sizeBufferedMemory -= size;
+		} else {
+			m_sizeBufferedMemory = 0;
+		}
+		if (m_flagWritingPaused && m_sizeBufferedMemory <= m_sizeLowWatermark) {
+			m_flagWritingPaused = sl_false;
+			lock.unlock();
+			m_onWritable(this);
+		}
 	}
 
 	void AsyncOutput::startWriting()
@@ -1756,6 +2823,7 @@ namespace slib
 				param.size = sizeBody;
 				param.bufferSize = m_bufferSize;
 				param.bufferCount = m_bufferCount;
+				param.flagUseSendFile = m_flagUseSendFile;
 				param.onEnd = SLIB_FUNCTION_WEAKREF(AsyncOutput, onAsyncCopyEnd, this);
 				Ref<AsyncCopy> copy = AsyncCopy::create(param);
 				if (copy.isNotNull()) {
@@ -1785,6 +2853,7 @@ namespace slib
 			_onError();
 			return;
 		}
+		_onWritten(result->size);
 		_write(sl_true);
 	}
 
@@ -1795,6 +2864,7 @@ namespace slib
 
 	void AsyncOutput::_onComplete()
 	{
+		m_onDrain(this);
 		m_onEnd(this, sl_false);
 	}
 
@@ -1870,10 +2940,7 @@ namespace slib
 	{
 		if (size > 0) {
 			MutexLocker lock(&m_lockReading);
-			Memory memConv = filterRead(data, size, userObject);
-			if (memConv.isNotNull()) {
-				m_bufReadConverted.add(memConv);
-			}
+			transformRead(data, size, userObject, m_bufReadConverted);
 		}
 	}
 
@@ -1918,9 +2985,22 @@ namespace slib
 		do {
 			Function<void(AsyncStreamResult*)> callback = SLIB_FUNCTION_WEAKREF(AsyncStreamFilter, onReadStream, this);
 			if (m_bufReadConverted.getSize() > 0) {
-				if (!(stream->read(sl_null, 0, callback))) {
-					break;
+				// the converted data is served in the callback, without overwriting the reading buffer referenced by the data
+				if (stream->read(sl_null, 0, callback)) {
+					m_flagReading = sl_true;
+					return sl_true;
+				}
+				break;
+			}
+			Ref<AsyncStreamRequest> request;
+			if (m_requestsRead.getFrontValue(&request) && request.isNotNull() && request->data && request->size >= SLIB_ASYNC_STREAM_FILTER_MIN_IN_PLACE_READ_SIZE) {
+				m_requestReadingInPlace = request;
+				if (stream->read(request->data, request->size, callback, request->userObject.get())) {
+					m_flagReading = sl_true;
+					return sl_true;
 				}
+				m_requestReadingInPlace.setNull();
+				break;
 			}
 			Memory mem = m_memReading;
 			if (mem.isNull()) {
@@ -1944,15 +3024,29 @@ namespace slib
 	{
 		MutexLocker lock(&m_lockReading);
 		m_flagReading = sl_false;
+		Ref<AsyncStreamRequest> requestInPlace = m_requestReadingInPlace;
+		m_requestReadingInPlace.setNull();
 		if (!m_flagOpened) {
 			return;
 		}
-		if (result->size > 0) {
-			addReadData(result->data, result->size, result->userObject);
-		}
 		if (result->flagError) {
 			m_flagReadingError = sl_true;
 		}
+		if (requestInPlace.isNotNull() && result->data == requestInPlace->data) {
+			sl_uint32 m = 0;
+			if (result->size > 0) {
+				m = _completeReadInPlace(requestInPlace.get(), result->data, result->size, result->userObject);
+			}
+			if (m > 0 || m_flagReadingError || m_flagReadingEnded) {
+				Ref<AsyncStreamRequest> req;
+				if (m_requestsRead.getFrontValue(&req) && req == requestInPlace) {
+					m_requestsRead.pop();
+					requestInPlace->runCallback(this, m, m_flagReadingError && m_bufReadConverted.getSize() == 0);
+				}
+			}
+		} else if (result->size > 0) {
+			addReadData(result->data, result->size, result->userObject);
+		}
 		if (m_bufReadConverted.getSize() > 0) {
 			for (;;) {
 				Ref<AsyncStreamRequest> req;
@@ -1985,13 +3079,53 @@ namespace slib
 		}
 	}
 
+	sl_uint32 AsyncStreamFilter::_completeReadInPlace(AsyncStreamRequest* request, void* data, sl_uint32 size, Referable* userObject)
+	{
+		MemoryQueue output;
+		transformRead(data, size, userObject, output);
+		sl_uint8* buf = (sl_uint8*)(request->data);
+		sl_uint8* bufEnd = buf + request->size;
+		// compacts the slices in the request buffer, which are in the increasing order as the in-place transforms write
+		sl_uint32 pos = 0;
+		sl_uint8* endPrev = buf;
+		MemoryData slice;
+		while (output.getSize() > 0 && output.pop(slice)) {
+			sl_uint8* p = (sl_uint8*)(slice.data);
+			if (p >= endPrev && p + slice.size <= bufEnd) {
+				if (p != buf + pos) {
+					Base::moveMemory(buf + pos, p, slice.size);
+				}
+				pos += (sl_uint32)(slice.size);
+				endPrev = p + slice.size;
+			} else {
+				// the other slices are served by the queue, after the slices referencing the request buffer are copied
+				for (;;) {
+					p = (sl_uint8*)(slice.data);
+					if (p + slice.size > buf && p < bufEnd) {
+						m_bufReadConverted.add(Memory::create(p, slice.size));
+					} else {
+						m_bufReadConverted.add(slice);
+					}
+					if (!(output.pop(slice))) {
+						break;
+					}
+				}
+				if (pos < request->size) {
+					pos += (sl_uint32)(m_bufReadConverted.pop(buf + pos, request->size - pos));
+				}
+				break;
+			}
+		}
+		return pos;
+	}
+
 	class _priv_AsyncStreamFilter_WriteRequest : public AsyncStreamRequest
 	{
 	public:
-		Memory memConverted;
+		MemoryData memConverted;
 		
 	public:
-		_priv_AsyncStreamFilter_WriteRequest(const Memory& _memConv, const void* data, sl_uint32 size, Referable* userObject, const Function<void(AsyncStreamResult*)>& callback)
+		_priv_AsyncStreamFilter_WriteRequest(const MemoryData& _memConv, const void* data, sl_uint32 size, Referable* userObject, const Function<void(AsyncStreamResult*)>& callback)
 		 : AsyncStreamRequest(data, size, userObject, callback, sl_false), memConverted(_memConv)
 		{
 		}
@@ -2012,10 +3146,25 @@ namespace slib
 			return sl_false;
 		}
 		if (data && size) {
-			Memory memConv = filterWrite(data, size, userObject);
+			MemoryQueue output;
+			transformWrite(data, size, userObject, output);
+			MemoryData memConv;
+			if (output.getSize() > 0) {
+				output.pop(memConv);
+				if (output.getSize() > 0) {
+					// multiple slices are written at once
+					MemoryQueue all;
+					all.add(memConv);
+					all.link(output);
+					Memory mem = all.merge();
+					memConv.data = mem.getData();
+					memConv.size = mem.getSize();
+					memConv.refer = mem.ref;
+				}
+			}
 			Ref<_priv_AsyncStreamFilter_WriteRequest> req = new _priv_AsyncStreamFilter_WriteRequest(memConv, data, size, userObject, callback);
 			if (req.isNotNull()) {
-				return stream->write(memConv.getData(), (sl_uint32)(memConv.getSize()), SLIB_FUNCTION_WEAKREF(AsyncStreamFilter, onWriteStream, this), req.get());
+				return stream->write(memConv.data, (sl_uint32)(memConv.size), SLIB_FUNCTION_WEAKREF(AsyncStreamFilter, onWriteStream, this), req.get());
 			}
 		} else {
 			return stream->write(data, size, callback, userObject);
@@ -2043,6 +3192,22 @@ namespace slib
 		return sl_false;
 	}
 
+	void AsyncStreamFilter::transformRead(void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output)
+	{
+		Memory mem = filterRead(data, size, userObject);
+		if (mem.isNotNull()) {
+			output.add(mem);
+		}
+	}
+
+	void AsyncStreamFilter::transformWrite(const void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output)
+	{
+		Memory mem = filterWrite(data, size, userObject);
+		if (mem.isNotNull()) {
+			output.add(mem);
+		}
+	}
+
 	Memory AsyncStreamFilter::filterRead(void* data, sl_uint32 size, Referable* userObject)
 	{
 		return Memory::createStatic(data, size, userObject);
@@ -2103,4 +3268,95 @@ namespace slib
 		}
 	}
 
+
+/**********************************************
+		AsyncStreamFilterChain
+**********************************************/
+
+	SLIB_DEFINE_OBJECT(AsyncStreamFilterChain, AsyncStreamFilter)
+
+	AsyncStreamFilterChain::AsyncStreamFilterChain()
+	{
+	}
+
+	AsyncStreamFilterChain::~AsyncStreamFilterChain()
+	{
+	}
+
+	Ref<AsyncStreamFilterChain> AsyncStreamFilterChain::create(const Ref<AsyncStream>& source, const List< Ref<AsyncStreamFilter> >& filters)
+	{
+		Ref<AsyncStreamFilterChain> ret = new AsyncStreamFilterChain;
+		if (ret.isNotNull()) {
+			ret->setSourceStream(source);
+			ret->m_filters.addAll(filters.ref.get());
+		}
+		return ret;
+	}
+
+	void AsyncStreamFilterChain::addFilter(const Ref<AsyncStreamFilter>& filter)
+	{
+		if (filter.isNotNull()) {
+			m_filters.add(filter);
+		}
+	}
+
+	List< Ref<AsyncStreamFilter> > AsyncStreamFilterChain::getFilters()
+	{
+		return m_filters.duplicate();
+	}
+
+	static void _priv_AsyncStreamFilterChain_addSlice(MemoryQueue& queue, const void* data, sl_uint32 size, Referable* userObject)
+	{
+		if (size) {
+			MemoryData slice;
+			slice.data = (void*)data;
+			slice.size = size;
+			slice.refer = userObject;
+			queue.add(slice);
+		}
+	}
+
+	void AsyncStreamFilterChain::transformRead(void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output)
+	{
+		ListElements< Ref<AsyncStreamFilter> > filters(getFilters());
+		MemoryQueue input;
+		_priv_AsyncStreamFilterChain_addSlice(input, data, size, userObject);
+		for (sl_size i = 0; i < filters.count; i++) {
+			AsyncStreamFilter* filter = filters[i].get();
+			MemoryQueue out;
+			MemoryData slice;
+			while (input.getSize() > 0 && input.pop(slice)) {
+				filter->transformRead(slice.data, (sl_uint32)(slice.size), slice.refer.get(), out);
+			}
+			if (filter->isReadingError()) {
+				setReadingError();
+			}
+			if (filter->isReadingEnded()) {
+				setReadingEnded();
+			}
+			input.link(out);
+		}
+		output.link(input);
+	}
+
+	void AsyncStreamFilterChain::transformWrite(const void* data, sl_uint32 size, Referable* userObject, MemoryQueue& output)
+	{
+		ListElements< Ref<AsyncStreamFilter> > filters(getFilters());
+		MemoryQueue input;
+		_priv_AsyncStreamFilterChain_addSlice(input, data, size, userObject);
+		for (sl_size i = filters.count; i > 0; i--) {
+			AsyncStreamFilter* filter = filters[i - 1].get();
+			MemoryQueue out;
+			MemoryData slice;
+			while (input.getSize() > 0 && input.pop(slice)) {
+				filter->transformWrite(slice.data, (sl_uint32)(slice.size), slice.refer.get(), out);
+			}
+			if (filter->isWritingError()) {
+				setWritingError();
+			}
+			input.link(out);
+		}
+		output.link(input);
+	}
+
 }
@@ -37,4 +37,8 @@
 
 #define ASYNC_MAX_WAIT_EVENT 256
 
+// timing wheel of AsyncIoLoop: 10ms per slot, 512 slots per round
+#define ASYNC_TIMER_RESOLUTION 10
+#define ASYNC_TIMER_WHEEL_SIZE 512
+
 #endif
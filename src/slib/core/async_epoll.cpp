@@ -26,10 +26,12 @@
 
 #include "slib/core/async.h"
 #include "slib/core/pipe.h"
+#include "slib/core/system.h"
 
 #include <unistd.h>
 #include <sys/epoll.h>
 #include <sys/errno.h>
+#include <sys/timerfd.h>
 
 #if defined(SLIB_PLATFORM_IS_ANDROID)
 #define EPOLL_LOW
@@ -42,8 +44,14 @@ namespace slib
 	{
 		int fdEpoll;
 		Ref<PipeEvent> eventWake;
+		int fdTimer;
+		sl_bool flagTimerArmed;
+		sl_uint32 tickTimerDue;
 	};
 
+	// the address only used to identify the timer event
+	static char _g_priv_AsyncIoLoop_timerEventTag;
+
 	void* AsyncIoLoop::_native_createHandle()
 	{
 		Ref<PipeEvent> pipe = PipeEvent::create();
@@ -61,11 +69,25 @@ namespace slib
 			if (handle) {
 				handle->fdEpoll = fdEpoll;
 				handle->eventWake = pipe;
+				handle->fdTimer = -1;
+				handle->flagTimerArmed = sl_false;
+				handle->tickTimerDue = 0;
 				// register wake event
 				epoll_event ev;
 				ev.data.ptr = sl_null;
 				ev.events = EPOLLIN | EPOLLPRI | EPOLLET;
 				if (0 == epoll_ctl(fdEpoll, EPOLL_CTL_ADD, (int)(pipe->getReadPipeHandle()), &ev)) {
+					// register timer event (the loop falls back to the timeout of `epoll_wait` if timerfd is not available)
+					int fdTimer = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+					if (fdTimer >= 0) {
+						ev.data.ptr = &_g_priv_AsyncIoLoop_timerEventTag;
+						ev.events = EPOLLIN | EPOLLET;
+						if (0 == epoll_ctl(fdEpoll, EPOLL_CTL_ADD, fdTimer, &ev)) {
+							handle->fdTimer = fdTimer;
+						} else {
+							::close(fdTimer);
+						}
+					}
 					return handle;
 				}
 				delete handle;
@@ -78,6 +100,9 @@ namespace slib
 	void AsyncIoLoop::_native_closeHandle(void* _handle)
 	{
 		_priv_AsyncIoLoopHandle* handle = (_priv_AsyncIoLoopHandle*)_handle;
+		if (handle->fdTimer >= 0) {
+			::close(handle->fdTimer);
+		}
 		::close(handle->fdEpoll);
 		delete handle;
 	}
@@ -92,7 +117,26 @@ namespace slib
 
 			_stepBegin();
 
-			int nEvents = ::epoll_wait(handle->fdEpoll, waitEvents, ASYNC_MAX_WAIT_EVENT, -1);
+			// the timer is armed once for the nearest timer of the timing wheel. The timer armed for the earlier time is kept (the loop wakes early once)
+			int timeout = _getTimerWaitTimeout();
+			if (handle->fdTimer >= 0 && timeout > 0) {
+				sl_uint32 tickDue = System::getTickCount() + timeout;
+				if (!(handle->flagTimerArmed) || (sl_int32)(tickDue - handle->tickTimerDue) < 0) {
+					itimerspec spec;
+					Base::zeroMemory(&spec, sizeof(spec));
+					spec.it_value.tv_sec = timeout / 1000;
+					spec.it_value.tv_nsec = (timeout % 1000) * 1000000;
+					if (0 == ::timerfd_settime(handle->fdTimer, 0, &spec, sl_null)) {
+						handle->flagTimerArmed = sl_true;
+						handle->tickTimerDue = tickDue;
+					}
+				}
+				if (handle->flagTimerArmed) {
+					timeout = -1;
+				}
+			}
+
+			int nEvents = ::epoll_wait(handle->fdEpoll, waitEvents, ASYNC_MAX_WAIT_EVENT, timeout);
 			if (nEvents == 0) {
 				m_queueInstancesClosed.removeAll();
 			}
@@ -105,6 +149,13 @@ namespace slib
 
 			for (int i = 0; m_flagRunning && i < nEvents; i++) {
 				epoll_event& ev = waitEvents[i];
+				if (ev.data.ptr == &_g_priv_AsyncIoLoop_timerEventTag) {
+					sl_uint64 nExpirations;
+					while (::read(handle->fdTimer, &nExpirations, sizeof(nExpirations)) > 0) {
+					}
+					handle->flagTimerArmed = sl_false;
+					continue;
+				}
 				AsyncIoInstance* instance = (AsyncIoInstance*)(ev.data.ptr);
 				if (instance) {
 					if (!(instance->isClosing())) {
@@ -174,6 +225,7 @@ namespace slib
 		
 		int ret = ::epoll_ctl(handle->fdEpoll, EPOLL_CTL_ADD, hObject, &ev);
 		if (ret == 0) {
+			instance->setMode(mode);
 			return sl_true;
 		} else {
 			return sl_false;
@@ -84,7 +84,15 @@ namespace slib
 
 			_stepBegin();
 
-			int nEvents = ::kevent(handle->kq, sl_null, 0, waitEvents, ASYNC_MAX_WAIT_EVENT, NULL);
+			struct timespec ts;
+			struct timespec* pts = sl_null;
+			int timeout = _getTimerWaitTimeout();
+			if (timeout >= 0) {
+				ts.tv_sec = timeout / 1000;
+				ts.tv_nsec = (timeout % 1000) * 1000000;
+				pts = &ts;
+			}
+			int nEvents = ::kevent(handle->kq, sl_null, 0, waitEvents, ASYNC_MAX_WAIT_EVENT, pts);
 			if (nEvents == 0) {
 				m_queueInstancesClosed.removeAll();
 			}
@@ -270,6 +270,31 @@ namespace slib
 		return str;
 	}
 	
+	sl_reg File::readAt(sl_uint64 offset, void* _buf, sl_size size)
+	{
+		char* buf = (char*)_buf;
+		if (size == 0) {
+			return 0;
+		}
+		sl_size nRead = 0;
+		while (nRead < size) {
+			sl_size n = size - nRead;
+			if (n > 0x40000000) {
+				n = 0x40000000; // 1GB
+			}
+			sl_int32 m = readAt32(offset + nRead, buf + nRead, (sl_uint32)n);
+			if (m <= 0) {
+				if (nRead) {
+					return nRead;
+				} else {
+					return m;
+				}
+			}
+			nRead += m;
+		}
+		return nRead;
+	}
+
 	Memory File::readAllBytes(sl_size maxSize)
 	{
 		return IO::readAllBytes(maxSize);
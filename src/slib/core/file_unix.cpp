@@ -201,6 +201,50 @@ namespace slib
 		return -1;
 	}
 
+	sl_int32 File::readAt32(sl_uint64 offset, void* buf, sl_uint32 size)
+	{
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			int fd = (int)m_file;
+			ssize_t n = ::pread(fd, buf, size, (off_t)offset);
+			if (n >= 0) {
+				if (n > 0) {
+					return (sl_int32)n;
+				}
+			} else {
+				int err = errno;
+				if (err == EAGAIN || err == EWOULDBLOCK) {
+					return 0;
+				}
+			}
+		}
+		return -1;
+	}
+
+	sl_int32 File::writeAt32(sl_uint64 offset, const void* buf, sl_uint32 size)
+	{
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			int fd = (int)m_file;
+			ssize_t n = ::pwrite(fd, buf, size, (off_t)offset);
+			if (n >= 0) {
+				if (n > 0) {
+					return (sl_int32)n;
+				}
+			} else {
+				int err = errno;
+				if (err == EAGAIN || err == EWOULDBLOCK) {
+					return 0;
+				}
+			}
+		}
+		return -1;
+	}
+
 	sl_bool File::setSize(sl_uint64 newSize)
 	{
 		if (isOpened()) {
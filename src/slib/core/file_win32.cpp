@@ -25,6 +25,7 @@
 #ifdef SLIB_PLATFORM_IS_WIN32
 
 #include "slib/core/file.h"
+#include "slib/core/base.h"
 
 #include <windows.h>
 
@@ -182,6 +183,48 @@ namespace slib
 		return -1;
 	}
 
+	sl_int32 File::readAt32(sl_uint64 offset, void* buf, sl_uint32 size)
+	{
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			sl_uint32 ret = 0;
+			HANDLE handle = (HANDLE)m_file;
+			OVERLAPPED overlapped;
+			Base::zeroMemory(&overlapped, sizeof(overlapped));
+			overlapped.Offset = (DWORD)offset;
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+			if (::ReadFile(handle, buf, size, (DWORD*)&ret, &overlapped)) {
+				if (ret > 0) {
+					return ret;
+				}
+			}
+		}
+		return -1;
+	}
+
+	sl_int32 File::writeAt32(sl_uint64 offset, const void* buf, sl_uint32 size)
+	{
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			sl_uint32 ret = 0;
+			HANDLE handle = (HANDLE)m_file;
+			OVERLAPPED overlapped;
+			Base::zeroMemory(&overlapped, sizeof(overlapped));
+			overlapped.Offset = (DWORD)offset;
+			overlapped.OffsetHigh = (DWORD)(offset >> 32);
+			if (::WriteFile(handle, (LPVOID)buf, size, (DWORD*)&ret, &overlapped)) {
+				if (ret > 0) {
+					return ret;
+				}
+			}
+		}
+		return -1;
+	}
+
 	sl_bool File::setSize(sl_uint64 size)
 	{
 		if (isOpened()) {
@@ -0,0 +1,839 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "slib/core/shared_memory_channel.h"
+
+#include "slib/core/system.h"
+
+#if defined(SLIB_PLATFORM_IS_LINUX) && !defined(SLIB_PLATFORM_IS_ANDROID)
+#define SHARED_MEMORY_CHANNEL_SUPPORTED
+#endif
+
+#if defined(SHARED_MEMORY_CHANNEL_SUPPORTED)
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/eventfd.h>
+#include <linux/futex.h>
+#endif
+
+#define SHARED_MEMORY_CHANNEL_MAGIC 0x43534C53 // SLSC
+#define SHARED_MEMORY_CHANNEL_DEFAULT_CAPACITY 0x100000
+#define SHARED_MEMORY_CHANNEL_MIN_CAPACITY 0x1000
+#define SHARED_MEMORY_CHANNEL_MAX_CAPACITY 0x40000000
+
+#define RECORD_FLAG_COMMITTED 1
+#define RECORD_FLAG_PADDING 2
+
+#define WAITING_THREAD 1
+#define WAITING_ASYNC 2
+
+// maximum number of the messages dispatched by an event, to be fair to the other instances on the loop
+#define ASYNC_RECEIVE_BATCH 1024
+
+namespace slib
+{
+
+	// placed at the beginning of the shared memory, followed by the ring. The positions are increased monotonically
+	struct _priv_SharedMemoryChannel_Header
+	{
+		sl_uint32 magic;
+		sl_uint32 capacity;
+		sl_uint32 flagMultipleProducers;
+		sl_uint8 _pad0[52];
+		// written position (reserved position for the multiple producers)
+		sl_uint64 head;
+		sl_uint8 _pad1[56];
+		// read position
+		sl_uint64 tail;
+		sl_uint8 _pad2[56];
+		// futex, increased when the waiting thread is woken
+		sl_int32 sequence;
+		sl_int32 waiting;
+		sl_uint8 _pad3[56];
+	};
+
+	// 8 bytes aligned in the ring
+	struct _priv_SharedMemoryChannel_Record
+	{
+		sl_uint32 size;
+		sl_uint32 flags;
+	};
+
+	SLIB_INLINE static sl_uint64 _priv_SharedMemoryChannel_getRecordSize(sl_uint32 size)
+	{
+		return sizeof(_priv_SharedMemoryChannel_Record) + (((sl_uint64)size + 7) & ~((sl_uint64)7));
+	}
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(SharedMemoryChannelParam)
+
+	SharedMemoryChannelParam::SharedMemoryChannelParam()
+	{
+		flagCreate = sl_true;
+		capacity = SHARED_MEMORY_CHANNEL_DEFAULT_CAPACITY;
+		flagMultipleProducers = sl_false;
+		handle = SLIB_FILE_INVALID_HANDLE;
+		eventHandle = SLIB_FILE_INVALID_HANDLE;
+	}
+
+
+	SLIB_DEFINE_OBJECT(SharedMemoryChannel, Object)
+
+	SharedMemoryChannel::SharedMemoryChannel()
+	{
+		m_header = sl_null;
+		m_ring = sl_null;
+		m_capacity = 0;
+		m_flagBroken = sl_false;
+		m_sizeMapped = 0;
+		m_flagMultipleProducers = sl_false;
+		m_handle = SLIB_FILE_INVALID_HANDLE;
+		m_handleEvent = SLIB_FILE_INVALID_HANDLE;
+		m_flagEventFd = sl_false;
+	}
+
+	SharedMemoryChannel::~SharedMemoryChannel()
+	{
+		close();
+	}
+
+	Ref<SharedMemoryChannel> SharedMemoryChannel::create(sl_uint32 capacity, sl_bool flagMultipleProducers)
+	{
+		SharedMemoryChannelParam param;
+		if (capacity) {
+			param.capacity = capacity;
+		}
+		param.flagMultipleProducers = flagMultipleProducers;
+		return create(param);
+	}
+
+	Ref<SharedMemoryChannel> SharedMemoryChannel::create(const String& name, sl_uint32 capacity, sl_bool flagMultipleProducers)
+	{
+		SharedMemoryChannelParam param;
+		param.name = name;
+		if (capacity) {
+			param.capacity = capacity;
+		}
+		param.flagMultipleProducers = flagMultipleProducers;
+		return create(param);
+	}
+
+	Ref<SharedMemoryChannel> SharedMemoryChannel::open(const String& name)
+	{
+		SharedMemoryChannelParam param;
+		param.name = name;
+		param.flagCreate = sl_false;
+		return create(param);
+	}
+
+	sl_bool SharedMemoryChannel::isOpened()
+	{
+		return m_header != sl_null;
+	}
+
+	sl_file SharedMemoryChannel::getHandle()
+	{
+		return m_handle;
+	}
+
+	sl_file SharedMemoryChannel::getEventHandle()
+	{
+		return m_handleEvent;
+	}
+
+	sl_uint32 SharedMemoryChannel::getCapacity()
+	{
+		return m_capacity;
+	}
+
+	sl_uint32 SharedMemoryChannel::getMaxMessageSize()
+	{
+		// a message never needs more than the whole ring with the padding at the end
+		if (m_capacity) {
+			return (m_capacity >> 1) - sizeof(_priv_SharedMemoryChannel_Record);
+		}
+		return 0;
+	}
+
+	sl_bool SharedMemoryChannel::isMultipleProducers()
+	{
+		return m_flagMultipleProducers;
+	}
+
+	sl_bool SharedMemoryChannel::write(const Memory& mem)
+	{
+		return write(mem.getData(), (sl_uint32)(mem.getSize()));
+	}
+
+	void* SharedMemoryChannel::peek(sl_uint32& size)
+	{
+		return _peek(size, sl_false);
+	}
+
+	Memory SharedMemoryChannel::peek()
+	{
+		sl_uint32 size;
+		void* data = _peek(size, sl_false);
+		if (data) {
+			return Memory::createStatic(data, size, this);
+		}
+		return sl_null;
+	}
+
+	sl_bool SharedMemoryChannel::pop()
+	{
+		sl_uint32 size;
+		return _peek(size, sl_true) != sl_null;
+	}
+
+	Memory SharedMemoryChannel::read()
+	{
+		sl_uint32 size;
+		void* data = _peek(size, sl_false);
+		if (data) {
+			Memory ret = Memory::create(data, size);
+			_peek(size, sl_true);
+			return ret;
+		}
+		return sl_null;
+	}
+
+	sl_bool SharedMemoryChannel::isEmpty()
+	{
+		sl_uint32 size;
+		return _peek(size, sl_false) == sl_null;
+	}
+
+	sl_bool SharedMemoryChannel::isBroken()
+	{
+		return m_flagBroken;
+	}
+
+#if defined(SHARED_MEMORY_CHANNEL_SUPPORTED)
+
+	static String _priv_SharedMemoryChannel_getName(const String& name)
+	{
+		if (name.startsWith('/')) {
+			return name;
+		}
+		return "/" + name;
+	}
+
+	static String _priv_SharedMemoryChannel_getFifoPath(const String& name)
+	{
+		return "/dev/shm" + name + ".event";
+	}
+
+	static int _priv_SharedMemoryChannel_futex(sl_int32* addr, int op, sl_int32 value, const struct timespec* timeout)
+	{
+		// not private: the futex is shared between the processes
+		return (int)(syscall(SYS_futex, addr, op, value, timeout, sl_null, 0));
+	}
+
+	Ref<SharedMemoryChannel> SharedMemoryChannel::create(const SharedMemoryChannelParam& param)
+	{
+		String name;
+		if (param.name.isNotEmpty()) {
+			name = _priv_SharedMemoryChannel_getName(param.name);
+		}
+		sl_bool flagCreate = param.flagCreate;
+		sl_uint32 capacity = 0;
+		if (flagCreate) {
+			capacity = SHARED_MEMORY_CHANNEL_MIN_CAPACITY;
+			while (capacity < param.capacity && capacity < SHARED_MEMORY_CHANNEL_MAX_CAPACITY) {
+				capacity <<= 1;
+			}
+		}
+
+		int fd = -1;
+		int fdEvent = -1;
+		sl_bool flagEventFd = sl_false;
+		if (name.isNotEmpty()) {
+			String pathFifo = _priv_SharedMemoryChannel_getFifoPath(name);
+			if (flagCreate) {
+				fd = ::shm_open(name.getData(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+				if (fd >= 0) {
+					::unlink(pathFifo.getData());
+					::mkfifo(pathFifo.getData(), 0600);
+				}
+			} else {
+				fd = ::shm_open(name.getData(), O_RDWR | O_CLOEXEC, 0);
+			}
+			if (fd >= 0) {
+				// opened for reading and writing to keep the FIFO alive without blocking, regardless of the peers
+				fdEvent = ::open(pathFifo.getData(), O_RDWR | O_NONBLOCK | O_CLOEXEC);
+			}
+		} else {
+			if (flagCreate) {
+				// inheritable
+				fd = (int)(syscall(SYS_memfd_create, "slib_shared_memory_channel", 0));
+				if (fd >= 0) {
+					fdEvent = ::eventfd(0, EFD_NONBLOCK);
+				}
+			} else {
+				if (param.handle != SLIB_FILE_INVALID_HANDLE && param.eventHandle != SLIB_FILE_INVALID_HANDLE) {
+					fd = ::dup((int)(param.handle));
+					fdEvent = ::dup((int)(param.eventHandle));
+				}
+			}
+			flagEventFd = sl_true;
+		}
+		if (fd < 0) {
+			return sl_null;
+		}
+		if (fdEvent < 0) {
+			::close(fd);
+			return sl_null;
+		}
+
+		sl_size sizeMapped = 0;
+		if (flagCreate) {
+			sizeMapped = sizeof(_priv_SharedMemoryChannel_Header) + capacity;
+			if (::ftruncate(fd, sizeMapped) != 0) {
+				sizeMapped = 0;
+			}
+		} else {
+			struct stat st;
+			if (::fstat(fd, &st) == 0 && st.st_size > (off_t)sizeof(_priv_SharedMemoryChannel_Header)) {
+				sizeMapped = (sl_size)(st.st_size);
+			}
+		}
+		void* mem = MAP_FAILED;
+		if (sizeMapped) {
+			mem = ::mmap(sl_null, sizeMapped, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		}
+		if (mem != MAP_FAILED) {
+			_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)mem;
+			sl_bool flagValid = sl_false;
+			if (flagCreate) {
+				// the new memory is filled with zero
+				header->capacity = capacity;
+				header->flagMultipleProducers = param.flagMultipleProducers ? 1 : 0;
+				__atomic_store_n(&(header->magic), SHARED_MEMORY_CHANNEL_MAGIC, __ATOMIC_RELEASE);
+				flagValid = sl_true;
+			} else {
+				if (__atomic_load_n(&(header->magic), __ATOMIC_ACQUIRE) == SHARED_MEMORY_CHANNEL_MAGIC) {
+					capacity = header->capacity;
+					if (capacity >= SHARED_MEMORY_CHANNEL_MIN_CAPACITY && !(capacity & (capacity - 1)) && sizeof(_priv_SharedMemoryChannel_Header) + capacity <= sizeMapped) {
+						flagValid = sl_true;
+					}
+				}
+			}
+			if (flagValid) {
+				Ref<SharedMemoryChannel> ret = new SharedMemoryChannel;
+				if (ret.isNotNull()) {
+					ret->m_header = header;
+					ret->m_ring = (sl_uint8*)mem + sizeof(_priv_SharedMemoryChannel_Header);
+					ret->m_capacity = capacity;
+					ret->m_sizeMapped = sizeMapped;
+					ret->m_flagMultipleProducers = header->flagMultipleProducers != 0;
+					ret->m_handle = (sl_file)fd;
+					ret->m_handleEvent = (sl_file)fdEvent;
+					ret->m_flagEventFd = flagEventFd;
+					return ret;
+				}
+			}
+			::munmap(mem, sizeMapped);
+		}
+		::close(fd);
+		::close(fdEvent);
+		return sl_null;
+	}
+
+	void SharedMemoryChannel::remove(const String& _name)
+	{
+		if (_name.isEmpty()) {
+			return;
+		}
+		String name = _priv_SharedMemoryChannel_getName(_name);
+		::shm_unlink(name.getData());
+		::unlink(_priv_SharedMemoryChannel_getFifoPath(name).getData());
+	}
+
+	void SharedMemoryChannel::close()
+	{
+		ObjectLocker lock(this);
+		if (m_header) {
+			::munmap(m_header, m_sizeMapped);
+			m_header = sl_null;
+			m_ring = sl_null;
+		}
+		if (m_handle != SLIB_FILE_INVALID_HANDLE) {
+			::close((int)m_handle);
+			m_handle = SLIB_FILE_INVALID_HANDLE;
+		}
+		if (m_handleEvent != SLIB_FILE_INVALID_HANDLE) {
+			::close((int)m_handleEvent);
+			m_handleEvent = SLIB_FILE_INVALID_HANDLE;
+		}
+	}
+
+	sl_bool SharedMemoryChannel::write(const void* data, sl_uint32 size)
+	{
+		_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)m_header;
+		if (!header) {
+			return sl_false;
+		}
+		if (size > getMaxMessageSize()) {
+			return sl_false;
+		}
+		sl_uint64 capacity = m_capacity;
+		sl_uint64 mask = capacity - 1;
+		sl_uint64 sizeRecord = _priv_SharedMemoryChannel_getRecordSize(size);
+		sl_uint64 head, offset, sizeReserve;
+		if (m_flagMultipleProducers) {
+			for (;;) {
+				// loaded before the head, so that it does not exceed the head
+				sl_uint64 tail = __atomic_load_n(&(header->tail), __ATOMIC_ACQUIRE);
+				head = __atomic_load_n(&(header->head), __ATOMIC_RELAXED);
+				offset = head & mask;
+				sizeReserve = sizeRecord;
+				if (offset + sizeRecord > capacity) {
+					sizeReserve += capacity - offset;
+				}
+				if (head + sizeReserve - tail > capacity) {
+					return sl_false;
+				}
+				if (__atomic_compare_exchange_n(&(header->head), &head, head + sizeReserve, sl_true, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+					break;
+				}
+			}
+		} else {
+			head = header->head;
+			offset = head & mask;
+			sizeReserve = sizeRecord;
+			if (offset + sizeRecord > capacity) {
+				sizeReserve += capacity - offset;
+			}
+			sl_uint64 tail = __atomic_load_n(&(header->tail), __ATOMIC_ACQUIRE);
+			if (head + sizeReserve - tail > capacity) {
+				return sl_false;
+			}
+		}
+		if (sizeReserve != sizeRecord) {
+			// the message is not split: skips to the beginning of the ring
+			_priv_SharedMemoryChannel_Record* padding = (_priv_SharedMemoryChannel_Record*)(m_ring + offset);
+			padding->size = (sl_uint32)(capacity - offset - sizeof(_priv_SharedMemoryChannel_Record));
+			__atomic_store_n(&(padding->flags), RECORD_FLAG_PADDING | RECORD_FLAG_COMMITTED, __ATOMIC_RELEASE);
+			offset = 0;
+		}
+		_priv_SharedMemoryChannel_Record* record = (_priv_SharedMemoryChannel_Record*)(m_ring + offset);
+		record->size = size;
+		Base::copyMemory(record + 1, data, size);
+		__atomic_store_n(&(record->flags), RECORD_FLAG_COMMITTED, __ATOMIC_RELEASE);
+		if (!m_flagMultipleProducers) {
+			__atomic_store_n(&(header->head), head + sizeReserve, __ATOMIC_RELEASE);
+		}
+		_notify();
+		return sl_true;
+	}
+
+	void* SharedMemoryChannel::_peek(sl_uint32& size, sl_bool flagPop)
+	{
+		_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)m_header;
+		if (!header) {
+			return sl_null;
+		}
+		if (m_flagBroken) {
+			return sl_null;
+		}
+		sl_uint64 capacity = m_capacity;
+		sl_uint64 mask = capacity - 1;
+		// only the reader changes the tail
+		sl_uint64 tail = header->tail;
+		for (;;) {
+			sl_uint64 head = __atomic_load_n(&(header->head), __ATOMIC_ACQUIRE);
+			if (tail == head) {
+				return sl_null;
+			}
+			sl_uint64 offset = tail & mask;
+			// the ring is writable by the other processes: the positions and the sizes are not trusted
+			if ((offset & 7) || head - tail > capacity) {
+				m_flagBroken = sl_true;
+				return sl_null;
+			}
+			_priv_SharedMemoryChannel_Record* record = (_priv_SharedMemoryChannel_Record*)(m_ring + offset);
+			sl_uint32 flags = __atomic_load_n(&(record->flags), __ATOMIC_ACQUIRE);
+			if (!(flags & RECORD_FLAG_COMMITTED)) {
+				// reserved by a producer, but not written yet
+				return sl_null;
+			}
+			if (flags & RECORD_FLAG_PADDING) {
+				if (sizeof(_priv_SharedMemoryChannel_Record) + (sl_uint64)(record->size) != capacity - offset) {
+					m_flagBroken = sl_true;
+					return sl_null;
+				}
+				if (m_flagMultipleProducers) {
+					Base::zeroMemory(record, sizeof(_priv_SharedMemoryChannel_Record));
+				}
+				tail += capacity - offset;
+				__atomic_store_n(&(header->tail), tail, __ATOMIC_RELEASE);
+				continue;
+			}
+			size = record->size;
+			sl_uint64 sizeRecord = _priv_SharedMemoryChannel_getRecordSize(size);
+			if (sizeRecord > capacity - offset || sizeRecord > head - tail) {
+				m_flagBroken = sl_true;
+				return sl_null;
+			}
+			if (flagPop) {
+				if (m_flagMultipleProducers) {
+					// the producers rely on the committed flag, so the ring must be cleared before reused
+					Base::zeroMemory(record, (sl_size)sizeRecord);
+				}
+				__atomic_store_n(&(header->tail), tail + sizeRecord, __ATOMIC_RELEASE);
+			}
+			return record + 1;
+		}
+	}
+
+	void SharedMemoryChannel::_notify()
+	{
+		_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)m_header;
+		// orders the written message before reading the waiting flags (pairs with the fence in the reader)
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (!(__atomic_load_n(&(header->waiting), __ATOMIC_RELAXED))) {
+			return;
+		}
+		// only one producer wakes the reader
+		sl_int32 waiting = __atomic_exchange_n(&(header->waiting), 0, __ATOMIC_ACQ_REL);
+		if (waiting & WAITING_THREAD) {
+			__atomic_add_fetch(&(header->sequence), 1, __ATOMIC_RELEASE);
+			_priv_SharedMemoryChannel_futex(&(header->sequence), FUTEX_WAKE, 1, sl_null);
+		}
+		if (waiting & WAITING_ASYNC) {
+			int fd = (int)m_handleEvent;
+			if (m_flagEventFd) {
+				sl_uint64 n = 1;
+				ssize_t ret = ::write(fd, &n, sizeof(n));
+				SLIB_UNUSED(ret);
+			} else {
+				char c = 1;
+				ssize_t ret = ::write(fd, &c, 1);
+				SLIB_UNUSED(ret);
+			}
+		}
+	}
+
+	sl_bool SharedMemoryChannel::wait(sl_int32 timeout)
+	{
+		_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)m_header;
+		if (!header) {
+			return sl_false;
+		}
+		if (!(isEmpty())) {
+			return sl_true;
+		}
+		sl_uint32 tickStart = System::getTickCount();
+		for (;;) {
+			sl_int32 sequence = __atomic_load_n(&(header->sequence), __ATOMIC_ACQUIRE);
+			__atomic_or_fetch(&(header->waiting), WAITING_THREAD, __ATOMIC_SEQ_CST);
+			__atomic_thread_fence(__ATOMIC_SEQ_CST);
+			if (!(isEmpty())) {
+				return sl_true;
+			}
+			if (timeout >= 0) {
+				sl_uint32 elapsed = System::getTickCount() - tickStart;
+				if (elapsed >= (sl_uint32)timeout) {
+					return sl_false;
+				}
+				sl_uint32 t = (sl_uint32)timeout - elapsed;
+				struct timespec ts;
+				ts.tv_sec = t / 1000;
+				ts.tv_nsec = (t % 1000) * 1000000;
+				_priv_SharedMemoryChannel_futex(&(header->sequence), FUTEX_WAIT, sequence, &ts);
+			} else {
+				_priv_SharedMemoryChannel_futex(&(header->sequence), FUTEX_WAIT, sequence, sl_null);
+			}
+			// woken by a writer, but the first message can still be being written by another writer
+			if (!(isEmpty())) {
+				return sl_true;
+			}
+		}
+	}
+
+	sl_bool SharedMemoryChannel::requestEvent()
+	{
+		_priv_SharedMemoryChannel_Header* header = (_priv_SharedMemoryChannel_Header*)m_header;
+		if (!header) {
+			return sl_false;
+		}
+		__atomic_or_fetch(&(header->waiting), WAITING_ASYNC, __ATOMIC_SEQ_CST);
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		return isEmpty();
+	}
+
+	void SharedMemoryChannel::clearEvent()
+	{
+		int fd = (int)m_handleEvent;
+		if (fd < 0) {
+			return;
+		}
+		char buf[64];
+		while (::read(fd, buf, sizeof(buf)) > 0) {
+			if (m_flagEventFd) {
+				break;
+			}
+		}
+	}
+
+#else
+
+	Ref<SharedMemoryChannel> SharedMemoryChannel::create(const SharedMemoryChannelParam& param)
+	{
+		return sl_null;
+	}
+
+	void SharedMemoryChannel::remove(const String& name)
+	{
+	}
+
+	void SharedMemoryChannel::close()
+	{
+	}
+
+	sl_bool SharedMemoryChannel::write(const void* data, sl_uint32 size)
+	{
+		return sl_false;
+	}
+
+	void* SharedMemoryChannel::_peek(sl_uint32& size, sl_bool flagPop)
+	{
+		return sl_null;
+	}
+
+	void SharedMemoryChannel::_notify()
+	{
+	}
+
+	sl_bool SharedMemoryChannel::wait(sl_int32 timeout)
+	{
+		return sl_false;
+	}
+
+	sl_bool SharedMemoryChannel::requestEvent()
+	{
+		return sl_false;
+	}
+
+	void SharedMemoryChannel::clearEvent()
+	{
+	}
+
+#endif
+
+
+	class _priv_AsyncSharedMemoryChannelInstance : public AsyncIoInstance
+	{
+	public:
+		Ref<SharedMemoryChannel> m_channel;
+		sl_bool m_flagRunning;
+
+	public:
+		_priv_AsyncSharedMemoryChannelInstance()
+		{
+			m_flagRunning = sl_false;
+		}
+
+		~_priv_AsyncSharedMemoryChannelInstance()
+		{
+			close();
+		}
+
+	public:
+		static Ref<_priv_AsyncSharedMemoryChannelInstance> create(const Ref<SharedMemoryChannel>& channel)
+		{
+			sl_file handle = channel->getEventHandle();
+			if (handle != SLIB_FILE_INVALID_HANDLE) {
+				Ref<_priv_AsyncSharedMemoryChannelInstance> ret = new _priv_AsyncSharedMemoryChannelInstance;
+				if (ret.isNotNull()) {
+					ret->m_channel = channel;
+					ret->setHandle(handle);
+					return ret;
+				}
+			}
+			return sl_null;
+		}
+
+		void close() override
+		{
+			m_flagRunning = sl_false;
+			// the handle is owned by the channel
+			setHandle(SLIB_FILE_INVALID_HANDLE);
+			m_channel.setNull();
+		}
+
+		void start()
+		{
+			ObjectLocker lock(this);
+			if (m_flagRunning) {
+				return;
+			}
+			m_flagRunning = sl_true;
+			requestOrder();
+		}
+
+		void onOrder() override
+		{
+			processReceive();
+		}
+
+		void onEvent(EventDesc* pev) override
+		{
+			Ref<SharedMemoryChannel> channel = m_channel;
+			if (channel.isNull()) {
+				return;
+			}
+			channel->clearEvent();
+			processReceive();
+		}
+
+		void processReceive()
+		{
+			if (!m_flagRunning) {
+				return;
+			}
+			Ref<SharedMemoryChannel> channel = m_channel;
+			if (channel.isNull()) {
+				return;
+			}
+			Ref<AsyncSharedMemoryChannel> object = Ref<AsyncSharedMemoryChannel>::from(getObject());
+			if (object.isNull()) {
+				return;
+			}
+			sl_uint32 nReceived = 0;
+			for (;;) {
+				sl_uint32 size;
+				void* data = channel->peek(size);
+				if (data) {
+					object->_onReceive(data, size);
+					channel->pop();
+					nReceived++;
+					if (nReceived >= ASYNC_RECEIVE_BATCH) {
+						requestOrder();
+						return;
+					}
+				} else {
+					if (channel->requestEvent()) {
+						return;
+					}
+				}
+			}
+		}
+
+	};
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(AsyncSharedMemoryChannelParam)
+
+	AsyncSharedMemoryChannelParam::AsyncSharedMemoryChannelParam()
+	{
+		flagAutoStart = sl_true;
+	}
+
+
+	SLIB_DEFINE_OBJECT(AsyncSharedMemoryChannel, AsyncIoObject)
+
+	AsyncSharedMemoryChannel::AsyncSharedMemoryChannel()
+	{
+	}
+
+	AsyncSharedMemoryChannel::~AsyncSharedMemoryChannel()
+	{
+	}
+
+	Ref<AsyncSharedMemoryChannel> AsyncSharedMemoryChannel::create(const AsyncSharedMemoryChannelParam& param)
+	{
+		Ref<SharedMemoryChannel> channel = param.channel;
+		if (channel.isNull()) {
+			return sl_null;
+		}
+		Ref<AsyncIoLoop> loop = param.ioLoop;
+		if (loop.isNull()) {
+			loop = AsyncIoLoop::getDefault();
+			if (loop.isNull()) {
+				return sl_null;
+			}
+		}
+		Ref<_priv_AsyncSharedMemoryChannelInstance> instance = _priv_AsyncSharedMemoryChannelInstance::create(channel);
+		if (instance.isNotNull()) {
+			Ref<AsyncSharedMemoryChannel> ret = new AsyncSharedMemoryChannel;
+			if (ret.isNotNull()) {
+				ret->m_channel = channel;
+				ret->m_onReceive = param.onReceive;
+				instance->setObject(ret.get());
+				ret->setIoInstance(instance.get());
+				ret->setIoLoop(loop);
+				if (loop->attachInstance(instance.get(), AsyncIoMode::In)) {
+					if (param.flagAutoStart) {
+						ret->start();
+					}
+					return ret;
+				}
+			}
+		}
+		return sl_null;
+	}
+
+	void AsyncSharedMemoryChannel::close()
+	{
+		closeIoInstance();
+	}
+
+	sl_bool AsyncSharedMemoryChannel::isOpened()
+	{
+		return getIoInstance().isNotNull();
+	}
+
+	void AsyncSharedMemoryChannel::start()
+	{
+		Ref<_priv_AsyncSharedMemoryChannelInstance> instance = Ref<_priv_AsyncSharedMemoryChannelInstance>::from(getIoInstance());
+		if (instance.isNotNull()) {
+			instance->start();
+		}
+	}
+
+	sl_bool AsyncSharedMemoryChannel::isRunning()
+	{
+		Ref<_priv_AsyncSharedMemoryChannelInstance> instance = Ref<_priv_AsyncSharedMemoryChannelInstance>::from(getIoInstance());
+		if (instance.isNotNull()) {
+			return instance->m_flagRunning;
+		}
+		return sl_false;
+	}
+
+	Ref<SharedMemoryChannel> AsyncSharedMemoryChannel::getChannel()
+	{
+		return m_channel;
+	}
+
+	void AsyncSharedMemoryChannel::_onReceive(void* data, sl_uint32 size)
+	{
+		m_onReceive(this, data, size);
+	}
+
+}
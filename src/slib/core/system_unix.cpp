@@ -133,6 +133,15 @@ namespace slib
 		return getpid();
 	}
 
+	sl_uint32 System::getProcessorCount()
+	{
+		long n = sysconf(_SC_NPROCESSORS_ONLN);
+		if (n > 0) {
+			return (sl_uint32)n;
+		}
+		return 1;
+	}
+
 	sl_uint32 System::getThreadId()
 	{
 #if defined(SLIB_PLATFORM_IS_APPLE)
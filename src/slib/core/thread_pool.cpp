@@ -129,6 +129,12 @@ namespace slib
 				task();
 			} else {
 				ObjectLocker lock(this);
+				// the task can be added after the above check, without waking any worker
+				if (m_tasks.pop(&task)) {
+					lock.unlock();
+					task();
+					continue;
+				}
 				sl_size nThreads = m_threadWorkers.getCount();
 				if (nThreads > getMinimumThreadsCount()) {
 					m_threadWorkers.remove_NoLock(thread);
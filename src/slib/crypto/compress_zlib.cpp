@@ -42,6 +42,7 @@ namespace slib
 	ZlibCompress::ZlibCompress()
 	{
 		m_flagStarted = sl_false;
+		m_flagFinished = sl_false;
 	}
 
 	ZlibCompress::~ZlibCompress()
@@ -51,7 +52,7 @@ namespace slib
 
 	sl_bool ZlibCompress::isStarted()
 	{
-		return m_flagStarted;
+		return m_flagStarted && !m_flagFinished;
 	}
 
 	sl_bool ZlibCompress::start(sl_int32 level)
@@ -63,6 +64,7 @@ namespace slib
 		int iRet = deflateInit2(STREAM, level, Z_DEFLATED, 15, 8, Z_DEFAULT_STRATEGY);
 		if (iRet == Z_OK) {
 			m_flagStarted = sl_true;
+			m_flagFinished = sl_false;
 			return sl_true;
 		}
 		return sl_false;
@@ -77,6 +79,7 @@ namespace slib
 		int iRet = deflateInit2(STREAM, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
 		if (iRet == Z_OK) {
 			m_flagStarted = sl_true;
+			m_flagFinished = sl_false;
 			return sl_true;
 		}
 		return sl_false;
@@ -103,6 +106,7 @@ namespace slib
 			iRet = deflateSetHeader(STREAM, GZIP_HEADER);
 			if (iRet == Z_OK) {
 				m_flagStarted = sl_true;
+				m_flagFinished = sl_false;
 				return sl_true;
 			} else {
 				deflateEnd(STREAM);
@@ -122,7 +126,22 @@ namespace slib
 		, void* output, sl_uint32 sizeOutputAvailable, sl_uint32& sizeOutputUsed
 		, sl_bool flagFinish)
 	{
-		if (!m_flagStarted) {
+		return _compress(input, sizeInputAvailable, sizeInputPassed, output, sizeOutputAvailable, sizeOutputUsed, flagFinish ? Z_FINISH : Z_NO_FLUSH);
+	}
+
+	sl_int32 ZlibCompress::flush(
+		const void* input, sl_uint32 sizeInputAvailable, sl_uint32& sizeInputPassed
+		, void* output, sl_uint32 sizeOutputAvailable, sl_uint32& sizeOutputUsed)
+	{
+		return _compress(input, sizeInputAvailable, sizeInputPassed, output, sizeOutputAvailable, sizeOutputUsed, Z_SYNC_FLUSH);
+	}
+
+	sl_int32 ZlibCompress::_compress(
+		const void* input, sl_uint32 sizeInputAvailable, sl_uint32& sizeInputPassed
+		, void* output, sl_uint32 sizeOutputAvailable, sl_uint32& sizeOutputUsed
+		, sl_int32 flush)
+	{
+		if (!m_flagStarted || m_flagFinished) {
 			return Z_STREAM_ERROR;
 		}
 		z_stream* stream = STREAM;
@@ -132,7 +151,11 @@ namespace slib
 		stream->avail_in = sizeInputAvailable;
 		stream->next_out = (Bytef*)output;
 		stream->avail_out = sizeOutputAvailable;
-		int iRet = deflate(stream, flagFinish ? Z_FINISH : Z_NO_FLUSH);
+		int iRet = deflate(stream, flush);
+		if (iRet == Z_BUF_ERROR) {
+			// no progress is possible, not fatal
+			iRet = Z_OK;
+		}
 		if (iRet < 0) {
 			abort();
 			return iRet;
@@ -140,7 +163,7 @@ namespace slib
 		sizeInputPassed = sizeInputAvailable - stream->avail_in;
 		sizeOutputUsed = sizeOutputAvailable - stream->avail_out;
 		if (iRet == Z_STREAM_END) {
-			abort();
+			m_flagFinished = sl_true;
 			return 0;
 		}
 		return 1;
@@ -186,11 +209,61 @@ namespace slib
 		return ret;
 	}
 
+	Memory ZlibCompress::flush(const void* _data, sl_size size)
+	{
+		sl_uint8* data = (sl_uint8*)_data;
+		sl_uint32 sizeChunk;
+		if (size > 16384) {
+			sizeChunk = 262144;
+		} else {
+			sizeChunk = 4096;
+		}
+		Memory memChunk = Memory::create(sizeChunk);
+		if (memChunk.isNull()) {
+			return sl_null;
+		}
+		sl_uint8* chunk = (sl_uint8*)(memChunk.getData());
+
+		MemoryBuffer buffer;
+		while (1) {
+			sl_uint32 sizeInput = (sl_uint32)(SLIB_MIN(size, 0x40000000));
+			sl_uint32 sizeInputPassed = 0, sizeOutputUsed = 0;
+			sl_int32 iRet = flush(data, sizeInput, sizeInputPassed, chunk, sizeChunk, sizeOutputUsed);
+			if (iRet < 0) {
+				return sl_null;
+			}
+			if (sizeOutputUsed > 0) {
+				buffer.add(Memory::create(chunk, sizeOutputUsed));
+			}
+			data += sizeInputPassed;
+			size -= sizeInputPassed;
+			// the flush is completed when the output is not full
+			if (size == 0 && sizeOutputUsed < sizeChunk) {
+				break;
+			}
+		}
+		return buffer.merge();
+	}
+
+	sl_bool ZlibCompress::reset()
+	{
+		if (!m_flagStarted) {
+			return sl_false;
+		}
+		if (deflateReset(STREAM) != Z_OK) {
+			abort();
+			return sl_false;
+		}
+		m_flagFinished = sl_false;
+		return sl_true;
+	}
+
 	void ZlibCompress::abort()
 	{
 		if (m_flagStarted) {
 			deflateEnd(STREAM);
 			m_flagStarted = sl_false;
+			m_flagFinished = sl_false;
 		}
 	}
 
@@ -257,6 +330,9 @@ namespace slib
 		int iRet = inflate(stream, Z_NO_FLUSH);
 		if (iRet == Z_NEED_DICT) {
 			iRet = Z_DATA_ERROR;
+		} else if (iRet == Z_BUF_ERROR) {
+			// no progress is possible, not fatal
+			iRet = Z_OK;
 		}
 		if (iRet < 0) {
 			abort();
@@ -417,7 +493,12 @@ namespace slib
 	{
 		ZlibDecompress zlib;
 		if (zlib.start()) {
-			return zlib.decompress(data, size);
+			Memory ret = zlib.decompress(data, size);
+			// the stream is not finished (truncated input)
+			if (zlib.isStarted()) {
+				return sl_null;
+			}
+			return ret;
 		}
 		return sl_null;
 	}
@@ -426,7 +507,12 @@ namespace slib
 	{
 		ZlibDecompress zlib;
 		if (zlib.startRaw()) {
-			return zlib.decompress(data, size);
+			Memory ret = zlib.decompress(data, size);
+			// the stream is not finished (truncated input)
+			if (zlib.isStarted()) {
+				return sl_null;
+			}
+			return ret;
 		}
 		return sl_null;
 	}
@@ -23,9 +23,17 @@
 #include "slib/network/dns.h"
 
 #include "slib/network/event.h"
+#include "slib/network/os.h"
 #include "slib/core/scoped.h"
 #include "slib/core/mio.h"
 #include "slib/core/log.h"
+#include "slib/core/system.h"
+#include "slib/core/thread.h"
+#include "slib/core/thread_pool.h"
+#include "slib/core/dispatch.h"
+#include "slib/core/file.h"
+#include "slib/core/math.h"
+#include "slib/core/safe_static.h"
 
 #define PRIV_MAX_NAME SLIB_NETWORK_DNS_NAME_MAX_LENGTH
 
@@ -543,6 +551,7 @@ namespace slib
 	{
 		id = 0;
 		flagQuestion = sl_false;
+		responseCode = DnsResponseCode::NoError;
 	}
 
 	sl_bool DnsPacket::parsePacket(const void* packet, sl_uint32 size)
@@ -560,6 +569,7 @@ namespace slib
 				flagQuestion = sl_false;
 			}
 			id = header->getId();
+			responseCode = header->getResponseCode();
 			
 			sl_uint32 i, n;
 			sl_uint32 offset = sizeof(DnsHeader);
@@ -593,6 +603,7 @@ namespace slib
 					IPv4Address addr = record.parseData_A();
 					if (addr.isNotZero()) {
 						item.address = addr;
+						item.TTL = record.getTTL();
 						addresses.add(item);
 					}
 				} else if (type == DnsRecordType::AAAA) {
@@ -601,6 +612,7 @@ namespace slib
 					IPv6Address addr = record.parseData_AAAA();
 					if (addr.isNotZero()) {
 						item.address = addr;
+						item.TTL = record.getTTL();
 						addresses.add(item);
 					}
 				} else if (type == DnsRecordType::CNAME) {
@@ -635,6 +647,11 @@ namespace slib
 	}
 
 	Memory DnsPacket::buildQuestionPacket(sl_uint16 id, const String& host)
+	{
+		return buildQuestionPacket(id, host, DnsRecordType::A);
+	}
+
+	Memory DnsPacket::buildQuestionPacket(sl_uint16 id, const String& host, DnsRecordType type)
 	{
 		char buf[1024];
 		DnsHeader* header = (DnsHeader*)buf;
@@ -646,7 +663,7 @@ namespace slib
 		header->setQuestionsCount(1);
 		DnsQuestionRecord record;
 		record.setName(host);
-		record.setType(DnsRecordType::A);
+		record.setType(type);
 		sl_uint32 size = record.buildRecord(buf, sizeof(DnsHeader), 1024);
 		if (size > 0) {
 			return Memory::create(buf, size);
@@ -721,14 +738,78 @@ namespace slib
 	
 	DnsClientParam::DnsClientParam()
 	{
+		serverAddress.setNone();
+		resolveTimeout = 1000;
+		resolveRetryCount = 2;
+		maxCacheTTL = 3600;
+		negativeCacheTTL = 30;
+	}
+
+#define DNS_CLIENT_SYSTEM_RESOLVER_THREADS 4
+#define DNS_CLIENT_SOURCE_PORT_BEGIN 49152
+#define DNS_CLIENT_SOURCE_PORT_COUNT 16384
+#define DNS_CLIENT_SOURCE_PORT_TRIES 8
+
+	// the query ids and the source port are the only secrets against the spoofed answers
+	static void _priv_DnsClient_getRandom(void* buf, sl_uint32 size)
+	{
+#if defined(SLIB_PLATFORM_IS_UNIX)
+		Ref<File> file = File::openForRead("/dev/urandom");
+		if (file.isNotNull()) {
+			if (file->readFully(buf, size) == (sl_reg)size) {
+				return;
+			}
+		}
+#endif
+		Math::randomMemory(buf, size);
+	}
+
+	static Ref<Socket> _priv_DnsClient_openSocket(sl_bool flagIPv6)
+	{
+		Ref<Socket> socket;
+		if (flagIPv6) {
+			socket = Socket::openUdp_IPv6();
+		} else {
+			socket = Socket::openUdp();
+		}
+		if (socket.isNull()) {
+			return sl_null;
+		}
+		sl_uint16 ports[DNS_CLIENT_SOURCE_PORT_TRIES];
+		_priv_DnsClient_getRandom(ports, sizeof(ports));
+		for (sl_uint32 i = 0; i < DNS_CLIENT_SOURCE_PORT_TRIES; i++) {
+			SocketAddress address;
+			if (flagIPv6) {
+				address.ip = IPv6Address::zero();
+			} else {
+				address.ip = IPv4Address::zero();
+			}
+			address.port = DNS_CLIENT_SOURCE_PORT_BEGIN + ports[i] % DNS_CLIENT_SOURCE_PORT_COUNT;
+			if (socket->bind(address)) {
+				return socket;
+			}
+		}
+		// the port chosen by the system
+		return socket;
+	}
+
+	static Ref<ThreadPool> _priv_DnsClient_getSystemResolver()
+	{
+		SLIB_SAFE_STATIC(Ref<ThreadPool>, ret, ThreadPool::create(0, DNS_CLIENT_SYSTEM_RESOLVER_THREADS))
+		if (SLIB_SAFE_STATIC_CHECK_FREED(ret)) {
+			return sl_null;
+		}
+		return ret;
 	}
 
-	
 	SLIB_DEFINE_OBJECT(DnsClient, Object)
 
 	DnsClient::DnsClient()
 	{
-		m_idLast = 0;
+		m_resolveTimeout = 1000;
+		m_resolveRetryCount = 2;
+		m_maxCacheTTL = 3600;
+		m_negativeCacheTTL = 30;
 	}
 
 	DnsClient::~DnsClient()
@@ -740,10 +821,24 @@ namespace slib
 		Ref<DnsClient> ret = new DnsClient;
 		if (ret.isNotNull()) {
 			ret->m_onAnswer = param.onAnswer;
+			ret->m_serverAddress = param.serverAddress;
+			if (ret->m_serverAddress.isInvalid()) {
+				ListElements<IPAddress> servers(Network::getDnsServers());
+				if (servers.count > 0) {
+					ret->m_serverAddress = SocketAddress(servers[0], SLIB_NETWORK_DNS_PORT);
+				}
+			}
+			ret->m_resolveTimeout = param.resolveTimeout;
+			ret->m_resolveRetryCount = param.resolveRetryCount;
+			ret->m_maxCacheTTL = param.maxCacheTTL;
+			ret->m_negativeCacheTTL = param.negativeCacheTTL;
 			AsyncUdpSocketParam up;
 			up.onReceiveFrom = SLIB_FUNCTION_WEAKREF(DnsClient, _onReceiveFrom, ret);
 			up.packetSize = 4096;
 			up.ioLoop = param.ioLoop;
+			up.flagIPv6 = ret->m_serverAddress.ip.isIPv6();
+			up.socket = _priv_DnsClient_openSocket(up.flagIPv6);
+			up.flagAutoStart = sl_true;
 			Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
 			if (socket.isNotNull()) {
 				ret->m_udp = socket;
@@ -752,9 +847,22 @@ namespace slib
 		return ret;
 	}
 
+	Ref<DnsClient> DnsClient::getDefault()
+	{
+		SLIB_SAFE_STATIC(Ref<DnsClient>, ret, create(DnsClientParam()))
+		if (SLIB_SAFE_STATIC_CHECK_FREED(ret)) {
+			return sl_null;
+		}
+		return ret;
+	}
+
 	void DnsClient::sendQuestion(const SocketAddress& serverAddress, const String& hostName)
 	{
-		sl_uint16 id = m_idLast++;
+		sl_uint16 id;
+		{
+			ObjectLocker lock(this);
+			id = _generateId_NoLock();
+		}
 		Memory mem = DnsPacket::buildQuestionPacket(id, hostName);
 		if (mem.isNotNull()) {
 			m_udp->sendTo(serverAddress, mem);
@@ -766,10 +874,88 @@ namespace slib
 		sendQuestion(SocketAddress(serverIp, SLIB_NETWORK_DNS_PORT), hostName);
 	}
 
+	void DnsClient::resolveHost(const String& _hostName, const Function<void(const List<IPAddress>& addresses)>& callback)
+	{
+		String hostName = _hostName.toLower();
+		if (hostName.isEmpty()) {
+			callback(sl_null);
+			return;
+		}
+		{
+			IPAddress ip;
+			if (ip.parse(hostName)) {
+				callback(List<IPAddress>::createFromElement(ip));
+				return;
+			}
+		}
+		Ref<ResolveRequest> request;
+		{
+			ObjectLocker lock(this);
+			CacheElement* cache = m_cache.getItemPointer(hostName);
+			if (cache) {
+				if ((sl_uint32)(System::getTickCount() - cache->tickUpdated) < cache->TTL) {
+					List<IPAddress> addresses = cache->addresses;
+					lock.unlock();
+					callback(addresses);
+					return;
+				}
+				m_cache.remove_NoLock(hostName);
+			}
+			if (m_mapResolving.get_NoLock(hostName, &request)) {
+				request->callbacks.add_NoLock(callback);
+				return;
+			}
+			request = new ResolveRequest;
+			if (request.isNull()) {
+				lock.unlock();
+				callback(sl_null);
+				return;
+			}
+			request->hostName = hostName;
+			request->serverAddress = m_serverAddress;
+			request->flagAnsweredA = sl_false;
+			request->flagAnsweredAAAA = sl_false;
+			request->TTL = m_maxCacheTTL;
+			request->nRetry = 0;
+			request->flagFinished = sl_false;
+			request->callbacks.add_NoLock(callback);
+			m_mapResolving.put_NoLock(hostName, request);
+			if (m_udp.isNull() || request->serverAddress.isInvalid()) {
+				lock.unlock();
+				_resolveBySystem(request);
+				return;
+			}
+			request->idA = _generateId_NoLock();
+			m_mapResolvingIds.put_NoLock(request->idA, request);
+			request->idAAAA = _generateId_NoLock();
+			m_mapResolvingIds.put_NoLock(request->idAAAA, request);
+		}
+		_sendResolveQuestions(request.get());
+		WeakRef<DnsClient> weak = this;
+		Dispatch::setTimeout([weak, request]() {
+			Ref<DnsClient> client = weak;
+			if (client.isNotNull()) {
+				client->_onResolveTimeout(request, 0);
+			}
+		}, m_resolveTimeout);
+	}
+
+	void DnsClient::clearCache()
+	{
+		ObjectLocker lock(this);
+		m_cache.removeAll_NoLock();
+	}
+
 	void DnsClient::_onReceiveFrom(AsyncUdpSocket* socket, const SocketAddress& address, void* data, sl_uint32 sizeReceive)
 	{
 		DnsPacket packet;
 		if (packet.parsePacket(data, sizeReceive)) {
+			if (packet.flagQuestion) {
+				return;
+			}
+			if (_onResolveAnswer(address, packet)) {
+				return;
+			}
 			_onAnswer(address, packet);
 		}
 	}
@@ -779,6 +965,214 @@ namespace slib
 		m_onAnswer(this, serverAddress, packet);
 	}
 
+	void DnsClient::_sendResolveQuestions(ResolveRequest* request)
+	{
+		// the answers of AAAA are preferred for connecting, so it is asked first
+		if (!(request->flagAnsweredAAAA)) {
+			Memory mem = DnsPacket::buildQuestionPacket(request->idAAAA, request->hostName, DnsRecordType::AAAA);
+			if (mem.isNotNull()) {
+				m_udp->sendTo(request->serverAddress, mem);
+			}
+		}
+		if (!(request->flagAnsweredA)) {
+			Memory mem = DnsPacket::buildQuestionPacket(request->idA, request->hostName, DnsRecordType::A);
+			if (mem.isNotNull()) {
+				m_udp->sendTo(request->serverAddress, mem);
+			}
+		}
+	}
+
+	void DnsClient::_onResolveTimeout(const Ref<ResolveRequest>& request, sl_uint32 nRetry)
+	{
+		{
+			ObjectLocker lock(this);
+			if (request->flagFinished || request->nRetry != nRetry) {
+				return;
+			}
+			if (nRetry >= m_resolveRetryCount) {
+				m_mapResolvingIds.remove_NoLock(request->idA);
+				m_mapResolvingIds.remove_NoLock(request->idAAAA);
+				if (request->flagAnsweredA || request->flagAnsweredAAAA) {
+					// one of the families is answered: the other is given up
+					List<IPAddress> addresses = request->addressesAAAA;
+					addresses.addAll_NoLock(request->addressesA);
+					if (addresses.isNotEmpty()) {
+						lock.unlock();
+						_finishResolve(request.get(), addresses, request->TTL);
+						return;
+					}
+				}
+				lock.unlock();
+				_resolveBySystem(request);
+				return;
+			}
+			nRetry++;
+			request->nRetry = nRetry;
+		}
+		_sendResolveQuestions(request.get());
+		WeakRef<DnsClient> weak = this;
+		Dispatch::setTimeout([weak, request, nRetry]() {
+			Ref<DnsClient> client = weak;
+			if (client.isNotNull()) {
+				client->_onResolveTimeout(request, nRetry);
+			}
+		}, m_resolveTimeout);
+	}
+
+	sl_bool DnsClient::_onResolveAnswer(const SocketAddress& serverAddress, const DnsPacket& packet)
+	{
+		ObjectLocker lock(this);
+		Ref<ResolveRequest> request;
+		if (!(m_mapResolvingIds.get_NoLock(packet.id, &request))) {
+			return sl_false;
+		}
+		if (request->serverAddress != serverAddress) {
+			return sl_false;
+		}
+		if (request->flagFinished) {
+			return sl_true;
+		}
+		// the answer must repeat the question: otherwise it is dropped as spoofed, and the real answer is still awaited
+		{
+			DnsRecordType type = packet.id == request->idA ? DnsRecordType::A : DnsRecordType::AAAA;
+			ListElements<DnsPacket::Question> questions(packet.questions);
+			if (questions.count != 1 || questions[0].type != type || questions[0].name.toLower() != request->hostName) {
+				return sl_true;
+			}
+		}
+		List<IPAddress>* addresses;
+		if (packet.id == request->idA) {
+			if (request->flagAnsweredA) {
+				return sl_true;
+			}
+			request->flagAnsweredA = sl_true;
+			addresses = &(request->addressesA);
+		} else {
+			if (request->flagAnsweredAAAA) {
+				return sl_true;
+			}
+			request->flagAnsweredAAAA = sl_true;
+			addresses = &(request->addressesAAAA);
+		}
+		m_mapResolvingIds.remove_NoLock(packet.id);
+		{
+			ListElements<DnsPacket::Address> items(packet.addresses);
+			for (sl_size i = 0; i < items.count; i++) {
+				DnsPacket::Address& item = items[i];
+				if ((packet.id == request->idA) == item.address.isIPv4()) {
+					addresses->add_NoLock(item.address);
+					if (item.TTL < request->TTL) {
+						request->TTL = item.TTL;
+					}
+				}
+			}
+		}
+		if (!(request->flagAnsweredA && request->flagAnsweredAAAA)) {
+			return sl_true;
+		}
+		List<IPAddress> result = request->addressesAAAA;
+		result.addAll_NoLock(request->addressesA);
+		lock.unlock();
+		if (result.isNotEmpty()) {
+			_finishResolve(request.get(), result, request->TTL);
+		} else {
+			_resolveBySystem(request);
+		}
+		return sl_true;
+	}
+
+	void DnsClient::_resolveBySystem(const Ref<ResolveRequest>& request)
+	{
+		Ref<ThreadPool> resolver = _priv_DnsClient_getSystemResolver();
+		if (resolver.isNull()) {
+			_finishResolve(request.get(), sl_null, m_negativeCacheTTL);
+			return;
+		}
+		WeakRef<DnsClient> weak = this;
+		resolver->addTask([weak, request]() {
+			List<IPAddress> addresses;
+			{
+				// IPv6 addresses first, without the duplicates of the socket types
+				ListElements<IPAddress> list(Network::getIPAddressesFromHostName(request->hostName));
+				for (sl_size i = 0; i < list.count; i++) {
+					if (list[i].isIPv6() && !(addresses.contains_NoLock(list[i]))) {
+						addresses.add_NoLock(list[i]);
+					}
+				}
+				for (sl_size i = 0; i < list.count; i++) {
+					if (list[i].isIPv4() && !(addresses.contains_NoLock(list[i]))) {
+						addresses.add_NoLock(list[i]);
+					}
+				}
+			}
+			Ref<DnsClient> client = weak;
+			if (client.isNotNull()) {
+				// the system does not give the TTL: kept as short as the negative result
+				client->_finishResolve(request.get(), addresses, client->m_negativeCacheTTL);
+			}
+		});
+	}
+
+#define DNS_CLIENT_MAX_CACHE_COUNT 4096
+
+	sl_uint16 DnsClient::_generateId_NoLock()
+	{
+		sl_uint16 ids[8];
+		_priv_DnsClient_getRandom(ids, sizeof(ids));
+		for (sl_uint32 i = 0; i < 8; i++) {
+			if (!(m_mapResolvingIds.find_NoLock(ids[i]))) {
+				return ids[i];
+			}
+		}
+		return ids[0];
+	}
+
+	void DnsClient::_finishResolve(ResolveRequest* request, const List<IPAddress>& addresses, sl_uint32 TTL)
+	{
+		List< Function<void(const List<IPAddress>&)> > callbacks;
+		{
+			ObjectLocker lock(this);
+			if (request->flagFinished) {
+				return;
+			}
+			request->flagFinished = sl_true;
+			m_mapResolving.remove_NoLock(request->hostName);
+			callbacks = request->callbacks;
+			request->callbacks.setNull();
+			if (addresses.isEmpty()) {
+				TTL = m_negativeCacheTTL;
+			} else if (TTL > m_maxCacheTTL) {
+				TTL = m_maxCacheTTL;
+			}
+			if (TTL) {
+				sl_uint32 tickNow = System::getTickCount();
+				if (m_cache.getCount() >= DNS_CLIENT_MAX_CACHE_COUNT) {
+					List<String> expired;
+					for (auto& item : m_cache) {
+						if ((sl_uint32)(tickNow - item.value.tickUpdated) >= item.value.TTL) {
+							expired.add_NoLock(item.key);
+						}
+					}
+					ListElements<String> keys(expired);
+					for (sl_size i = 0; i < keys.count; i++) {
+						m_cache.remove_NoLock(keys[i]);
+					}
+				}
+				if (m_cache.getCount() < DNS_CLIENT_MAX_CACHE_COUNT) {
+					CacheElement cache;
+					cache.addresses = addresses;
+					cache.tickUpdated = tickNow;
+					cache.TTL = TTL * 1000;
+					m_cache.put_NoLock(request->hostName, cache);
+				}
+			}
+		}
+		ListElements< Function<void(const List<IPAddress>&)> > list(callbacks);
+		for (sl_size i = 0; i < list.count; i++) {
+			list[i](addresses);
+		}
+	}
+
 /*************************************************************
 					DnsServer
 *************************************************************/
@@ -809,6 +1203,8 @@ namespace slib
 		flagEncryptDefaultForward = sl_false;
 
 		flagAutoStart = sl_true;
+
+		batchCount = 32;
 	}
 
 	void DnsServerParam::parse(const Json& conf)
@@ -822,6 +1218,8 @@ namespace slib
 		IPv4Address defaultForwardAddressIp = IPv4Address(8, 8, 4, 4);
 		defaultForwardAddressIp.parse(conf.getItem("forward_dns").getString());
 		defaultForwardAddress = SocketAddress(defaultForwardAddressIp, SLIB_NETWORK_DNS_PORT);
+
+		batchCount = conf.getItem("batch_count").getUint32(32);
 	}
 
 
@@ -845,6 +1243,40 @@ namespace slib
 
 #define TAG_SERVER "DnsServer"
 
+	static List< Ref<AsyncUdpSocket> > _priv_DnsServer_createSockets(AsyncUdpSocketParam& up, const Ref<AsyncIoLoopGroup>& group)
+	{
+		List< Ref<AsyncUdpSocket> > sockets;
+		sl_uint32 nLoops = group.isNotNull() ? group->getCount() : 0;
+		if (nLoops > 1) {
+			up.flagReusePort = sl_true;
+			for (sl_uint32 i = 0; i < nLoops; i++) {
+				up.ioLoop = group->getLoop(i);
+				Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
+				if (socket.isNull()) {
+					break;
+				}
+				sockets.add_NoLock(socket);
+			}
+			up.flagReusePort = sl_false;
+			if (sockets.getCount() == nLoops) {
+				return sockets;
+			}
+			// SO_REUSEPORT is not supported: falls back to the single socket
+			for (sl_size i = 0; i < sockets.getCount(); i++) {
+				sockets.getValueAt(i)->close();
+			}
+			sockets.removeAll_NoLock();
+		}
+		if (nLoops) {
+			up.ioLoop = group->getLoop(0);
+		}
+		Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
+		if (socket.isNotNull()) {
+			sockets.add_NoLock(socket);
+		}
+		return sockets;
+	}
+
 	Ref<DnsServer> DnsServer::create(const DnsServerParam& param)
 	{
 		Ref<DnsServer> ret = new DnsServer;
@@ -854,45 +1286,50 @@ namespace slib
 			AsyncUdpSocketParam up;
 			up.onReceiveFrom = SLIB_FUNCTION_WEAKREF(DnsServer, _onReceiveFrom, ret);
 			up.packetSize = 4096;
+			up.batchCount = param.batchCount;
 			up.ioLoop = param.ioLoop;
 			up.flagAutoStart = sl_false;
 			
 			up.bindAddress.port = param.portDns;
-			Ref<AsyncUdpSocket> socketDns = AsyncUdpSocket::create(up);
-			if (socketDns.isNull()) {
+			List< Ref<AsyncUdpSocket> > socketsDns = _priv_DnsServer_createSockets(up, param.ioLoopGroup);
+			if (socketsDns.isEmpty()) {
 				LogError(TAG_SERVER, "Failed to bind to port %d", param.portDns);
 				return sl_null;
 			}
 			
 			up.bindAddress.port = param.portEncryption;
-			Ref<AsyncUdpSocket> socketEncrypt = AsyncUdpSocket::create(up);
-			if (socketEncrypt.isNull()) {
+			List< Ref<AsyncUdpSocket> > socketsEncrypt;
+			if (param.portEncryption) {
+				socketsEncrypt = _priv_DnsServer_createSockets(up, param.ioLoopGroup);
+			} else {
+				// ephemeral port can not be shared by SO_REUSEPORT
+				socketsEncrypt = _priv_DnsServer_createSockets(up, sl_null);
+			}
+			if (socketsEncrypt.isEmpty()) {
 				LogError(TAG_SERVER, "Failed to bind to port %d", param.portEncryption);
 				return sl_null;
 			}
 
-			if (socketDns.isNotNull() || socketEncrypt.isNotNull()) {
+			ret->m_udpDns = socketsDns.getValueAt(0);
+			ret->m_udpsDns = socketsDns;
+			ret->m_udpEncrypt = socketsEncrypt.getValueAt(0);
+			ret->m_udpsEncrypt = socketsEncrypt;
 
-				ret->m_udpDns = socketDns;
-				ret->m_udpEncrypt = socketEncrypt;
+			ret->m_encrypt.setKey_SHA256(param.encryptionKey);
 
-				ret->m_encrypt.setKey_SHA256(param.encryptionKey);
+			ret->m_flagProxy = param.flagProxy;
 
-				ret->m_flagProxy = param.flagProxy;
+			ret->m_defaultForwardAddress = param.defaultForwardAddress;
+			ret->m_flagEncryptDefaultForward = param.flagEncryptDefaultForward;
 
-				ret->m_defaultForwardAddress = param.defaultForwardAddress;
-				ret->m_flagEncryptDefaultForward = param.flagEncryptDefaultForward;
-
-				ret->m_onResolve = param.onResolve;
-				ret->m_onCache = param.onCache;
-
-				ret->m_flagInit = sl_true;
-				if (param.flagAutoStart) {
-					ret->start();
-				}
-				return ret;
+			ret->m_onResolve = param.onResolve;
+			ret->m_onCache = param.onCache;
 
+			ret->m_flagInit = sl_true;
+			if (param.flagAutoStart) {
+				ret->start();
 			}
+			return ret;
 			
 		}
 		return sl_null;
@@ -907,11 +1344,17 @@ namespace slib
 		m_flagInit = sl_false;
 
 		m_flagRunning = sl_false;
-		if (m_udpDns.isNotNull()) {
-			m_udpDns->close();
+		{
+			ListElements< Ref<AsyncUdpSocket> > sockets(m_udpsDns);
+			for (sl_size i = 0; i < sockets.count; i++) {
+				sockets[i]->close();
+			}
 		}
-		if (m_udpEncrypt.isNotNull()) {
-			m_udpEncrypt->close();
+		{
+			ListElements< Ref<AsyncUdpSocket> > sockets(m_udpsEncrypt);
+			for (sl_size i = 0; i < sockets.count; i++) {
+				sockets[i]->close();
+			}
 		}
 	}
 
@@ -924,11 +1367,17 @@ namespace slib
 		if (m_flagRunning) {
 			return;
 		}
-		if (m_udpDns.isNotNull()) {
-			m_udpDns->start();
+		{
+			ListElements< Ref<AsyncUdpSocket> > sockets(m_udpsDns);
+			for (sl_size i = 0; i < sockets.count; i++) {
+				sockets[i]->start();
+			}
 		}
-		if (m_udpEncrypt.isNotNull()) {
-			m_udpEncrypt->start();
+		{
+			ListElements< Ref<AsyncUdpSocket> > sockets(m_udpsEncrypt);
+			for (sl_size i = 0; i < sockets.count; i++) {
+				sockets[i]->start();
+			}
 		}
 		m_flagRunning = sl_true;
 	}
@@ -962,7 +1411,8 @@ namespace slib
 		
 		// forward DNS request
 		{
-			sl_uint16 idForward = m_lastForwardId++;
+			// the requests can be received on the several loops
+			sl_uint16 idForward = (sl_uint16)(Base::interlockedIncrement32(&m_lastForwardId));
 			ForwardElement fe;
 			fe.requestedId = id;
 			fe.requestedHostName = hostName;
@@ -1146,9 +1596,20 @@ namespace slib
 	void DnsServer::_onReceiveFrom(AsyncUdpSocket* socket, const SocketAddress& addressFrom, void* data, sl_uint32 size)
 	{
 		sl_bool flagEncrypted = sl_false;
-		Memory memDecrypt;
 		if (socket == m_udpEncrypt) {
 			flagEncrypted = sl_true;
+		} else if (socket != m_udpDns) {
+			ListElements< Ref<AsyncUdpSocket> > sockets(m_udpsEncrypt);
+			for (sl_size i = 0; i < sockets.count; i++) {
+				if (sockets[i] == socket) {
+					flagEncrypted = sl_true;
+					break;
+				}
+			}
+		}
+		Memory memDecrypt;
+		if (flagEncrypted) {
+			flagEncrypted = sl_true;
 			memDecrypt = m_encrypt.decrypt_CBC_PKCS7Padding(data, size);
 			if (memDecrypt.isNull()) {
 				return;
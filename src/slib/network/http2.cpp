@@ -0,0 +1,814 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+#include "slib/network/http2.h"
+
+#include "slib/core/base.h"
+
+#define PRIV_HPACK_ENTRY_OVERHEAD 32
+// the encoder does not use the larger dynamic table even if the peer allows
+#define PRIV_HPACK_ENCODER_TABLE_SIZE_MAX 4096
+
+namespace slib
+{
+
+	struct _priv_HpackStaticEntry
+	{
+		const char* name;
+		sl_uint32 lengthName;
+		const char* value;
+		sl_uint32 lengthValue;
+	};
+
+	static const sl_uint32 _priv_Hpack_HuffmanCodes[257] = {
+		0x1ff8, 0x7fffd8, 0xfffffe2, 0xfffffe3, 0xfffffe4, 0xfffffe5, 0xfffffe6, 0xfffffe7,
+		0xfffffe8, 0xffffea, 0x3ffffffc, 0xfffffe9, 0xfffffea, 0x3ffffffd, 0xfffffeb, 0xfffffec,
+		0xfffffed, 0xfffffee, 0xfffffef, 0xffffff0, 0xffffff1, 0xffffff2, 0x3ffffffe, 0xffffff3,
+		0xffffff4, 0xffffff5, 0xffffff6, 0xffffff7, 0xffffff8, 0xffffff9, 0xffffffa, 0xffffffb,
+		0x14, 0x3f8, 0x3f9, 0xffa, 0x1ff9, 0x15, 0xf8, 0x7fa,
+		0x3fa, 0x3fb, 0xf9, 0x7fb, 0xfa, 0x16, 0x17, 0x18,
+		0x0, 0x1, 0x2, 0x19, 0x1a, 0x1b, 0x1c, 0x1d,
+		0x1e, 0x1f, 0x5c, 0xfb, 0x7ffc, 0x20, 0xffb, 0x3fc,
+		0x1ffa, 0x21, 0x5d, 0x5e, 0x5f, 0x60, 0x61, 0x62,
+		0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69, 0x6a,
+		0x6b, 0x6c, 0x6d, 0x6e, 0x6f, 0x70, 0x71, 0x72,
+		0xfc, 0x73, 0xfd, 0x1ffb, 0x7fff0, 0x1ffc, 0x3ffc, 0x22,
+		0x7ffd, 0x3, 0x23, 0x4, 0x24, 0x5, 0x25, 0x26,
+		0x27, 0x6, 0x74, 0x75, 0x28, 0x29, 0x2a, 0x7,
+		0x2b, 0x76, 0x2c, 0x8, 0x9, 0x2d, 0x77, 0x78,
+		0x79, 0x7a, 0x7b, 0x7ffe, 0x7fc, 0x3ffd, 0x1ffd, 0xffffffc,
+		0xfffe6, 0x3fffd2, 0xfffe7, 0xfffe8, 0x3fffd3, 0x3fffd4, 0x3fffd5, 0x7fffd9,
+		0x3fffd6, 0x7fffda, 0x7fffdb, 0x7fffdc, 0x7fffdd, 0x7fffde, 0xffffeb, 0x7fffdf,
+		0xffffec, 0xffffed, 0x3fffd7, 0x7fffe0, 0xffffee, 0x7fffe1, 0x7fffe2, 0x7fffe3,
+		0x7fffe4, 0x1fffdc, 0x3fffd8, 0x7fffe5, 0x3fffd9, 0x7fffe6, 0x7fffe7, 0xffffef,
+		0x3fffda, 0x1fffdd, 0xfffe9, 0x3fffdb, 0x3fffdc, 0x7fffe8, 0x7fffe9, 0x1fffde,
+		0x7fffea, 0x3fffdd, 0x3fffde, 0xfffff0, 0x1fffdf, 0x3fffdf, 0x7fffeb, 0x7fffec,
+		0x1fffe0, 0x1fffe1, 0x3fffe0, 0x1fffe2, 0x7fffed, 0x3fffe1, 0x7fffee, 0x7fffef,
+		0xfffea, 0x3fffe2, 0x3fffe3, 0x3fffe4, 0x7ffff0, 0x3fffe5, 0x3fffe6, 0x7ffff1,
+		0x3ffffe0, 0x3ffffe1, 0xfffeb, 0x7fff1, 0x3fffe7, 0x7ffff2, 0x3fffe8, 0x1ffffec,
+		0x3ffffe2, 0x3ffffe3, 0x3ffffe4, 0x7ffffde, 0x7ffffdf, 0x3ffffe5, 0xfffff1, 0x1ffffed,
+		0x7fff2, 0x1fffe3, 0x3ffffe6, 0x7ffffe0, 0x7ffffe1, 0x3ffffe7, 0x7ffffe2, 0xfffff2,
+		0x1fffe4, 0x1fffe5, 0x3ffffe8, 0x3ffffe9, 0xffffffd, 0x7ffffe3, 0x7ffffe4, 0x7ffffe5,
+		0xfffec, 0xfffff3, 0xfffed, 0x1fffe6, 0x3fffe9, 0x1fffe7, 0x1fffe8, 0x7ffff3,
+		0x3fffea, 0x3fffeb, 0x1ffffee, 0x1ffffef, 0xfffff4, 0xfffff5, 0x3ffffea, 0x7ffff4,
+		0x3ffffeb, 0x7ffffe6, 0x3ffffec, 0x3ffffed, 0x7ffffe7, 0x7ffffe8, 0x7ffffe9, 0x7ffffea,
+		0x7ffffeb, 0xffffffe, 0x7ffffec, 0x7ffffed, 0x7ffffee, 0x7ffffef, 0x7fffff0, 0x3ffffee,
+		0x3fffffff
+	};
+
+	static const sl_uint8 _priv_Hpack_HuffmanLengths[257] = {
+		13, 23, 28, 28, 28, 28, 28, 28, 28, 24, 30, 28, 28, 30, 28, 28,
+		28, 28, 28, 28, 28, 28, 30, 28, 28, 28, 28, 28, 28, 28, 28, 28,
+		6, 10, 10, 12, 13, 6, 8, 11, 10, 10, 8, 11, 8, 6, 6, 6,
+		5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 7, 8, 15, 6, 12, 10,
+		13, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7,
+		7, 7, 7, 7, 7, 7, 7, 7, 8, 7, 8, 13, 19, 13, 14, 6,
+		15, 5, 6, 5, 6, 5, 6, 6, 6, 5, 7, 7, 6, 6, 6, 5,
+		6, 7, 6, 5, 5, 6, 7, 7, 7, 7, 7, 15, 11, 14, 13, 28,
+		20, 22, 20, 20, 22, 22, 22, 23, 22, 23, 23, 23, 23, 23, 24, 23,
+		24, 24, 22, 23, 24, 23, 23, 23, 23, 21, 22, 23, 22, 23, 23, 24,
+		22, 21, 20, 22, 22, 23, 23, 21, 23, 22, 22, 24, 21, 22, 23, 23,
+		21, 21, 22, 21, 23, 22, 23, 23, 20, 22, 22, 22, 23, 22, 22, 23,
+		26, 26, 20, 19, 22, 23, 22, 25, 26, 26, 26, 27, 27, 26, 24, 25,
+		19, 21, 26, 27, 27, 26, 27, 24, 21, 21, 26, 26, 28, 27, 27, 27,
+		20, 24, 20, 21, 22, 21, 21, 23, 22, 22, 25, 25, 24, 24, 26, 23,
+		26, 27, 26, 26, 27, 27, 27, 27, 27, 28, 27, 27, 27, 27, 27, 26,
+		30
+	};
+
+	// symbols sorted by the code (canonical Huffman code)
+	static const sl_uint16 _priv_Hpack_HuffmanSymbols[257] = {
+		48, 49, 50, 97, 99, 101, 105, 111, 115, 116, 32, 37, 45, 46, 47, 51,
+		52, 53, 54, 55, 56, 57, 61, 65, 95, 98, 100, 102, 103, 104, 108, 109,
+		110, 112, 114, 117, 58, 66, 67, 68, 69, 70, 71, 72, 73, 74, 75, 76,
+		77, 78, 79, 80, 81, 82, 83, 84, 85, 86, 87, 89, 106, 107, 113, 118,
+		119, 120, 121, 122, 38, 42, 44, 59, 88, 90, 33, 34, 40, 41, 63, 39,
+		43, 124, 35, 62, 0, 36, 64, 91, 93, 126, 94, 125, 60, 96, 123, 92,
+		195, 208, 128, 130, 131, 162, 184, 194, 224, 226, 153, 161, 167, 172, 176, 177,
+		179, 209, 216, 217, 227, 229, 230, 129, 132, 133, 134, 136, 146, 154, 156, 160,
+		163, 164, 169, 170, 173, 178, 181, 185, 186, 187, 189, 190, 196, 198, 228, 232,
+		233, 1, 135, 137, 138, 139, 140, 141, 143, 147, 149, 150, 151, 152, 155, 157,
+		158, 165, 166, 168, 174, 175, 180, 182, 183, 188, 191, 197, 231, 239, 9, 142,
+		144, 145, 148, 159, 171, 206, 215, 225, 236, 237, 199, 207, 234, 235, 192, 193,
+		200, 201, 202, 205, 210, 213, 218, 219, 238, 240, 242, 243, 255, 203, 204, 211,
+		212, 214, 221, 222, 223, 241, 244, 245, 246, 247, 248, 250, 251, 252, 253, 254,
+		2, 3, 4, 5, 6, 7, 8, 11, 12, 14, 15, 16, 17, 18, 19, 20,
+		21, 23, 24, 25, 26, 27, 28, 29, 30, 31, 127, 220, 249, 10, 13, 22,
+		256
+	};
+
+	// first code, number of codes, index of the first symbol, for each code length
+	static const sl_uint32 _priv_Hpack_HuffmanFirstCodes[31] = {
+		0x0, 0x0, 0x0, 0x0, 0x0, 0x0, 0x14, 0x5c, 0xf8, 0x1fc, 0x3f8, 0x7fa, 0xffa, 0x1ff8, 0x3ffc, 0x7ffc, 0xfffe, 0x1fffc, 0x3fff8, 0x7fff0, 0xfffe6, 0x1fffdc, 0x3fffd2, 0x7fffd8, 0xffffea, 0x1ffffec, 0x3ffffe0, 0x7ffffde, 0xfffffe2, 0x1ffffffe, 0x3ffffffc
+	};
+
+	static const sl_uint16 _priv_Hpack_HuffmanCounts[31] = {
+		0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3, 0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+	};
+
+	static const sl_uint16 _priv_Hpack_HuffmanOffsets[31] = {
+		0, 0, 0, 0, 0, 0, 10, 36, 68, 74, 74, 79, 82, 84, 90, 92, 95, 95, 95, 95, 98, 106, 119, 145, 174, 186, 190, 205, 224, 253, 253
+	};
+
+	static const _priv_HpackStaticEntry _priv_Hpack_StaticTable[61] = {
+		{ ":authority", 10, "", 0 },
+		{ ":method", 7, "GET", 3 },
+		{ ":method", 7, "POST", 4 },
+		{ ":path", 5, "/", 1 },
+		{ ":path", 5, "/index.html", 11 },
+		{ ":scheme", 7, "http", 4 },
+		{ ":scheme", 7, "https", 5 },
+		{ ":status", 7, "200", 3 },
+		{ ":status", 7, "204", 3 },
+		{ ":status", 7, "206", 3 },
+		{ ":status", 7, "304", 3 },
+		{ ":status", 7, "400", 3 },
+		{ ":status", 7, "404", 3 },
+		{ ":status", 7, "500", 3 },
+		{ "accept-charset", 14, "", 0 },
+		{ "accept-encoding", 15, "gzip, deflate", 13 },
+		{ "accept-language", 15, "", 0 },
+		{ "accept-ranges", 13, "", 0 },
+		{ "accept", 6, "", 0 },
+		{ "access-control-allow-origin", 27, "", 0 },
+		{ "age", 3, "", 0 },
+		{ "allow", 5, "", 0 },
+		{ "authorization", 13, "", 0 },
+		{ "cache-control", 13, "", 0 },
+		{ "content-disposition", 19, "", 0 },
+		{ "content-encoding", 16, "", 0 },
+		{ "content-language", 16, "", 0 },
+		{ "content-length", 14, "", 0 },
+		{ "content-location", 16, "", 0 },
+		{ "content-range", 13, "", 0 },
+		{ "content-type", 12, "", 0 },
+		{ "cookie", 6, "", 0 },
+		{ "date", 4, "", 0 },
+		{ "etag", 4, "", 0 },
+		{ "expect", 6, "", 0 },
+		{ "expires", 7, "", 0 },
+		{ "from", 4, "", 0 },
+		{ "host", 4, "", 0 },
+		{ "if-match", 8, "", 0 },
+		{ "if-modified-since", 17, "", 0 },
+		{ "if-none-match", 13, "", 0 },
+		{ "if-range", 8, "", 0 },
+		{ "if-unmodified-since", 19, "", 0 },
+		{ "last-modified", 13, "", 0 },
+		{ "link", 4, "", 0 },
+		{ "location", 8, "", 0 },
+		{ "max-forwards", 12, "", 0 },
+		{ "proxy-authenticate", 18, "", 0 },
+		{ "proxy-authorization", 19, "", 0 },
+		{ "range", 5, "", 0 },
+		{ "referer", 7, "", 0 },
+		{ "refresh", 7, "", 0 },
+		{ "retry-after", 11, "", 0 },
+		{ "server", 6, "", 0 },
+		{ "set-cookie", 10, "", 0 },
+		{ "strict-transport-security", 25, "", 0 },
+		{ "transfer-encoding", 17, "", 0 },
+		{ "user-agent", 10, "", 0 },
+		{ "vary", 4, "", 0 },
+		{ "via", 3, "", 0 },
+		{ "www-authenticate", 16, "", 0 }
+	};
+
+/***********************************************************************
+						Http2Settings
+***********************************************************************/
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(Http2Settings)
+
+	Http2Settings::Http2Settings()
+	{
+		headerTableSize = SLIB_HTTP2_DEFAULT_HEADER_TABLE_SIZE;
+		flagEnablePush = sl_true;
+		maxConcurrentStreams = 0xffffffff;
+		initialWindowSize = SLIB_HTTP2_DEFAULT_WINDOW_SIZE;
+		maxFrameSize = SLIB_HTTP2_DEFAULT_FRAME_SIZE;
+		maxHeaderListSize = 0xffffffff;
+	}
+
+	sl_bool Http2Settings::parse(const void* payload, sl_size size, Http2ErrorCode* outError)
+	{
+		if (size % 6) {
+			if (outError) {
+				*outError = Http2ErrorCode::FrameSizeError;
+			}
+			return sl_false;
+		}
+		const sl_uint8* p = (const sl_uint8*)payload;
+		for (sl_size i = 0; i < size; i += 6) {
+			sl_uint32 id = ((sl_uint32)(p[i]) << 8) | p[i + 1];
+			sl_uint32 value = ((sl_uint32)(p[i + 2]) << 24) | ((sl_uint32)(p[i + 3]) << 16) | ((sl_uint32)(p[i + 4]) << 8) | p[i + 5];
+			switch ((Http2SettingsId)id) {
+				case Http2SettingsId::HeaderTableSize:
+					headerTableSize = value;
+					break;
+				case Http2SettingsId::EnablePush:
+					if (value > 1) {
+						if (outError) {
+							*outError = Http2ErrorCode::ProtocolError;
+						}
+						return sl_false;
+					}
+					flagEnablePush = value != 0;
+					break;
+				case Http2SettingsId::MaxConcurrentStreams:
+					maxConcurrentStreams = value;
+					break;
+				case Http2SettingsId::InitialWindowSize:
+					if (value > SLIB_HTTP2_MAX_WINDOW_SIZE) {
+						if (outError) {
+							*outError = Http2ErrorCode::FlowControlError;
+						}
+						return sl_false;
+					}
+					initialWindowSize = value;
+					break;
+				case Http2SettingsId::MaxFrameSize:
+					if (value < SLIB_HTTP2_DEFAULT_FRAME_SIZE || value > SLIB_HTTP2_MAX_FRAME_SIZE) {
+						if (outError) {
+							*outError = Http2ErrorCode::ProtocolError;
+						}
+						return sl_false;
+					}
+					maxFrameSize = value;
+					break;
+				case Http2SettingsId::MaxHeaderListSize:
+					maxHeaderListSize = value;
+					break;
+				default:
+					// unknown parameters are ignored
+					break;
+			}
+		}
+		return sl_true;
+	}
+
+	Memory Http2Settings::build() const
+	{
+		Http2Settings def;
+		sl_uint8 buf[36];
+		sl_uint32 n = 0;
+		sl_uint32 ids[6];
+		sl_uint32 values[6];
+		if (headerTableSize != def.headerTableSize) {
+			ids[n] = (sl_uint32)(Http2SettingsId::HeaderTableSize);
+			values[n] = headerTableSize;
+			n++;
+		}
+		if (flagEnablePush != def.flagEnablePush) {
+			ids[n] = (sl_uint32)(Http2SettingsId::EnablePush);
+			values[n] = flagEnablePush ? 1 : 0;
+			n++;
+		}
+		if (maxConcurrentStreams != def.maxConcurrentStreams) {
+			ids[n] = (sl_uint32)(Http2SettingsId::MaxConcurrentStreams);
+			values[n] = maxConcurrentStreams;
+			n++;
+		}
+		if (initialWindowSize != def.initialWindowSize) {
+			ids[n] = (sl_uint32)(Http2SettingsId::InitialWindowSize);
+			values[n] = initialWindowSize;
+			n++;
+		}
+		if (maxFrameSize != def.maxFrameSize) {
+			ids[n] = (sl_uint32)(Http2SettingsId::MaxFrameSize);
+			values[n] = maxFrameSize;
+			n++;
+		}
+		if (maxHeaderListSize != def.maxHeaderListSize) {
+			ids[n] = (sl_uint32)(Http2SettingsId::MaxHeaderListSize);
+			values[n] = maxHeaderListSize;
+			n++;
+		}
+		for (sl_uint32 i = 0; i < n; i++) {
+			sl_uint8* p = buf + i * 6;
+			p[0] = (sl_uint8)(ids[i] >> 8);
+			p[1] = (sl_uint8)(ids[i]);
+			p[2] = (sl_uint8)(values[i] >> 24);
+			p[3] = (sl_uint8)(values[i] >> 16);
+			p[4] = (sl_uint8)(values[i] >> 8);
+			p[5] = (sl_uint8)(values[i]);
+		}
+		return Memory::create(buf, n * 6);
+	}
+
+/***********************************************************************
+						HpackHeaderField
+***********************************************************************/
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HpackHeaderField)
+
+	HpackHeaderField::HpackHeaderField()
+	{
+	}
+
+	HpackHeaderField::HpackHeaderField(const String& _name, const String& _value): name(_name), value(_value)
+	{
+	}
+
+/***********************************************************************
+						HpackTable
+***********************************************************************/
+
+	HpackTable::HpackTable()
+	{
+		m_size = 0;
+		m_sizeMax = SLIB_HTTP2_DEFAULT_HEADER_TABLE_SIZE;
+	}
+
+	HpackTable::~HpackTable()
+	{
+	}
+
+	sl_uint32 HpackTable::getMaximumSize() const
+	{
+		return m_sizeMax;
+	}
+
+	void HpackTable::setMaximumSize(sl_uint32 size)
+	{
+		m_sizeMax = size;
+		_evict(size);
+	}
+
+	sl_uint32 HpackTable::getSize() const
+	{
+		return m_size;
+	}
+
+	sl_uint32 HpackTable::getCount() const
+	{
+		return (sl_uint32)(m_entries.getCount());
+	}
+
+	const HpackHeaderField* HpackTable::getEntry(sl_uint32 index) const
+	{
+		if (index < m_entries.getCount()) {
+			return m_entries.getData() + index;
+		}
+		return sl_null;
+	}
+
+	void HpackTable::add(const String& name, const String& value)
+	{
+		sl_uint32 size = (sl_uint32)(name.getLength() + value.getLength()) + PRIV_HPACK_ENTRY_OVERHEAD;
+		if (size > m_sizeMax) {
+			// the table is emptied by the entry larger than the maximum size
+			m_entries.removeAll_NoLock();
+			m_size = 0;
+			return;
+		}
+		_evict(m_sizeMax - size);
+		if (m_entries.insert_NoLock(0, name, value)) {
+			m_size += size;
+		}
+	}
+
+	sl_int32 HpackTable::find(const String& name, const String& value) const
+	{
+		ListElements<HpackHeaderField> entries(m_entries);
+		for (sl_size i = 0; i < entries.count; i++) {
+			if (entries[i].name == name && entries[i].value == value) {
+				return (sl_int32)i;
+			}
+		}
+		return -1;
+	}
+
+	sl_int32 HpackTable::findName(const String& name) const
+	{
+		ListElements<HpackHeaderField> entries(m_entries);
+		for (sl_size i = 0; i < entries.count; i++) {
+			if (entries[i].name == name) {
+				return (sl_int32)i;
+			}
+		}
+		return -1;
+	}
+
+	void HpackTable::_evict(sl_uint32 sizeLimit)
+	{
+		while (m_size > sizeLimit) {
+			sl_size n = m_entries.getCount();
+			if (!n) {
+				m_size = 0;
+				return;
+			}
+			HpackHeaderField* entry = m_entries.getData() + (n - 1);
+			m_size -= (sl_uint32)(entry->name.getLength() + entry->value.getLength()) + PRIV_HPACK_ENTRY_OVERHEAD;
+			m_entries.popBack_NoLock();
+		}
+	}
+
+/***********************************************************************
+						HpackDecoder
+***********************************************************************/
+
+	SLIB_INLINE static sl_bool _priv_Hpack_decodeInteger(const sl_uint8*& p, const sl_uint8* end, sl_uint32 bitsPrefix, sl_uint32& _out)
+	{
+		sl_uint32 mask = (1 << bitsPrefix) - 1;
+		sl_uint32 value = *p & mask;
+		p++;
+		if (value < mask) {
+			_out = value;
+			return sl_true;
+		}
+		sl_uint32 shift = 0;
+		for (;;) {
+			if (p >= end || shift > 28) {
+				return sl_false;
+			}
+			sl_uint32 b = *p;
+			p++;
+			sl_uint64 v = (sl_uint64)value + ((sl_uint64)(b & 0x7f) << shift);
+			if (v > 0xffffffff) {
+				return sl_false;
+			}
+			value = (sl_uint32)v;
+			if (!(b & 0x80)) {
+				break;
+			}
+			shift += 7;
+		}
+		_out = value;
+		return sl_true;
+	}
+
+	static sl_bool _priv_Hpack_decodeString(const sl_uint8*& p, const sl_uint8* end, String& _out)
+	{
+		if (p >= end) {
+			return sl_false;
+		}
+		sl_bool flagHuffman = (*p & 0x80) != 0;
+		sl_uint32 len;
+		if (!(_priv_Hpack_decodeInteger(p, end, 7, len))) {
+			return sl_false;
+		}
+		if (len > (sl_size)(end - p)) {
+			return sl_false;
+		}
+		if (flagHuffman) {
+			// the shortest code has 5 bits
+			String str = String::allocate(len * 8 / 5 + 1);
+			if (str.isNull()) {
+				return sl_false;
+			}
+			sl_reg n = Hpack::decodeHuffman(p, len, str.getData());
+			if (n < 0) {
+				return sl_false;
+			}
+			str.getData()[n] = 0;
+			str.setLength(n);
+			_out = Move(str);
+		} else {
+			_out = String((const sl_char8*)p, len);
+		}
+		p += len;
+		return sl_true;
+	}
+
+	HpackDecoder::HpackDecoder()
+	{
+		m_sizeTableLimit = SLIB_HTTP2_DEFAULT_HEADER_TABLE_SIZE;
+	}
+
+	HpackDecoder::~HpackDecoder()
+	{
+	}
+
+	void HpackDecoder::setMaximumTableSize(sl_uint32 size)
+	{
+		m_sizeTableLimit = size;
+		if (m_table.getMaximumSize() > size) {
+			m_table.setMaximumSize(size);
+		}
+	}
+
+	sl_bool HpackDecoder::decode(const void* data, sl_size size, List<HpackHeaderField>& output)
+	{
+		const sl_uint8* p = (const sl_uint8*)data;
+		const sl_uint8* end = p + size;
+		sl_bool flagField = sl_false;
+		while (p < end) {
+			sl_uint8 b = *p;
+			if (b & 0x80) {
+				// indexed header field
+				sl_uint32 index;
+				if (!(_priv_Hpack_decodeInteger(p, end, 7, index))) {
+					return sl_false;
+				}
+				HpackHeaderField field;
+				if (!(_getField(index, field))) {
+					return sl_false;
+				}
+				output.add_NoLock(Move(field));
+				flagField = sl_true;
+			} else if ((b & 0xe0) == 0x20) {
+				// dynamic table size update, only at the beginning of the block
+				if (flagField) {
+					return sl_false;
+				}
+				sl_uint32 sizeTable;
+				if (!(_priv_Hpack_decodeInteger(p, end, 5, sizeTable))) {
+					return sl_false;
+				}
+				if (sizeTable > m_sizeTableLimit) {
+					return sl_false;
+				}
+				m_table.setMaximumSize(sizeTable);
+			} else {
+				// literal header field: with incremental indexing (01), without indexing (0000), never indexed (0001)
+				sl_bool flagIndexing = (b & 0xc0) == 0x40;
+				sl_uint32 index;
+				if (!(_priv_Hpack_decodeInteger(p, end, flagIndexing ? 6 : 4, index))) {
+					return sl_false;
+				}
+				HpackHeaderField field;
+				if (index) {
+					if (!(_getField(index, field))) {
+						return sl_false;
+					}
+				} else {
+					if (!(_priv_Hpack_decodeString(p, end, field.name))) {
+						return sl_false;
+					}
+				}
+				if (!(_priv_Hpack_decodeString(p, end, field.value))) {
+					return sl_false;
+				}
+				if (flagIndexing) {
+					m_table.add(field.name, field.value);
+				}
+				output.add_NoLock(Move(field));
+				flagField = sl_true;
+			}
+		}
+		return sl_true;
+	}
+
+	sl_bool HpackDecoder::_getField(sl_uint32 index, HpackHeaderField& field) const
+	{
+		if (!index) {
+			return sl_false;
+		}
+		if (index <= 61) {
+			const _priv_HpackStaticEntry& entry = _priv_Hpack_StaticTable[index - 1];
+			field.name = String::fromStatic(entry.name, entry.lengthName);
+			field.value = String::fromStatic(entry.value, entry.lengthValue);
+			return sl_true;
+		}
+		const HpackHeaderField* entry = m_table.getEntry(index - 62);
+		if (entry) {
+			field = *entry;
+			return sl_true;
+		}
+		return sl_false;
+	}
+
+/***********************************************************************
+						HpackEncoder
+***********************************************************************/
+
+	SLIB_INLINE static sl_uint8* _priv_Hpack_encodeInteger(sl_uint8* p, sl_uint8 pattern, sl_uint32 bitsPrefix, sl_uint32 value)
+	{
+		sl_uint32 mask = (1 << bitsPrefix) - 1;
+		if (value < mask) {
+			*(p++) = (sl_uint8)(pattern | value);
+			return p;
+		}
+		*(p++) = (sl_uint8)(pattern | mask);
+		value -= mask;
+		while (value >= 0x80) {
+			*(p++) = (sl_uint8)((value & 0x7f) | 0x80);
+			value >>= 7;
+		}
+		*(p++) = (sl_uint8)value;
+		return p;
+	}
+
+	static sl_uint8* _priv_Hpack_encodeString(sl_uint8* p, const String& str)
+	{
+		sl_size len = str.getLength();
+		sl_size lenHuffman = Hpack::getHuffmanEncodedSize(str.getData(), len);
+		if (lenHuffman < len) {
+			p = _priv_Hpack_encodeInteger(p, 0x80, 7, (sl_uint32)lenHuffman);
+			return p + Hpack::encodeHuffman(str.getData(), len, p);
+		} else {
+			p = _priv_Hpack_encodeInteger(p, 0, 7, (sl_uint32)len);
+			Base::copyMemory(p, str.getData(), len);
+			return p + len;
+		}
+	}
+
+	SLIB_INLINE static sl_bool _priv_Hpack_equals(const String& str, const char* s, sl_uint32 len)
+	{
+		return str.getLength() == len && Base::equalsMemory(str.getData(), s, len);
+	}
+
+	// the fields changing for every message are not added to the dynamic table
+	static sl_bool _priv_Hpack_isIndexable(const String& name)
+	{
+		switch (name.getLength()) {
+			case 3:
+				return !(_priv_Hpack_equals(name, "age", 3));
+			case 4:
+				return !(_priv_Hpack_equals(name, "date", 4) || _priv_Hpack_equals(name, "etag", 4));
+			case 5:
+				return !(_priv_Hpack_equals(name, ":path", 5));
+			case 7:
+				return !(_priv_Hpack_equals(name, "expires", 7));
+			case 8:
+				return !(_priv_Hpack_equals(name, "location", 8));
+			case 10:
+				return !(_priv_Hpack_equals(name, "set-cookie", 10));
+			case 13:
+				return !(_priv_Hpack_equals(name, "last-modified", 13) || _priv_Hpack_equals(name, "content-range", 13) || _priv_Hpack_equals(name, "authorization", 13));
+			case 14:
+				return !(_priv_Hpack_equals(name, "content-length", 14));
+			default:
+				break;
+		}
+		return sl_true;
+	}
+
+	HpackEncoder::HpackEncoder()
+	{
+		m_flagUpdateTableSize = sl_false;
+	}
+
+	HpackEncoder::~HpackEncoder()
+	{
+	}
+
+	void HpackEncoder::setMaximumTableSize(sl_uint32 size)
+	{
+		if (size > PRIV_HPACK_ENCODER_TABLE_SIZE_MAX) {
+			size = PRIV_HPACK_ENCODER_TABLE_SIZE_MAX;
+		}
+		if (size != m_table.getMaximumSize()) {
+			m_table.setMaximumSize(size);
+			m_flagUpdateTableSize = sl_true;
+		}
+	}
+
+	Memory HpackEncoder::encode(const HpackHeaderField* fields, sl_size count, sl_size offset)
+	{
+		sl_size size = offset + 8;
+		for (sl_size i = 0; i < count; i++) {
+			size += fields[i].name.getLength() + fields[i].value.getLength() + 16;
+		}
+		Memory mem = Memory::create(size);
+		if (mem.isNull()) {
+			return sl_null;
+		}
+		sl_uint8* start = (sl_uint8*)(mem.getData());
+		sl_uint8* p = start + offset;
+		if (m_flagUpdateTableSize) {
+			p = _priv_Hpack_encodeInteger(p, 0x20, 5, m_table.getMaximumSize());
+			m_flagUpdateTableSize = sl_false;
+		}
+		for (sl_size i = 0; i < count; i++) {
+			p = _encodeField(p, fields[i]);
+		}
+		return mem.sub(0, p - start);
+	}
+
+	sl_uint8* HpackEncoder::_encodeField(sl_uint8* p, const HpackHeaderField& field)
+	{
+		const String& name = field.name;
+		const String& value = field.value;
+		sl_uint32 lenName = (sl_uint32)(name.getLength());
+		sl_uint32 lenValue = (sl_uint32)(value.getLength());
+		sl_uint32 indexName = 0;
+		for (sl_uint32 i = 0; i < 61; i++) {
+			const _priv_HpackStaticEntry& entry = _priv_Hpack_StaticTable[i];
+			if (entry.lengthName == lenName && Base::equalsMemory(entry.name, name.getData(), lenName)) {
+				if (entry.lengthValue == lenValue && Base::equalsMemory(entry.value, value.getData(), lenValue)) {
+					return _priv_Hpack_encodeInteger(p, 0x80, 7, i + 1);
+				}
+				if (!indexName) {
+					indexName = i + 1;
+				}
+			}
+		}
+		sl_int32 indexDynamic = m_table.find(name, value);
+		if (indexDynamic >= 0) {
+			return _priv_Hpack_encodeInteger(p, 0x80, 7, 62 + indexDynamic);
+		}
+		if (!indexName) {
+			indexDynamic = m_table.findName(name);
+			if (indexDynamic >= 0) {
+				indexName = 62 + indexDynamic;
+			}
+		}
+		if (_priv_Hpack_isIndexable(name)) {
+			p = _priv_Hpack_encodeInteger(p, 0x40, 6, indexName);
+			m_table.add(name, value);
+		} else {
+			p = _priv_Hpack_encodeInteger(p, 0, 4, indexName);
+		}
+		if (!indexName) {
+			p = _priv_Hpack_encodeString(p, name);
+		}
+		return _priv_Hpack_encodeString(p, value);
+	}
+
+/***********************************************************************
+							Hpack
+***********************************************************************/
+
+	sl_reg Hpack::decodeHuffman(const void* data, sl_size size, void* _output)
+	{
+		const sl_uint8* input = (const sl_uint8*)data;
+		sl_uint8* output = (sl_uint8*)_output;
+		sl_size n = 0;
+		sl_uint32 code = 0;
+		sl_uint32 len = 0;
+		for (sl_size i = 0; i < size; i++) {
+			sl_uint32 b = input[i];
+			for (sl_uint32 k = 0; k < 8; k++) {
+				code = (code << 1) | ((b >> (7 - k)) & 1);
+				len++;
+				if (len < 5) {
+					continue;
+				}
+				// the codes of the same length are consecutive, starting from the first code
+				sl_uint32 offset = code - _priv_Hpack_HuffmanFirstCodes[len];
+				if (offset < _priv_Hpack_HuffmanCounts[len]) {
+					sl_uint32 symbol = _priv_Hpack_HuffmanSymbols[_priv_Hpack_HuffmanOffsets[len] + offset];
+					if (symbol == 256) {
+						// EOS
+						return -1;
+					}
+					output[n++] = (sl_uint8)symbol;
+					code = 0;
+					len = 0;
+				} else if (len >= 30) {
+					return -1;
+				}
+			}
+		}
+		// the padding should be the most significant bits of EOS (all 1), shorter than 8 bits
+		if (len > 7 || code != (sl_uint32)((1 << len) - 1)) {
+			return -1;
+		}
+		return n;
+	}
+
+	sl_size Hpack::getHuffmanEncodedSize(const void* data, sl_size size)
+	{
+		const sl_uint8* input = (const sl_uint8*)data;
+		sl_size bits = 0;
+		for (sl_size i = 0; i < size; i++) {
+			bits += _priv_Hpack_HuffmanLengths[input[i]];
+		}
+		return (bits + 7) >> 3;
+	}
+
+	sl_size Hpack::encodeHuffman(const void* data, sl_size size, void* _output)
+	{
+		const sl_uint8* input = (const sl_uint8*)data;
+		sl_uint8* output = (sl_uint8*)_output;
+		sl_size n = 0;
+		sl_uint64 bits = 0;
+		sl_uint32 nBits = 0;
+		for (sl_size i = 0; i < size; i++) {
+			sl_uint32 symbol = input[i];
+			sl_uint32 len = _priv_Hpack_HuffmanLengths[symbol];
+			bits = (bits << len) | _priv_Hpack_HuffmanCodes[symbol];
+			nBits += len;
+			while (nBits >= 8) {
+				nBits -= 8;
+				output[n++] = (sl_uint8)(bits >> nBits);
+			}
+		}
+		if (nBits) {
+			// pads with the most significant bits of EOS
+			output[n++] = (sl_uint8)((bits << (8 - nBits)) | (0xff >> nBits));
+		}
+		return n;
+	}
+
+}
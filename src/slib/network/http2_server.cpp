@@ -0,0 +1,1356 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "http2_server.h"
+
+#include "slib/core/thread_pool.h"
+#include "slib/core/pair.h"
+#include "slib/core/mio.h"
+#include "slib/core/math.h"
+#include "slib/core/system.h"
+
+// the frames of the streams are not written while the output of the connection buffers this size
+#define PRIV_HTTP2_OUTPUT_BUFFER_LIMIT 0x40000
+#define PRIV_HTTP2_DEFAULT_WEIGHT 16
+#define PRIV_HTTP2_MAX_PRIORITY_DEPTH 32
+
+namespace slib
+{
+
+	_priv_Http2ServerStream::_priv_Http2ServerStream(sl_uint32 _id)
+	{
+		id = _id;
+		flagRemoteClosed = sl_false;
+		flagLocalClosed = sl_false;
+		flagCounted = sl_false;
+		flagReset = sl_false;
+		flagHeaderProcessed = sl_false;
+		flagDispatched = sl_false;
+		flagDiscardingBody = sl_false;
+		dependency = 0;
+		weight = PRIV_HTTP2_DEFAULT_WEIGHT;
+		sizeBodyReceived = 0;
+		windowRecv = 0;
+		sizeRecvConsumed = 0;
+		sizeBodyTotal = 0;
+		sizeBodySent = 0;
+		windowSend = 0;
+		offsetWriting = 0;
+		flagBlocked = sl_false;
+	}
+
+	_priv_Http2ServerStream::~_priv_Http2ServerStream()
+	{
+	}
+
+
+	_priv_Http2ServerStreamWriter::_priv_Http2ServerStreamWriter()
+	{
+		m_streamId = 0;
+	}
+
+	_priv_Http2ServerStreamWriter::~_priv_Http2ServerStreamWriter()
+	{
+	}
+
+	void _priv_Http2ServerStreamWriter::close()
+	{
+	}
+
+	sl_bool _priv_Http2ServerStreamWriter::isOpened()
+	{
+		return m_session.isNotNull();
+	}
+
+	sl_bool _priv_Http2ServerStreamWriter::read(void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject)
+	{
+		return sl_false;
+	}
+
+	sl_bool _priv_Http2ServerStreamWriter::write(const void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject)
+	{
+		Ref<_priv_Http2ServerSession> session = m_session;
+		if (session.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncStreamRequest> request = AsyncStreamRequest::createWrite(data, size, userObject, callback);
+		if (request.isNull()) {
+			return sl_false;
+		}
+		return session->writeStreamData(m_streamId, request.get());
+	}
+
+	sl_bool _priv_Http2ServerStreamWriter::addTask(const Function<void()>& callback)
+	{
+		return m_io->addTask(callback);
+	}
+
+
+	class _priv_Http2ServerStreamPriorityCompare
+	{
+	public:
+		int operator()(const Pair< sl_uint64, Ref<_priv_Http2ServerStream> >& a, const Pair< sl_uint64, Ref<_priv_Http2ServerStream> >& b) const
+		{
+			return Compare<sl_uint64>()(a.first, b.first);
+		}
+	};
+
+	_priv_Http2ServerSession::_priv_Http2ServerSession()
+	{
+		m_flagClosed = sl_false;
+
+		m_maxConcurrentStreams = 100;
+		m_initialWindowSize = SLIB_HTTP2_DEFAULT_WINDOW_SIZE;
+		m_maxFrameSize = SLIB_HTTP2_DEFAULT_FRAME_SIZE;
+		m_maxHeaderBlockSize = 0x10000;
+
+		m_lastStreamId = 0;
+		m_countActiveStreams = 0;
+		m_maxResetStreamsPerSecond = 0;
+		m_timeResetStreams = 0;
+		m_countResetStreams = 0;
+
+		m_windowSend = SLIB_HTTP2_DEFAULT_WINDOW_SIZE;
+		m_windowRecv = SLIB_HTTP2_DEFAULT_WINDOW_SIZE;
+		m_sizeRecvConsumed = 0;
+
+		m_sizePrefaceRemaining = SLIB_HTTP2_CONNECTION_PREFACE_SIZE;
+		m_sizeFrameReceived = 0;
+		m_streamIdHeaderBlock = 0;
+		m_flagHeaderBlockEndStream = sl_false;
+		m_dependencyHeaderBlock = 0;
+		m_weightHeaderBlock = PRIV_HTTP2_DEFAULT_WEIGHT;
+
+		m_flagGoAwayReceived = sl_false;
+		m_flagGoAwaySent = sl_false;
+	}
+
+	_priv_Http2ServerSession::~_priv_Http2ServerSession()
+	{
+	}
+
+	Ref<_priv_Http2ServerSession> _priv_Http2ServerSession::create(HttpServerConnection* connection, HttpServerContext* contextUpgrade, const Memory& settingsUpgrade, sl_uint32 sizePrefaceReceived)
+	{
+		Ref<HttpServer> server = connection->getServer();
+		if (server.isNull()) {
+			return sl_null;
+		}
+		const HttpServerParam& param = server->getParam();
+		Ref<_priv_Http2ServerSession> ret = new _priv_Http2ServerSession;
+		if (ret.isNull()) {
+			return sl_null;
+		}
+		ret->m_connection = connection;
+		ret->m_server = server;
+		ret->m_io = connection->m_io;
+		ret->m_output = connection->m_output;
+		if (param.http2MaxConcurrentStreams) {
+			ret->m_maxConcurrentStreams = param.http2MaxConcurrentStreams;
+		}
+		ret->m_maxResetStreamsPerSecond = param.http2MaxResetStreamsPerSecond;
+		ret->m_initialWindowSize = Math::clamp(param.http2InitialWindowSize, (sl_uint32)SLIB_HTTP2_DEFAULT_WINDOW_SIZE, (sl_uint32)SLIB_HTTP2_MAX_WINDOW_SIZE);
+		ret->m_maxFrameSize = Math::clamp(param.http2MaxFrameSize, (sl_uint32)SLIB_HTTP2_DEFAULT_FRAME_SIZE, (sl_uint32)SLIB_HTTP2_MAX_FRAME_SIZE);
+		ret->m_maxHeaderBlockSize = param.maxRequestHeadersSize;
+		ret->m_bufFrame = Memory::create(Http2FrameHeader::HeaderSize + ret->m_maxFrameSize);
+		if (ret->m_bufFrame.isNull()) {
+			return sl_null;
+		}
+		ret->m_sizePrefaceRemaining = SLIB_HTTP2_CONNECTION_PREFACE_SIZE - sizePrefaceReceived;
+
+		// the server connection preface
+		Http2Settings settings;
+		settings.maxConcurrentStreams = ret->m_maxConcurrentStreams;
+		settings.initialWindowSize = ret->m_initialWindowSize;
+		settings.maxFrameSize = ret->m_maxFrameSize;
+		Memory payload = settings.build();
+		ret->_writeFrame(Http2FrameType::Settings, 0, 0, payload.getData(), (sl_uint32)(payload.getSize()));
+		if (ret->m_initialWindowSize > SLIB_HTTP2_DEFAULT_WINDOW_SIZE) {
+			ret->_writeWindowUpdate(0, ret->m_initialWindowSize - SLIB_HTTP2_DEFAULT_WINDOW_SIZE);
+			ret->m_windowRecv = ret->m_initialWindowSize;
+		}
+
+		if (contextUpgrade) {
+			Http2ErrorCode code;
+			if (!(ret->m_settingsRemote.parse(settingsUpgrade.getData(), settingsUpgrade.getSize(), &code))) {
+				return sl_null;
+			}
+			ret->m_encoder.setMaximumTableSize(ret->m_settingsRemote.headerTableSize);
+			// the upgraded request is the stream 1, half-closed (remote)
+			Ref<_priv_Http2ServerStream> stream = new _priv_Http2ServerStream(1);
+			if (stream.isNull()) {
+				return sl_null;
+			}
+			stream->context = contextUpgrade;
+			stream->flagRemoteClosed = sl_true;
+			stream->windowSend = ret->m_settingsRemote.initialWindowSize;
+			contextUpgrade->m_http2Stream = stream;
+			ret->m_streams.put_NoLock(1, stream);
+			ret->m_streamsReceived.add_NoLock(stream);
+			ret->m_lastStreamId = 1;
+			stream->flagCounted = sl_true;
+			ret->m_countActiveStreams = 1;
+		}
+		return ret;
+	}
+
+	void _priv_Http2ServerSession::close()
+	{
+		List< Ref<_priv_Http2ServerStream> > streams;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			m_flagClosed = sl_true;
+			for (auto& item : m_streams) {
+				streams.add_NoLock(item.value);
+			}
+			m_streams.removeAll_NoLock();
+			m_streamsReceived.setNull();
+			m_streamsBlocked.setNull();
+			m_countActiveStreams = 0;
+		}
+		ListElements< Ref<_priv_Http2ServerStream> > items(streams);
+		for (sl_size i = 0; i < items.count; i++) {
+			_priv_Http2ServerStream* stream = items[i].get();
+			Ref<AsyncOutput> output = stream->output;
+			if (output.isNotNull()) {
+				output->close();
+			}
+			stream->output.setNull();
+			stream->writer.setNull();
+			stream->requestWriting.setNull();
+			stream->context.setNull();
+		}
+	}
+
+	void _priv_Http2ServerSession::processInput(const void* _data, sl_size size)
+	{
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNull()) {
+			return;
+		}
+		if (size) {
+			connection->_setDeadline(0);
+		}
+		sl_bool flagClose = sl_false;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed || m_flagGoAwaySent) {
+				return;
+			}
+			sl_uint8* data = (sl_uint8*)_data;
+			if (m_sizePrefaceRemaining && size) {
+				sl_uint32 n = m_sizePrefaceRemaining;
+				if (n > size) {
+					n = (sl_uint32)size;
+				}
+				const char* preface = SLIB_HTTP2_CONNECTION_PREFACE + (SLIB_HTTP2_CONNECTION_PREFACE_SIZE - m_sizePrefaceRemaining);
+				if (!(Base::equalsMemory(data, preface, n))) {
+					flagClose = sl_true;
+					size = 0;
+				} else {
+					m_sizePrefaceRemaining -= n;
+					data += n;
+					size -= n;
+				}
+			}
+			sl_uint8* bufFrame = (sl_uint8*)(m_bufFrame.getData());
+			while (size) {
+				Http2FrameHeader* frame;
+				if (m_sizeFrameReceived) {
+					// continues the frame split by the reads
+					sl_uint32 sizeFrame = Http2FrameHeader::HeaderSize;
+					if (m_sizeFrameReceived >= Http2FrameHeader::HeaderSize) {
+						sizeFrame += ((Http2FrameHeader*)bufFrame)->getLength();
+					}
+					sl_uint32 n = sizeFrame - m_sizeFrameReceived;
+					if (n > size) {
+						n = (sl_uint32)size;
+					}
+					Base::copyMemory(bufFrame + m_sizeFrameReceived, data, n);
+					m_sizeFrameReceived += n;
+					data += n;
+					size -= n;
+					if (m_sizeFrameReceived < Http2FrameHeader::HeaderSize) {
+						break;
+					}
+					sl_uint32 length = ((Http2FrameHeader*)bufFrame)->getLength();
+					if (length > m_maxFrameSize) {
+						_goAway(Http2ErrorCode::FrameSizeError);
+						break;
+					}
+					if (m_sizeFrameReceived < Http2FrameHeader::HeaderSize + length) {
+						continue;
+					}
+					m_sizeFrameReceived = 0;
+					frame = (Http2FrameHeader*)bufFrame;
+				} else {
+					if (size < Http2FrameHeader::HeaderSize) {
+						Base::copyMemory(bufFrame, data, size);
+						m_sizeFrameReceived = (sl_uint32)size;
+						break;
+					}
+					frame = (Http2FrameHeader*)data;
+					sl_uint32 length = frame->getLength();
+					if (length > m_maxFrameSize) {
+						_goAway(Http2ErrorCode::FrameSizeError);
+						break;
+					}
+					sl_size sizeFrame = Http2FrameHeader::HeaderSize + length;
+					if (size < sizeFrame) {
+						Base::copyMemory(bufFrame, data, size);
+						m_sizeFrameReceived = (sl_uint32)size;
+						break;
+					}
+					data += sizeFrame;
+					size -= sizeFrame;
+				}
+				if (!(_processFrame(frame))) {
+					break;
+				}
+			}
+		}
+		if (flagClose) {
+			connection->close();
+			return;
+		}
+		_processStreams();
+		m_output->startWriting();
+	}
+
+	void _priv_Http2ServerSession::resumeInput()
+	{
+		List< Ref<_priv_Http2ServerStream> > streams;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			for (auto& item : m_streams) {
+				_priv_Http2ServerStream* stream = item.value.get();
+				if (!(stream->flagDispatched) && (stream->bodyPending.getSize() || stream->flagRemoteClosed)) {
+					streams.add_NoLock(stream);
+				}
+			}
+		}
+		ListElements< Ref<_priv_Http2ServerStream> > items(streams);
+		for (sl_size i = 0; i < items.count; i++) {
+			_processStream(items[i].get());
+		}
+		m_output->startWriting();
+	}
+
+	sl_bool _priv_Http2ServerSession::_processFrame(const Http2FrameHeader* frame)
+	{
+		Http2FrameType type = frame->getType();
+		sl_uint32 streamId = frame->getStreamId();
+		sl_uint32 length = frame->getLength();
+		const sl_uint8* payload = frame->getPayload();
+		if (m_streamIdHeaderBlock && type != Http2FrameType::Continuation) {
+			_goAway(Http2ErrorCode::ProtocolError);
+			return sl_false;
+		}
+		switch (type) {
+			case Http2FrameType::Data:
+				return _processData(frame);
+			case Http2FrameType::Headers:
+				return _processHeaders(frame);
+			case Http2FrameType::Priority:
+				{
+					if (!streamId) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					if (length != 5) {
+						_writeResetStream(streamId, Http2ErrorCode::FrameSizeError);
+						return sl_true;
+					}
+					sl_uint32 dependency = MIO::readUint32BE(payload) & 0x7fffffff;
+					if (dependency == streamId) {
+						_writeResetStream(streamId, Http2ErrorCode::ProtocolError);
+						return sl_true;
+					}
+					Ref<_priv_Http2ServerStream> stream;
+					if (m_streams.get_NoLock(streamId, &stream)) {
+						stream->dependency = dependency;
+						stream->weight = (sl_uint32)(payload[4]) + 1;
+					}
+					return sl_true;
+				}
+			case Http2FrameType::ResetStream:
+				{
+					if (!streamId || streamId > m_lastStreamId) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					if (length != 4) {
+						_goAway(Http2ErrorCode::FrameSizeError);
+						return sl_false;
+					}
+					// Rapid Reset (CVE-2023-44487): the reset doesn't stop the handler, so the resets are limited by their rate
+					if (m_maxResetStreamsPerSecond) {
+						sl_uint32 now = System::getTickCount();
+						if (now - m_timeResetStreams >= 1000) {
+							m_timeResetStreams = now;
+							m_countResetStreams = 0;
+						}
+						m_countResetStreams++;
+						if (m_countResetStreams > m_maxResetStreamsPerSecond) {
+							_goAway(Http2ErrorCode::EnhanceYourCalm);
+							return sl_false;
+						}
+					}
+					Ref<_priv_Http2ServerStream> stream;
+					if (m_streams.get_NoLock(streamId, &stream)) {
+						// the stream being processed keeps its slot of the concurrent streams until the handler completes the response
+						Ref<HttpServerContext> context = stream->context;
+						sl_bool flagProcessing = stream->flagDispatched && context.isNotNull() && !(context->m_flagResponseCompleted);
+						_removeStream(stream.get(), flagProcessing);
+					}
+					return sl_true;
+				}
+			case Http2FrameType::Settings:
+				{
+					if (streamId) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					if (frame->getFlags() & Http2FrameHeader::FlagAck) {
+						if (length) {
+							_goAway(Http2ErrorCode::FrameSizeError);
+							return sl_false;
+						}
+						return sl_true;
+					}
+					return _processSettings(frame);
+				}
+			case Http2FrameType::PushPromise:
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			case Http2FrameType::Ping:
+				{
+					if (streamId) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					if (length != 8) {
+						_goAway(Http2ErrorCode::FrameSizeError);
+						return sl_false;
+					}
+					if (!(frame->getFlags() & Http2FrameHeader::FlagAck)) {
+						_writeFrame(Http2FrameType::Ping, Http2FrameHeader::FlagAck, 0, payload, 8);
+					}
+					return sl_true;
+				}
+			case Http2FrameType::GoAway:
+				{
+					if (streamId) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					// the active streams are completed, and the connection is closed when idle
+					m_flagGoAwayReceived = sl_true;
+					return sl_true;
+				}
+			case Http2FrameType::WindowUpdate:
+				return _processWindowUpdate(frame);
+			case Http2FrameType::Continuation:
+				{
+					if (!streamId || streamId != m_streamIdHeaderBlock) {
+						_goAway(Http2ErrorCode::ProtocolError);
+						return sl_false;
+					}
+					if (m_headerBlock.getSize() + length > m_maxHeaderBlockSize) {
+						_goAway(Http2ErrorCode::EnhanceYourCalm);
+						return sl_false;
+					}
+					m_headerBlock.add(Memory::create(payload, length));
+					if (frame->getFlags() & Http2FrameHeader::FlagEndHeaders) {
+						m_streamIdHeaderBlock = 0;
+						Memory block = m_headerBlock.merge();
+						m_headerBlock.clear();
+						return _processHeaderBlock(streamId, block.getData(), block.getSize(), m_flagHeaderBlockEndStream, m_dependencyHeaderBlock, m_weightHeaderBlock);
+					}
+					return sl_true;
+				}
+			default:
+				// unknown frame types are ignored
+				return sl_true;
+		}
+	}
+
+	sl_bool _priv_Http2ServerSession::_processHeaders(const Http2FrameHeader* frame)
+	{
+		sl_uint32 streamId = frame->getStreamId();
+		if (!streamId) {
+			_goAway(Http2ErrorCode::ProtocolError);
+			return sl_false;
+		}
+		sl_uint8 flags = frame->getFlags();
+		const sl_uint8* data = frame->getPayload();
+		sl_uint32 size = frame->getLength();
+		if (flags & Http2FrameHeader::FlagPadded) {
+			if (!size) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			sl_uint32 sizePadding = data[0];
+			data++;
+			size--;
+			if (sizePadding > size) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			size -= sizePadding;
+		}
+		sl_uint32 dependency = 0;
+		sl_uint32 weight = PRIV_HTTP2_DEFAULT_WEIGHT;
+		if (flags & Http2FrameHeader::FlagPriority) {
+			if (size < 5) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			dependency = MIO::readUint32BE(data) & 0x7fffffff;
+			weight = (sl_uint32)(data[4]) + 1;
+			data += 5;
+			size -= 5;
+			if (dependency == streamId) {
+				dependency = 0;
+			}
+		}
+		sl_bool flagEndStream = (flags & Http2FrameHeader::FlagEndStream) != 0;
+		if (flags & Http2FrameHeader::FlagEndHeaders) {
+			return _processHeaderBlock(streamId, data, size, flagEndStream, dependency, weight);
+		}
+		if (size > m_maxHeaderBlockSize) {
+			_goAway(Http2ErrorCode::EnhanceYourCalm);
+			return sl_false;
+		}
+		m_headerBlock.clear();
+		m_headerBlock.add(Memory::create(data, size));
+		m_streamIdHeaderBlock = streamId;
+		m_flagHeaderBlockEndStream = flagEndStream;
+		m_dependencyHeaderBlock = dependency;
+		m_weightHeaderBlock = weight;
+		return sl_true;
+	}
+
+	sl_bool _priv_Http2ServerSession::_processHeaderBlock(sl_uint32 streamId, const void* data, sl_size size, sl_bool flagEndStream, sl_uint32 dependency, sl_uint32 weight)
+	{
+		// the block is decoded even for the refused stream, to keep the state of the dynamic table
+		List<HpackHeaderField> fields;
+		if (!(m_decoder.decode(data, size, fields))) {
+			_goAway(Http2ErrorCode::CompressionError);
+			return sl_false;
+		}
+		Ref<_priv_Http2ServerStream> stream;
+		if (m_streams.get_NoLock(streamId, &stream)) {
+			// trailers
+			if (stream->flagRemoteClosed) {
+				_writeResetStream(streamId, Http2ErrorCode::StreamClosed);
+				_removeStream(stream.get());
+				return sl_true;
+			}
+			if (!flagEndStream) {
+				_writeResetStream(streamId, Http2ErrorCode::ProtocolError);
+				_removeStream(stream.get());
+				return sl_true;
+			}
+			stream->flagRemoteClosed = sl_true;
+			if (!(m_streamsReceived.contains_NoLock(stream))) {
+				m_streamsReceived.add_NoLock(stream);
+			}
+			return sl_true;
+		}
+		if (streamId <= m_lastStreamId || !(streamId & 1)) {
+			_goAway(Http2ErrorCode::ProtocolError);
+			return sl_false;
+		}
+		m_lastStreamId = streamId;
+		if (m_flagGoAwayReceived || m_countActiveStreams >= m_maxConcurrentStreams) {
+			_writeResetStream(streamId, Http2ErrorCode::RefusedStream);
+			return sl_true;
+		}
+		stream = new _priv_Http2ServerStream(streamId);
+		if (stream.isNull()) {
+			_writeResetStream(streamId, Http2ErrorCode::InternalError);
+			return sl_true;
+		}
+		stream->dependency = dependency;
+		stream->weight = weight;
+		stream->flagRemoteClosed = flagEndStream;
+		stream->windowSend = m_settingsRemote.initialWindowSize;
+		stream->windowRecv = m_initialWindowSize;
+		Ref<HttpServerContext> context = _createContext(stream.get(), fields);
+		if (context.isNull()) {
+			_writeResetStream(streamId, Http2ErrorCode::ProtocolError);
+			return sl_true;
+		}
+		stream->context = context;
+		context->m_http2Stream = stream;
+		m_streams.put_NoLock(streamId, stream);
+		stream->flagCounted = sl_true;
+		m_countActiveStreams++;
+		m_streamsReceived.add_NoLock(stream);
+		return sl_true;
+	}
+
+	Ref<HttpServerContext> _priv_Http2ServerSession::_createContext(_priv_Http2ServerStream* stream, const List<HpackHeaderField>& fields)
+	{
+		SLIB_STATIC_STRING(s_method, ":method")
+		SLIB_STATIC_STRING(s_scheme, ":scheme")
+		SLIB_STATIC_STRING(s_authority, ":authority")
+		SLIB_STATIC_STRING(s_path, ":path")
+		SLIB_STATIC_STRING(s_cookie, "cookie")
+		SLIB_STATIC_STRING(s_version, "HTTP/2.0")
+		SLIB_STATIC_STRING(s_cookieSeparator, "; ")
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNull()) {
+			return sl_null;
+		}
+		Ref<HttpServerContext> context = HttpServerContext::create(connection);
+		if (context.isNull()) {
+			return sl_null;
+		}
+		String method, scheme, authority, path;
+		StringBuffer cookie;
+		ListElements<HpackHeaderField> items(fields);
+		for (sl_size i = 0; i < items.count; i++) {
+			HpackHeaderField& field = items[i];
+			if (field.name.startsWith(':')) {
+				if (field.name == s_method) {
+					method = field.value;
+				} else if (field.name == s_scheme) {
+					scheme = field.value;
+				} else if (field.name == s_authority) {
+					authority = field.value;
+				} else if (field.name == s_path) {
+					path = field.value;
+				} else {
+					return sl_null;
+				}
+			} else if (field.name == s_cookie) {
+				// the cookie crumbs are joined into one header
+				if (cookie.getLength()) {
+					cookie.addStatic(s_cookieSeparator.getData(), s_cookieSeparator.getLength());
+				}
+				cookie.add(field.value);
+			} else {
+				context->addRequestHeader(field.name, field.value);
+			}
+		}
+		if (method.isEmpty()) {
+			return sl_null;
+		}
+		context->setMethod(method);
+		if (context->getMethod() != HttpMethod::CONNECT) {
+			if (scheme.isEmpty() || path.isEmpty()) {
+				return sl_null;
+			}
+		}
+		sl_reg indexQuery = path.indexOf('?');
+		if (indexQuery >= 0) {
+			context->setPath(path.substring(0, indexQuery));
+			context->setQuery(path.substring(indexQuery + 1));
+		} else {
+			context->setPath(path);
+		}
+		context->setRequestVersion(s_version);
+		if (authority.isNotEmpty() && !(context->containsRequestHeader(HttpHeaders::Host))) {
+			context->setHost(authority);
+		}
+		if (cookie.getLength()) {
+			context->setRequestHeader(HttpHeaders::Cookie, cookie.merge());
+		}
+		context->m_requestContentLength = context->getRequestContentLengthHeader();
+		context->applyQueryToParameters();
+		Ref<HttpServer> server = m_server;
+		if (server.isNotNull()) {
+			context->setProcessingByThread(server->getParam().flagProcessByThreads);
+		}
+		return context;
+	}
+
+	sl_bool _priv_Http2ServerSession::_processData(const Http2FrameHeader* frame)
+	{
+		sl_uint32 streamId = frame->getStreamId();
+		if (!streamId) {
+			_goAway(Http2ErrorCode::ProtocolError);
+			return sl_false;
+		}
+		sl_uint32 length = frame->getLength();
+		if ((sl_int64)length > m_windowRecv) {
+			_goAway(Http2ErrorCode::FlowControlError);
+			return sl_false;
+		}
+		m_windowRecv -= length;
+		// the connection window is returned on receipt, and the stream window when the context consumes the body
+		m_sizeRecvConsumed += length;
+		if (m_sizeRecvConsumed >= m_initialWindowSize / 2) {
+			_writeWindowUpdate(0, m_sizeRecvConsumed);
+			m_windowRecv += m_sizeRecvConsumed;
+			m_sizeRecvConsumed = 0;
+		}
+		const sl_uint8* data = frame->getPayload();
+		sl_uint32 size = length;
+		if (frame->getFlags() & Http2FrameHeader::FlagPadded) {
+			if (!size) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			sl_uint32 sizePadding = data[0];
+			data++;
+			size--;
+			if (sizePadding > size) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			size -= sizePadding;
+		}
+		Ref<_priv_Http2ServerStream> stream;
+		if (!(m_streams.get_NoLock(streamId, &stream))) {
+			if (streamId > m_lastStreamId) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			// the frames of the closed streams are ignored
+			return sl_true;
+		}
+		if (stream->flagRemoteClosed) {
+			_writeResetStream(streamId, Http2ErrorCode::StreamClosed);
+			_removeStream(stream.get());
+			return sl_true;
+		}
+		if ((sl_int64)length > stream->windowRecv) {
+			_writeResetStream(streamId, Http2ErrorCode::FlowControlError);
+			_removeStream(stream.get());
+			return sl_true;
+		}
+		stream->windowRecv -= length;
+		if (frame->getFlags() & Http2FrameHeader::FlagEndStream) {
+			stream->flagRemoteClosed = sl_true;
+		}
+		if (stream->flagDiscardingBody) {
+			_returnWindow(stream.get(), length);
+			return sl_true;
+		}
+		_returnWindow(stream.get(), length - size);
+		if (size) {
+			if (!(stream->bodyPending.add_NoLock(Memory::create(data, size)))) {
+				_writeResetStream(streamId, Http2ErrorCode::InternalError);
+				_removeStream(stream.get());
+				return sl_true;
+			}
+			stream->sizeBodyReceived += size;
+		}
+		if (!(m_streamsReceived.contains_NoLock(stream))) {
+			m_streamsReceived.add_NoLock(stream);
+		}
+		return sl_true;
+	}
+
+	sl_bool _priv_Http2ServerSession::_processSettings(const Http2FrameHeader* frame)
+	{
+		sl_uint32 windowOld = m_settingsRemote.initialWindowSize;
+		Http2ErrorCode code;
+		if (!(m_settingsRemote.parse(frame->getPayload(), frame->getLength(), &code))) {
+			_goAway(code);
+			return sl_false;
+		}
+		m_encoder.setMaximumTableSize(m_settingsRemote.headerTableSize);
+		_writeFrame(Http2FrameType::Settings, Http2FrameHeader::FlagAck, 0, sl_null, 0);
+		sl_int64 delta = (sl_int64)(m_settingsRemote.initialWindowSize) - (sl_int64)windowOld;
+		if (delta) {
+			for (auto& item : m_streams) {
+				_priv_Http2ServerStream* stream = item.value.get();
+				stream->windowSend += delta;
+				if (stream->windowSend > SLIB_HTTP2_MAX_WINDOW_SIZE) {
+					_goAway(Http2ErrorCode::FlowControlError);
+					return sl_false;
+				}
+			}
+			if (delta > 0) {
+				_sendBlockedStreams();
+			}
+		}
+		return sl_true;
+	}
+
+	sl_bool _priv_Http2ServerSession::_processWindowUpdate(const Http2FrameHeader* frame)
+	{
+		if (frame->getLength() != 4) {
+			_goAway(Http2ErrorCode::FrameSizeError);
+			return sl_false;
+		}
+		sl_uint32 streamId = frame->getStreamId();
+		sl_uint32 increment = MIO::readUint32BE(frame->getPayload()) & 0x7fffffff;
+		if (!streamId) {
+			if (!increment) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			m_windowSend += increment;
+			if (m_windowSend > SLIB_HTTP2_MAX_WINDOW_SIZE) {
+				_goAway(Http2ErrorCode::FlowControlError);
+				return sl_false;
+			}
+			_sendBlockedStreams();
+			return sl_true;
+		}
+		Ref<_priv_Http2ServerStream> stream;
+		if (!(m_streams.get_NoLock(streamId, &stream))) {
+			if (streamId > m_lastStreamId) {
+				_goAway(Http2ErrorCode::ProtocolError);
+				return sl_false;
+			}
+			return sl_true;
+		}
+		if (!increment) {
+			_writeResetStream(streamId, Http2ErrorCode::ProtocolError);
+			_removeStream(stream.get());
+			return sl_true;
+		}
+		stream->windowSend += increment;
+		if (stream->windowSend > SLIB_HTTP2_MAX_WINDOW_SIZE) {
+			_writeResetStream(streamId, Http2ErrorCode::FlowControlError);
+			_removeStream(stream.get());
+			return sl_true;
+		}
+		if (stream->flagBlocked) {
+			_sendBlockedStreams();
+		}
+		return sl_true;
+	}
+
+	void _priv_Http2ServerSession::_processStreams()
+	{
+		List< Ref<_priv_Http2ServerStream> > streams;
+		{
+			ObjectLocker lock(this);
+			if (m_sizePrefaceRemaining) {
+				// the upgraded request is answered after the client connection preface, not to flood the client switching the protocol
+				return;
+			}
+			streams = m_streamsReceived;
+			m_streamsReceived.setNull();
+		}
+		ListElements< Ref<_priv_Http2ServerStream> > items(streams);
+		for (sl_size i = 0; i < items.count; i++) {
+			_processStream(items[i].get());
+		}
+	}
+
+	void _priv_Http2ServerSession::_processStream(_priv_Http2ServerStream* stream)
+	{
+		Ref<HttpServerContext> context;
+		{
+			ObjectLocker lock(this);
+			context = stream->context;
+		}
+		if (context.isNull() || stream->flagDispatched) {
+			return;
+		}
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNull()) {
+			return;
+		}
+		Ref<HttpServer> server = m_server;
+		if (server.isNull()) {
+			return;
+		}
+		const HttpServerParam& param = server->getParam();
+		if (!(stream->flagHeaderProcessed)) {
+			stream->flagHeaderProcessed = sl_true;
+			if (context->getMethod() == HttpMethod::CONNECT) {
+				_respondError(stream, HttpStatus::NotImplemented);
+				return;
+			}
+			if (connection->_admitRequest(context.get()) != HttpStatus::OK) {
+				_respondError(stream, context->getResponseCode());
+				return;
+			}
+			if (!(connection->_processRequestHeader(context.get()))) {
+				_respondError(stream, HttpStatus::InternalServerError);
+				return;
+			}
+			if (context->isStreamingRequestBody()) {
+				if (param.maxStreamingRequestBodySize && context->m_requestContentLength > param.maxStreamingRequestBodySize) {
+					_respondError(stream, HttpStatus::RequestEntityTooLarge);
+					return;
+				}
+			} else {
+				if (context->m_requestContentLength > param.maxRequestBodySize) {
+					_respondError(stream, HttpStatus::RequestEntityTooLarge);
+					return;
+				}
+			}
+		}
+		sl_bool flagStreaming = context->isStreamingRequestBody();
+		for (;;) {
+			if (flagStreaming && context->m_flagRequestBodySuspended) {
+				// continued by `resumeInput`
+				return;
+			}
+			MemoryData chunk;
+			{
+				ObjectLocker lock(this);
+				if (!(stream->bodyPending.pop_NoLock(chunk))) {
+					break;
+				}
+			}
+			if (flagStreaming) {
+				context->m_sizeRequestBodyReceived += chunk.size;
+				if (param.maxStreamingRequestBodySize && context->m_sizeRequestBodyReceived > param.maxStreamingRequestBodySize) {
+					_respondError(stream, HttpStatus::RequestEntityTooLarge);
+					return;
+				}
+				HttpStatus status = connection->_writeRequestBody(context.get(), chunk.data, chunk.size);
+				if (status != HttpStatus::OK) {
+					_respondError(stream, status);
+					return;
+				}
+			} else {
+				if (context->m_requestBodyBuffer.getSize() + chunk.size > param.maxRequestBodySize) {
+					_respondError(stream, HttpStatus::RequestEntityTooLarge);
+					return;
+				}
+				if (!(context->m_requestBodyBuffer.add(chunk))) {
+					_respondError(stream, HttpStatus::InternalServerError);
+					return;
+				}
+			}
+			ObjectLocker lock(this);
+			_returnWindow(stream, (sl_uint32)(chunk.size));
+		}
+		{
+			ObjectLocker lock(this);
+			if (!(stream->flagRemoteClosed) || stream->bodyPending.getSize()) {
+				return;
+			}
+		}
+		if (context->containsRequestHeader(HttpHeaders::ContentLength) && stream->sizeBodyReceived != context->m_requestContentLength) {
+			_respondError(stream, HttpStatus::BadRequest);
+			return;
+		}
+		stream->flagDispatched = sl_true;
+		context->m_requestContentLength = stream->sizeBodyReceived;
+		if (flagStreaming) {
+			// closes and removes the part left incomplete by the missing closing boundary
+			context->m_multipartSpooler.setNull();
+		} else {
+			if (!(connection->_completeRequestBody(context.get()))) {
+				stream->flagDispatched = sl_false;
+				_respondError(stream, HttpStatus::InternalServerError);
+				return;
+			}
+		}
+		connection->_startProcessing(context.get(), sl_false);
+	}
+
+	void _priv_Http2ServerSession::_respondError(_priv_Http2ServerStream* stream, HttpStatus status)
+	{
+		Ref<HttpServerContext> context;
+		{
+			ObjectLocker lock(this);
+			context = stream->context;
+			if (context.isNull()) {
+				return;
+			}
+			stream->flagDispatched = sl_true;
+			stream->flagDiscardingBody = sl_true;
+			_returnWindow(stream, (sl_uint32)(stream->bodyPending.getSize()));
+			stream->bodyPending.clear_NoLock();
+		}
+		context->m_multipartSpooler.setNull();
+		context->setResponseCode(status);
+		context->completeResponse();
+	}
+
+	void _priv_Http2ServerSession::sendResponse(HttpServerContext* context)
+	{
+		SLIB_STATIC_STRING(s_status, ":status")
+		SLIB_STATIC_STRING(s_keepAlive, "keep-alive")
+		SLIB_STATIC_STRING(s_proxyConnection, "proxy-connection")
+		SLIB_STATIC_STRING(s_upgrade, "upgrade")
+		Ref<_priv_Http2ServerStream> stream = (_priv_Http2ServerStream*)(context->m_http2Stream.get());
+		if (stream.isNull()) {
+			return;
+		}
+		// the connection-specific headers are not allowed
+		List<HpackHeaderField> fields;
+		fields.add_NoLock(HpackHeaderField(s_status, String::fromUint32((sl_uint32)(context->getResponseCode()))));
+		for (auto& pair : context->getResponseHeaders()) {
+			String name = pair.key.toLower();
+			if (name == s_keepAlive || name == s_proxyConnection || name == s_upgrade || name.equalsIgnoreCase(HttpHeaders::Connection) || name.equalsIgnoreCase(HttpHeaders::TransferEncoding)) {
+				continue;
+			}
+			fields.add_NoLock(HpackHeaderField(name, pair.value));
+		}
+		sl_uint64 sizeBody = context->getOutputLength();
+		Ref<AsyncOutput> output;
+		Ref<_priv_Http2ServerStreamWriter> writer;
+		if (sizeBody) {
+			writer = new _priv_Http2ServerStreamWriter;
+			if (writer.isNotNull()) {
+				writer->m_session = this;
+				writer->m_streamId = stream->id;
+				writer->m_io = m_io;
+				AsyncOutputParam op;
+				op.stream = writer;
+				op.onEnd = SLIB_BIND_WEAKREF(void(AsyncOutput*, sl_bool), _priv_Http2ServerSession, onStreamOutputEnd, this, stream->id);
+				op.bufferSize = SLIB_HTTP2_DEFAULT_FRAME_SIZE;
+				op.flagUseSendFile = sl_false;
+				output = AsyncOutput::create(op);
+			}
+		}
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			if (stream->flagReset) {
+				if (stream->flagCounted) {
+					// the handler of the stream reset by the client is finished
+					stream->flagCounted = sl_false;
+					m_countActiveStreams--;
+				}
+				return;
+			}
+			if (stream->flagLocalClosed) {
+				return;
+			}
+			if (sizeBody && output.isNull()) {
+				_writeResetStream(stream->id, Http2ErrorCode::InternalError);
+				_removeStream(stream.get());
+				lock.unlock();
+				m_output->startWriting();
+				return;
+			}
+			Memory block = m_encoder.encode(fields.getData(), fields.getCount(), Http2FrameHeader::HeaderSize);
+			if (block.isNull()) {
+				_goAway(Http2ErrorCode::InternalError);
+				lock.unlock();
+				m_output->startWriting();
+				return;
+			}
+			_writeHeaderBlock(stream->id, block, !sizeBody);
+			if (sizeBody) {
+				stream->output = output;
+				stream->writer = writer;
+				stream->sizeBodyTotal = sizeBody;
+			} else {
+				stream->flagLocalClosed = sl_true;
+				_finishStream(stream.get());
+			}
+		}
+		if (output.isNotNull()) {
+			output->mergeBuffer(&(context->m_bufferOutput));
+			output->startWriting();
+		}
+		m_output->startWriting();
+	}
+
+	sl_bool _priv_Http2ServerSession::writeStreamData(sl_uint32 streamId, AsyncStreamRequest* request)
+	{
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return sl_false;
+			}
+			Ref<_priv_Http2ServerStream> stream;
+			if (!(m_streams.get_NoLock(streamId, &stream))) {
+				return sl_false;
+			}
+			if (stream->flagLocalClosed || stream->requestWriting.isNotNull()) {
+				return sl_false;
+			}
+			stream->requestWriting = request;
+			stream->offsetWriting = 0;
+			_sendData(stream.get());
+		}
+		m_output->startWriting();
+		return sl_true;
+	}
+
+	void _priv_Http2ServerSession::onStreamOutputEnd(sl_uint32 streamId, AsyncOutput* output, sl_bool flagError)
+	{
+		Ref<_priv_Http2ServerStream> stream;
+		{
+			ObjectLocker lock(this);
+			if (!(m_streams.get_NoLock(streamId, &stream))) {
+				return;
+			}
+			if (stream->output.get() != output) {
+				return;
+			}
+			if (flagError || !(stream->flagLocalClosed)) {
+				// the body is shorter than its length
+				_writeResetStream(streamId, Http2ErrorCode::InternalError);
+				_removeStream(stream.get());
+			} else {
+				_finishStream(stream.get());
+			}
+		}
+		m_output->startWriting();
+	}
+
+	void _priv_Http2ServerSession::onOutputEnd(sl_bool flagError)
+	{
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNull()) {
+			return;
+		}
+		if (flagError) {
+			connection->close();
+			return;
+		}
+		sl_bool flagIdle = sl_false;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			if (m_flagGoAwaySent || (m_flagGoAwayReceived && !m_countActiveStreams)) {
+				lock.unlock();
+				connection->close();
+				return;
+			}
+			_sendBlockedStreams();
+			flagIdle = !m_countActiveStreams;
+		}
+		m_output->startWriting();
+		if (flagIdle) {
+			Ref<HttpServer> server = m_server;
+			if (server.isNotNull()) {
+				connection->_setDeadline(server->getParam().keepAliveTimeout);
+			}
+		}
+	}
+
+	void _priv_Http2ServerSession::_writeFrame(Http2FrameType type, sl_uint8 flags, sl_uint32 streamId, const void* payload, sl_uint32 size)
+	{
+		Memory mem = Memory::create(Http2FrameHeader::HeaderSize + size);
+		if (mem.isNull()) {
+			return;
+		}
+		Http2FrameHeader* frame = (Http2FrameHeader*)(mem.getData());
+		frame->setLength(size);
+		frame->setType(type);
+		frame->setFlags(flags);
+		frame->setStreamId(streamId);
+		if (size) {
+			Base::copyMemory(frame->getPayload(), payload, size);
+		}
+		m_output->write(mem);
+	}
+
+	void _priv_Http2ServerSession::_writeHeaderBlock(sl_uint32 streamId, const Memory& block, sl_bool flagEndStream)
+	{
+		sl_uint8* data = (sl_uint8*)(block.getData()) + Http2FrameHeader::HeaderSize;
+		sl_size size = block.getSize() - Http2FrameHeader::HeaderSize;
+		sl_uint32 sizeFrameMax = m_settingsRemote.maxFrameSize;
+		sl_uint8 flags = flagEndStream ? Http2FrameHeader::FlagEndStream : 0;
+		if (size <= sizeFrameMax) {
+			// the frame header is written in the space left by the encoder
+			Http2FrameHeader* frame = (Http2FrameHeader*)(block.getData());
+			frame->setLength((sl_uint32)size);
+			frame->setType(Http2FrameType::Headers);
+			frame->setFlags(flags | Http2FrameHeader::FlagEndHeaders);
+			frame->setStreamId(streamId);
+			m_output->write(block);
+			return;
+		}
+		_writeFrame(Http2FrameType::Headers, flags, streamId, data, sizeFrameMax);
+		data += sizeFrameMax;
+		size -= sizeFrameMax;
+		while (size > sizeFrameMax) {
+			_writeFrame(Http2FrameType::Continuation, 0, streamId, data, sizeFrameMax);
+			data += sizeFrameMax;
+			size -= sizeFrameMax;
+		}
+		_writeFrame(Http2FrameType::Continuation, Http2FrameHeader::FlagEndHeaders, streamId, data, (sl_uint32)size);
+	}
+
+	void _priv_Http2ServerSession::_writeWindowUpdate(sl_uint32 streamId, sl_uint32 increment)
+	{
+		sl_uint8 payload[4];
+		MIO::writeUint32BE(payload, increment);
+		_writeFrame(Http2FrameType::WindowUpdate, 0, streamId, payload, 4);
+	}
+
+	void _priv_Http2ServerSession::_writeResetStream(sl_uint32 streamId, Http2ErrorCode code)
+	{
+		sl_uint8 payload[4];
+		MIO::writeUint32BE(payload, (sl_uint32)code);
+		_writeFrame(Http2FrameType::ResetStream, 0, streamId, payload, 4);
+	}
+
+	void _priv_Http2ServerSession::_goAway(Http2ErrorCode code)
+	{
+		if (m_flagGoAwaySent) {
+			return;
+		}
+		m_flagGoAwaySent = sl_true;
+		sl_uint8 payload[8];
+		MIO::writeUint32BE(payload, m_lastStreamId);
+		MIO::writeUint32BE(payload + 4, (sl_uint32)code);
+		_writeFrame(Http2FrameType::GoAway, 0, 0, payload, 8);
+		// the connection is closed when GOAWAY is written
+	}
+
+	void _priv_Http2ServerSession::_returnWindow(_priv_Http2ServerStream* stream, sl_uint32 size)
+	{
+		if (!size || stream->flagRemoteClosed) {
+			return;
+		}
+		stream->sizeRecvConsumed += size;
+		if (stream->sizeRecvConsumed >= m_initialWindowSize / 2) {
+			_writeWindowUpdate(stream->id, stream->sizeRecvConsumed);
+			stream->windowRecv += stream->sizeRecvConsumed;
+			stream->sizeRecvConsumed = 0;
+		}
+	}
+
+	void _priv_Http2ServerSession::_sendData(_priv_Http2ServerStream* stream)
+	{
+		while (stream->requestWriting.isNotNull()) {
+			AsyncStreamRequest* request = stream->requestWriting.get();
+			if (stream->offsetWriting < request->size) {
+				sl_int64 n = request->size - stream->offsetWriting;
+				if (n > stream->windowSend) {
+					n = stream->windowSend;
+				}
+				if (n > m_windowSend) {
+					n = m_windowSend;
+				}
+				if (n > m_settingsRemote.maxFrameSize) {
+					n = m_settingsRemote.maxFrameSize;
+				}
+				if (n <= 0 || m_output->getBufferedSize() >= PRIV_HTTP2_OUTPUT_BUFFER_LIMIT) {
+					if (!(stream->flagBlocked)) {
+						stream->flagBlocked = sl_true;
+						m_streamsBlocked.add_NoLock(stream);
+					}
+					return;
+				}
+				sl_uint8 flags = 0;
+				if (stream->sizeBodySent + n >= stream->sizeBodyTotal) {
+					flags = Http2FrameHeader::FlagEndStream;
+					stream->flagLocalClosed = sl_true;
+					if (stream->flagRemoteClosed && stream->flagCounted) {
+						// the stream is closed for the peer, before the output of the stream is completed
+						stream->flagCounted = sl_false;
+						m_countActiveStreams--;
+					}
+				}
+				_writeFrame(Http2FrameType::Data, flags, stream->id, (sl_uint8*)(request->data) + stream->offsetWriting, (sl_uint32)n);
+				stream->offsetWriting += (sl_uint32)n;
+				stream->sizeBodySent += n;
+				stream->windowSend -= n;
+				m_windowSend -= n;
+				continue;
+			}
+			// the written data is copied into the frames, and the request is completed on the I/O loop
+			Ref<AsyncStreamRequest> requestCompleted = request;
+			Ref<AsyncStream> writer = stream->writer;
+			stream->requestWriting.setNull();
+			m_io->addTask([requestCompleted, writer]() {
+				requestCompleted->runCallback(writer.get(), requestCompleted->size, sl_false);
+			});
+		}
+	}
+
+	void _priv_Http2ServerSession::_sendBlockedStreams()
+	{
+		if (m_streamsBlocked.isEmpty()) {
+			return;
+		}
+		List< Ref<_priv_Http2ServerStream> > streams = m_streamsBlocked;
+		m_streamsBlocked.setNull();
+		// the parents and the heavier streams first
+		List< Pair< sl_uint64, Ref<_priv_Http2ServerStream> > > list;
+		ListElements< Ref<_priv_Http2ServerStream> > items(streams);
+		for (sl_size i = 0; i < items.count; i++) {
+			_priv_Http2ServerStream* stream = items[i].get();
+			stream->flagBlocked = sl_false;
+			sl_uint64 depth = 0;
+			sl_uint32 dependency = stream->dependency;
+			while (dependency && depth < PRIV_HTTP2_MAX_PRIORITY_DEPTH) {
+				Ref<_priv_Http2ServerStream> parent;
+				if (!(m_streams.get_NoLock(dependency, &parent))) {
+					break;
+				}
+				dependency = parent->dependency;
+				depth++;
+			}
+			sl_uint64 key = (depth << 40) | ((sl_uint64)(256 - stream->weight) << 32) | stream->id;
+			list.add_NoLock(Pair< sl_uint64, Ref<_priv_Http2ServerStream> >(key, stream));
+		}
+		list.sort_NoLock(_priv_Http2ServerStreamPriorityCompare());
+		ListElements< Pair< sl_uint64, Ref<_priv_Http2ServerStream> > > sorted(list);
+		for (sl_size i = 0; i < sorted.count; i++) {
+			_priv_Http2ServerStream* stream = sorted[i].second.get();
+			if (!(stream->flagReset)) {
+				_sendData(stream);
+			}
+		}
+	}
+
+	void _priv_Http2ServerSession::_finishStream(_priv_Http2ServerStream* stream)
+	{
+		if (!(stream->flagRemoteClosed)) {
+			// the rest of the request is not needed
+			_writeResetStream(stream->id, Http2ErrorCode::NoError);
+		}
+		_removeStream(stream);
+	}
+
+	void _priv_Http2ServerSession::_removeStream(_priv_Http2ServerStream* stream, sl_bool flagKeepCounted)
+	{
+		if (stream->flagReset) {
+			return;
+		}
+		stream->flagReset = sl_true;
+		if (stream->requestWriting.isNotNull()) {
+			Ref<AsyncStreamRequest> request = stream->requestWriting;
+			Ref<AsyncStream> writer = stream->writer;
+			stream->requestWriting.setNull();
+			m_io->addTask([request, writer]() {
+				request->runCallback(writer.get(), 0, sl_true);
+			});
+		}
+		if (stream->flagBlocked) {
+			stream->flagBlocked = sl_false;
+			m_streamsBlocked.remove_NoLock(stream);
+		}
+		stream->bodyPending.clear_NoLock();
+		// the output is released out of its callbacks, by the write request or the context
+		stream->context.setNull();
+		m_streams.remove_NoLock(stream->id);
+		if (stream->flagCounted && !flagKeepCounted) {
+			stream->flagCounted = sl_false;
+			m_countActiveStreams--;
+		}
+	}
+
+}
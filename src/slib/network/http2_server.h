@@ -0,0 +1,229 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#ifndef CHECKHEADER_SLIB_NETWORK_HTTP2_SERVER_CONFIG
+#define CHECKHEADER_SLIB_NETWORK_HTTP2_SERVER_CONFIG
+
+#include "slib/network/http_server.h"
+#include "slib/network/http2.h"
+
+#include "slib/core/hash_map.h"
+#include "slib/core/string_buffer.h"
+
+namespace slib
+{
+
+	class _priv_Http2ServerSession;
+
+	class _priv_Http2ServerStream : public Referable
+	{
+	public:
+		sl_uint32 id;
+		Ref<HttpServerContext> context;
+
+		sl_bool flagRemoteClosed; // END_STREAM is received
+		sl_bool flagLocalClosed; // END_STREAM is sent
+		sl_bool flagReset;
+		sl_bool flagHeaderProcessed;
+		sl_bool flagDispatched;
+		sl_bool flagDiscardingBody; // the request is answered before its body
+		sl_bool flagCounted; // counted in the concurrent streams, until the response is completed for the stream reset by the client
+
+		sl_uint32 dependency;
+		sl_uint32 weight;
+
+		// received DATA not passed to the context yet
+		MemoryQueue bodyPending;
+		sl_uint64 sizeBodyReceived;
+		sl_int64 windowRecv;
+		sl_uint32 sizeRecvConsumed; // not yet returned by WINDOW_UPDATE
+
+		Ref<AsyncOutput> output;
+		Ref<AsyncStream> writer;
+		sl_uint64 sizeBodyTotal;
+		sl_uint64 sizeBodySent;
+		sl_int64 windowSend;
+		// the write request of `output` waiting for the flow control window
+		Ref<AsyncStreamRequest> requestWriting;
+		sl_uint32 offsetWriting;
+		sl_bool flagBlocked;
+
+	public:
+		_priv_Http2ServerStream(sl_uint32 id);
+
+		~_priv_Http2ServerStream();
+
+	};
+
+	// frames the response body written by `AsyncOutput` into DATA frames of the stream
+	class _priv_Http2ServerStreamWriter : public AsyncStream
+	{
+	public:
+		WeakRef<_priv_Http2ServerSession> m_session;
+		sl_uint32 m_streamId;
+		Ref<AsyncStream> m_io;
+
+	public:
+		_priv_Http2ServerStreamWriter();
+
+		~_priv_Http2ServerStreamWriter();
+
+	public:
+		void close() override;
+
+		sl_bool isOpened() override;
+
+		sl_bool read(void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject) override;
+
+		sl_bool write(const void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject) override;
+
+		sl_bool addTask(const Function<void()>& callback) override;
+
+	};
+
+	/*
+		One HTTP/2 connection, multiplexing the requests of the streams onto `HttpServerContext` objects.
+
+		The frames are written to the output of the connection in the lock of the session, so that the HPACK states of both sides agree. The output of a stream, the handlers and the connection are never called in the lock.
+	*/
+	class _priv_Http2ServerSession : public Object
+	{
+	public:
+		_priv_Http2ServerSession();
+
+		~_priv_Http2ServerSession();
+
+	public:
+		// `contextUpgrade` is the HTTP/1.1 request upgraded to the stream 1 (h2c), `sizePrefaceReceived` is the size of the connection preface already parsed as a HTTP/1.x request header (prior knowledge)
+		static Ref<_priv_Http2ServerSession> create(HttpServerConnection* connection, HttpServerContext* contextUpgrade, const Memory& settingsUpgrade, sl_uint32 sizePrefaceReceived);
+
+	public:
+		void close();
+
+		void processInput(const void* data, sl_size size);
+
+		// continues the suspended request bodies
+		void resumeInput();
+
+		void sendResponse(HttpServerContext* context);
+
+		void onOutputEnd(sl_bool flagError);
+
+		sl_bool writeStreamData(sl_uint32 streamId, AsyncStreamRequest* request);
+
+		void onStreamOutputEnd(sl_uint32 streamId, AsyncOutput* output, sl_bool flagError);
+
+	protected:
+		sl_bool _processFrame(const Http2FrameHeader* frame);
+
+		sl_bool _processHeaders(const Http2FrameHeader* frame);
+
+		sl_bool _processHeaderBlock(sl_uint32 streamId, const void* data, sl_size size, sl_bool flagEndStream, sl_uint32 dependency, sl_uint32 weight);
+
+		sl_bool _processData(const Http2FrameHeader* frame);
+
+		sl_bool _processSettings(const Http2FrameHeader* frame);
+
+		sl_bool _processWindowUpdate(const Http2FrameHeader* frame);
+
+		Ref<HttpServerContext> _createContext(_priv_Http2ServerStream* stream, const List<HpackHeaderField>& fields);
+
+		// passes the received bodies to the contexts and dispatches the completed requests, out of the lock
+		void _processStreams();
+
+		void _processStream(_priv_Http2ServerStream* stream);
+
+		void _respondError(_priv_Http2ServerStream* stream, HttpStatus status);
+
+		void _writeFrame(Http2FrameType type, sl_uint8 flags, sl_uint32 streamId, const void* payload, sl_uint32 size);
+
+		// `block` is returned by the encoder, leaving the space of the frame header
+		void _writeHeaderBlock(sl_uint32 streamId, const Memory& block, sl_bool flagEndStream);
+
+		void _writeWindowUpdate(sl_uint32 streamId, sl_uint32 increment);
+
+		void _writeResetStream(sl_uint32 streamId, Http2ErrorCode code);
+
+		// sends GOAWAY, and the connection is closed when the output is written
+		void _goAway(Http2ErrorCode code);
+
+		// returns the window of the consumed body to the peer
+		void _returnWindow(_priv_Http2ServerStream* stream, sl_uint32 size);
+
+		// writes the DATA frames allowed by the flow control and the output buffer
+		void _sendData(_priv_Http2ServerStream* stream);
+
+		// continues the streams blocked by the flow control or the full output, in the order of the priority
+		void _sendBlockedStreams();
+
+		// the response is sent
+		void _finishStream(_priv_Http2ServerStream* stream);
+
+		void _removeStream(_priv_Http2ServerStream* stream, sl_bool flagKeepCounted = sl_false);
+
+	protected:
+		WeakRef<HttpServerConnection> m_connection;
+		WeakRef<HttpServer> m_server;
+		Ref<AsyncStream> m_io;
+		Ref<AsyncOutput> m_output;
+		sl_bool m_flagClosed;
+
+		sl_uint32 m_maxConcurrentStreams;
+		sl_uint32 m_initialWindowSize;
+		sl_uint32 m_maxFrameSize;
+		sl_uint64 m_maxHeaderBlockSize;
+
+		Http2Settings m_settingsRemote;
+		HpackDecoder m_decoder;
+		HpackEncoder m_encoder;
+
+		HashMap< sl_uint32, Ref<_priv_Http2ServerStream> > m_streams;
+		sl_uint32 m_lastStreamId;
+		sl_uint32 m_countActiveStreams;
+		sl_uint32 m_maxResetStreamsPerSecond;
+		sl_uint32 m_timeResetStreams; // start of the second counting the streams reset by the client
+		sl_uint32 m_countResetStreams;
+		List< Ref<_priv_Http2ServerStream> > m_streamsReceived;
+		List< Ref<_priv_Http2ServerStream> > m_streamsBlocked;
+
+		sl_int64 m_windowSend;
+		sl_int64 m_windowRecv;
+		sl_uint32 m_sizeRecvConsumed;
+
+		// input
+		sl_uint32 m_sizePrefaceRemaining;
+		Memory m_bufFrame;
+		sl_uint32 m_sizeFrameReceived;
+		MemoryBuffer m_headerBlock;
+		sl_uint32 m_streamIdHeaderBlock; // expecting CONTINUATION
+		sl_bool m_flagHeaderBlockEndStream;
+		sl_uint32 m_dependencyHeaderBlock;
+		sl_uint32 m_weightHeaderBlock;
+
+		sl_bool m_flagGoAwayReceived;
+		sl_bool m_flagGoAwaySent;
+
+	};
+
+}
+
+#endif
@@ -0,0 +1,457 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "slib/network/http_admission.h"
+
+#include "slib/core/async.h"
+#include "slib/core/dispatch.h"
+#include "slib/core/hash_map.h"
+#include "slib/core/spin_lock.h"
+#include "slib/core/system.h"
+
+#define PRIV_HTTP_ADMISSION_SHARDS 64
+// addresses checked for the replacement when a shard is full
+#define PRIV_HTTP_ADMISSION_EVICT_SCAN 16
+
+namespace slib
+{
+
+	class _priv_HttpAdmissionAddress
+	{
+	public:
+		sl_uint32 countConnections;
+		sl_uint64 tokens; // in 1/1000 tokens
+		sl_uint32 tickUpdated;
+		sl_bool flagAccessed;
+		Link<IPAddress>* link;
+
+	public:
+		void refill(sl_uint32 tick, sl_uint32 rate, sl_uint64 capacity)
+		{
+			// `rate` tokens per second are `rate` milli-tokens per millisecond
+			sl_uint64 n = (sl_uint64)(tick - tickUpdated) * rate;
+			tickUpdated = tick;
+			if (n >= capacity - tokens) {
+				tokens = capacity;
+			} else {
+				tokens += n;
+			}
+		}
+
+	};
+
+	class _priv_HttpAdmissionShard
+	{
+	public:
+		SpinLock lock;
+		CHashMap<IPAddress, _priv_HttpAdmissionAddress> map;
+		CLinkedList<IPAddress> clock;
+
+	public:
+		// returns null if the shard is full of the addresses having connections
+		_priv_HttpAdmissionAddress* getAddress_NoLock(const IPAddress& address, sl_uint32 tick, const HttpAdmissionParam& param, sl_uint64 capacity)
+		{
+			_priv_HttpAdmissionAddress* item = map.getItemPointer(address);
+			if (item) {
+				item->flagAccessed = sl_true;
+				return item;
+			}
+			sl_size limit = param.maxAddressesCount / PRIV_HTTP_ADMISSION_SHARDS;
+			if (!limit) {
+				limit = 1;
+			}
+			if (map.getCount() >= limit) {
+				if (!(evict_NoLock(tick, param.requestRate, capacity))) {
+					return sl_null;
+				}
+			}
+			Link<IPAddress>* link = clock.pushBack_NoLock(address);
+			if (!link) {
+				return sl_null;
+			}
+			_priv_HttpAdmissionAddress init;
+			init.countConnections = 0;
+			init.tokens = capacity;
+			init.tickUpdated = tick;
+			init.flagAccessed = sl_false;
+			init.link = link;
+			auto node = map.put_NoLock(address, init);
+			if (node) {
+				return &(node->value);
+			}
+			clock.removeAt(link);
+			return sl_null;
+		}
+
+		// checks at most `PRIV_HTTP_ADMISSION_EVICT_SCAN` addresses in CLOCK order, and removes the idle one (no connection and a full bucket), or the one without connections not accessed since the last check
+		sl_bool evict_NoLock(sl_uint32 tick, sl_uint32 rate, sl_uint64 capacity)
+		{
+			for (sl_uint32 i = 0; i < PRIV_HTTP_ADMISSION_EVICT_SCAN; i++) {
+				Link<IPAddress>* link = clock.getFront();
+				if (!link) {
+					return sl_true;
+				}
+				IPAddress address = link->value;
+				clock.removeAt(link);
+				_priv_HttpAdmissionAddress* item = map.getItemPointer(address);
+				if (!item) {
+					continue;
+				}
+				if (!(item->countConnections)) {
+					item->refill(tick, rate, capacity);
+					if (item->tokens >= capacity || !(item->flagAccessed)) {
+						map.remove_NoLock(address);
+						return sl_true;
+					}
+				}
+				item->flagAccessed = sl_false;
+				item->link = clock.pushBack_NoLock(address);
+				if (!(item->link)) {
+					map.remove_NoLock(address);
+					return sl_true;
+				}
+			}
+			return sl_false;
+		}
+
+	};
+
+	class _priv_HttpAdmissionWaiter : public Referable
+	{
+	public:
+		Function<void(sl_bool)> callback;
+		sl_uint32 tickQueued;
+
+	};
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HttpAdmissionParam)
+
+	HttpAdmissionParam::HttpAdmissionParam()
+	{
+		maxConnectionsPerAddress = 0;
+		requestRate = 0;
+		requestBurst = 0;
+		maxAddressesCount = 65536;
+		maxConcurrentRequests = 0;
+		maxQueuedRequests = 256;
+		maxQueueTime = 5000;
+		retryAfter = 1;
+	}
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HttpAdmissionStatistics)
+
+	HttpAdmissionStatistics::HttpAdmissionStatistics()
+	{
+		rejectedConnections = 0;
+		rejectedRequestsByRate = 0;
+		rejectedRequestsByQueue = 0;
+		rejectedRequestsByTimeout = 0;
+		queuedRequests = 0;
+		activeRequests = 0;
+		waitingRequests = 0;
+		addressesCount = 0;
+	}
+
+
+	SLIB_DEFINE_OBJECT(HttpAdmissionControl, Object)
+
+	HttpAdmissionControl::HttpAdmissionControl()
+	{
+		m_capacityBucket = 0;
+		m_shards = sl_null;
+		m_countActive = 0;
+		m_countRejectedConnections = 0;
+		m_countRejectedByRate = 0;
+		m_countRejectedByQueue = 0;
+		m_countRejectedByTimeout = 0;
+		m_countQueued = 0;
+		m_flagQueueTimer = sl_false;
+	}
+
+	HttpAdmissionControl::~HttpAdmissionControl()
+	{
+		if (m_shards) {
+			delete[] m_shards;
+		}
+	}
+
+	Ref<HttpAdmissionControl> HttpAdmissionControl::create(const HttpAdmissionParam& param, const Ref<AsyncIoLoop>& loop)
+	{
+		Ref<HttpAdmissionControl> ret = new HttpAdmissionControl;
+		if (ret.isNotNull()) {
+			ret->m_shards = new _priv_HttpAdmissionShard[PRIV_HTTP_ADMISSION_SHARDS];
+			if (ret->m_shards) {
+				ret->m_param = param;
+				ret->m_ioLoop = loop;
+				sl_uint32 burst = param.requestBurst;
+				if (!burst) {
+					burst = param.requestRate;
+				}
+				ret->m_capacityBucket = (sl_uint64)burst * 1000;
+				return ret;
+			}
+		}
+		return sl_null;
+	}
+
+	Ref<HttpAdmissionControl> HttpAdmissionControl::create(const HttpAdmissionParam& param)
+	{
+		return create(param, sl_null);
+	}
+
+	sl_bool HttpAdmissionControl::addConnection(const IPAddress& address)
+	{
+		sl_uint32 maxConnections = m_param.maxConnectionsPerAddress;
+		if (!maxConnections) {
+			return sl_true;
+		}
+		sl_uint32 tick = System::getTickCount();
+		_priv_HttpAdmissionShard* shard = _getShard(address);
+		{
+			SpinLocker lock(&(shard->lock));
+			_priv_HttpAdmissionAddress* item = shard->getAddress_NoLock(address, tick, m_param, m_capacityBucket);
+			if (item && item->countConnections < maxConnections) {
+				item->countConnections++;
+				return sl_true;
+			}
+		}
+		Base::interlockedIncrement64(&m_countRejectedConnections);
+		return sl_false;
+	}
+
+	void HttpAdmissionControl::removeConnection(const IPAddress& address)
+	{
+		if (!(m_param.maxConnectionsPerAddress)) {
+			return;
+		}
+		_priv_HttpAdmissionShard* shard = _getShard(address);
+		SpinLocker lock(&(shard->lock));
+		_priv_HttpAdmissionAddress* item = shard->map.getItemPointer(address);
+		if (item && item->countConnections) {
+			item->countConnections--;
+		}
+	}
+
+	sl_bool HttpAdmissionControl::takeRequestToken(const IPAddress& address)
+	{
+		sl_uint32 rate = m_param.requestRate;
+		if (!rate) {
+			return sl_true;
+		}
+		sl_uint32 tick = System::getTickCount();
+		_priv_HttpAdmissionShard* shard = _getShard(address);
+		{
+			SpinLocker lock(&(shard->lock));
+			_priv_HttpAdmissionAddress* item = shard->getAddress_NoLock(address, tick, m_param, m_capacityBucket);
+			if (item) {
+				item->refill(tick, rate, m_capacityBucket);
+				if (item->tokens >= 1000) {
+					item->tokens -= 1000;
+					return sl_true;
+				}
+			}
+		}
+		Base::interlockedIncrement64(&m_countRejectedByRate);
+		return sl_false;
+	}
+
+	sl_bool HttpAdmissionControl::checkQueue()
+	{
+		sl_uint32 maxConcurrent = m_param.maxConcurrentRequests;
+		if (!maxConcurrent) {
+			return sl_true;
+		}
+		if (m_countActive < maxConcurrent || m_queue.getCount() < m_param.maxQueuedRequests) {
+			return sl_true;
+		}
+		Base::interlockedIncrement64(&m_countRejectedByQueue);
+		return sl_false;
+	}
+
+	HttpAdmissionStatus HttpAdmissionControl::enterProcessing(const Function<void(sl_bool flagAdmitted)>& callback)
+	{
+		sl_uint32 maxConcurrent = m_param.maxConcurrentRequests;
+		if (!maxConcurrent) {
+			return HttpAdmissionStatus::Admitted;
+		}
+		List< Ref<_priv_HttpAdmissionWaiter> > expired;
+		HttpAdmissionStatus status;
+		sl_bool flagStartTimer = sl_false;
+		{
+			ObjectLocker lock(this);
+			_popExpired_NoLock(expired);
+			if (m_countActive < maxConcurrent) {
+				m_countActive++;
+				status = HttpAdmissionStatus::Admitted;
+			} else {
+				status = HttpAdmissionStatus::Rejected;
+				if (m_queue.getCount() < m_param.maxQueuedRequests) {
+					Ref<_priv_HttpAdmissionWaiter> waiter = new _priv_HttpAdmissionWaiter;
+					if (waiter.isNotNull()) {
+						waiter->callback = callback;
+						waiter->tickQueued = System::getTickCount();
+						if (m_queue.pushBack_NoLock(waiter)) {
+							status = HttpAdmissionStatus::Queued;
+							if (m_param.maxQueueTime && !m_flagQueueTimer) {
+								m_flagQueueTimer = sl_true;
+								flagStartTimer = sl_true;
+							}
+						}
+					}
+				}
+			}
+		}
+		if (flagStartTimer) {
+			_startQueueTimer(m_param.maxQueueTime);
+		}
+		if (status == HttpAdmissionStatus::Queued) {
+			Base::interlockedIncrement64(&m_countQueued);
+		} else if (status == HttpAdmissionStatus::Rejected) {
+			Base::interlockedIncrement64(&m_countRejectedByQueue);
+		}
+		ListElements< Ref<_priv_HttpAdmissionWaiter> > items(expired);
+		for (sl_size i = 0; i < items.count; i++) {
+			items[i]->callback(sl_false);
+		}
+		return status;
+	}
+
+	void HttpAdmissionControl::leaveProcessing()
+	{
+		if (!(m_param.maxConcurrentRequests)) {
+			return;
+		}
+		List< Ref<_priv_HttpAdmissionWaiter> > expired;
+		Ref<_priv_HttpAdmissionWaiter> next;
+		{
+			ObjectLocker lock(this);
+			_popExpired_NoLock(expired);
+			// the slot is passed to the next request
+			if (!(m_queue.popFront_NoLock(&next))) {
+				if (m_countActive) {
+					m_countActive--;
+				}
+			}
+		}
+		ListElements< Ref<_priv_HttpAdmissionWaiter> > items(expired);
+		for (sl_size i = 0; i < items.count; i++) {
+			items[i]->callback(sl_false);
+		}
+		if (next.isNotNull()) {
+			next->callback(sl_true);
+		}
+	}
+
+	HttpAdmissionStatistics HttpAdmissionControl::getStatistics()
+	{
+		HttpAdmissionStatistics ret;
+		ret.rejectedConnections = m_countRejectedConnections;
+		ret.rejectedRequestsByRate = m_countRejectedByRate;
+		ret.rejectedRequestsByQueue = m_countRejectedByQueue;
+		ret.rejectedRequestsByTimeout = m_countRejectedByTimeout;
+		ret.queuedRequests = m_countQueued;
+		{
+			ObjectLocker lock(this);
+			ret.activeRequests = m_countActive;
+			ret.waitingRequests = (sl_uint32)(m_queue.getCount());
+		}
+		sl_size n = 0;
+		for (sl_uint32 i = 0; i < PRIV_HTTP_ADMISSION_SHARDS; i++) {
+			n += m_shards[i].map.getCount();
+		}
+		ret.addressesCount = (sl_uint32)n;
+		return ret;
+	}
+
+	const HttpAdmissionParam& HttpAdmissionControl::getParam()
+	{
+		return m_param;
+	}
+
+	_priv_HttpAdmissionShard* HttpAdmissionControl::_getShard(const IPAddress& address)
+	{
+		sl_size h = Hash<IPAddress>()(address);
+		return m_shards + (h % PRIV_HTTP_ADMISSION_SHARDS);
+	}
+
+	void HttpAdmissionControl::_startQueueTimer(sl_uint32 delay)
+	{
+		Function<void()> callback = SLIB_BIND_WEAKREF(void(), HttpAdmissionControl, _onQueueTimer, this);
+		sl_bool flagStarted;
+		Ref<AsyncIoLoop> loop = m_ioLoop;
+		if (loop.isNotNull()) {
+			flagStarted = loop->setTimeout(callback, delay);
+		} else {
+			flagStarted = Dispatch::setTimeout(callback, delay);
+		}
+		if (!flagStarted) {
+			ObjectLocker lock(this);
+			m_flagQueueTimer = sl_false;
+		}
+	}
+
+	void HttpAdmissionControl::_onQueueTimer()
+	{
+		List< Ref<_priv_HttpAdmissionWaiter> > expired;
+		sl_uint32 delay = 0;
+		{
+			ObjectLocker lock(this);
+			_popExpired_NoLock(expired);
+			// armed again for the deadline of the new front
+			Ref<_priv_HttpAdmissionWaiter> front;
+			if (m_queue.getFrontValue_NoLock(&front)) {
+				sl_uint32 elapsed = System::getTickCount() - front->tickQueued;
+				delay = elapsed < m_param.maxQueueTime ? m_param.maxQueueTime - elapsed : 1;
+			} else {
+				m_flagQueueTimer = sl_false;
+			}
+		}
+		if (delay) {
+			_startQueueTimer(delay);
+		}
+		ListElements< Ref<_priv_HttpAdmissionWaiter> > items(expired);
+		for (sl_size i = 0; i < items.count; i++) {
+			items[i]->callback(sl_false);
+		}
+	}
+
+	void HttpAdmissionControl::_popExpired_NoLock(List< Ref<_priv_HttpAdmissionWaiter> >& expired)
+	{
+		sl_uint32 timeout = m_param.maxQueueTime;
+		if (!timeout) {
+			return;
+		}
+		sl_uint32 tick = System::getTickCount();
+		Ref<_priv_HttpAdmissionWaiter> waiter;
+		while (m_queue.getFrontValue_NoLock(&waiter)) {
+			if (tick - waiter->tickQueued < timeout) {
+				break;
+			}
+			m_queue.popFront_NoLock();
+			expired.add_NoLock(waiter);
+			Base::interlockedIncrement64(&m_countRejectedByTimeout);
+		}
+	}
+
+}
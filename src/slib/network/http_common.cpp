@@ -77,6 +77,7 @@ namespace slib
 			HTTP_STATUS_CASE(UnsupportedMediaType, "Unsupported Media Type");
 			HTTP_STATUS_CASE(RequestRangeNotSatisfiable, "Requested range not satisfiable");
 			HTTP_STATUS_CASE(ExpectationFailed, "Expectation Failed");
+			HTTP_STATUS_CASE(TooManyRequests, "Too Many Requests");
 			
 			HTTP_STATUS_CASE(InternalServerError, "Internal Server Error");
 			HTTP_STATUS_CASE(NotImplemented, "Not Implemented");
@@ -163,6 +164,7 @@ namespace slib
 	DEFINE_HTTP_HEADER(Connection, "Connection")
 	DEFINE_HTTP_HEADER(CacheControl, "Cache-Control")
 	DEFINE_HTTP_HEADER(ContentDisposition, "Content-Disposition")
+	DEFINE_HTTP_HEADER(Vary, "Vary")
 
 	DEFINE_HTTP_HEADER(ContentLength, "Content-Length")
 	DEFINE_HTTP_HEADER(ContentType, "Content-Type")
@@ -174,6 +176,8 @@ namespace slib
 	DEFINE_HTTP_HEADER(Cookie, "Cookie")
 	DEFINE_HTTP_HEADER(Range, "Range")
 	DEFINE_HTTP_HEADER(IfModifiedSince, "If-Modified-Since")
+	DEFINE_HTTP_HEADER(IfNoneMatch, "If-None-Match")
+	DEFINE_HTTP_HEADER(Authorization, "Authorization")
 
 	DEFINE_HTTP_HEADER(TransferEncoding, "Transfer-Encoding")
 	DEFINE_HTTP_HEADER(AccessControlAllowOrigin, "Access-Control-Allow-Origin")
@@ -181,6 +185,8 @@ namespace slib
 	DEFINE_HTTP_HEADER(AcceptRanges, "Accept-Ranges")
 	DEFINE_HTTP_HEADER(ContentRange, "Content-Range")
 	DEFINE_HTTP_HEADER(LastModified, "Last-Modified")
+	DEFINE_HTTP_HEADER(ETag, "ETag")
+	DEFINE_HTTP_HEADER(RetryAfter, "Retry-After")
 
 	sl_reg HttpHeaders::parseHeaders(HttpHeaderMap& map, const void* _data, sl_size size)
 	{
@@ -554,6 +560,25 @@ namespace slib
 	}
 	
 	
+	class _priv_HttpUploadFile_Temporary : public Referable
+	{
+	public:
+		String path;
+		
+	public:
+		_priv_HttpUploadFile_Temporary(const String& _path) : path(_path)
+		{
+		}
+		
+		~_priv_HttpUploadFile_Temporary()
+		{
+			if (path.isNotEmpty()) {
+				File::deleteFile(path);
+			}
+		}
+		
+	};
+	
 	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HttpUploadFile)
 	
 	HttpUploadFile::HttpUploadFile(const String& fileName, const HttpHeaderMap& headers, void* data, sl_size size, const Ref<Referable>& ref)
@@ -561,6 +586,11 @@ namespace slib
 	{
 	}
 	
+	HttpUploadFile::HttpUploadFile(const String& fileName, const HttpHeaderMap& headers, const String& filePath, sl_size size)
+	 : m_fileName(fileName), m_headers(headers), m_data(sl_null), m_size(size), m_filePath(filePath), m_ref(new _priv_HttpUploadFile_Temporary(filePath))
+	{
+	}
+	
 	String HttpUploadFile::getFileName()
 	{
 		return m_fileName;
@@ -591,9 +621,50 @@ namespace slib
 		return m_size;
 	}
 	
+	String HttpUploadFile::getFilePath()
+	{
+		return m_filePath;
+	}
+	
 	sl_bool HttpUploadFile::saveToFile(const String& path)
 	{
-		return File::writeAllBytes(path, m_data, m_size);
+		if (m_filePath.isEmpty()) {
+			if (!m_data && m_size) {
+				return sl_false;
+			}
+			return File::writeAllBytes(path, m_data, m_size);
+		}
+		_priv_HttpUploadFile_Temporary* temp = (_priv_HttpUploadFile_Temporary*)(m_ref.get());
+		if (temp && temp->path == m_filePath) {
+			File::deleteFile(path);
+			if (File::rename(m_filePath, path)) {
+				temp->path.setNull();
+				m_filePath = path;
+				return sl_true;
+			}
+		}
+		// copies when the file can not be moved (for example, to another volume)
+		Ref<File> src = File::openForRead(m_filePath);
+		if (src.isNull()) {
+			return sl_false;
+		}
+		Ref<File> dst = File::openForWrite(path);
+		if (dst.isNull()) {
+			return sl_false;
+		}
+		char buf[0x10000];
+		sl_size sizeRemain = m_size;
+		while (sizeRemain) {
+			sl_reg n = src->read(buf, sizeRemain < sizeof(buf) ? sizeRemain : sizeof(buf));
+			if (n <= 0) {
+				return sl_false;
+			}
+			if (dst->writeFully(buf, n) != n) {
+				return sl_false;
+			}
+			sizeRemain -= n;
+		}
+		return sl_true;
 	}
 	
 	
@@ -611,6 +682,7 @@ namespace slib
 		SLIB_STATIC_STRING(s2, "GET");
 		m_methodText = s2;
 		m_methodTextUpper = s2;
+		m_countRequestHeaderSlices = 0;
 	}
 
 	HttpMethod HttpRequest::getMethod() const
@@ -674,12 +746,21 @@ namespace slib
 
 	const HttpHeaderMap& HttpRequest::getRequestHeaders() const
 	{
+		_materializeRequestHeaders();
 		return m_requestHeaders;
 	}
 
 	String HttpRequest::getRequestHeader(const String& name) const
 	{
-		String value = m_requestHeaders.getValue_NoLock(name, String::null());
+		String value;
+		if (m_countRequestHeaderSlices) {
+			sl_reg index = _findRequestHeaderSlice(name);
+			if (index >= 0) {
+				value = _getRequestHeaderSliceValue(index);
+			}
+		} else {
+			value = m_requestHeaders.getValue_NoLock(name, String::null());
+		}
 		sl_size len = value.getLength();
 		if (len >= 2 && value.startsWith('\"') && value.endsWith('\"')) {
 			return value.substring(1, len - 1);
@@ -689,26 +770,33 @@ namespace slib
 	
 	void HttpRequest::setRequestHeader(const String& name, const String& value)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.put_NoLock(name, value);
 	}
 
 	void HttpRequest::addRequestHeader(const String& name, const String& value)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.add_NoLock(name, value);
 	}
 
 	sl_bool HttpRequest::containsRequestHeader(const String& name) const
 	{
+		if (m_countRequestHeaderSlices) {
+			return _findRequestHeaderSlice(name) >= 0;
+		}
 		return m_requestHeaders.find_NoLock(name) != sl_null;
 	}
 
 	void HttpRequest::removeRequestHeader(const String& name)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.removeItems_NoLock(name);
 	}
 
 	List<String> HttpRequest::getRequestHeaderValues(const String& name) const
 	{
+		_materializeRequestHeaders();
 		List<String> list;
 		MapNode<String, String>* node;
 		MapNode<String, String>* nodeEnd;
@@ -726,16 +814,19 @@ namespace slib
 	
 	void HttpRequest::setRequestHeaderValues(const String& name, const List<String>& list)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.put_NoLock(name, HttpHeaders::mergeValues(list));
 	}
 	
 	void HttpRequest::addRequestHeaderValues(const String& name, const List<String>& list)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.add_NoLock(name, HttpHeaders::mergeValues(list));
 	}
 	
 	HttpHeaderValueMap HttpRequest::getRequestHeaderValueMap(const String& name) const
 	{
+		_materializeRequestHeaders();
 		HttpHeaderValueMap map;
 		MapNode<String, String>* node;
 		MapNode<String, String>* nodeEnd;
@@ -753,16 +844,20 @@ namespace slib
 
 	void HttpRequest::setRequestHeaderValueMap(const String& name, const HttpHeaderValueMap& map)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.put_NoLock(name, HttpHeaders::mergeValueMap(map));
 	}
 	
 	void HttpRequest::addRequestHeaderValueMap(const String& name, const HttpHeaderValueMap& map)
 	{
+		_materializeRequestHeaders();
 		m_requestHeaders.add_NoLock(name, HttpHeaders::mergeValueMap(map));
 	}
 	
 	void HttpRequest::clearRequestHeaders()
 	{
+		m_countRequestHeaderSlices = 0;
+		m_requestHeaderPacket.setNull();
 		m_requestHeaders.removeAll_NoLock();
 	}
 
@@ -862,8 +957,21 @@ namespace slib
 	
 	sl_bool HttpRequest::isKeepAlive() const
 	{
-		SLIB_STATIC_STRING(str, "Keep-Alive");
-		return getRequestHeader(HttpHeaders::Connection).equalsIgnoreCase(str);
+		SLIB_STATIC_STRING(s1, "keep-alive");
+		SLIB_STATIC_STRING(s2, "close");
+		SLIB_STATIC_STRING(s3, "HTTP/1.0");
+		String connection = getRequestHeader(HttpHeaders::Connection);
+		if (connection.isNotEmpty()) {
+			connection = connection.toLower();
+			if (connection.contains(s2)) {
+				return sl_false;
+			}
+			if (connection.contains(s1)) {
+				return sl_true;
+			}
+		}
+		// persistent by default since HTTP/1.1
+		return m_requestVersion.isNotEmpty() && !(m_requestVersion.equalsIgnoreCase(s3));
 	}
 	
 	void HttpRequest::setKeepAlive()
@@ -1003,6 +1111,7 @@ namespace slib
 	
 	HashMap<String, String> HttpRequest::getRequestCookies() const
 	{
+		_materializeRequestHeaders();
 		HashMap<String, String> map;
 		MapNode<String, String>* node;
 		MapNode<String, String>* nodeEnd;
@@ -1056,6 +1165,12 @@ namespace slib
 		return m_parameters.find_NoLock(name) != sl_null;
 	}
 
+	void HttpRequest::setParameter(const String& name, const String& value)
+	{
+		m_parameters.removeItems_NoLock(name);
+		m_parameters.add_NoLock(name, value);
+	}
+
 	const HashMap<String, String>& HttpRequest::getQueryParameters() const
 	{
 		return m_queryParameters;
@@ -1270,6 +1385,7 @@ namespace slib
 		msg.addStatic(strVersion.getData(), strVersion.getLength());
 		msg.addStatic("\r\n", 2);
 
+		_materializeRequestHeaders();
 		for (auto& pair : m_requestHeaders) {
 			String str = pair.key;
 			msg.addStatic(str.getData(), str.getLength());
@@ -1282,9 +1398,80 @@ namespace slib
 		return msg.merge();
 	}
 
+	static sl_bool _priv_HttpRequest_equalsMethod(const sl_char8* data, sl_size len, const String& method)
+	{
+		return len == method.getLength() && Base::equalsMemory(data, method.getData(), len);
+	}
+
+	// exact (uppercase) match of the standard methods, without creating the string
+	static HttpMethod _priv_HttpRequest_getMethod(const sl_char8* data, sl_size len)
+	{
+		switch (len) {
+			case 3:
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_GET)) {
+					return HttpMethod::GET;
+				}
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_PUT)) {
+					return HttpMethod::PUT;
+				}
+				break;
+			case 4:
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_POST)) {
+					return HttpMethod::POST;
+				}
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_HEAD)) {
+					return HttpMethod::HEAD;
+				}
+				break;
+			case 5:
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_PATCH)) {
+					return HttpMethod::PATCH;
+				}
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_TRACE)) {
+					return HttpMethod::TRACE;
+				}
+				break;
+			case 6:
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_DELETE)) {
+					return HttpMethod::DELETE;
+				}
+				break;
+			case 7:
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_OPTIONS)) {
+					return HttpMethod::OPTIONS;
+				}
+				if (_priv_HttpRequest_equalsMethod(data, len, _g_priv_http_method_CONNECT)) {
+					return HttpMethod::CONNECT;
+				}
+				break;
+		}
+		return HttpMethod::Unknown;
+	}
+
 	sl_reg HttpRequest::parseRequestPacket(const void* packet, sl_size size)
 	{
-		const sl_char8* data = (const sl_char8*)packet;
+		m_requestHeaderPacket = Memory::createStatic(packet, size);
+		sl_reg iRet = _parseRequestPacket((const sl_char8*)packet, size);
+		// `packet` is not kept
+		_materializeRequestHeaders();
+		m_requestHeaderPacket.setNull();
+		return iRet;
+	}
+
+	sl_reg HttpRequest::parseRequestPacket(const Memory& packet)
+	{
+		m_requestHeaderPacket = packet;
+		sl_reg iRet = _parseRequestPacket((const sl_char8*)(packet.getData()), packet.getSize());
+		if (!m_countRequestHeaderSlices) {
+			m_requestHeaderPacket.setNull();
+		}
+		return iRet;
+	}
+
+	sl_reg HttpRequest::_parseRequestPacket(const sl_char8* data, sl_size size)
+	{
+		_materializeRequestHeaders();
+		
 		sl_size posCurrent = 0;
 		sl_size posStart = 0;
 		// method
@@ -1301,61 +1488,180 @@ namespace slib
 		if (posCurrent == size) {
 			return 0;
 		}
-		setMethod(String::fromUtf8(data + posStart, posCurrent - posStart));
+		HttpMethod method = _priv_HttpRequest_getMethod(data + posStart, posCurrent - posStart);
+		if (method != HttpMethod::Unknown) {
+			setMethod(method);
+		} else {
+			setMethod(String::fromUtf8(data + posStart, posCurrent - posStart));
+		}
 		posCurrent++;
 
 		// uri
 		posStart = posCurrent;
-		sl_size posQuery = 0;
-		while (posCurrent < size) {
-			sl_char8 ch = data[posCurrent];
-			if (ch == ' ') {
-				break;
-			}
-			if (ch == '\r' || ch == '\n') {
+		const sl_char8* end = (const sl_char8*)(Base::findMemory(data + posStart, ' ', size - posStart));
+		if (!end) {
+			if (Base::findMemory(data + posStart, '\r', size - posStart) || Base::findMemory(data + posStart, '\n', size - posStart)) {
 				return -1;
 			}
-			if (posQuery == 0 && ch == '?') {
-				posQuery = posCurrent + 1;
-			}
-			posCurrent++;
-		}
-		if (posCurrent == size) {
 			return 0;
 		}
-		if (posQuery > 0) {
+		posCurrent = end - data;
+		sl_size lenUri = posCurrent - posStart;
+		if (Base::findMemory(data + posStart, '\r', lenUri) || Base::findMemory(data + posStart, '\n', lenUri)) {
+			return -1;
+		}
+		const sl_char8* query = (const sl_char8*)(Base::findMemory(data + posStart, '?', lenUri));
+		if (query) {
+			sl_size posQuery = query - data + 1;
 			setPath(String::fromUtf8(data + posStart, posQuery - 1 - posStart));
 			setQuery(String::fromUtf8(data + posQuery, posCurrent - posQuery));
 		} else {
-			setPath(String::fromUtf8(data + posStart, posCurrent - posStart));
+			setPath(String::fromUtf8(data + posStart, lenUri));
 			setQuery(String::null());
 		}
 		posCurrent++;
 
 		// version
 		posStart = posCurrent;
-		while (posCurrent < size) {
-			sl_char8 ch = data[posCurrent];
-			if (ch == '\r') {
-				break;
-			}
-			posCurrent++;
+		end = (const sl_char8*)(Base::findMemory(data + posStart, '\r', size - posStart));
+		if (!end) {
+			return 0;
 		}
+		posCurrent = end - data;
 		if (posCurrent >= size - 1) {
 			return 0;
 		}
 		if (data[posCurrent + 1] != '\n') {
 			return -1;
 		}
-		setRequestVersion(String::fromUtf8(data + posStart, posCurrent - posStart));
+		SLIB_STATIC_STRING(strVersion11, "HTTP/1.1");
+		if (_priv_HttpRequest_equalsMethod(data + posStart, posCurrent - posStart, strVersion11)) {
+			m_requestVersion = strVersion11;
+		} else {
+			setRequestVersion(String::fromUtf8(data + posStart, posCurrent - posStart));
+		}
 		posCurrent += 2;
+		
+		sl_size posHeaders = posCurrent;
 
-		sl_reg iRet = HttpHeaders::parseHeaders(m_requestHeaders, data + posCurrent, size - posCurrent);
-		if (iRet > 0) {
-			return posCurrent + iRet;
+		// headers
+		sl_uint32 nSlices = 0;
+		for (;;) {
+			posStart = posCurrent;
+			end = (const sl_char8*)(Base::findMemory(data + posStart, '\r', size - posStart));
+			if (!end) {
+				return 0;
+			}
+			posCurrent = end - data;
+			if (posCurrent >= size - 1) {
+				return 0;
+			}
+			if (data[posCurrent + 1] != '\n') {
+				return -1;
+			}
+			if (posCurrent == posStart) {
+				posCurrent += 2;
+				break;
+			}
+			if (nSlices >= SLIB_HTTP_REQUEST_HEADER_SLICES_MAX || posCurrent > 0xFFFFFFFF) {
+				// too many headers to keep as the slices
+				nSlices = 0;
+				sl_reg iRet = HttpHeaders::parseHeaders(m_requestHeaders, data + posHeaders, size - posHeaders);
+				if (iRet > 0) {
+					if (Base::findMemory(data, 0, posHeaders + iRet)) {
+						return -1;
+					}
+					return posHeaders + iRet;
+				} else {
+					return iRet;
+				}
+			}
+			HttpHeaderSlice& slice = m_requestHeaderSlices[nSlices];
+			slice.name = (sl_uint32)posStart;
+			const sl_char8* split = (const sl_char8*)(Base::findMemory(data + posStart, ':', posCurrent - posStart));
+			if (split) {
+				sl_size indexSplit = split - data;
+				slice.lengthName = (sl_uint32)(indexSplit - posStart);
+				sl_size startValue = indexSplit + 1;
+				sl_size endValue = posCurrent;
+				while (startValue < endValue) {
+					if (data[startValue] != ' ' && data[startValue] != '\t') {
+						break;
+					}
+					startValue++;
+				}
+				while (startValue < endValue) {
+					if (data[endValue - 1] != ' ' && data[endValue - 1] != '\t') {
+						break;
+					}
+					endValue--;
+				}
+				slice.value = (sl_uint32)startValue;
+				slice.lengthValue = (sl_uint32)(endValue - startValue);
+			} else {
+				slice.lengthName = (sl_uint32)(posCurrent - posStart);
+				slice.value = (sl_uint32)posCurrent;
+				slice.lengthValue = 0;
+			}
+			nSlices++;
+			posCurrent += 2;
+		}
+		// NUL would end the names and the values created from the slices (RFC 9110: must be rejected)
+		if (Base::findMemory(data, 0, posCurrent)) {
+			return -1;
+		}
+		m_countRequestHeaderSlices = nSlices;
+		return posCurrent;
+	}
+
+	sl_reg HttpRequest::_findRequestHeaderSlice(const String& name) const
+	{
+		const sl_char8* data = (const sl_char8*)(m_requestHeaderPacket.getData());
+		const sl_char8* sz = name.getData();
+		sl_size len = name.getLength();
+		for (sl_uint32 i = 0; i < m_countRequestHeaderSlices; i++) {
+			const HttpHeaderSlice& slice = m_requestHeaderSlices[i];
+			if (slice.lengthName == len) {
+				const sl_char8* s = data + slice.name;
+				sl_size k = 0;
+				for (; k < len; k++) {
+					if (SLIB_CHAR_LOWER_TO_UPPER(s[k]) != SLIB_CHAR_LOWER_TO_UPPER(sz[k])) {
+						break;
+					}
+				}
+				if (k == len) {
+					return i;
+				}
+			}
+		}
+		return -1;
+	}
+
+	String HttpRequest::_getRequestHeaderSliceValue(sl_size index) const
+	{
+		const HttpHeaderSlice& slice = m_requestHeaderSlices[index];
+		const sl_char8* value = (const sl_char8*)(m_requestHeaderPacket.getData()) + slice.value;
+		if (Base::findMemory(value, '%', slice.lengthValue)) {
+			return Url::decodeUriComponentByUTF8(String::fromUtf8(value, slice.lengthValue));
 		} else {
-			return iRet;
+			// same as `Url::decodeUriComponentByUTF8` without the percent sign
+			return String::fromUtf8(value, slice.lengthValue);
+		}
+	}
+
+	void HttpRequest::_materializeRequestHeaders() const
+	{
+		sl_uint32 n = m_countRequestHeaderSlices;
+		if (!n) {
+			return;
+		}
+		const sl_char8* data = (const sl_char8*)(m_requestHeaderPacket.getData());
+		for (sl_uint32 i = 0; i < n; i++) {
+			const HttpHeaderSlice& slice = m_requestHeaderSlices[i];
+			m_requestHeaders.add_NoLock(String::fromUtf8(data + slice.name, slice.lengthName), _getRequestHeaderSliceValue(i));
 		}
+		m_countRequestHeaderSlices = 0;
+		m_requestHeaderPacket.setNull();
 	}
 
 
@@ -0,0 +1,506 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "slib/network/http_file_cache.h"
+
+#include "slib/core/system.h"
+#include "slib/core/variant.h"
+#include "slib/core/asset.h"
+#include "slib/crypto/zlib.h"
+
+#if defined(SLIB_PLATFORM_IS_LINUX)
+#define HTTP_FILE_CACHE_SUPPORT_INOTIFY
+#endif
+
+#if defined(HTTP_FILE_CACHE_SUPPORT_INOTIFY)
+#include <unistd.h>
+#include <sys/inotify.h>
+#endif
+
+namespace slib
+{
+
+	static ContentType _priv_HttpFileCache_getContentType(const String& path)
+	{
+		ContentType contentType = ContentTypes::getFromFileExtension(File::getFileExtension(path));
+		if (contentType == ContentType::Unknown) {
+			contentType = ContentType::OctetStream;
+		}
+		return contentType;
+	}
+
+	static sl_bool _priv_HttpFileCache_isCompressible(ContentType contentType, sl_size size)
+	{
+		if (size < 256) {
+			return sl_false;
+		}
+		String type = ContentTypes::toString(contentType);
+		if (type.startsWith("text/")) {
+			return sl_true;
+		}
+		return type.contains("javascript") || type.contains("json") || type.contains("xml");
+	}
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HttpFileCacheParam)
+
+	HttpFileCacheParam::HttpFileCacheParam()
+	{
+		maxEntriesCount = 1024;
+		maxMemorySize = 0x2000000; // 32MB
+		maxContentSize = 0x40000; // 256KB
+		flagCompressGzip = sl_true;
+		gzipLevel = 6;
+		flagUseGzipFile = sl_true;
+		revalidateInterval = 1000;
+		negativeTimeout = 1000;
+		flagUseInotify = sl_false;
+	}
+
+
+	HttpFileCacheEntry::HttpFileCacheEntry()
+	{
+		flagExists = sl_false;
+		size = 0;
+		contentType = ContentType::OctetStream;
+
+		m_tickValidated = 0;
+		m_flagAccessed = sl_false;
+		m_watch = -1;
+		m_flagAsset = sl_false;
+		m_link = sl_null;
+	}
+
+	HttpFileCacheEntry::~HttpFileCacheEntry()
+	{
+	}
+
+	sl_size HttpFileCacheEntry::getMemorySize()
+	{
+		return sizeof(HttpFileCacheEntry) + path.getLength() + lastModified.getLength() + eTag.getLength() + eTagGzip.getLength() + content.getSize() + contentGzip.getSize();
+	}
+
+
+	SLIB_DEFINE_OBJECT(HttpFileCache, Object)
+
+	HttpFileCache::HttpFileCache()
+	{
+		m_sizeMemory = 0;
+		m_fdInotify = -1;
+		m_tickLastEvents = 0;
+	}
+
+	HttpFileCache::~HttpFileCache()
+	{
+		_removeAll_NoLock();
+#if defined(HTTP_FILE_CACHE_SUPPORT_INOTIFY)
+		if (m_fdInotify >= 0) {
+			::close(m_fdInotify);
+		}
+#endif
+	}
+
+	Ref<HttpFileCache> HttpFileCache::create(const HttpFileCacheParam& param)
+	{
+		Ref<HttpFileCache> ret = new HttpFileCache;
+		if (ret.isNotNull()) {
+			ret->m_param = param;
+#if defined(HTTP_FILE_CACHE_SUPPORT_INOTIFY)
+			if (param.flagUseInotify) {
+				ret->m_fdInotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+			}
+#endif
+			return ret;
+		}
+		return sl_null;
+	}
+
+	Ref<HttpFileCache> HttpFileCache::create()
+	{
+		HttpFileCacheParam param;
+		return create(param);
+	}
+
+	Ref<HttpFileCacheEntry> HttpFileCache::get(const String& path)
+	{
+		if (path.isEmpty()) {
+			return sl_null;
+		}
+		if (m_fdInotify >= 0) {
+			_processEvents();
+		}
+		Ref<HttpFileCacheEntry> entry;
+		{
+			ObjectLocker lock(this);
+			m_map.get_NoLock(path, &entry);
+			if (entry.isNotNull()) {
+				entry->m_flagAccessed = sl_true;
+			}
+		}
+		if (entry.isNotNull()) {
+			sl_uint32 tick = System::getTickCount();
+			sl_uint32 elapsed = tick - entry->m_tickValidated;
+			if (entry->flagExists) {
+				if (entry->m_watch >= 0 || elapsed < m_param.revalidateInterval) {
+					return entry;
+				}
+				if (_validate(entry.get())) {
+					entry->m_tickValidated = tick;
+					return entry;
+				}
+			} else {
+				if (elapsed < m_param.negativeTimeout) {
+					return entry;
+				}
+			}
+			ObjectLocker lock(this);
+			_remove_NoLock(entry.get());
+		}
+		entry = _load(path);
+		if (entry.isNotNull()) {
+			_put(entry);
+		}
+		return entry;
+	}
+
+	Ref<HttpFileCacheEntry> HttpFileCache::getAsset(const String& path)
+	{
+		if (path.isEmpty()) {
+			return sl_null;
+		}
+		Ref<HttpFileCacheEntry> entry;
+		{
+			ObjectLocker lock(this);
+			m_mapAssets.get_NoLock(path, &entry);
+			if (entry.isNotNull()) {
+				entry->m_flagAccessed = sl_true;
+				return entry;
+			}
+		}
+		entry = new HttpFileCacheEntry;
+		if (entry.isNull()) {
+			return sl_null;
+		}
+		entry->path = path;
+		entry->m_flagAsset = sl_true;
+		Memory content = Assets::readAllBytes(path);
+		if (content.isNotNull()) {
+			entry->flagExists = sl_true;
+			entry->size = content.getSize();
+			// the assets have no modified time: tagged by the checksum
+			entry->eTag = String::format("\"%x-%x\"", Zlib::crc32(content), entry->size);
+			entry->contentType = _priv_HttpFileCache_getContentType(path);
+			Memory contentGzip;
+			if (m_param.flagUseGzipFile) {
+				contentGzip = Assets::readAllBytes(path + ".gz");
+			}
+			_loadContent(entry.get(), content, contentGzip);
+		}
+		_put(entry);
+		return entry;
+	}
+
+	void HttpFileCache::invalidate(const String& path)
+	{
+		ObjectLocker lock(this);
+		Ref<HttpFileCacheEntry> entry;
+		if (m_map.get_NoLock(path, &entry)) {
+			_remove_NoLock(entry.get());
+		}
+	}
+
+	void HttpFileCache::removeAll()
+	{
+		ObjectLocker lock(this);
+		_removeAll_NoLock();
+	}
+
+	sl_size HttpFileCache::getEntriesCount()
+	{
+		return m_clock.getCount();
+	}
+
+	sl_size HttpFileCache::getMemorySize()
+	{
+		return m_sizeMemory;
+	}
+
+	const HttpFileCacheParam& HttpFileCache::getParam()
+	{
+		return m_param;
+	}
+
+	Ref<HttpFileCacheEntry> HttpFileCache::_load(const String& path)
+	{
+		Ref<HttpFileCacheEntry> entry = new HttpFileCacheEntry;
+		if (entry.isNull()) {
+			return sl_null;
+		}
+		entry->path = path;
+		// watches before opening, not to miss the modification after loading
+		entry->m_watch = _watch(path);
+		entry->m_tickValidated = System::getTickCount();
+		Ref<File> file = File::openForRead(path);
+		if (file.isNull() || File::isDirectory(path)) {
+			return entry;
+		}
+		entry->flagExists = sl_true;
+		entry->file = file;
+		entry->size = file->getSize();
+		Time lastModifiedTime = Time::fromUnixTime(file->getModifiedTime().toUnixTime());
+		entry->lastModifiedTime = lastModifiedTime;
+		entry->lastModified = lastModifiedTime.toHttpDate();
+		entry->eTag = String::format("\"%x-%x\"", lastModifiedTime.toUnixTime(), entry->size);
+		entry->contentType = _priv_HttpFileCache_getContentType(path);
+		if (entry->size && entry->size <= m_param.maxContentSize) {
+			Memory content = Memory::create((sl_size)(entry->size));
+			if (content.isNotNull() && file->readAt(0, content.getData(), (sl_size)(entry->size)) == (sl_reg)(entry->size)) {
+				Memory contentGzip;
+				if (m_param.flagUseGzipFile) {
+					String pathGzip = path + ".gz";
+					Ref<File> fileGzip = File::openForRead(pathGzip);
+					if (fileGzip.isNotNull() && Time::fromUnixTime(fileGzip->getModifiedTime().toUnixTime()) >= lastModifiedTime) {
+						sl_uint64 sizeGzip = fileGzip->getSize();
+						if (sizeGzip && sizeGzip <= m_param.maxContentSize) {
+							contentGzip = fileGzip->readAllBytes();
+						}
+					}
+				}
+				_loadContent(entry.get(), content, contentGzip);
+			}
+		}
+		return entry;
+	}
+
+	void HttpFileCache::_loadContent(HttpFileCacheEntry* entry, const Memory& content, const Memory& _contentGzip)
+	{
+		entry->content = content;
+		Memory contentGzip = _contentGzip;
+		if (contentGzip.isNull() && m_param.flagCompressGzip && _priv_HttpFileCache_isCompressible(entry->contentType, content.getSize())) {
+			contentGzip = Zlib::compressGzip(content.getData(), content.getSize(), m_param.gzipLevel);
+			// not worth the decompression on the client
+			if (contentGzip.getSize() + (content.getSize() >> 4) >= content.getSize()) {
+				contentGzip.setNull();
+			}
+		}
+		if (contentGzip.isNotNull()) {
+			entry->contentGzip = contentGzip;
+			String& eTag = entry->eTag;
+			entry->eTagGzip = eTag.substring(0, eTag.getLength() - 1) + "-gz\"";
+		}
+	}
+
+	sl_bool HttpFileCache::_validate(HttpFileCacheEntry* entry)
+	{
+		Time time = File::getModifiedTime(entry->path);
+		if (Time::fromUnixTime(time.toUnixTime()) != entry->lastModifiedTime) {
+			return sl_false;
+		}
+		return File::getSize(entry->path) == entry->size;
+	}
+
+	void HttpFileCache::_put(const Ref<HttpFileCacheEntry>& entry)
+	{
+		if (!(entry->flagExists) && !(m_param.negativeTimeout)) {
+			return;
+		}
+		ObjectLocker lock(this);
+		CHashMap< String, Ref<HttpFileCacheEntry> >& map = entry->m_flagAsset ? m_mapAssets : m_map;
+		Ref<HttpFileCacheEntry> old;
+		if (map.get_NoLock(entry->path, &old)) {
+			_remove_NoLock(old.get());
+		}
+		Link< Ref<HttpFileCacheEntry> >* link = m_clock.pushBack_NoLock(entry);
+		if (!link) {
+			return;
+		}
+		if (!(map.put_NoLock(entry->path, entry))) {
+			m_clock.removeAt(link);
+			return;
+		}
+		entry->m_link = link;
+		m_sizeMemory += entry->getMemorySize();
+		_evict_NoLock();
+	}
+
+	void HttpFileCache::_remove_NoLock(HttpFileCacheEntry* entry)
+	{
+		Link< Ref<HttpFileCacheEntry> >* link = entry->m_link;
+		if (!link) {
+			return;
+		}
+		// keeps the entry alive until it is unlinked
+		Ref<HttpFileCacheEntry> ref = entry;
+		entry->m_link = sl_null;
+		m_sizeMemory -= entry->getMemorySize();
+		if (entry->m_flagAsset) {
+			m_mapAssets.removeKeyAndValue_NoLock(entry->path, ref);
+		} else {
+			m_map.removeKeyAndValue_NoLock(entry->path, ref);
+		}
+		m_clock.removeAt(link);
+	}
+
+	void HttpFileCache::_removeAll_NoLock()
+	{
+		Link< Ref<HttpFileCacheEntry> >* link = m_clock.getFront();
+		while (link) {
+			link->value->m_link = sl_null;
+			link = link->next;
+		}
+		m_clock.removeAll_NoLock();
+		m_map.removeAll_NoLock();
+		m_mapAssets.removeAll_NoLock();
+		m_sizeMemory = 0;
+	}
+
+	void HttpFileCache::_evict_NoLock()
+	{
+		sl_size maxCount = m_param.maxEntriesCount;
+		if (!maxCount) {
+			maxCount = 1;
+		}
+		// second chance: the entries accessed since the last sweep are moved to the back once
+		sl_size nSweep = m_clock.getCount() << 1;
+		while (nSweep && m_clock.getCount() > 1 && (m_clock.getCount() > maxCount || m_sizeMemory > m_param.maxMemorySize)) {
+			Link< Ref<HttpFileCacheEntry> >* link = m_clock.getFront();
+			Ref<HttpFileCacheEntry> entry = link->value;
+			if (entry->m_flagAccessed) {
+				entry->m_flagAccessed = sl_false;
+				m_clock.removeAt(link);
+				entry->m_link = m_clock.pushBack_NoLock(entry);
+				if (!(entry->m_link)) {
+					m_sizeMemory -= entry->getMemorySize();
+					if (entry->m_flagAsset) {
+						m_mapAssets.removeKeyAndValue_NoLock(entry->path, entry);
+					} else {
+						m_map.removeKeyAndValue_NoLock(entry->path, entry);
+					}
+				}
+			} else {
+				_remove_NoLock(entry.get());
+			}
+			nSweep--;
+		}
+	}
+
+	sl_int32 HttpFileCache::_watch(const String& path)
+	{
+#if defined(HTTP_FILE_CACHE_SUPPORT_INOTIFY)
+		if (m_fdInotify < 0) {
+			return -1;
+		}
+		String dir = File::getParentDirectoryPath(path);
+		if (dir.isEmpty()) {
+			dir = "/";
+		}
+		ObjectLocker lock(this);
+		sl_int32 watch;
+		if (m_mapWatches.get_NoLock(dir, &watch)) {
+			return watch;
+		}
+		watch = ::inotify_add_watch(m_fdInotify, dir.getData(), IN_MODIFY | IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF);
+		if (watch >= 0) {
+			m_mapWatches.put_NoLock(dir, watch);
+		}
+		return watch;
+#else
+		return -1;
+#endif
+	}
+
+	void HttpFileCache::_processEvents()
+	{
+#if defined(HTTP_FILE_CACHE_SUPPORT_INOTIFY)
+		sl_uint32 tick = System::getTickCount();
+		if (tick - m_tickLastEvents < m_param.revalidateInterval) {
+			return;
+		}
+		ObjectLocker lock(this);
+		if (tick - m_tickLastEvents < m_param.revalidateInterval) {
+			return;
+		}
+		m_tickLastEvents = tick;
+		union {
+			struct inotify_event event;
+			char buf[4096];
+		} u;
+		for (;;) {
+			ssize_t n = ::read(m_fdInotify, u.buf, sizeof(u.buf));
+			if (n <= 0) {
+				break;
+			}
+			char* p = u.buf;
+			char* end = p + n;
+			while (p < end) {
+				struct inotify_event* ev = (struct inotify_event*)p;
+				if (ev->mask & IN_Q_OVERFLOW) {
+					_removeAll_NoLock();
+				} else if (ev->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+					// the directory is gone: its entries can't be tracked anymore
+					_removeWatch_NoLock(ev->wd, sl_null);
+					if (!(ev->mask & IN_IGNORED)) {
+						::inotify_rm_watch(m_fdInotify, ev->wd);
+					}
+				} else if (ev->len) {
+					_removeWatch_NoLock(ev->wd, String(ev->name));
+				}
+				p += sizeof(struct inotify_event) + ev->len;
+			}
+		}
+#endif
+	}
+
+	void HttpFileCache::_removeWatch_NoLock(sl_int32 watch, const String& fileName)
+	{
+		Link< Ref<HttpFileCacheEntry> >* link = m_clock.getFront();
+		while (link) {
+			Link< Ref<HttpFileCacheEntry> >* next = link->next;
+			HttpFileCacheEntry* entry = link->value.get();
+			if (entry->m_watch == watch) {
+				if (fileName.isNull()) {
+					entry->m_watch = -1;
+					_remove_NoLock(entry);
+				} else {
+					String name = File::getFileName(entry->path);
+					// the sibling `.gz` file is the gzip variant of the entry
+					if (fileName.startsWith(name) && (fileName.getLength() == name.getLength() || fileName.substring(name.getLength()) == ".gz")) {
+						_remove_NoLock(entry);
+					}
+				}
+			}
+			link = next;
+		}
+		if (fileName.isNull()) {
+			List<String> dirs;
+			for (auto& item : m_mapWatches) {
+				if (item.value == watch) {
+					dirs.add_NoLock(item.key);
+				}
+			}
+			ListElements<String> list(dirs);
+			for (sl_size i = 0; i < list.count; i++) {
+				m_mapWatches.remove_NoLock(list[i]);
+			}
+		}
+	}
+
+}
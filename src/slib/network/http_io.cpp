@@ -97,25 +97,31 @@ namespace slib
 		}
 		sl_bool flagFound = sl_false;
 		const sl_uint8* buf = (const sl_uint8*)(_buf);
+		// terminator across the previous input
 		if (size > 0 && m_last[0] == '\r' && m_last[1] == '\n' && m_last[2] == '\r' && buf[0] == '\n') {
 			posBody = 1;
 			flagFound = sl_true;
-		}
-		if (size > 1 && m_last[1] == '\r' && m_last[2] == '\n' && buf[0] == '\r' && buf[1] == '\n') {
+		} else if (size > 1 && m_last[1] == '\r' && m_last[2] == '\n' && buf[0] == '\r' && buf[1] == '\n') {
 			posBody = 2;
 			flagFound = sl_true;
-		}
-		if (size > 2 && m_last[2] == '\r' && buf[0] == '\n' && buf[1] == '\r' && buf[2] == '\n') {
+		} else if (size > 2 && m_last[2] == '\r' && buf[0] == '\n' && buf[1] == '\r' && buf[2] == '\n') {
 			posBody = 3;
 			flagFound = sl_true;
-		}
-		if (size > 3) {
-			for (sl_size i = 0; i <= size - 4; i++) {
-				if (buf[i] == '\r' && buf[i + 1] == '\n' && buf[i + 2] == '\r' && buf[i + 3] == '\n') {
-					posBody = 4 + i;
+		} else if (size > 3) {
+			// jumps between the line feeds (`memchr`) instead of testing every byte
+			sl_size i = 3;
+			while (i < size) {
+				const sl_uint8* p = Base::findMemory(buf + i, '\n', size - i);
+				if (!p) {
+					break;
+				}
+				i = p - buf;
+				if (buf[i - 1] == '\r' && buf[i - 2] == '\n' && buf[i - 3] == '\r') {
+					posBody = i + 1;
 					flagFound = sl_true;
 					break;
 				}
+				i++;
 			}
 		}
 		if (flagFound) {
@@ -162,6 +168,167 @@ namespace slib
 		m_buffer.clear();
 	}
 
+/***********************************************************************
+						HttpMultipartReader
+***********************************************************************/
+
+#define PRIV_MULTIPART_STATE_PREAMBLE 0
+#define PRIV_MULTIPART_STATE_BOUNDARY 1
+#define PRIV_MULTIPART_STATE_HEADER 2
+#define PRIV_MULTIPART_STATE_BODY 3
+#define PRIV_MULTIPART_STATE_END 4
+#define PRIV_MULTIPART_STATE_ERROR 5
+
+#define PRIV_MULTIPART_HEADER_SIZE_MAX 0x4000
+
+	HttpMultipartReader::HttpMultipartReader()
+	{
+		m_state = PRIV_MULTIPART_STATE_ERROR;
+	}
+
+	HttpMultipartReader::~HttpMultipartReader()
+	{
+	}
+
+	void HttpMultipartReader::setBoundary(const String& boundary)
+	{
+		SLIB_STATIC_STRING(prefix, "\r\n--")
+		m_delimiter = prefix + boundary;
+		m_state = PRIV_MULTIPART_STATE_PREAMBLE;
+		// the first boundary may be at the beginning of the body, without the preceding CRLF
+		m_remained = Memory::create("\r\n", 2);
+	}
+
+	sl_bool HttpMultipartReader::add(const void* data, sl_size size)
+	{
+		if (m_state == PRIV_MULTIPART_STATE_ERROR) {
+			return sl_false;
+		}
+		if (!size) {
+			return sl_true;
+		}
+		if (m_remained.isNotNull()) {
+			Memory remained = m_remained;
+			m_remained.setNull();
+			sl_size sizeRemained = remained.getSize();
+			Memory mem = Memory::create(sizeRemained + size);
+			if (mem.isNull()) {
+				m_state = PRIV_MULTIPART_STATE_ERROR;
+				return sl_false;
+			}
+			sl_char8* buf = (sl_char8*)(mem.getData());
+			Base::copyMemory(buf, remained.getData(), sizeRemained);
+			Base::copyMemory(buf + sizeRemained, data, size);
+			return _process(buf, sizeRemained + size);
+		}
+		return _process((const sl_char8*)data, size);
+	}
+
+	sl_bool HttpMultipartReader::isCompleted()
+	{
+		return m_state == PRIV_MULTIPART_STATE_END;
+	}
+
+	sl_bool HttpMultipartReader::_process(const sl_char8* data, sl_size size)
+	{
+		const sl_char8* delimiter = m_delimiter.getData();
+		sl_size lenDelimiter = m_delimiter.getLength();
+		sl_size pos = 0;
+		while (pos < size) {
+			sl_uint32 state = m_state;
+			if (state == PRIV_MULTIPART_STATE_PREAMBLE || state == PRIV_MULTIPART_STATE_BODY) {
+				const sl_char8* p = data + pos;
+				sl_size n = size - pos;
+				// jumps between CRs to find the delimiter; stops at a partial delimiter in the end of the input
+				sl_size i = 0;
+				sl_bool flagFound = sl_false;
+				while (i < n) {
+					const sl_char8* q = (const sl_char8*)(Base::findMemory(p + i, '\r', n - i));
+					if (!q) {
+						i = n;
+						break;
+					}
+					i = q - p;
+					sl_size m = n - i;
+					if (m >= lenDelimiter) {
+						if (Base::equalsMemory(q, delimiter, lenDelimiter)) {
+							flagFound = sl_true;
+							break;
+						}
+					} else {
+						if (Base::equalsMemory(q, delimiter, m)) {
+							break;
+						}
+					}
+					i++;
+				}
+				if (i && state == PRIV_MULTIPART_STATE_BODY) {
+					if (!(onPartData(p, i))) {
+						m_state = PRIV_MULTIPART_STATE_ERROR;
+						return sl_false;
+					}
+				}
+				if (!flagFound) {
+					pos += i;
+					break;
+				}
+				if (state == PRIV_MULTIPART_STATE_BODY) {
+					if (!(onPartEnd())) {
+						m_state = PRIV_MULTIPART_STATE_ERROR;
+						return sl_false;
+					}
+				}
+				m_state = PRIV_MULTIPART_STATE_BOUNDARY;
+				pos += i + lenDelimiter;
+			} else if (state == PRIV_MULTIPART_STATE_BOUNDARY) {
+				if (pos + 2 > size) {
+					break;
+				}
+				if (data[pos] == '-' && data[pos + 1] == '-') {
+					m_state = PRIV_MULTIPART_STATE_END;
+					return sl_true;
+				}
+				if (data[pos] != '\r' || data[pos + 1] != '\n') {
+					m_state = PRIV_MULTIPART_STATE_ERROR;
+					return sl_false;
+				}
+				m_state = PRIV_MULTIPART_STATE_HEADER;
+				pos += 2;
+			} else if (state == PRIV_MULTIPART_STATE_HEADER) {
+				HttpHeaderMap headers;
+				sl_reg n = HttpHeaders::parseHeaders(headers, data + pos, size - pos);
+				if (n < 0) {
+					m_state = PRIV_MULTIPART_STATE_ERROR;
+					return sl_false;
+				}
+				if (!n) {
+					if (size - pos > PRIV_MULTIPART_HEADER_SIZE_MAX) {
+						m_state = PRIV_MULTIPART_STATE_ERROR;
+						return sl_false;
+					}
+					break;
+				}
+				if (!(onPartBegin(headers))) {
+					m_state = PRIV_MULTIPART_STATE_ERROR;
+					return sl_false;
+				}
+				m_state = PRIV_MULTIPART_STATE_BODY;
+				pos += n;
+			} else {
+				// ignores the epilogue
+				return sl_true;
+			}
+		}
+		if (pos < size) {
+			m_remained = Memory::create(data + pos, size - pos);
+			if (m_remained.isNull()) {
+				m_state = PRIV_MULTIPART_STATE_ERROR;
+				return sl_false;
+			}
+		}
+		return sl_true;
+	}
+
 /***********************************************************************
 						HttpContentReader
 ***********************************************************************/
@@ -190,18 +357,17 @@ namespace slib
 			m_sizeTotal = 0;
 		}
 
-		Memory filterRead(void* data, sl_uint32 size, Referable* refData)
+		void transformRead(void* data, sl_uint32 size, Referable* refData, MemoryQueue& output) override
 		{
 			sl_uint64 sizeRemain = m_sizeTotal - m_sizeRead;
 			if (size < sizeRemain) {
 				m_sizeRead += size;
-				return decompressData(data, size, refData);
+				decompressData(data, size, refData, output);
 			} else {
 				m_sizeRead = m_sizeTotal;
 				sl_uint32 sizeRead = (sl_uint32)sizeRemain;
-				Memory ret = decompressData(data, sizeRead, refData);
+				decompressData(data, sizeRead, refData, output);
 				setCompleted((char*)data + sizeRead, size - sizeRead);
-				return ret;
 			}
 		}
 	};
@@ -268,12 +434,13 @@ namespace slib
 			m_sizeTrailerField = 0;
 		}
 
-		Memory filterRead(void* _data, sl_uint32 size, Referable* refData)
+		// chunk-data is compacted in place, in front of the chunk headers
+		void transformRead(void* _data, sl_uint32 size, Referable* refData, MemoryQueue& output) override
 		{
 			sl_uint8* data = (sl_uint8*)_data;
 			sl_uint32 pos = 0;
 
-			sl_uint8* output = data;
+			sl_uint8* dataOutput = data;
 			sl_uint32 sizeOutput = 0;
 			
 			sl_uint32 v;
@@ -308,13 +475,13 @@ namespace slib
 					} else {
 						m_state = -1;
 						setError();
-						return sl_null;
+						return;
 					}
 					pos++;
 					break;
 				case 3: // chunk-data
 					if (m_sizeCurrentChunkRead < m_sizeCurrentChunk) {
-						output[sizeOutput] = ch;
+						dataOutput[sizeOutput] = ch;
 						m_sizeCurrentChunkRead++;
 						sizeOutput++;
 					} else {
@@ -323,7 +490,7 @@ namespace slib
 						} else {
 							m_state = -1;
 							setError();
-							return sl_null;
+							return;
 						}
 					}
 					pos++;
@@ -336,7 +503,7 @@ namespace slib
 					} else {
 						m_state = -1;
 						setError();
-						return sl_null;
+						return;
 					}
 					pos++;
 					break;
@@ -356,22 +523,22 @@ namespace slib
 						} else {
 							pos++;
 							m_state = -1;
-							Memory mem = decompressData(output, sizeOutput, refData);
+							decompressData(dataOutput, sizeOutput, refData, output);
 							setCompleted(data + pos, size - pos);
-							return mem;
+							return;
 						}
 					} else {
 						m_state = -1;
 						setError();
-						return sl_null;
+						return;
 					}
 					pos++;
 					break;
 				default:
-					return sl_null;
+					return;
 				}
 			}
-			return decompressData(output, sizeOutput, refData);
+			decompressData(dataOutput, sizeOutput, refData, output);
 		}
 	};
 
@@ -403,9 +570,9 @@ namespace slib
 	class _priv_HttpContentReader_TearDown : public HttpContentReader
 	{
 	public:
-		Memory filterRead(void* data, sl_uint32 size, Referable* refData)
+		void transformRead(void* data, sl_uint32 size, Referable* refData, MemoryQueue& output) override
 		{
-			return decompressData(data, size, refData);
+			decompressData(data, size, refData, output);
 		}
 	};
 
@@ -480,12 +647,22 @@ namespace slib
 		}
 	}
 
-	Memory HttpContentReader::decompressData(void* data, sl_uint32 size, Referable* refData)
+	void HttpContentReader::decompressData(void* data, sl_uint32 size, Referable* refData, MemoryQueue& output)
 	{
+		if (!size) {
+			return;
+		}
 		if (m_flagDecompressing) {
-			return m_zlib.decompress(data, size);
+			Memory mem = m_zlib.decompress(data, size);
+			if (mem.isNotNull()) {
+				output.add(mem);
+			}
 		} else {
-			return Memory::createStatic(data, size, refData);
+			MemoryData slice;
+			slice.data = data;
+			slice.size = size;
+			slice.refer = refData;
+			output.add(slice);
 		}
 	}
 
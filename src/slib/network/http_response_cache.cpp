@@ -0,0 +1,415 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "slib/network/http_response_cache.h"
+
+#include "slib/network/http_server.h"
+#include "slib/core/system.h"
+#include "slib/core/string_buffer.h"
+
+namespace slib
+{
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(HttpResponseCacheParam)
+
+	HttpResponseCacheParam::HttpResponseCacheParam()
+	{
+		maxEntriesCount = 1024;
+		maxMemorySize = 0x2000000; // 32MB
+		maxBodySize = 0x100000; // 1MB
+		defaultTimeToLive = 0;
+		defaultStaleWhileRevalidate = 0;
+		passTimeout = 1000;
+		maxWaitTime = 10000;
+	}
+
+
+	HttpResponseCacheEntry::HttpResponseCacheEntry()
+	{
+		flagPass = sl_false;
+		responseCode = HttpStatus::OK;
+		timeToLive = 0;
+		staleWhileRevalidate = 0;
+
+		m_tickCreated = 0;
+		m_flagAccessed = sl_false;
+		m_link = sl_null;
+	}
+
+	HttpResponseCacheEntry::~HttpResponseCacheEntry()
+	{
+	}
+
+	sl_size HttpResponseCacheEntry::getMemorySize()
+	{
+		// the header fields are counted by the header packet
+		return sizeof(HttpResponseCacheEntry) + (key.getLength() << 1) + (responseHeaderPacket.getSize() << 1) + body.getSize();
+	}
+
+
+	SLIB_DEFINE_OBJECT(HttpResponseCache, Object)
+
+	HttpResponseCache::HttpResponseCache()
+	{
+		m_sizeMemory = 0;
+	}
+
+	HttpResponseCache::~HttpResponseCache()
+	{
+		_removeAll_NoLock();
+	}
+
+	Ref<HttpResponseCache> HttpResponseCache::create(const HttpResponseCacheParam& param)
+	{
+		Ref<HttpResponseCache> ret = new HttpResponseCache;
+		if (ret.isNotNull()) {
+			ret->m_param = param;
+			return ret;
+		}
+		return sl_null;
+	}
+
+	Ref<HttpResponseCache> HttpResponseCache::create()
+	{
+		HttpResponseCacheParam param;
+		return create(param);
+	}
+
+	static sl_bool _priv_HttpResponseCache_isVaryHeader(ListElements<String>& varyHeaders, const String& name)
+	{
+		for (sl_size i = 0; i < varyHeaders.count; i++) {
+			if (varyHeaders[i].equalsIgnoreCase(name)) {
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	String HttpResponseCache::getKey(HttpServerContext* context)
+	{
+		HttpMethod method = context->getMethod();
+		if (method != HttpMethod::GET && method != HttpMethod::HEAD) {
+			return sl_null;
+		}
+		if (context->isWebSocketRequest()) {
+			return sl_null;
+		}
+		ListElements<String> varyHeaders(m_param.varyHeaders);
+		// the responses for the credentials are not shared unless they select the variant
+		if (context->containsRequestHeader(HttpHeaders::Authorization)) {
+			if (!(_priv_HttpResponseCache_isVaryHeader(varyHeaders, HttpHeaders::Authorization))) {
+				return sl_null;
+			}
+		}
+		if (context->containsRequestHeader(HttpHeaders::Cookie)) {
+			if (!(_priv_HttpResponseCache_isVaryHeader(varyHeaders, HttpHeaders::Cookie))) {
+				return sl_null;
+			}
+		}
+		StringBuffer buf;
+		if (method == HttpMethod::GET) {
+			buf.addStatic("GET ", 4);
+		} else {
+			buf.addStatic("HEAD ", 5);
+		}
+		// the virtual hosts (`:authority` of HTTP/2 is set to `Host`)
+		buf.add(context->getHost().toLower());
+		buf.add(context->getPath());
+		String query = context->getQuery();
+		if (query.isNotEmpty()) {
+			buf.addStatic("?", 1);
+			buf.add(query);
+		}
+		for (sl_size i = 0; i < varyHeaders.count; i++) {
+			// the values can't contain the line breaks
+			buf.addStatic("\n", 1);
+			buf.add(context->getRequestHeader(varyHeaders[i]));
+		}
+		if (context->isCompressingResponse()) {
+			// the compressed response is cached for the negotiated encoding (`Vary: Accept-Encoding`)
+			buf.addStatic("\n", 1);
+			buf.add(context->getResponseCompressionEncoding());
+		}
+		return buf.merge();
+	}
+
+	HttpResponseCacheStatus HttpResponseCache::lookup(const String& key, HttpServerContext* context, Ref<HttpResponseCacheEntry>& outEntry)
+	{
+		sl_uint32 tick = System::getTickCount();
+		ObjectLocker lock(this);
+		List< Ref<HttpServerContext> >* waiting = m_mapFilling.getItemPointer(key);
+		Ref<HttpResponseCacheEntry> entry;
+		if (m_map.get_NoLock(key, &entry)) {
+			sl_uint32 elapsed = tick - entry->m_tickCreated;
+			if (elapsed < entry->timeToLive) {
+				if (entry->flagPass) {
+					return HttpResponseCacheStatus::Pass;
+				}
+				entry->m_flagAccessed = sl_true;
+				outEntry = entry;
+				return HttpResponseCacheStatus::Hit;
+			}
+			if (elapsed - entry->timeToLive < entry->staleWhileRevalidate) {
+				entry->m_flagAccessed = sl_true;
+				if (waiting) {
+					outEntry = entry;
+					return HttpResponseCacheStatus::Stale;
+				}
+				// revalidates by this request, keeping the stale entry for the others
+				if (m_mapFilling.put_NoLock(key, List< Ref<HttpServerContext> >())) {
+					return HttpResponseCacheStatus::Miss;
+				}
+				outEntry = entry;
+				return HttpResponseCacheStatus::Stale;
+			}
+			_remove_NoLock(entry.get());
+		}
+		if (waiting) {
+			if (waiting->add_NoLock(context)) {
+				return HttpResponseCacheStatus::Wait;
+			}
+			return HttpResponseCacheStatus::Pass;
+		}
+		if (m_mapFilling.put_NoLock(key, List< Ref<HttpServerContext> >())) {
+			return HttpResponseCacheStatus::Miss;
+		}
+		return HttpResponseCacheStatus::Pass;
+	}
+
+	List< Ref<HttpServerContext> > HttpResponseCache::complete(const String& key, const Ref<HttpResponseCacheEntry>& _entry)
+	{
+		Ref<HttpResponseCacheEntry> entry = _entry;
+		if (entry.isNull() && m_param.passTimeout) {
+			entry = new HttpResponseCacheEntry;
+			if (entry.isNotNull()) {
+				entry->flagPass = sl_true;
+				entry->timeToLive = m_param.passTimeout;
+			}
+		}
+		if (entry.isNotNull()) {
+			entry->key = key;
+			entry->m_tickCreated = System::getTickCount();
+		}
+		List< Ref<HttpServerContext> > waiting;
+		ObjectLocker lock(this);
+		m_mapFilling.remove_NoLock(key, &waiting);
+		if (entry.isNotNull()) {
+			_put_NoLock(entry);
+		} else {
+			Ref<HttpResponseCacheEntry> old;
+			if (m_map.get_NoLock(key, &old)) {
+				_remove_NoLock(old.get());
+			}
+		}
+		return waiting;
+	}
+
+	Ref<HttpServerContext> HttpResponseCache::abandon(const String& key)
+	{
+		ObjectLocker lock(this);
+		List< Ref<HttpServerContext> >* waiting = m_mapFilling.getItemPointer(key);
+		if (!waiting) {
+			return sl_null;
+		}
+		Ref<HttpServerContext> context;
+		if (waiting->popFront_NoLock(&context)) {
+			return context;
+		}
+		m_mapFilling.remove_NoLock(key);
+		return sl_null;
+	}
+
+	sl_bool HttpResponseCache::removeWaiting(const String& key, HttpServerContext* context)
+	{
+		ObjectLocker lock(this);
+		List< Ref<HttpServerContext> >* waiting = m_mapFilling.getItemPointer(key);
+		if (waiting) {
+			return waiting->remove_NoLock(context);
+		}
+		return sl_false;
+	}
+
+	sl_bool HttpResponseCache::isCacheableResponse(HttpServerContext* context, sl_uint32* pTimeToLive)
+	{
+		switch (context->getResponseCode()) {
+			case HttpStatus::OK:
+			case HttpStatus::NonAuthInfo:
+			case HttpStatus::NoContent:
+			case HttpStatus::MultipleChoices:
+			case HttpStatus::MovedPermanently:
+			case HttpStatus::NotFound:
+			case HttpStatus::MethodNotAllowed:
+			case HttpStatus::Gone:
+			case HttpStatus::RequestUriTooLarge:
+			case HttpStatus::NotImplemented:
+				break;
+			default:
+				return sl_false;
+		}
+		if (context->getResponseContentLength() > m_param.maxBodySize) {
+			return sl_false;
+		}
+		if (context->containsResponseHeader(HttpHeaders::SetCookie)) {
+			return sl_false;
+		}
+		if (context->containsResponseHeader(HttpHeaders::CacheControl)) {
+			HttpCacheControlResponse cc = context->getResponseCacheControl();
+			if (cc.private_ || cc.no_store || cc.no_cache) {
+				return sl_false;
+			}
+			// `s-maxage` overrides `max-age` for the shared caches
+			Nullable<sl_int32> maxAge = cc.s_maxage.isNotNull() ? cc.s_maxage : cc.max_age;
+			if (maxAge.isNotNull()) {
+				if (maxAge.value <= 0) {
+					return sl_false;
+				}
+				if (pTimeToLive && (sl_uint32)(maxAge.value) < *pTimeToLive / 1000) {
+					*pTimeToLive = (sl_uint32)(maxAge.value) * 1000;
+				}
+			}
+		}
+		String vary = context->getResponseHeader(HttpHeaders::Vary);
+		if (vary.isNotEmpty()) {
+			ListElements<String> names(vary.split(","));
+			ListElements<String> varyHeaders(m_param.varyHeaders);
+			for (sl_size i = 0; i < names.count; i++) {
+				String name = names[i].trim();
+				if (name.isEmpty()) {
+					continue;
+				}
+				sl_bool flagFound = context->isCompressingResponse() && name.equalsIgnoreCase(HttpHeaders::AcceptEncoding);
+				for (sl_size k = 0; !flagFound && k < varyHeaders.count; k++) {
+					if (varyHeaders[k].equalsIgnoreCase(name)) {
+						flagFound = sl_true;
+						break;
+					}
+				}
+				if (!flagFound) {
+					return sl_false;
+				}
+			}
+		}
+		return sl_true;
+	}
+
+	void HttpResponseCache::invalidate(const String& key)
+	{
+		ObjectLocker lock(this);
+		Ref<HttpResponseCacheEntry> entry;
+		if (m_map.get_NoLock(key, &entry)) {
+			_remove_NoLock(entry.get());
+		}
+	}
+
+	void HttpResponseCache::removeAll()
+	{
+		ObjectLocker lock(this);
+		_removeAll_NoLock();
+	}
+
+	sl_size HttpResponseCache::getEntriesCount()
+	{
+		return m_clock.getCount();
+	}
+
+	sl_size HttpResponseCache::getMemorySize()
+	{
+		return m_sizeMemory;
+	}
+
+	const HttpResponseCacheParam& HttpResponseCache::getParam()
+	{
+		return m_param;
+	}
+
+	void HttpResponseCache::_put_NoLock(const Ref<HttpResponseCacheEntry>& entry)
+	{
+		Ref<HttpResponseCacheEntry> old;
+		if (m_map.get_NoLock(entry->key, &old)) {
+			_remove_NoLock(old.get());
+		}
+		Link< Ref<HttpResponseCacheEntry> >* link = m_clock.pushBack_NoLock(entry);
+		if (!link) {
+			return;
+		}
+		if (!(m_map.put_NoLock(entry->key, entry))) {
+			m_clock.removeAt(link);
+			return;
+		}
+		entry->m_link = link;
+		m_sizeMemory += entry->getMemorySize();
+		_evict_NoLock();
+	}
+
+	void HttpResponseCache::_remove_NoLock(HttpResponseCacheEntry* entry)
+	{
+		Link< Ref<HttpResponseCacheEntry> >* link = entry->m_link;
+		if (!link) {
+			return;
+		}
+		// keeps the entry alive until it is unlinked
+		Ref<HttpResponseCacheEntry> ref = entry;
+		entry->m_link = sl_null;
+		m_sizeMemory -= entry->getMemorySize();
+		m_map.removeKeyAndValue_NoLock(entry->key, ref);
+		m_clock.removeAt(link);
+	}
+
+	void HttpResponseCache::_removeAll_NoLock()
+	{
+		Link< Ref<HttpResponseCacheEntry> >* link = m_clock.getFront();
+		while (link) {
+			link->value->m_link = sl_null;
+			link = link->next;
+		}
+		m_clock.removeAll_NoLock();
+		m_map.removeAll_NoLock();
+		m_sizeMemory = 0;
+	}
+
+	void HttpResponseCache::_evict_NoLock()
+	{
+		sl_size maxCount = m_param.maxEntriesCount;
+		if (!maxCount) {
+			maxCount = 1;
+		}
+		// second chance: the entries accessed since the last sweep are moved to the back once
+		sl_size nSweep = m_clock.getCount() << 1;
+		while (nSweep && m_clock.getCount() > 1 && (m_clock.getCount() > maxCount || m_sizeMemory > m_param.maxMemorySize)) {
+			Link< Ref<HttpResponseCacheEntry> >* link = m_clock.getFront();
+			Ref<HttpResponseCacheEntry> entry = link->value;
+			if (entry->m_flagAccessed) {
+				entry->m_flagAccessed = sl_false;
+				m_clock.removeAt(link);
+				entry->m_link = m_clock.pushBack_NoLock(entry);
+				if (!(entry->m_link)) {
+					m_sizeMemory -= entry->getMemorySize();
+					m_map.removeKeyAndValue_NoLock(entry->key, entry);
+				}
+			} else {
+				_remove_NoLock(entry.get());
+			}
+			nSweep--;
+		}
+	}
+
+}
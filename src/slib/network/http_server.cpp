@@ -22,6 +22,10 @@
 
 #include "slib/network/http_server.h"
 
+#include "slib/network/websocket.h"
+
+#include "http2_server.h"
+
 #include "slib/network/url.h"
 #include "slib/core/app.h"
 #include "slib/core/asset.h"
@@ -29,9 +33,16 @@
 #include "slib/core/log.h"
 #include "slib/core/json.h"
 #include "slib/core/content_type.h"
+#include "slib/core/dispatch.h"
+#include "slib/core/system.h"
+#include "slib/core/math.h"
+#include "slib/crypto/base64.h"
 
 #define SERVER_TAG "HTTP SERVER"
 
+#define PRIV_HTTP_SERVER_COMPRESSOR_POOL_SIZE 2
+#define PRIV_HTTP_SERVER_COMPRESSED_BLOCK_SIZE 32768
+
 namespace slib
 {
 
@@ -45,6 +56,20 @@ namespace slib
 	{
 		m_requestContentLength = 0;
 		m_flagAsynchronousResponse = sl_false;
+		
+		m_flagSpoolingMultipartFormData = sl_false;
+		m_sizeRequestBodyReceived = 0;
+		m_flagRequestBodySuspended = sl_false;
+		m_flagResponseCompleted = sl_false;
+		
+		m_flagResponseCacheChecked = sl_false;
+		m_responseCacheTimeToLive = 0;
+		m_responseCacheStaleWhileRevalidate = 0;
+		
+		m_flagAdmitted = 0;
+		
+		m_flagCompressingResponse = sl_false;
+		m_flagStreamOutput = sl_false;
 
 		setClosingConnection(sl_false);
 		setProcessingByThread(sl_true);
@@ -52,6 +77,18 @@ namespace slib
 
 	HttpServerContext::~HttpServerContext()
 	{
+		_leaveProcessing();
+		if (m_responseCache.isNotNull()) {
+			// the response is not completed: one of the waiting requests fills the entry instead
+			Ref<HttpServerContext> next = m_responseCache->abandon(m_responseCacheKey);
+			if (next.isNotNull()) {
+				next->_startFillingResponseCache(m_responseCache.get(), m_responseCacheKey);
+				Ref<HttpServerConnection> connection = next->getConnection();
+				if (connection.isNotNull()) {
+					connection->_resumeCoalescedContext(next.get());
+				}
+			}
+		}
 	}
 
 	Ref<HttpServerContext> HttpServerContext::create(const Ref<HttpServerConnection>& connection)
@@ -86,6 +123,42 @@ namespace slib
 		return Json::parseJson16Utf8(m_requestBody);
 	}
 
+	void HttpServerContext::setRequestBodyHandler(const HttpServerRequestBodyHandler& handler)
+	{
+		m_requestBodyHandler = handler;
+	}
+
+	void HttpServerContext::setSpoolingMultipartFormData(sl_bool flag)
+	{
+		m_flagSpoolingMultipartFormData = flag;
+	}
+
+	sl_bool HttpServerContext::isStreamingRequestBody()
+	{
+		return m_requestBodyHandler.isNotNull() || m_multipartSpooler.isNotNull();
+	}
+
+	void HttpServerContext::suspendRequestBody()
+	{
+		ObjectLocker lock(this);
+		m_flagRequestBodySuspended = sl_true;
+	}
+
+	void HttpServerContext::resumeRequestBody()
+	{
+		{
+			ObjectLocker lock(this);
+			if (!m_flagRequestBodySuspended) {
+				return;
+			}
+			m_flagRequestBodySuspended = sl_false;
+		}
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNotNull()) {
+			connection->_resumeInput();
+		}
+	}
+
 	sl_uint64 HttpServerContext::getResponseContentLength() const
 	{
 		return getOutputLength();
@@ -116,6 +189,10 @@ namespace slib
 
 	Ref<AsyncIoLoop> HttpServerContext::getAsyncIoLoop()
 	{
+		Ref<AsyncStream> io = getIO();
+		if (io.isNotNull()) {
+			return io->getIoLoop();
+		}
 		Ref<HttpServer> server = getServer();
 		if (server.isNotNull()) {
 			return server->getAsyncIoLoop();
@@ -162,6 +239,489 @@ namespace slib
 		}
 	}
 
+	void HttpServerContext::setResponseCacheTime(sl_uint32 timeToLive, sl_uint32 staleWhileRevalidate)
+	{
+		m_responseCacheTimeToLive = timeToLive;
+		m_responseCacheStaleWhileRevalidate = staleWhileRevalidate;
+	}
+
+	void HttpServerContext::_startFillingResponseCache(HttpResponseCache* cache, const String& key)
+	{
+		const HttpResponseCacheParam& param = cache->getParam();
+		m_responseCache = cache;
+		m_responseCacheKey = key;
+		m_responseCacheTimeToLive = param.defaultTimeToLive;
+		m_responseCacheStaleWhileRevalidate = param.defaultStaleWhileRevalidate;
+	}
+
+	static void _priv_HttpServer_setRetryAfter(HttpServerContext* context, HttpAdmissionControl* admission)
+	{
+		sl_uint32 retryAfter = admission->getParam().retryAfter;
+		if (retryAfter) {
+			context->setResponseHeader(HttpHeaders::RetryAfter, String::fromUint32(retryAfter));
+		}
+	}
+
+	void HttpServerContext::_leaveProcessing()
+	{
+		if (Base::interlockedCompareExchange32(&m_flagAdmitted, 0, 1)) {
+			m_admission->leaveProcessing();
+		}
+	}
+
+	void HttpServerContext::_onAdmitted(sl_bool flagAdmitted)
+	{
+		if (flagAdmitted) {
+			m_flagAdmitted = 1;
+			Ref<HttpServerConnection> connection = m_connection;
+			if (connection.isNotNull()) {
+				connection->_startProcessing(this, sl_true);
+			} else {
+				_leaveProcessing();
+			}
+		} else {
+			// timed out in the queue
+			setResponseCode(HttpStatus::ServiceUnavailable);
+			_priv_HttpServer_setRetryAfter(this, m_admission.get());
+			completeResponse();
+		}
+	}
+
+	// quality value of `coding` in `Accept-Encoding` (0: not acceptable)
+	static double _priv_HttpServer_getAcceptEncodingQuality(const String& acceptEncoding, const char* coding)
+	{
+		if (acceptEncoding.isEmpty()) {
+			return 0;
+		}
+		double qAny = 0;
+		ListElements<String> items(acceptEncoding.split(","));
+		for (sl_size i = 0; i < items.count; i++) {
+			String name = items[i];
+			double q = 1;
+			sl_reg index = name.indexOf(';');
+			if (index >= 0) {
+				String weight = name.substring(index + 1).trim();
+				if (weight.startsWith("q=")) {
+					if (!(weight.substring(2).parseDouble(&q))) {
+						q = 1;
+					}
+				}
+				name = name.substring(0, index);
+			}
+			name = name.trim();
+			if (name.equalsIgnoreCase(coding)) {
+				return q;
+			}
+			if (name == "*") {
+				qAny = q;
+			}
+		}
+		return qAny;
+	}
+
+	static sl_bool _priv_HttpServer_isAcceptingGzip(const String& acceptEncoding)
+	{
+		return _priv_HttpServer_getAcceptEncodingQuality(acceptEncoding, "gzip") > 0;
+	}
+
+	// weak comparison of `eTag` with the tags listed in `If-None-Match`
+	static sl_bool _priv_HttpServer_matchEntityTag(const String& ifNoneMatch, const String& eTag)
+	{
+		String opaque = eTag;
+		if (opaque.startsWith("W/")) {
+			opaque = opaque.substring(2);
+		}
+		if (opaque.getLength() >= 2 && opaque.startsWith('\"') && opaque.endsWith('\"')) {
+			opaque = opaque.substring(1, opaque.getLength() - 1);
+		}
+		ListElements<String> items(ifNoneMatch.split(","));
+		for (sl_size i = 0; i < items.count; i++) {
+			String tag = items[i].trim();
+			if (tag == "*") {
+				return sl_true;
+			}
+			if (tag.startsWith("W/")) {
+				tag = tag.substring(2);
+			}
+			// `getRequestHeader` strips the enclosing quotes of the whole list
+			if (tag.startsWith('\"')) {
+				tag = tag.substring(1);
+			}
+			if (tag.endsWith('\"')) {
+				tag = tag.substring(0, tag.getLength() - 1);
+			}
+			if (tag == opaque) {
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	// `gzip` is preferred on the same quality
+	static String _priv_HttpServer_negotiateCompression(const String& acceptEncoding)
+	{
+		double qGzip = _priv_HttpServer_getAcceptEncodingQuality(acceptEncoding, "gzip");
+		double qDeflate = _priv_HttpServer_getAcceptEncodingQuality(acceptEncoding, "deflate");
+		if (qGzip > 0 && qGzip >= qDeflate) {
+			SLIB_RETURN_STRING("gzip")
+		}
+		if (qDeflate > 0) {
+			SLIB_RETURN_STRING("deflate")
+		}
+		return sl_null;
+	}
+
+	static sl_bool _priv_HttpServer_isCompressibleContentType(const String& type)
+	{
+		if (type.isEmpty()) {
+			// `text/html` is set on the completion
+			return sl_true;
+		}
+		if (type.startsWith("text/")) {
+			return sl_true;
+		}
+		return type.contains("javascript") || type.contains("json") || type.contains("xml");
+	}
+
+	class _priv_HttpServer_Compressor : public ZlibCompress
+	{
+	public:
+		sl_bool flagGzip;
+		sl_int32 level;
+	};
+
+	// compressors reused by the responses compressed on the thread, to avoid allocating the state of zlib for each response
+	class _priv_HttpServer_CompressorPool : public Referable
+	{
+	public:
+		Ref<_priv_HttpServer_Compressor> items[PRIV_HTTP_SERVER_COMPRESSOR_POOL_SIZE];
+		sl_uint32 count;
+
+	public:
+		_priv_HttpServer_CompressorPool()
+		{
+			count = 0;
+		}
+
+	public:
+		static _priv_HttpServer_CompressorPool* get(sl_bool flagCreate)
+		{
+			// the pool is removed with the thread
+			Ref<Thread> thread = Thread::getCurrent();
+			if (thread.isNull()) {
+				return sl_null;
+			}
+			SLIB_STATIC_STRING(name, "HTTP_SERVER_COMPRESSOR_POOL")
+			Ref<Referable> pool = thread->getAttachedObject(name);
+			if (pool.isNull() && flagCreate) {
+				pool = new _priv_HttpServer_CompressorPool;
+				if (pool.isNull()) {
+					return sl_null;
+				}
+				thread->attachObject(name, pool.get());
+			}
+			return (_priv_HttpServer_CompressorPool*)(pool.get());
+		}
+
+		static Ref<ZlibCompress> acquire(sl_bool flagGzip, sl_int32 level)
+		{
+			_priv_HttpServer_CompressorPool* pool = get(sl_false);
+			if (pool) {
+				for (sl_uint32 i = pool->count; i > 0; i--) {
+					Ref<_priv_HttpServer_Compressor> item = pool->items[i - 1];
+					if (item->flagGzip == flagGzip && item->level == level) {
+						pool->count--;
+						pool->items[i - 1] = pool->items[pool->count];
+						pool->items[pool->count].setNull();
+						return item;
+					}
+				}
+			}
+			Ref<_priv_HttpServer_Compressor> ret = new _priv_HttpServer_Compressor;
+			if (ret.isNotNull()) {
+				ret->flagGzip = flagGzip;
+				ret->level = level;
+				if (flagGzip ? ret->startGzip(level) : ret->start(level)) {
+					return ret;
+				}
+			}
+			return sl_null;
+		}
+
+		static void release(ZlibCompress* compressor)
+		{
+			if (!(compressor->reset())) {
+				return;
+			}
+			_priv_HttpServer_CompressorPool* pool = get(sl_true);
+			if (pool && pool->count < PRIV_HTTP_SERVER_COMPRESSOR_POOL_SIZE) {
+				pool->items[pool->count] = (_priv_HttpServer_Compressor*)compressor;
+				pool->count++;
+			}
+		}
+
+	};
+
+	sl_bool HttpServerContext::isCompressingResponse()
+	{
+		return m_flagCompressingResponse;
+	}
+
+	void HttpServerContext::setCompressingResponse(sl_bool flag)
+	{
+		m_flagCompressingResponse = flag;
+	}
+
+	String HttpServerContext::getResponseCompressionEncoding()
+	{
+		return m_compressionEncoding;
+	}
+
+	void HttpServerContext::clearOutput()
+	{
+		m_flagStreamOutput = sl_false;
+		HttpOutputBuffer::clearOutput();
+	}
+
+	void HttpServerContext::copyFrom(AsyncStream* stream, sl_uint64 size)
+	{
+		// the length of the compressed stream is not known before it is read by the output
+		m_flagStreamOutput = sl_true;
+		HttpOutputBuffer::copyFrom(stream, size);
+	}
+
+	void HttpServerContext::copyFromFile(const String& path)
+	{
+		m_flagStreamOutput = sl_true;
+		HttpOutputBuffer::copyFromFile(path);
+	}
+
+	void HttpServerContext::copyFromFile(const String& path, const Ref<Dispatcher>& dispatcher)
+	{
+		m_flagStreamOutput = sl_true;
+		HttpOutputBuffer::copyFromFile(path, dispatcher);
+	}
+
+	// compresses the whole content into the blocks shared with the output
+	static sl_bool _priv_HttpServer_compress(ZlibCompress* compressor, const Memory& content, List<Memory>& blocks)
+	{
+		const sl_uint8* data = (const sl_uint8*)(content.getData());
+		sl_size size = content.getSize();
+		for (;;) {
+			Memory block = Memory::create(PRIV_HTTP_SERVER_COMPRESSED_BLOCK_SIZE);
+			if (block.isNull()) {
+				return sl_false;
+			}
+			sl_uint8* output = (sl_uint8*)(block.getData());
+			sl_uint32 sizeBlock = (sl_uint32)(block.getSize());
+			sl_uint32 sizeOutput = 0;
+			sl_int32 iRet;
+			do {
+				sl_uint32 sizeInput = (sl_uint32)(SLIB_MIN(size, 0x40000000));
+				sl_uint32 sizeInputPassed = 0, sizeOutputUsed = 0;
+				iRet = compressor->compress(data, sizeInput, sizeInputPassed, output + sizeOutput, sizeBlock - sizeOutput, sizeOutputUsed, sizeInput == size);
+				if (iRet < 0) {
+					return sl_false;
+				}
+				data += sizeInputPassed;
+				size -= sizeInputPassed;
+				sizeOutput += sizeOutputUsed;
+			} while (iRet && sizeOutput < sizeBlock);
+			if (sizeOutput) {
+				blocks.add(sizeOutput < sizeBlock ? block.sub(0, sizeOutput) : block);
+			}
+			if (!iRet) {
+				// finished
+				return sl_true;
+			}
+		}
+	}
+
+	void HttpServerContext::_finishCompression()
+	{
+		if (!m_flagCompressingResponse || m_flagStreamOutput) {
+			return;
+		}
+		Ref<HttpServer> server = getServer();
+		if (server.isNull()) {
+			return;
+		}
+		const HttpServerParam& param = server->getParam();
+		if (getOutputLength() < param.minimumCompressionSize) {
+			return;
+		}
+		switch (getResponseCode()) {
+			case HttpStatus::SwitchingProtocols:
+			case HttpStatus::NoContent:
+			case HttpStatus::PartialContent:
+			case HttpStatus::NotModified:
+				return;
+			default:
+				break;
+		}
+		if (containsResponseHeader(HttpHeaders::ContentEncoding) || containsResponseHeader(HttpHeaders::ContentRange)) {
+			return;
+		}
+		if (!(_priv_HttpServer_isCompressibleContentType(getResponseContentType()))) {
+			return;
+		}
+		// the representation depends on `Accept-Encoding`
+		String vary = getResponseHeader(HttpHeaders::Vary);
+		if (vary.isEmpty()) {
+			setResponseHeader(HttpHeaders::Vary, HttpHeaders::AcceptEncoding);
+		} else if (!(vary.toLower().contains("accept-encoding"))) {
+			setResponseHeader(HttpHeaders::Vary, vary + ", " + HttpHeaders::AcceptEncoding);
+		}
+		if (m_compressionEncoding.isEmpty()) {
+			return;
+		}
+		Memory content;
+		if (!(m_bufferOutput.mergeOutput(content))) {
+			return;
+		}
+		Ref<ZlibCompress> compressor = _priv_HttpServer_CompressorPool::acquire(m_compressionEncoding == "gzip", param.compressionLevel);
+		if (compressor.isNull()) {
+			return;
+		}
+		List<Memory> blocks;
+		sl_bool flagCompressed = _priv_HttpServer_compress(compressor.get(), content, blocks);
+		_priv_HttpServer_CompressorPool::release(compressor.get());
+		if (!flagCompressed) {
+			// sent without compression
+			return;
+		}
+		HttpOutputBuffer::clearOutput();
+		ListElements<Memory> items(blocks);
+		for (sl_size i = 0; i < items.count; i++) {
+			HttpOutputBuffer::write(items[i]);
+		}
+		setResponseContentEncoding(m_compressionEncoding);
+		// raw value, `getResponseHeader` removes the quotes
+		String eTag = getResponseHeaders().getValue_NoLock(HttpHeaders::ETag);
+		if (eTag.endsWith('"')) {
+			// the validator of the compressed representation differs from the original
+			setResponseHeader(HttpHeaders::ETag, eTag.substring(0, eTag.getLength() - 1) + "-" + m_compressionEncoding + "\"");
+		}
+	}
+
+	class _priv_HttpServer_MultipartSpooler : public Referable, public HttpMultipartReader
+	{
+	public:
+		HttpServerContext* m_context;
+		String m_dirTemp;
+		sl_uint32 m_maxFieldSize;
+		Function<Ptr<IWriter>(HttpServer*, HttpServerContext*, const String&, const String&, const HttpHeaderMap&)> m_onUploadFile;
+		sl_bool m_flagWriteError;
+		
+		String m_name;
+		String m_fileName;
+		HttpHeaderMap m_headers;
+		MemoryQueue m_field;
+		Ref<File> m_file;
+		String m_filePath;
+		Ptr<IWriter> m_writer;
+		sl_uint64 m_sizePart;
+		
+	public:
+		_priv_HttpServer_MultipartSpooler(HttpServerContext* context, const HttpServerParam& param)
+		{
+			m_context = context;
+			m_dirTemp = param.uploadTempDirectory;
+			if (m_dirTemp.isEmpty()) {
+				m_dirTemp = System::getTempDirectory();
+			}
+			m_maxFieldSize = param.maxMultipartFieldSize;
+			m_onUploadFile = param.onUploadFile;
+			m_flagWriteError = sl_false;
+			m_sizePart = 0;
+		}
+		
+		~_priv_HttpServer_MultipartSpooler()
+		{
+			// the request is aborted while a part is being written
+			if (m_file.isNotNull()) {
+				m_file->close();
+				File::deleteFile(m_filePath);
+			}
+		}
+		
+	public:
+		sl_bool onPartBegin(const HttpHeaderMap& headers) override
+		{
+			SLIB_STATIC_STRING(s1, "name")
+			SLIB_STATIC_STRING(s2, "filename")
+			HttpHeaderMap fields = HttpHeaders::splitValueToMap(headers.getValue_NoLock(HttpHeaders::ContentDisposition), ';');
+			m_name = fields.getValue_NoLock(s1);
+			m_fileName = fields.getValue_NoLock(s2);
+			m_headers = headers;
+			m_sizePart = 0;
+			if (m_fileName.isNull()) {
+				return sl_true;
+			}
+			if (m_onUploadFile.isNotNull()) {
+				Ref<HttpServer> server = m_context->getServer();
+				m_writer = m_onUploadFile(server.get(), m_context, m_name, m_fileName, headers);
+				if (m_writer.isNotNull()) {
+					return sl_true;
+				}
+			}
+			char rand[16];
+			Math::randomMemory(rand, sizeof(rand));
+			m_filePath = m_dirTemp + "/slib_upload_" + String::makeHexString(rand, sizeof(rand));
+			m_file = File::openForWrite(m_filePath);
+			if (m_file.isNull()) {
+				m_flagWriteError = sl_true;
+				return sl_false;
+			}
+			m_writer = m_file;
+			return sl_true;
+		}
+		
+		sl_bool onPartData(const void* data, sl_size size) override
+		{
+			m_sizePart += size;
+			if (m_fileName.isNull()) {
+				if (m_sizePart > m_maxFieldSize) {
+					return sl_false;
+				}
+				return m_field.add(Memory::create(data, size));
+			}
+			if (m_writer->writeFully(data, size) != (sl_reg)size) {
+				m_flagWriteError = sl_true;
+				return sl_false;
+			}
+			return sl_true;
+		}
+		
+		sl_bool onPartEnd() override
+		{
+			if (m_fileName.isNull()) {
+				Memory mem = m_field.merge();
+				m_field.clear();
+				String value((sl_char8*)(mem.getData()), mem.getSize());
+				m_context->m_postParameters.add_NoLock(m_name, value);
+				m_context->m_parameters.add_NoLock(m_name, value);
+				return sl_true;
+			}
+			Ref<HttpUploadFile> file;
+			if (m_file.isNotNull()) {
+				m_file->close();
+				m_file.setNull();
+				file = new HttpUploadFile(m_fileName, m_headers, m_filePath, (sl_size)m_sizePart);
+				m_filePath.setNull();
+			} else {
+				file = new HttpUploadFile(m_fileName, m_headers, sl_null, (sl_size)m_sizePart, sl_null);
+			}
+			m_writer.setNull();
+			if (file.isNull()) {
+				return sl_false;
+			}
+			m_context->m_uploadFiles.add_NoLock(m_name, file);
+			return sl_true;
+		}
+		
+	};
+
 /******************************************************
 			HttpServerConnection
 ******************************************************/
@@ -175,6 +735,11 @@ namespace slib
 		m_flagClosed = sl_true;
 		m_flagReading = sl_false;
 		m_flagKeepAlive = sl_true;
+		m_flagInputEnded = sl_false;
+		m_flagStreamEnded = sl_false;
+		m_flagSendingResponses = sl_false;
+		m_idDeadline = 0;
+		m_flagAddressCounted = sl_false;
 	}
 
 	HttpServerConnection::~HttpServerConnection()
@@ -193,6 +758,7 @@ namespace slib
 					op.stream = io;
 					op.onEnd = SLIB_FUNCTION_WEAKREF(HttpServerConnection, onAsyncOutputEnd, ret);
 					op.bufferSize = SIZE_COPY_BUF;
+					op.flagUseSendFile = server->getParam().flagUseSendFile;
 					Ref<AsyncOutput> output = AsyncOutput::create(op);
 					if (output.isNotNull()) {
 						ret->m_server = server;
@@ -200,6 +766,7 @@ namespace slib
 						ret->m_output = output;
 						ret->m_bufRead = bufRead;
 						ret->m_flagClosed = sl_false;
+						ret->_setDeadline(server->getParam().keepAliveTimeout);
 						return ret;
 					}
 				}
@@ -219,9 +786,25 @@ namespace slib
 		Ref<HttpServer> server = m_server;
 		if (server.isNotNull()) {
 			server->closeConnection(this);
+			if (m_flagAddressCounted) {
+				m_flagAddressCounted = sl_false;
+				Ref<HttpAdmissionControl> admission = server->getAdmissionControl();
+				if (admission.isNotNull()) {
+					admission->removeConnection(getRemoteAddress().ip);
+				}
+			}
 		}
 		m_io->close();
 		m_output->close();
+		Ref<Referable> http2 = m_http2Session;
+		if (http2.isNotNull()) {
+			((_priv_Http2ServerSession*)(http2.get()))->close();
+		}
+		Ref<Referable> webSocket = m_webSocket;
+		lock.unlock();
+		if (webSocket.isNotNull()) {
+			((WebSocketConnection*)(webSocket.get()))->_onClosed();
+		}
 	}
 
 	void HttpServerConnection::start(const void* data, sl_uint32 size)
@@ -252,7 +835,7 @@ namespace slib
 	void HttpServerConnection::_read()
 	{
 		ObjectLocker lock(this);
-		if (m_flagClosed) {
+		if (m_flagClosed || m_flagStreamEnded) {
 			return;
 		}
 		if (m_flagReading) {
@@ -265,176 +848,867 @@ namespace slib
 		}
 	}
 
+	void HttpServerConnection::_setDeadline(sl_uint32 timeout)
+	{
+		sl_int32 id = Base::interlockedIncrement32(&m_idDeadline);
+		if (!timeout) {
+			return;
+		}
+		Function<void()> callback = SLIB_BIND_WEAKREF(void(), HttpServerConnection, _onDeadline, this, id);
+		Ref<AsyncIoLoop> loop = m_io->getIoLoop();
+		if (loop.isNotNull()) {
+			loop->setTimeout(callback, timeout);
+		} else {
+			Dispatch::setTimeout(callback, timeout);
+		}
+	}
+
+	void HttpServerConnection::_onDeadline(sl_int32 id)
+	{
+		if (id != m_idDeadline) {
+			return;
+		}
+		Ref<HttpServer> server = m_server;
+		if (server.isNotNull() && server->getParam().flagLogDebug) {
+			Log(SERVER_TAG, "[%s] Connection Timeout", String::fromPointerValue(this));
+		}
+		close();
+	}
+
 	void HttpServerConnection::_processInput(const void* _data, sl_uint32 size)
 	{
 		Ref<HttpServer> server = m_server;
 		if (server.isNull()) {
 			return;
 		}
-		if (m_flagClosed) {
-			return;
+		{
+			Ref<Referable> http2 = m_http2Session;
+			if (http2.isNotNull()) {
+				((_priv_Http2ServerSession*)(http2.get()))->processInput(_data, size);
+				_read();
+				return;
+			}
+			Ref<Referable> webSocket = m_webSocket;
+			if (webSocket.isNotNull()) {
+				((WebSocketConnection*)(webSocket.get()))->_processInput(_data, size);
+				_read();
+				return;
+			}
 		}
 		
 		const HttpServerParam& param = server->getParam();
 		sl_uint64 maxRequestHeadersSize = param.maxRequestHeadersSize;
 		sl_uint64 maxRequestBodySize = param.maxRequestBodySize;
+		sl_uint32 maxPipelinedRequests = param.maxPipelinedRequests;
+		if (!maxPipelinedRequests) {
+			maxPipelinedRequests = 1;
+		}
 
 		char* data = (char*)_data;
-		Ref<HttpServerContext> _context = m_contextCurrent;
-		if (_context.isNull()) {
-			_context = HttpServerContext::create(this);
-			if (_context.isNull()) {
-				sendResponse_ServerError();
+		// the bytes after a request are the beginning of the next request (pipelining)
+		for (;;) {
+			if (m_flagClosed || m_flagInputEnded) {
 				return;
 			}
-			m_contextCurrent = _context;
-			_context->setProcessingByThread(param.flagProcessByThreads);
-		}
-		HttpServerContext* context = _context.get();
-		if (context->m_requestHeader.isNull()) {
-			sl_size posBody;
-			if (context->m_requestHeaderReader.add(data, size, posBody)) {
-				context->m_requestHeader = context->m_requestHeaderReader.mergeHeader();
-				if (context->m_requestHeader.isNull()) {
-					sendResponse_ServerError();
+			Ref<HttpServerContext> _context = m_contextCurrent;
+			if (_context.isNull()) {
+				if (!size) {
+					break;
+				}
+				{
+					ObjectLocker lock(this);
+					if (m_queueResponses.getCount() >= maxPipelinedRequests) {
+						// keeps the input until a response is sent
+						m_bufPending = Memory::create(data, size);
+						if (m_bufPending.isNull()) {
+							lock.unlock();
+							close();
+						}
+						return;
+					}
+				}
+				_context = HttpServerContext::create(this);
+				if (_context.isNull()) {
+					_processInputError(sl_null, sl_true);
+					return;
+				}
+				m_contextCurrent = _context;
+				_context->setProcessingByThread(param.flagProcessByThreads);
+				_setDeadline(param.requestHeaderTimeout);
+			}
+			HttpServerContext* context = _context.get();
+			// the bytes of the input used by the current request
+			sl_uint32 sizeUsed = size;
+			if (context->m_requestHeader.isNull()) {
+				if (!size) {
+					break;
+				}
+				sl_size posBody;
+				if (context->m_requestHeaderReader.add(data, size, posBody)) {
+					_setDeadline(0);
+					context->m_requestHeader = context->m_requestHeaderReader.mergeHeader();
+					if (context->m_requestHeader.isNull()) {
+						_processInputError(context, sl_true);
+						return;
+					}
+					if (posBody > size) {
+						_processInputError(context, sl_true);
+						return;
+					}
+					context->m_requestHeaderReader.clear();
+					Memory header = context->getRawRequestHeader();
+					sl_reg iRet = context->parseRequestPacket(header);
+					if (iRet != (sl_reg)(context->m_requestHeader.getSize())) {
+						_processInputError(context, sl_false);
+						return;
+					}
+					context->m_requestContentLength = context->getRequestContentLengthHeader();
+					context->applyQueryToParameters();
+					if (param.flagUseHttp2) {
+						if (_startHttp2(context, data + posBody, size - (sl_uint32)posBody)) {
+							return;
+						}
+					}
+					if (_admitRequest(context) != HttpStatus::OK) {
+						if (!(_rejectRequest(context))) {
+							return;
+						}
+						data += posBody;
+						size -= (sl_uint32)posBody;
+						continue;
+					}
+					if (!(_processRequestHeader(context))) {
+						_processInputError(context, sl_true);
+						return;
+					}
+					sl_uint32 sizeBody = size - (sl_uint32)posBody;
+					if (context->isStreamingRequestBody()) {
+						if (param.maxStreamingRequestBodySize && context->m_requestContentLength > param.maxStreamingRequestBodySize) {
+							_processInputError(context, sl_false);
+							return;
+						}
+						if (server->preprocessRequest(context)) {
+							return;
+						}
+						sl_reg n = _processRequestBody(context, data + posBody, sizeBody);
+						if (n < 0) {
+							return;
+						}
+						sizeUsed = (sl_uint32)posBody + (sl_uint32)n;
+					} else {
+						if (context->m_requestContentLength > maxRequestBodySize) {
+							_processInputError(context, sl_false);
+							return;
+						}
+						if (sizeBody > context->m_requestContentLength) {
+							sizeBody = (sl_uint32)(context->m_requestContentLength);
+						}
+						context->m_requestBody = Memory::create(data + posBody, sizeBody);
+						if (!(context->m_requestBodyBuffer.add(context->m_requestBody))) {
+							_processInputError(context, sl_true);
+							return;
+						}
+						if (server->preprocessRequest(context)) {
+							return;
+						}
+						sizeUsed = (sl_uint32)posBody + sizeBody;
+					}
+				} else {
+					if (context->m_requestHeaderReader.getHeaderSize() > maxRequestHeadersSize) {
+						_processInputError(context, sl_false);
+						return;
+					}
+				}
+			} else if (context->isStreamingRequestBody()) {
+				if (context->m_flagRequestBodySuspended) {
+					_keepPendingInput(data, size);
 					return;
 				}
-				if (posBody > size) {
-					sendResponse_ServerError();
+				sl_reg n = _processRequestBody(context, data, size);
+				if (n < 0) {
 					return;
 				}
-				context->m_requestHeaderReader.clear();
-				Memory header = context->getRawRequestHeader();
-				sl_reg iRet = context->parseRequestPacket(header.getData(), header.getSize());
-				if (iRet != (sl_reg)(context->m_requestHeader.getSize())) {
-					sendResponse_BadRequest();
+				sizeUsed = (sl_uint32)n;
+			} else {
+				sl_uint64 sizeRemain = context->m_requestContentLength - context->m_requestBodyBuffer.getSize();
+				if (sizeUsed > sizeRemain) {
+					sizeUsed = (sl_uint32)sizeRemain;
+				}
+				if (sizeUsed) {
+					if (!(context->m_requestBodyBuffer.add(Memory::create(data, sizeUsed)))) {
+						_processInputError(context, sl_true);
+						return;
+					}
+				}
+			}
+			data += sizeUsed;
+			size -= sizeUsed;
+			
+			if (context->m_requestHeader.isNull()) {
+				break;
+			}
+			if (context->isStreamingRequestBody()) {
+				if (context->m_flagRequestBodySuspended) {
+					_keepPendingInput(data, size);
 					return;
 				}
-				context->m_requestContentLength = context->getRequestContentLengthHeader();
-				if (context->m_requestContentLength > maxRequestBodySize) {
-					sendResponse_BadRequest();
+				if (context->m_sizeRequestBodyReceived < context->m_requestContentLength) {
+					break;
+				}
+				// closes and removes the part left incomplete by the missing closing boundary
+				context->m_multipartSpooler.setNull();
+			} else {
+				if (context->m_requestBodyBuffer.getSize() < context->m_requestContentLength) {
+					break;
+				}
+				if (!(_completeRequestBody(context))) {
+					_processInputError(context, sl_true);
 					return;
 				}
-				context->m_requestBody = Memory::create(data + posBody, size - (sl_uint32)posBody);
-				if (!(context->m_requestBodyBuffer.add(context->m_requestBody))) {
-					sendResponse_ServerError();
+			}
+			m_contextCurrent.setNull();
+			_dispatchContext(context);
+		}
+		_read();
+	}
+
+	void HttpServerConnection::_processInputError(HttpServerContext* context, sl_bool flagServerError)
+	{
+		m_contextCurrent.setNull();
+		if (!context) {
+			if (flagServerError) {
+				sendResponse_ServerError();
+			} else {
+				sendResponse_BadRequest();
+			}
+			return;
+		}
+		// responds after the responses of the previous requests, and closes the connection
+		{
+			ObjectLocker lock(this);
+			m_flagInputEnded = sl_true;
+			m_bufPending.setNull();
+			m_queueResponses.pushBack_NoLock(context);
+		}
+		context->setResponseCode(flagServerError ? HttpStatus::InternalServerError : HttpStatus::BadRequest);
+		context->setClosingConnection(sl_true);
+		context->completeResponse();
+	}
+
+	void HttpServerConnection::_keepPendingInput(const void* data, sl_uint32 size)
+	{
+		if (!size) {
+			return;
+		}
+		ObjectLocker lock(this);
+		m_bufPending = Memory::create(data, size);
+		if (m_bufPending.isNull()) {
+			lock.unlock();
+			close();
+		}
+	}
+
+	void HttpServerConnection::_resumeInput()
+	{
+		Function<void()> callback = SLIB_FUNCTION_WEAKREF(HttpServerConnection, _processPendingInput, this);
+		Ref<AsyncIoLoop> loop = m_io->getIoLoop();
+		if (loop.isNotNull()) {
+			loop->addTask(callback);
+		} else {
+			callback();
+		}
+	}
+
+	void HttpServerConnection::_processPendingInput()
+	{
+		{
+			Ref<Referable> http2 = m_http2Session;
+			if (http2.isNotNull()) {
+				((_priv_Http2ServerSession*)(http2.get()))->resumeInput();
+				return;
+			}
+		}
+		Memory input;
+		{
+			ObjectLocker lock(this);
+			input = m_bufPending;
+			m_bufPending.setNull();
+		}
+		_processInput(input.getData(), (sl_uint32)(input.getSize()));
+		if (m_flagStreamEnded) {
+			ObjectLocker lock(this);
+			if (m_queueResponses.isNotEmpty() || m_bufPending.isNotNull() || m_flagSendingResponses) {
+				return;
+			}
+			lock.unlock();
+			close();
+		}
+	}
+
+	sl_reg HttpServerConnection::_processRequestBody(HttpServerContext* context, const void* data, sl_size size)
+	{
+		sl_uint64 sizeRemain = context->m_requestContentLength - context->m_sizeRequestBodyReceived;
+		if (size > sizeRemain) {
+			size = (sl_size)sizeRemain;
+		}
+		if (!size) {
+			return 0;
+		}
+		context->m_sizeRequestBodyReceived += size;
+		HttpStatus status = _writeRequestBody(context, data, size);
+		if (status != HttpStatus::OK) {
+			_processInputError(context, status == HttpStatus::InternalServerError);
+			return -1;
+		}
+		return size;
+	}
+
+	sl_bool HttpServerConnection::_processRequestHeader(HttpServerContext* context)
+	{
+		Ref<HttpServer> server = m_server;
+		if (server.isNull()) {
+			return sl_false;
+		}
+		const HttpServerParam& param = server->getParam();
+		if (param.flagSpoolMultipartFormData) {
+			context->setSpoolingMultipartFormData();
+		}
+		if (param.flagUseCompression) {
+			context->m_flagCompressingResponse = sl_true;
+			context->m_compressionEncoding = _priv_HttpServer_negotiateCompression(context->getRequestHeader(HttpHeaders::AcceptEncoding));
+		}
+		server->dispatchRequestHeader(context);
+		if (context->m_flagSpoolingMultipartFormData) {
+			String multipartBoundary = context->getRequestMultipartFormDataBoundary();
+			if (multipartBoundary.isNotEmpty()) {
+				_priv_HttpServer_MultipartSpooler* spooler = new _priv_HttpServer_MultipartSpooler(context, param);
+				context->m_multipartSpooler = spooler;
+				if (context->m_multipartSpooler.isNull()) {
+					return sl_false;
+				}
+				spooler->setBoundary(multipartBoundary);
+			}
+		}
+		return sl_true;
+	}
+
+	HttpStatus HttpServerConnection::_writeRequestBody(HttpServerContext* context, const void* data, sl_size size)
+	{
+		_priv_HttpServer_MultipartSpooler* spooler = (_priv_HttpServer_MultipartSpooler*)(context->m_multipartSpooler.get());
+		if (spooler) {
+			if (!(spooler->add(data, size))) {
+				return spooler->m_flagWriteError ? HttpStatus::InternalServerError : HttpStatus::BadRequest;
+			}
+		}
+		if (context->m_requestBodyHandler.isNotNull()) {
+			if (!(context->m_requestBodyHandler(context, Memory::createStatic(data, size)))) {
+				return HttpStatus::InternalServerError;
+			}
+		}
+		return HttpStatus::OK;
+	}
+
+	sl_bool HttpServerConnection::_completeRequestBody(HttpServerContext* context)
+	{
+		context->m_requestBody = context->m_requestBodyBuffer.merge();
+		if (context->m_requestContentLength > 0 && context->m_requestBody.isNull()) {
+			return sl_false;
+		}
+		context->m_requestBodyBuffer.clear();
+		String multipartBoundary = context->getRequestMultipartFormDataBoundary();
+		if (multipartBoundary.isNotEmpty()) {
+			Memory body = context->getRequestBody();
+			context->applyMultipartFormData(multipartBoundary, body);
+		} else if (context->getMethod() == HttpMethod::POST) {
+			String reqContentType = context->getRequestContentTypeNoParams();
+			if (reqContentType == ContentTypes::WebForm) {
+				Memory body = context->getRequestBody();
+				context->applyPostParameters(body.getData(), body.getSize());
+			}
+		}
+		return sl_true;
+	}
+
+	sl_bool HttpServerConnection::_startHttp2(HttpServerContext* context, const void* data, sl_uint32 size)
+	{
+		SLIB_STATIC_STRING(s_prefaceMethod, "PRI")
+		SLIB_STATIC_STRING(s_prefacePath, "*")
+		SLIB_STATIC_STRING(s_version, "HTTP/2.0")
+		SLIB_STATIC_STRING(s_upgrade, "Upgrade")
+		SLIB_STATIC_STRING(s_h2c, "h2c")
+		SLIB_STATIC_STRING(s_settings, "HTTP2-Settings")
+		SLIB_STATIC_STRING(s_switching, "HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n")
+		sl_bool flagIdle;
+		{
+			ObjectLocker lock(this);
+			flagIdle = m_queueResponses.isEmpty();
+		}
+		Ref<_priv_Http2ServerSession> session;
+		if (context->getMethodText() == s_prefaceMethod && context->getPath() == s_prefacePath && context->getRequestVersion() == s_version) {
+			// the first 18 bytes of the connection preface ("PRI * HTTP/2.0\r\n\r\n") are parsed as the request header
+			if (!flagIdle) {
+				_processInputError(context, sl_false);
+				return sl_true;
+			}
+			session = _priv_Http2ServerSession::create(this, sl_null, sl_null, 18);
+		} else {
+			// the upgrade of the request with the body is ignored
+			if (!flagIdle || context->m_requestContentLength || context->containsRequestHeader(HttpHeaders::TransferEncoding)) {
+				return sl_false;
+			}
+			if (!(context->getRequestHeader(s_upgrade).toLower().contains(s_h2c)) || !(context->containsRequestHeader(s_settings))) {
+				return sl_false;
+			}
+			// base64url without the padding
+			Memory settings = Base64::decode(context->getRequestHeader(s_settings).trim(), 0);
+			if (!(m_output->write(Memory::create(s_switching.getData(), s_switching.getLength())))) {
+				close();
+				return sl_true;
+			}
+			session = _priv_Http2ServerSession::create(this, context, settings, 0);
+		}
+		m_contextCurrent.setNull();
+		if (session.isNull()) {
+			close();
+			return sl_true;
+		}
+		m_http2Session = session;
+		session->processInput(data, size);
+		_read();
+		return sl_true;
+	}
+
+	void HttpServerConnection::_dispatchContext(HttpServerContext* context)
+	{
+		{
+			ObjectLocker lock(this);
+			m_queueResponses.pushBack_NoLock(context);
+		}
+		if (!(context->isKeepAlive())) {
+			// the requests after the last request are not processed
+			m_flagInputEnded = sl_true;
+		}
+		_startProcessing(context, sl_false);
+	}
+
+	void HttpServerConnection::_startProcessing(HttpServerContext* context, sl_bool flagPost)
+	{
+		Ref<HttpServer> server = m_server;
+		if (server.isNull()) {
+			return;
+		}
+		if (!(context->m_flagAdmitted)) {
+			Ref<HttpAdmissionControl> admission = server->getAdmissionControl();
+			if (admission.isNotNull() && admission->getParam().maxConcurrentRequests) {
+				context->m_admission = admission;
+				HttpAdmissionStatus status = admission->enterProcessing(SLIB_FUNCTION_REF(HttpServerContext, _onAdmitted, context));
+				if (status == HttpAdmissionStatus::Queued) {
 					return;
 				}
-				context->applyQueryToParameters();
-				if (server->preprocessRequest(context)) {
+				if (status == HttpAdmissionStatus::Rejected) {
+					context->setResponseCode(HttpStatus::ServiceUnavailable);
+					_priv_HttpServer_setRetryAfter(context, admission.get());
+					context->completeResponse();
 					return;
 				}
+				context->m_flagAdmitted = 1;
+			}
+		}
+		Function<void()> task = SLIB_BIND_WEAKREF(void(), HttpServerConnection, _processContext, this, Ref<HttpServerContext>(context));
+		if (context->isProcessingByThread()) {
+			Ref<ThreadPool> threadPool = server->getThreadPool();
+			if (threadPool.isNotNull()) {
+				threadPool->addTask(task);
 			} else {
-				if (context->m_requestHeaderReader.getHeaderSize() > maxRequestHeadersSize) {
-					sendResponse_BadRequest();
+				close();
+			}
+		} else if (flagPost) {
+			m_io->addTask(task);
+		} else {
+			_processContext(context);
+		}
+	}
+
+	HttpStatus HttpServerConnection::_admitRequest(HttpServerContext* context)
+	{
+		Ref<HttpServer> server = m_server;
+		if (server.isNull()) {
+			return HttpStatus::OK;
+		}
+		Ref<HttpAdmissionControl> admission = server->getAdmissionControl();
+		if (admission.isNull()) {
+			return HttpStatus::OK;
+		}
+		HttpStatus status;
+		if (!(admission->takeRequestToken(getRemoteAddress().ip))) {
+			status = HttpStatus::TooManyRequests;
+		} else if (!(admission->checkQueue())) {
+			status = HttpStatus::ServiceUnavailable;
+		} else {
+			return HttpStatus::OK;
+		}
+		context->setResponseCode(status);
+		_priv_HttpServer_setRetryAfter(context, admission.get());
+		return status;
+	}
+
+	sl_bool HttpServerConnection::_rejectRequest(HttpServerContext* context)
+	{
+		// the connection is kept only when the next request follows right after the header
+		sl_bool flagContinue = !(context->m_requestContentLength) && !(context->containsRequestHeader(HttpHeaders::TransferEncoding)) && context->isKeepAlive();
+		m_contextCurrent.setNull();
+		{
+			ObjectLocker lock(this);
+			if (!flagContinue) {
+				m_flagInputEnded = sl_true;
+				m_bufPending.setNull();
+			}
+			m_queueResponses.pushBack_NoLock(context);
+		}
+		if (!flagContinue) {
+			context->setClosingConnection(sl_true);
+			SLIB_STATIC_STRING(s_close, "close")
+			context->setResponseHeader(HttpHeaders::Connection, s_close);
+		}
+		context->completeResponse();
+		return flagContinue;
+	}
+
+	void HttpServerConnection::_processContext(const Ref<HttpServerContext>& context)
+	{
+		Ref<HttpServer> server = getServer();
+		if (server.isNull()) {
+			return;
+		}
+		if (context->getMethod() == HttpMethod::CONNECT) {
+			sendConnectResponse_Failed();
+			return;
+		}
+		if (!(context->m_flagResponseCacheChecked)) {
+			context->m_flagResponseCacheChecked = sl_true;
+			Ref<HttpResponseCache> cache = server->getResponseCache();
+			if (cache.isNotNull()) {
+				if (_processResponseCache(cache.get(), context.get())) {
 					return;
 				}
 			}
-		} else {
-			if (!(context->m_requestBodyBuffer.add(Memory::create(data, size)))) {
-				sendResponse_ServerError();
-				return;
-			}
 		}
-		
-		if (context->m_requestHeader.isNotNull()) {
-			
-			if (context->m_requestBodyBuffer.getSize() >= context->m_requestContentLength) {
-
-				m_contextCurrent.setNull();
+		server->processRequest(context.get());
+		if (!(context->isAsynchronousResponse())) {
+			context->completeResponse();
+		}
+	}
 
-				context->m_requestBody = context->m_requestBodyBuffer.merge();
-				if (context->m_requestContentLength > 0 && context->m_requestBody.isNull()) {
-					sendResponse_ServerError();
-					return;
-				}
-				context->m_requestBodyBuffer.clear();
-
-				String multipartBoundary = context->getRequestMultipartFormDataBoundary();
-				if (multipartBoundary.isNotEmpty()) {
-					Memory body = context->getRequestBody();
-					context->applyMultipartFormData(multipartBoundary, body);
-				} else if (context->getMethod() == HttpMethod::POST) {
-					String reqContentType = context->getRequestContentTypeNoParams();
-					if (reqContentType == ContentTypes::WebForm) {
-						Memory body = context->getRequestBody();
-						context->applyPostParameters(body.getData(), body.getSize());
+	sl_bool HttpServerConnection::_processResponseCache(HttpResponseCache* cache, HttpServerContext* context)
+	{
+		String key = cache->getKey(context);
+		if (key.isNull()) {
+			return sl_false;
+		}
+		// set before waiting: the response can be completed as soon as the request is queued
+		context->setAsynchronousResponse(sl_true);
+		Ref<HttpResponseCacheEntry> entry;
+		switch (cache->lookup(key, context, entry)) {
+			case HttpResponseCacheStatus::Hit:
+			case HttpResponseCacheStatus::Stale:
+				context->setAsynchronousResponse(sl_false);
+				_completeCachedResponse(context, entry.get());
+				return sl_true;
+			case HttpResponseCacheStatus::Wait:
+				{
+					// waiting doesn't occupy the processing slot
+					context->_leaveProcessing();
+					sl_uint32 timeout = cache->getParam().maxWaitTime;
+					if (timeout) {
+						Function<void()> callback = SLIB_BIND_WEAKREF(void(), HttpServerConnection, _onCoalescedWaitTimeout, this, Ref<HttpServerContext>(context), key);
+						Ref<AsyncIoLoop> loop = m_io->getIoLoop();
+						if (loop.isNotNull()) {
+							loop->setTimeout(callback, timeout);
+						} else {
+							Dispatch::setTimeout(callback, timeout);
+						}
 					}
 				}
-				
-				if (context->isProcessingByThread()) {
-					Ref<ThreadPool> threadPool = server->getThreadPool();
-					if (threadPool.isNotNull()) {
-						threadPool->addTask(SLIB_BIND_WEAKREF(void(), HttpServerConnection, _processContext, this, _context));
-					} else {
-						sendResponse_ServerError();
+				return sl_true;
+			case HttpResponseCacheStatus::Miss:
+				context->_startFillingResponseCache(cache, key);
+				break;
+			default:
+				break;
+		}
+		context->setAsynchronousResponse(sl_false);
+		return sl_false;
+	}
+
+	Memory HttpServerConnection::_fillResponseCache(HttpServerContext* context)
+	{
+		Ref<HttpResponseCache> cache = Move(context->m_responseCache);
+		context->m_responseCache.setNull();
+		Memory header;
+		Ref<HttpResponseCacheEntry> entry;
+		sl_uint32 timeToLive = context->m_responseCacheTimeToLive;
+		if (timeToLive && cache->isCacheableResponse(context, &timeToLive)) {
+			Memory body;
+			// the body is shared by the response and the entry
+			if (context->m_bufferOutput.mergeOutput(body)) {
+				header = context->makeResponsePacket();
+				if (header.isNotNull()) {
+					entry = new HttpResponseCacheEntry;
+					if (entry.isNotNull()) {
+						entry->responseCode = context->getResponseCode();
+						entry->responseMessage = context->getResponseMessage();
+						entry->responseHeaders = context->getResponseHeaders().duplicate();
+						entry->responseHeaderPacket = header;
+						entry->body = body;
+						entry->timeToLive = timeToLive;
+						entry->staleWhileRevalidate = context->m_responseCacheStaleWhileRevalidate;
 					}
+				}
+			}
+		}
+		ListElements< Ref<HttpServerContext> > waiting(cache->complete(context->m_responseCacheKey, entry));
+		for (sl_size i = 0; i < waiting.count; i++) {
+			HttpServerContext* other = waiting[i].get();
+			Ref<HttpServerConnection> connection = other->getConnection();
+			if (connection.isNotNull()) {
+				if (entry.isNotNull()) {
+					connection->_completeCachedResponse(other, entry.get());
 				} else {
-					_processContext(context);
+					connection->_resumeCoalescedContext(other);
 				}
-				return;
 			}
 		}
-		_read();
+		return header;
 	}
 
-	void HttpServerConnection::_processContext(const Ref<HttpServerContext>& context)
+	void HttpServerConnection::_completeCachedResponse(HttpServerContext* context, HttpResponseCacheEntry* entry)
 	{
-		Ref<HttpServer> server = getServer();
-		if (server.isNull()) {
+		if (context->m_flagResponseCompleted) {
 			return;
 		}
-		if (context->getMethod() == HttpMethod::CONNECT) {
-			sendConnectResponse_Failed();
+		context->_leaveProcessing();
+		context->setResponseCode(entry->responseCode);
+		context->setResponseMessage(entry->responseMessage);
+		if (entry->body.isNotNull()) {
+			context->write(entry->body);
+		}
+		if (context->m_http2Stream.isNotNull()) {
+			context->m_responseHeaders = entry->responseHeaders.duplicate();
+			context->m_flagResponseCompleted = sl_true;
+			Ref<Referable> http2 = m_http2Session;
+			if (http2.isNotNull()) {
+				((_priv_Http2ServerSession*)(http2.get()))->sendResponse(context);
+			}
 			return;
 		}
-		server->processRequest(context.get());
-		if (!(context->isAsynchronousResponse())) {
-			context->completeResponse();
+		{
+			ObjectLocker lock(this);
+			context->m_responseHeaderPacket = entry->responseHeaderPacket;
+			context->m_flagResponseCompleted = sl_true;
+		}
+		_sendResponses();
+	}
+
+	void HttpServerConnection::_onCoalescedWaitTimeout(const Ref<HttpServerContext>& context, const String& key)
+	{
+		Ref<HttpServer> server = m_server;
+		if (server.isNull()) {
+			return;
 		}
+		Ref<HttpResponseCache> cache = server->getResponseCache();
+		if (cache.isNotNull() && cache->removeWaiting(key, context.get())) {
+			_resumeCoalescedContext(context.get());
+		}
+	}
+
+	void HttpServerConnection::_resumeCoalescedContext(HttpServerContext* context)
+	{
+		context->setAsynchronousResponse(sl_false);
+		_startProcessing(context, sl_true);
 	}
 
 	void HttpServerConnection::_completeResponse(HttpServerContext* context)
 	{
-		context->setResponseHeader(HttpHeaders::ContentLength, String::fromUint64(context->getResponseContentLength()));
-		String oldResponseContentType = context->getResponseContentType();
-		if (oldResponseContentType.isEmpty()) {
-			context->setResponseContentType(ContentTypes::TextHtml_Utf8);
+		if (context->m_flagResponseCompleted) {
+			return;
+		}
+		context->_leaveProcessing();
+		context->_finishCompression();
+		if (context->m_webSocket.isNotNull() && context->getResponseCode() != HttpStatus::SwitchingProtocols) {
+			// the handshake is rejected by the handler
+			context->m_webSocket.setNull();
+		}
+		if (context->m_webSocket.isNull()) {
+			context->setResponseHeader(HttpHeaders::ContentLength, String::fromUint64(context->getResponseContentLength()));
+			String oldResponseContentType = context->getResponseContentType();
+			if (oldResponseContentType.isEmpty()) {
+				context->setResponseContentType(ContentTypes::TextHtml_Utf8);
+			}
+		}
+		Memory header;
+		if (context->m_responseCache.isNotNull()) {
+			header = _fillResponseCache(context);
+		}
+		if (context->m_http2Stream.isNotNull()) {
+			context->m_flagResponseCompleted = sl_true;
+			Ref<Referable> http2 = m_http2Session;
+			if (http2.isNotNull()) {
+				((_priv_Http2ServerSession*)(http2.get()))->sendResponse(context);
+			}
+			return;
+		}
+		if (header.isNull()) {
+			header = context->makeResponsePacket();
 		}
-		Memory header = context->makeResponsePacket();
 		if (header.isNull()) {
 			close();
 			return;
 		}
-		if (!(m_output->write(header))) {
-			close();
+		{
+			ObjectLocker lock(this);
+			context->m_responseHeaderPacket = header;
+			context->m_flagResponseCompleted = sl_true;
+		}
+		_sendResponses();
+	}
+
+	void HttpServerConnection::_sendResponses()
+	{
+		// Serializes the senders to keep the order of the responses. The connection is not locked while writing to the output, which calls `onAsyncOutputEnd` in its own lock
+		MutexLocker lockSending(&m_lockSending);
+		List< Ref<HttpServerContext> > contexts;
+		sl_bool flagResume = sl_false;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			Ref<HttpServerContext> context;
+			// the responses are sent in the order of the requests
+			while (m_queueResponses.getFrontValue_NoLock(&context) && context->m_flagResponseCompleted) {
+				m_queueResponses.popFront_NoLock();
+				contexts.add_NoLock(context);
+				if (context->m_webSocket.isNotNull()) {
+					// the connection is switched to WebSocket after the handshake response
+					m_queueResponses.removeAll_NoLock();
+					m_bufPending.setNull();
+					break;
+				}
+				if (!(context->isKeepAlive()) || context->isClosingConnection()) {
+					m_flagInputEnded = sl_true;
+					m_flagKeepAlive = sl_false;
+					m_queueResponses.removeAll_NoLock();
+					m_bufPending.setNull();
+					break;
+				}
+				if (m_bufPending.isNotNull()) {
+					flagResume = sl_true;
+				}
+			}
+		}
+		if (contexts.isEmpty()) {
 			return;
 		}
-		m_output->mergeBuffer(&(context->m_bufferOutput));
-		if (context->isKeepAlive()) {
-			m_output->startWriting();
-			start();
-		} else {
-			m_contextCurrent.setNull();
-			m_flagKeepAlive = sl_false;
-			m_output->startWriting();
+		Ref<Referable> webSocket;
+		ListElements< Ref<HttpServerContext> > items(contexts);
+		for (sl_size i = 0; i < items.count; i++) {
+			HttpServerContext* context = items[i].get();
+			if (!(m_output->write(context->m_responseHeaderPacket))) {
+				close();
+				return;
+			}
+			context->m_responseHeaderPacket.setNull();
+			m_output->mergeBuffer(&(context->m_bufferOutput));
+			if (context->m_webSocket.isNotNull()) {
+				webSocket = context->m_webSocket;
+				context->m_webSocket.setNull();
+				m_webSocket = webSocket;
+				_setDeadline(0);
+				// the frames sent before are written after the handshake response
+				((WebSocketConnection*)(webSocket.get()))->_start(context);
+			}
+		}
+		{
+			ObjectLocker lock(this);
+			m_flagSendingResponses = sl_true;
+		}
+		m_output->startWriting();
+		if (webSocket.isNotNull()) {
+			m_io->addTask(SLIB_BIND_WEAKREF(void(), WebSocketConnection, _dispatchOpen, (WebSocketConnection*)(webSocket.get())));
+			return;
+		}
+		if (flagResume) {
+			_resumeInput();
 		}
 	}
 
 	void HttpServerConnection::onReadStream(AsyncStreamResult* result)
 	{
-		m_flagReading = sl_false;
 		if (result->flagError) {
+			m_flagStreamEnded = sl_true;
+			m_flagReading = sl_false;
+			// the data can arrive with the end of the stream
+			if (result->size) {
+				_processInput(result->data, result->size);
+			}
+			if (m_webSocket.isNotNull()) {
+				close();
+				return;
+			}
+			{
+				ObjectLocker lock(this);
+				m_flagKeepAlive = sl_false;
+				if (m_queueResponses.isNotEmpty() || m_bufPending.isNotNull() || m_flagSendingResponses) {
+					// sends the responses of the received requests before closing
+					return;
+				}
+			}
 			close();
 		} else {
+			m_flagReading = sl_false;
 			_processInput(result->data, result->size);
 		}
 	}
 
 	void HttpServerConnection::onAsyncOutputEnd(AsyncOutput* output, sl_bool flagError)
 	{
-		if (flagError || !m_flagKeepAlive) {
+		{
+			// called in the lock of the output, which is locked in the lock of the session
+			Ref<Referable> http2 = m_http2Session;
+			if (http2.isNotNull()) {
+				m_io->addTask(SLIB_BIND_WEAKREF(void(), _priv_Http2ServerSession, onOutputEnd, (_priv_Http2ServerSession*)(http2.get()), flagError));
+				return;
+			}
+			Ref<Referable> webSocket = m_webSocket;
+			if (webSocket.isNotNull()) {
+				if (!(m_io->addTask(SLIB_BIND_WEAKREF(void(), WebSocketConnection, _onOutputEnd, (WebSocketConnection*)(webSocket.get()), flagError)))) {
+					close();
+				}
+				return;
+			}
+		}
+		if (flagError) {
+			close();
+			return;
+		}
+		{
+			ObjectLocker lock(this);
+			m_flagSendingResponses = sl_false;
+			if (m_queueResponses.isNotEmpty() || m_bufPending.isNotNull()) {
+				// waiting for the responses of the pipelined requests
+				return;
+			}
+		}
+		if (!m_flagKeepAlive) {
 			close();
+			return;
+		}
+		// the response is sent, and the next request is not started yet
+		if (m_contextCurrent.isNull()) {
+			Ref<HttpServer> server = m_server;
+			if (server.isNotNull()) {
+				_setDeadline(server->getParam().keepAliveTimeout);
+			}
 		}
 	}
 
@@ -501,6 +1775,12 @@ namespace slib
 		sendResponseAndRestart(Memory::create(s.getData(), s.getLength()));
 	}
 
+	void HttpServerConnection::sendResponse_ServiceUnavailable()
+	{
+		SLIB_STATIC_STRING(s, "HTTP/1.1 503 Service Unavailable\r\nConnection: close\r\nContent-Length: 0\r\n\r\n");
+		sendResponseAndClose(Memory::create(s.getData(), s.getLength()));
+	}
+
 	void HttpServerConnection::sendConnectResponse_Successed()
 	{
 		SLIB_STATIC_STRING(s, "HTTP/1.1 200 Connection established\r\n\r\n");
@@ -547,7 +1827,6 @@ namespace slib
 	{
 	public:
 		Ref<AsyncTcpServer> m_server;
-		Ref<AsyncIoLoop> m_loop;
 
 	public:
 		_priv_DefaultHttpServerConnectionProvider()
@@ -566,12 +1845,19 @@ namespace slib
 			if (loop.isNotNull()) {
 				Ref<_priv_DefaultHttpServerConnectionProvider> ret = new _priv_DefaultHttpServerConnectionProvider;
 				if (ret.isNotNull()) {
-					ret->m_loop = loop;
 					ret->setServer(server);
 					AsyncTcpServerParam sp;
 					sp.bindAddress = addressListen;
 					sp.onAccept = SLIB_FUNCTION_WEAKREF(_priv_DefaultHttpServerConnectionProvider, onAccept, ret);
-					sp.ioLoop = loop;
+					sp.flagNonBlockingAccept = sl_true;
+					Ref<AsyncIoLoopGroup> group = server->getAsyncIoLoopGroup();
+					if (group.isNotNull() && server->getParam().ioLoopGroup.isNull()) {
+						// one listener per loop
+						sp.ioLoopGroup = group;
+						sp.listenerCount = 0;
+					} else {
+						sp.ioLoop = loop;
+					}
 					Ref<AsyncTcpServer> server = AsyncTcpServer::create(sp);
 					if (server.isNotNull()) {
 						ret->m_server = server;
@@ -594,10 +1880,19 @@ namespace slib
 		{
 			Ref<HttpServer> server = getServer();
 			if (server.isNotNull()) {
-				Ref<AsyncIoLoop> loop = m_loop;
+				Ref<AsyncIoLoop> loop;
+				Ref<AsyncTcpServer> listener = m_server;
+				if (listener.isNotNull() && listener->getListenerCount() > 1) {
+					// keeps the connection on the loop of the accepting listener
+					loop = socketListen->getIoLoop();
+				} else {
+					loop = server->selectAsyncIoLoop();
+				}
 				if (loop.isNull()) {
 					return;
 				}
+				// the response header and body are written separately, and should not wait for the delayed ACK
+				socketAccept->setOption_TcpNoDelay(sl_true);
 				AsyncTcpSocketParam cp;
 				cp.socket = socketAccept;
 				cp.ioLoop = loop;
@@ -631,12 +1926,39 @@ namespace slib
 		maxRequestHeadersSize = 0x10000; // 64KB
 		maxRequestBodySize = 0x2000000; // 32MB
 		
+		flagSpoolMultipartFormData = sl_false;
+		maxStreamingRequestBodySize = 0x40000000; // 1GB
+		maxMultipartFieldSize = 0x100000; // 1MB
+		
+		maxPipelinedRequests = 16;
+		
+		flagUseHttp2 = sl_false;
+		http2MaxConcurrentStreams = 100;
+		http2InitialWindowSize = 0x100000; // 1MB
+		http2MaxFrameSize = 16384;
+		http2MaxResetStreamsPerSecond = 200;
+		
+		keepAliveTimeout = 15000;
+		requestHeaderTimeout = 30000;
+		
 		flagAllowCrossOrigin = sl_false;
 		
 		flagUseCacheControl = sl_true;
 		flagCacheControlNoCache = sl_false;
 		cacheControlMaxAge = 600;
 		
+		flagUseSendFile = sl_true;
+		
+		flagUseFileCache = sl_false;
+		flagUseResponseCache = sl_false;
+		flagUseAdmissionControl = sl_false;
+		
+		flagUseCompression = sl_false;
+		compressionLevel = 6;
+		minimumCompressionSize = 1024;
+		
+		ioLoopCount = 1;
+		
 		flagLogDebug = sl_false;
 	}
 
@@ -678,6 +2000,78 @@ namespace slib
 				maxRequestBodySize = n * 1024 * 1024;
 			}
 		}
+		
+		Json jsonUpload = conf["upload"];
+		if (jsonUpload.isNotNull()) {
+			flagSpoolMultipartFormData = jsonUpload["spool"].getBoolean(sl_true);
+			maxStreamingRequestBodySize = jsonUpload["max_size"].getUint64(maxStreamingRequestBodySize);
+			maxMultipartFieldSize = jsonUpload["max_field_size"].getUint32(maxMultipartFieldSize);
+			String dir = jsonUpload["temp_dir"].getString();
+			if (dir.isNotEmpty()) {
+				uploadTempDirectory = dir;
+			}
+		}
+		
+		Json jsonFileCache = conf["file_cache"];
+		if (jsonFileCache.isNotNull()) {
+			flagUseFileCache = jsonFileCache["enabled"].getBoolean(sl_true);
+			fileCache.maxEntriesCount = jsonFileCache["max_entries"].getUint32(fileCache.maxEntriesCount);
+			fileCache.maxMemorySize = (sl_size)(jsonFileCache["max_memory"].getUint64(fileCache.maxMemorySize));
+			fileCache.revalidateInterval = jsonFileCache["revalidate_interval"].getUint32(fileCache.revalidateInterval);
+			fileCache.negativeTimeout = jsonFileCache["negative_timeout"].getUint32(fileCache.negativeTimeout);
+			fileCache.flagUseInotify = jsonFileCache["inotify"].getBoolean(fileCache.flagUseInotify);
+		}
+		
+		Json jsonResponseCache = conf["response_cache"];
+		if (jsonResponseCache.isNotNull()) {
+			flagUseResponseCache = jsonResponseCache["enabled"].getBoolean(sl_true);
+			responseCache.maxEntriesCount = jsonResponseCache["max_entries"].getUint32(responseCache.maxEntriesCount);
+			responseCache.maxMemorySize = (sl_size)(jsonResponseCache["max_memory"].getUint64(responseCache.maxMemorySize));
+			responseCache.maxBodySize = (sl_size)(jsonResponseCache["max_body"].getUint64(responseCache.maxBodySize));
+			responseCache.defaultTimeToLive = jsonResponseCache["ttl"].getUint32(responseCache.defaultTimeToLive);
+			responseCache.defaultStaleWhileRevalidate = jsonResponseCache["stale_while_revalidate"].getUint32(responseCache.defaultStaleWhileRevalidate);
+			responseCache.passTimeout = jsonResponseCache["pass_timeout"].getUint32(responseCache.passTimeout);
+			responseCache.maxWaitTime = jsonResponseCache["max_wait_time"].getUint32(responseCache.maxWaitTime);
+			List<String> vary;
+			jsonResponseCache["vary"].get(vary);
+			if (vary.isNotNull()) {
+				responseCache.varyHeaders = vary;
+			}
+		}
+		
+		Json jsonAdmission = conf["admission"];
+		if (jsonAdmission.isNotNull()) {
+			flagUseAdmissionControl = jsonAdmission["enabled"].getBoolean(sl_true);
+			admission.maxConnectionsPerAddress = jsonAdmission["max_connections_per_address"].getUint32(admission.maxConnectionsPerAddress);
+			admission.requestRate = jsonAdmission["request_rate"].getUint32(admission.requestRate);
+			admission.requestBurst = jsonAdmission["request_burst"].getUint32(admission.requestBurst);
+			admission.maxAddressesCount = jsonAdmission["max_addresses"].getUint32(admission.maxAddressesCount);
+			admission.maxConcurrentRequests = jsonAdmission["max_concurrent_requests"].getUint32(admission.maxConcurrentRequests);
+			admission.maxQueuedRequests = jsonAdmission["max_queued_requests"].getUint32(admission.maxQueuedRequests);
+			admission.maxQueueTime = jsonAdmission["max_queue_time"].getUint32(admission.maxQueueTime);
+			admission.retryAfter = jsonAdmission["retry_after"].getUint32(admission.retryAfter);
+		}
+		
+		Json jsonCompression = conf["compression"];
+		if (jsonCompression.isNotNull()) {
+			flagUseCompression = jsonCompression["enabled"].getBoolean(sl_true);
+			compressionLevel = jsonCompression["level"].getInt32(compressionLevel);
+			minimumCompressionSize = jsonCompression["min_size"].getUint32(minimumCompressionSize);
+		}
+		
+		Json jsonHttp2 = conf["http2"];
+		if (jsonHttp2.isNotNull()) {
+			flagUseHttp2 = jsonHttp2["enabled"].getBoolean(sl_true);
+			http2MaxConcurrentStreams = jsonHttp2["max_concurrent_streams"].getUint32(http2MaxConcurrentStreams);
+			http2InitialWindowSize = jsonHttp2["initial_window_size"].getUint32(http2InitialWindowSize);
+			http2MaxFrameSize = jsonHttp2["max_frame_size"].getUint32(http2MaxFrameSize);
+			http2MaxResetStreamsPerSecond = jsonHttp2["max_reset_streams_per_second"].getUint32(http2MaxResetStreamsPerSecond);
+		}
+		
+		maxPipelinedRequests = conf["max_pipelined_requests"].getUint32(maxPipelinedRequests);
+		keepAliveTimeout = conf["keep_alive_timeout"].getUint32(keepAliveTimeout);
+		requestHeaderTimeout = conf["request_header_timeout"].getUint32(requestHeaderTimeout);
+		ioLoopCount = conf["io_loops"].getUint32(ioLoopCount);
 	}
 	
 	sl_bool HttpServerParam::parseJsonFile(const String& filePath)
@@ -706,7 +2100,17 @@ namespace slib
 
 	sl_bool HttpServer::_init(const HttpServerParam& param)
 	{
-		Ref<AsyncIoLoop> ioLoop = AsyncIoLoop::create(sl_false);
+		Ref<AsyncIoLoop> ioLoop;
+		Ref<AsyncIoLoopGroup> ioLoopGroup;
+		if (param.ioLoopGroup.isNull() && param.ioLoopCount != 1) {
+			ioLoopGroup = AsyncIoLoopGroup::create(param.ioLoopCount, sl_false);
+			if (ioLoopGroup.isNull()) {
+				return sl_false;
+			}
+			ioLoop = ioLoopGroup->getLoop(0);
+		} else {
+			ioLoop = AsyncIoLoop::create(sl_false);
+		}
 		
 		if (ioLoop.isNotNull()) {
 			
@@ -717,15 +2121,32 @@ namespace slib
 				threadPool->setMaximumThreadsCount(param.maxThreadsCount);
 				
 				m_ioLoop = ioLoop;
+				m_ioLoopGroup = ioLoopGroup;
 				m_threadPool = threadPool;
 				m_param = param;
+				if (param.flagUseFileCache) {
+					m_fileCache = HttpFileCache::create(param.fileCache);
+				}
+				if (param.flagUseResponseCache) {
+					m_responseCache = HttpResponseCache::create(param.responseCache);
+				}
+				if (param.flagUseAdmissionControl) {
+					m_admission = HttpAdmissionControl::create(param.admission, ioLoop);
+					if (m_admission.isNull()) {
+						return sl_false;
+					}
+				}
 				if (param.port) {
 					if (! (addHttpServer(param.addressBind, param.port))) {
 						return sl_false;
 					}
 				}
 				
-				ioLoop->start();
+				if (ioLoopGroup.isNotNull()) {
+					ioLoopGroup->start();
+				} else {
+					ioLoop->start();
+				}
 
 				return sl_true;
 			}
@@ -762,6 +2183,11 @@ namespace slib
 		}
 		m_connectionProviders.removeAll();
 		
+		Ref<AsyncIoLoopGroup> ioLoopGroup = m_ioLoopGroup;
+		if (ioLoopGroup.isNotNull()) {
+			ioLoopGroup->release();
+			m_ioLoopGroup.setNull();
+		}
 		Ref<AsyncIoLoop> ioLoop = m_ioLoop;
 		if (ioLoop.isNotNull()) {
 			ioLoop->release();
@@ -786,11 +2212,46 @@ namespace slib
 		return m_ioLoop;
 	}
 
+	Ref<AsyncIoLoopGroup> HttpServer::getAsyncIoLoopGroup()
+	{
+		if (m_param.ioLoopGroup.isNotNull()) {
+			return m_param.ioLoopGroup;
+		}
+		return m_ioLoopGroup;
+	}
+
+	Ref<AsyncIoLoop> HttpServer::selectAsyncIoLoop()
+	{
+		Ref<AsyncIoLoopGroup> group = getAsyncIoLoopGroup();
+		if (group.isNotNull()) {
+			Ref<AsyncIoLoop> loop = group->selectLoop();
+			if (loop.isNotNull()) {
+				return loop;
+			}
+		}
+		return m_ioLoop;
+	}
+
 	Ref<ThreadPool> HttpServer::getThreadPool()
 	{
 		return m_threadPool;
 	}
 
+	Ref<HttpFileCache> HttpServer::getFileCache()
+	{
+		return m_fileCache;
+	}
+
+	Ref<HttpResponseCache> HttpServer::getResponseCache()
+	{
+		return m_responseCache;
+	}
+
+	Ref<HttpAdmissionControl> HttpServer::getAdmissionControl()
+	{
+		return m_admission;
+	}
+
 	const HttpServerParam& HttpServer::getParam()
 	{
 		return m_param;
@@ -906,6 +2367,11 @@ namespace slib
 			if (Assets::isBasedOnFileSystem()) {
 				String filePath = Assets::getFilePath(path);
 				return processFile(context, filePath);
+			} else if (m_fileCache.isNotNull()) {
+				Ref<HttpFileCacheEntry> entry = m_fileCache->getAsset(path);
+				if (entry.isNotNull() && entry->flagExists) {
+					return _processFileCacheEntry(context, entry.get());
+				}
 			} else {
 				Memory mem = Assets::readAllBytes(path);
 				if (mem.isNotNull()) {
@@ -928,6 +2394,9 @@ namespace slib
 
 	sl_bool HttpServer::processFile(const Ref<HttpServerContext>& context, const String& path)
 	{
+		if (m_fileCache.isNotNull()) {
+			return _processCachedFile(context, path);
+		}
 		if (File::exists(path) && !(File::isDirectory(path))) {
 
 			sl_uint64 totalSize = File::getSize(path);
@@ -992,6 +2461,117 @@ namespace slib
 		return sl_false;
 	}
 	
+	sl_bool HttpServer::_processCachedFile(const Ref<HttpServerContext>& context, const String& path)
+	{
+		for (sl_uint32 iTry = 0; iTry < 2; iTry++) {
+			Ref<HttpFileCacheEntry> entry = m_fileCache->get(path);
+			if (entry.isNull() || !(entry->flagExists)) {
+				return sl_false;
+			}
+			if (_processFileCacheEntry(context, entry.get())) {
+				return sl_true;
+			}
+			// truncated after the validation: reloads the entry once
+			m_fileCache->invalidate(path);
+		}
+		return sl_false;
+	}
+	
+	
+	sl_bool HttpServer::_processFileCacheEntry(const Ref<HttpServerContext>& context, HttpFileCacheEntry* entry)
+	{
+		if (context->getResponseContentType().isEmpty()) {
+			context->setResponseContentType(entry->contentType);
+		}
+		
+		context->setResponseAcceptRanges(sl_true);
+		
+		_processCacheControl(context);
+		
+		if (entry->lastModified.isNotEmpty()) {
+			context->setResponseHeader(HttpHeaders::LastModified, entry->lastModified);
+		}
+		
+		String rangeHeader = context->getRequestRange();
+		
+		sl_bool flagGzip = sl_false;
+		if (entry->contentGzip.isNotNull()) {
+			context->setResponseHeader(HttpHeaders::Vary, HttpHeaders::AcceptEncoding);
+			if (rangeHeader.isEmpty()) {
+				flagGzip = _priv_HttpServer_isAcceptingGzip(context->getRequestHeader(HttpHeaders::AcceptEncoding));
+			}
+		}
+		const String& eTag = flagGzip ? entry->eTagGzip : entry->eTag;
+		context->setResponseHeader(HttpHeaders::ETag, eTag);
+		
+		String ifNoneMatch = context->getRequestHeader(HttpHeaders::IfNoneMatch);
+		if (ifNoneMatch.isNotEmpty()) {
+			if (_priv_HttpServer_matchEntityTag(ifNoneMatch, eTag)) {
+				context->setResponseCode(HttpStatus::NotModified);
+				return sl_true;
+			}
+		} else if (entry->lastModified.isNotEmpty()) {
+			String ifModifiedSince = context->getRequestHeader(HttpHeaders::IfModifiedSince);
+			if (ifModifiedSince.isNotEmpty()) {
+				Time time;
+				if (ifModifiedSince == entry->lastModified || (time.parseHttpDate(ifModifiedSince) && time >= entry->lastModifiedTime)) {
+					context->setResponseCode(HttpStatus::NotModified);
+					return sl_true;
+				}
+			}
+		}
+		
+		if (flagGzip) {
+			context->setResponseContentEncoding("gzip");
+			context->write(entry->contentGzip);
+			return sl_true;
+		}
+		
+		Memory& content = entry->content;
+		sl_uint64 totalSize = entry->size;
+		if (rangeHeader.isNotEmpty()) {
+			sl_uint64 start;
+			sl_uint64 len;
+			if (processRangeRequest(context, totalSize, rangeHeader, start, len)) {
+				if (content.isNotNull()) {
+					context->write(content.sub((sl_size)start, (sl_size)len));
+					return sl_true;
+				}
+				Ref<AsyncFile> file = AsyncFile::createShared(entry->file, start, m_threadPool);
+				if (file.isNotNull()) {
+					context->copyFrom(file.get(), len);
+					return sl_true;
+				}
+			} else {
+				return sl_true;
+			}
+		} else {
+			if (!totalSize) {
+				return sl_true;
+			}
+			if (content.isNotNull()) {
+				context->write(content);
+				return sl_true;
+			}
+			if (totalSize > 100000) {
+				Ref<AsyncFile> file = AsyncFile::createShared(entry->file, 0, m_threadPool);
+				if (file.isNotNull()) {
+					context->copyFrom(file.get(), totalSize);
+					return sl_true;
+				}
+			} else {
+				Memory mem = Memory::create((sl_size)totalSize);
+				if (mem.isNotNull()) {
+					if (entry->file->readAt(0, mem.getData(), (sl_size)totalSize) == (sl_reg)totalSize) {
+						context->write(mem);
+						return sl_true;
+					}
+				}
+			}
+		}
+		return sl_false;
+	}
+	
 	void HttpServer::_processCacheControl(const Ref<HttpServerContext>& context)
 	{
 		if (m_param.flagUseCacheControl) {
@@ -1067,6 +2647,16 @@ namespace slib
 		return sl_true;
 	}
 	
+	void HttpServer::onRequestHeader(HttpServerContext* context)
+	{
+	}
+	
+	void HttpServer::dispatchRequestHeader(HttpServerContext* context)
+	{
+		m_param.onRequestHeader(this, context);
+		onRequestHeader(context);
+	}
+	
 	sl_bool HttpServer::onRequest(HttpServerContext* context)
 	{
 		return sl_false;
@@ -1112,8 +2702,17 @@ namespace slib
 			}
 			connection->setRemoteAddress(remoteAddress);
 			connection->setLocalAddress(localAddress);
+			sl_bool flagAdmitted = sl_true;
+			if (m_admission.isNotNull()) {
+				flagAdmitted = m_admission->addConnection(remoteAddress.ip);
+				connection->m_flagAddressCounted = flagAdmitted;
+			}
 			m_connections.put(connection.get(), connection);
-			connection->start();
+			if (flagAdmitted) {
+				connection->start();
+			} else {
+				connection->sendResponse_ServiceUnavailable();
+			}
 		}
 		return connection;
 	}
@@ -24,6 +24,12 @@
 
 #include "network_async.h"
 
+#include "slib/network/dns.h"
+#include "slib/core/dispatch.h"
+#include "slib/core/timer.h"
+#include "slib/core/system.h"
+#include "slib/core/linked_list.h"
+
 namespace slib
 {
 
@@ -31,6 +37,22 @@ namespace slib
 			AsyncTcpSocket
 ********************************************/
 
+	SLIB_DEFINE_OBJECT(AsyncTcpSocketSendFileRequest, AsyncStreamRequest)
+
+	AsyncTcpSocketSendFileRequest::AsyncTcpSocketSendFileRequest(const Ref<File>& _file, sl_uint64 _offset, sl_uint64 _size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& _callback)
+	 : AsyncStreamRequest(sl_null, 0, sl_null, sl_null, sl_false), file(_file), offset(_offset), sizeFile(_size), sizeSent(0), callbackFile(_callback)
+	{
+	}
+
+	AsyncTcpSocketSendFileRequest::~AsyncTcpSocketSendFileRequest()
+	{
+	}
+
+	sl_uint64 AsyncTcpSocketSendFileRequest::getWriteSize()
+	{
+		return sizeFile;
+	}
+
 	AsyncTcpSocketInstance::AsyncTcpSocketInstance()
 	{
 		m_flagRequestConnect = sl_false;
@@ -58,6 +80,11 @@ namespace slib
 		return sl_true;
 	}
 
+	sl_bool AsyncTcpSocketInstance::setZeroCopyThreshold(sl_uint32 size)
+	{
+		return sl_false;
+	}
+
 	void AsyncTcpSocketInstance::_onReceive(AsyncStreamRequest* req, sl_uint32 size, sl_bool flagError)
 	{
 		Ref<AsyncTcpSocket> object = Ref<AsyncTcpSocket>::from(getObject());
@@ -74,6 +101,14 @@ namespace slib
 		}
 	}
 
+	void AsyncTcpSocketInstance::_onSendFile(AsyncTcpSocketSendFileRequest* req, sl_bool flagError)
+	{
+		Ref<AsyncTcpSocket> object = Ref<AsyncTcpSocket>::from(getObject());
+		if (object.isNotNull()) {
+			object->_onSendFile(req, flagError);
+		}
+	}
+
 	void AsyncTcpSocketInstance::_onConnect(sl_bool flagError)
 	{
 		Ref<AsyncTcpSocket> object = Ref<AsyncTcpSocket>::from(getObject());
@@ -90,6 +125,12 @@ namespace slib
 		flagIPv6 = sl_false;
 		
 		flagLogError = sl_true;
+		
+		zeroCopyThreshold = 0;
+		
+		readTimeout = 0;
+		writeTimeout = 0;
+		idleTimeout = 0;
 	}
 
 
@@ -143,6 +184,19 @@ namespace slib
 				if (ret->_initialize(instance.get(), AsyncIoMode::InOut, loop)) {
 					ret->m_onConnect = param.onConnect;
 					ret->m_onError = param.onError;
+					ret->m_dnsClient = param.dnsClient;
+					if (param.zeroCopyThreshold) {
+						instance->setZeroCopyThreshold(param.zeroCopyThreshold);
+					}
+					if (param.readTimeout) {
+						ret->setReadTimeout(param.readTimeout);
+					}
+					if (param.writeTimeout) {
+						ret->setWriteTimeout(param.writeTimeout);
+					}
+					if (param.idleTimeout) {
+						ret->setIdleTimeout(param.idleTimeout);
+					}
 					if (param.connectAddress.isValid()) {
 						if (!(ret->connect(param.connectAddress))) {
 							if (param.flagLogError) {
@@ -210,6 +264,164 @@ namespace slib
 		return sl_false;
 	}
 
+#define HAPPY_EYEBALLS_CONNECTION_ATTEMPT_DELAY 250
+
+	class _priv_AsyncTcpHostConnector : public Referable
+	{
+	public:
+		WeakRef<AsyncTcpSocket> m_socket;
+		Ref<AsyncIoLoop> m_loop;
+		List<SocketAddress> m_addresses;
+		sl_size m_indexNext;
+		List< Ref<AsyncTcpSocket> > m_attempts;
+		SocketAddress m_addressLast;
+		sl_bool m_flagFinished;
+		
+	public:
+		_priv_AsyncTcpHostConnector()
+		{
+			m_indexNext = 0;
+			m_flagFinished = sl_false;
+		}
+		
+	public:
+		// runs on the loop of the socket
+		void start(const List<IPAddress>& ips, sl_uint16 port)
+		{
+			// interleaves the address families, starting from IPv6
+			List<SocketAddress> list6, list4;
+			ListElements<IPAddress> items(ips);
+			for (sl_size i = 0; i < items.count; i++) {
+				if (items[i].isIPv6()) {
+					list6.add_NoLock(SocketAddress(items[i], port));
+				} else if (items[i].isIPv4()) {
+					list4.add_NoLock(SocketAddress(items[i], port));
+				}
+			}
+			sl_size n6 = list6.getCount();
+			sl_size n4 = list4.getCount();
+			for (sl_size i = 0; i < n6 || i < n4; i++) {
+				if (i < n6) {
+					m_addresses.add_NoLock(list6.getValueAt_NoLock(i));
+				}
+				if (i < n4) {
+					m_addresses.add_NoLock(list4.getValueAt_NoLock(i));
+				}
+			}
+			m_addressLast = SocketAddress(IPAddress::none(), port);
+			startNextAttempt();
+		}
+		
+		void startNextAttempt()
+		{
+			while (!m_flagFinished) {
+				if (m_indexNext >= m_addresses.getCount()) {
+					if (m_attempts.isEmpty()) {
+						finish(sl_null);
+					}
+					return;
+				}
+				sl_size index = m_indexNext++;
+				SocketAddress address = m_addresses.getValueAt_NoLock(index);
+				m_addressLast = address;
+				Ref<_priv_AsyncTcpHostConnector> thiz = this;
+				AsyncTcpSocketParam param;
+				param.flagIPv6 = address.ip.isIPv6();
+				param.flagLogError = sl_false;
+				param.ioLoop = m_loop;
+				param.onConnect = [thiz](AsyncTcpSocket* socket, const SocketAddress& address, sl_bool flagError) {
+					thiz->onAttemptConnect(socket, address, flagError);
+				};
+				param.connectAddress = address;
+				Ref<AsyncTcpSocket> socket = AsyncTcpSocket::create(param);
+				if (socket.isNull()) {
+					continue;
+				}
+				m_attempts.add_NoLock(socket);
+				Ref<AsyncIoLoop> loop = m_loop;
+				Dispatch::setTimeout([thiz, loop, index]() {
+					loop->addTask([thiz, index]() {
+						// starts the next attempt if no attempt is started after this
+						if (thiz->m_indexNext == index + 1) {
+							thiz->startNextAttempt();
+						}
+					});
+				}, HAPPY_EYEBALLS_CONNECTION_ATTEMPT_DELAY);
+				return;
+			}
+		}
+		
+		void onAttemptConnect(AsyncTcpSocket* socket, const SocketAddress& address, sl_bool flagError)
+		{
+			if (m_flagFinished) {
+				return;
+			}
+			if (flagError) {
+				m_attempts.remove_NoLock(socket);
+				socket->close();
+				startNextAttempt();
+			} else {
+				m_addressLast = address;
+				finish(socket);
+			}
+		}
+		
+		void finish(AsyncTcpSocket* socketConnected)
+		{
+			m_flagFinished = sl_true;
+			ListElements< Ref<AsyncTcpSocket> > attempts(m_attempts);
+			for (sl_size i = 0; i < attempts.count; i++) {
+				if (attempts[i] != socketConnected) {
+					attempts[i]->close();
+				}
+			}
+			m_attempts.setNull();
+			Ref<AsyncTcpSocket> socket = m_socket;
+			if (socket.isNull()) {
+				if (socketConnected) {
+					socketConnected->close();
+				}
+				return;
+			}
+			if (socketConnected) {
+				if (socket->_takeIoInstance(socketConnected)) {
+					socket->_onConnect(m_addressLast, sl_false);
+					return;
+				}
+				socketConnected->close();
+			}
+			socket->_onConnect(m_addressLast, sl_true);
+		}
+		
+	};
+
+	sl_bool AsyncTcpSocket::connectHost(const String& host, sl_uint16 port)
+	{
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return sl_false;
+		}
+		Ref<DnsClient> client = m_dnsClient;
+		if (client.isNull()) {
+			client = DnsClient::getDefault();
+			if (client.isNull()) {
+				return sl_false;
+			}
+		}
+		Ref<_priv_AsyncTcpHostConnector> connector = new _priv_AsyncTcpHostConnector;
+		if (connector.isNull()) {
+			return sl_false;
+		}
+		connector->m_socket = this;
+		connector->m_loop = loop;
+		client->resolveHost(host, [connector, loop, port](const List<IPAddress>& addresses) {
+			loop->addTask([connector, addresses, port]() {
+				connector->start(addresses, port);
+			});
+		});
+		return sl_true;
+	}
+
 	sl_bool AsyncTcpSocket::receive(void* data, sl_uint32 size, const Function<void(AsyncStreamResult*)>& callback, Referable* userObject)
 	{
 		return AsyncStreamBase::read(data, size, callback, userObject);
@@ -230,6 +442,15 @@ namespace slib
 		return AsyncStreamBase::write(mem.getData(), (sl_uint32)(mem.getSize()), callback, mem.ref.get());
 	}
 
+	sl_bool AsyncTcpSocket::setZeroCopyThreshold(sl_uint32 size)
+	{
+		Ref<AsyncTcpSocketInstance> instance = _getIoInstance();
+		if (instance.isNotNull()) {
+			return instance->setZeroCopyThreshold(size);
+		}
+		return sl_false;
+	}
+
 	Ref<AsyncTcpSocketInstance> AsyncTcpSocket::_getIoInstance()
 	{
 		return Ref<AsyncTcpSocketInstance>::from(AsyncStreamBase::getIoInstance());
@@ -251,6 +472,14 @@ namespace slib
 		}
 	}
 
+	void AsyncTcpSocket::_onSendFile(AsyncTcpSocketSendFileRequest* req, sl_bool flagError)
+	{
+		req->callbackFile(this, req->sizeSent, flagError);
+		if (flagError) {
+			_onError();
+		}
+	}
+
 	void AsyncTcpSocket::_onConnect(const SocketAddress& address, sl_bool flagError)
 	{
 		m_onConnect(this, address, flagError);
@@ -261,6 +490,20 @@ namespace slib
 		m_onError(this);
 	}
 
+	sl_bool AsyncTcpSocket::_takeIoInstance(AsyncTcpSocket* other)
+	{
+		Ref<AsyncTcpSocketInstance> instance = other->_getIoInstance();
+		if (instance.isNull()) {
+			return sl_false;
+		}
+		// the instance keeps running on the same loop, and only its owner is changed
+		other->setIoInstance(sl_null);
+		closeIoInstance();
+		instance->setObject(this);
+		setIoInstance(instance.get());
+		return sl_true;
+	}
+
 
 /*******************************************
 			AsyncTcpServer
@@ -269,6 +512,7 @@ namespace slib
 	AsyncTcpServerInstance::AsyncTcpServerInstance()
 	{
 		m_flagRunning = sl_false;
+		m_flagNonBlockingAccept = sl_false;
 	}
 
 	AsyncTcpServerInstance::~AsyncTcpServerInstance()
@@ -300,6 +544,11 @@ namespace slib
 		return m_socket;
 	}
 
+	void AsyncTcpServerInstance::setNonBlockingAccept(sl_bool flag)
+	{
+		m_flagNonBlockingAccept = flag;
+	}
+
 	void AsyncTcpServerInstance::_onAccept(const Ref<Socket>& socketAccept, const SocketAddress& address)
 	{
 		Ref<AsyncTcpServer> server = Ref<AsyncTcpServer>::from(getObject());
@@ -325,6 +574,10 @@ namespace slib
 		
 		flagAutoStart = sl_true;
 		flagLogError = sl_true;
+		flagNonBlockingAccept = sl_false;
+		
+		listenerCount = 1;
+		flagReusePortCpuSteering = sl_false;
 	}
 
 
@@ -338,40 +591,61 @@ namespace slib
 	{
 	}
 
-	Ref<AsyncTcpServer> AsyncTcpServer::create(const AsyncTcpServerParam& param)
+	Ref<Socket> AsyncTcpServer::_openSocket(const AsyncTcpServerParam& param, sl_bool flagReusePort)
 	{
-		Ref<Socket> socket = param.socket;
+		if (param.bindAddress.port == 0) {
+			return sl_null;
+		}
+		sl_bool flagIPv6 = param.flagIPv6;
+		if (param.bindAddress.ip.isIPv6()) {
+			flagIPv6 = sl_true;
+		}
+		Ref<Socket> socket;
+		if (flagIPv6) {
+			socket = Socket::openTcp_IPv6();
+		} else {
+			socket = Socket::openTcp();
+		}
 		if (socket.isNull()) {
-			if (param.bindAddress.port == 0) {
+			return sl_null;
+		}
+		
+#if defined(SLIB_PLATFORM_IS_UNIX)
+		/*
+		 * SO_REUSEADDR option allows the server applications to listen on the port that is still
+		 * bound by some TIME_WAIT sockets.
+		 *
+		 * http://stackoverflow.com/questions/14388706/socket-options-so-reuseaddr-and-so-reuseport-how-do-they-differ-do-they-mean-t
+		 */
+		socket->setOption_ReuseAddress(sl_true);
+#endif
+		if (flagReusePort) {
+			if (!(socket->setOption_ReusePort(sl_true))) {
 				return sl_null;
 			}
-			sl_bool flagIPv6 = param.flagIPv6;
-			if (param.bindAddress.ip.isIPv6()) {
-				flagIPv6 = sl_true;
-			}
-			if (flagIPv6) {
-				socket = Socket::openTcp_IPv6();
-			} else {
-				socket = Socket::openTcp();
-			}
-			if (socket.isNull()) {
-				return sl_null;
+		}
+
+		if (!(socket->bind(param.bindAddress))) {
+			if (param.flagLogError) {
+				LogError(TAG, "AsyncTcpServer bind error: %s, %s", param.bindAddress.toString(), socket->getLastErrorMessage());
 			}
-			
-#if defined(SLIB_PLATFORM_IS_UNIX)
-			/*
-			 * SO_REUSEADDR option allows the server applications to listen on the port that is still
-			 * bound by some TIME_WAIT sockets.
-			 *
-			 * http://stackoverflow.com/questions/14388706/socket-options-so-reuseaddr-and-so-reuseport-how-do-they-differ-do-they-mean-t
-			 */
-			socket->setOption_ReuseAddress(sl_true);
-#endif
+			return sl_null;
+		}
+		return socket;
+	}
 
-			if (!(socket->bind(param.bindAddress))) {
-				if (param.flagLogError) {
-					LogError(TAG, "AsyncTcpServer bind error: %s, %s", param.bindAddress.toString(), socket->getLastErrorMessage());
+	Ref<AsyncTcpServer> AsyncTcpServer::create(const AsyncTcpServerParam& param)
+	{
+		Ref<Socket> socket = param.socket;
+		if (socket.isNull()) {
+			if (param.listenerCount != 1) {
+				Ref<AsyncTcpServer> ret = _createListeners(param);
+				if (ret.isNotNull()) {
+					return ret;
 				}
+			}
+			socket = _openSocket(param, sl_false);
+			if (socket.isNull()) {
 				return sl_null;
 			}
 		}
@@ -381,15 +655,22 @@ namespace slib
 			if (instance.isNotNull()) {
 				Ref<AsyncIoLoop> loop = param.ioLoop;
 				if (loop.isNull()) {
-					loop = AsyncIoLoop::getDefault();
+					if (param.ioLoopGroup.isNotNull()) {
+						loop = param.ioLoopGroup->getNextLoop();
+					}
 					if (loop.isNull()) {
-						return sl_null;
+						loop = AsyncIoLoop::getDefault();
+						if (loop.isNull()) {
+							return sl_null;
+						}
 					}
 				}
+				instance->setNonBlockingAccept(param.flagNonBlockingAccept);
 				Ref<AsyncTcpServer> ret = new AsyncTcpServer;
 				if (ret.isNotNull()) {
 					ret->m_onAccept = param.onAccept;
 					ret->m_onError = param.onError;
+					ret->m_ioLoopGroup = param.ioLoopGroup;
 					instance->setObject(ret.get());
 					ret->setIoInstance(instance.get());
 					ret->setIoLoop(loop);
@@ -409,10 +690,82 @@ namespace slib
 		return sl_null;
 	}
 
+	Ref<AsyncTcpServer> AsyncTcpServer::_createListeners(const AsyncTcpServerParam& param)
+	{
+		Ref<AsyncIoLoopGroup> group = param.ioLoopGroup;
+		sl_uint32 nLoops = group.isNotNull() ? group->getCount() : 0;
+		sl_uint32 nListeners = param.listenerCount;
+		if (!nListeners) {
+			nListeners = nLoops;
+		}
+		if (nListeners < 2) {
+			return sl_null;
+		}
+		
+		// all the sockets of a SO_REUSEPORT group should be bound before accepting
+		List< Ref<Socket> > sockets;
+		for (sl_uint32 i = 0; i < nListeners; i++) {
+			Ref<Socket> socket = _openSocket(param, sl_true);
+			if (socket.isNull()) {
+				// SO_REUSEPORT is not supported: falls back to the single listener
+				return sl_null;
+			}
+			sockets.add_NoLock(socket);
+		}
+		if (param.flagReusePortCpuSteering) {
+			sockets.getValueAt(0)->setOption_ReusePortCpuSteering(nListeners);
+		}
+		
+		AsyncTcpServerParam paramListener = param;
+		paramListener.listenerCount = 1;
+		paramListener.ioLoopGroup.setNull();
+		
+		Ref<AsyncTcpServer> ret;
+		for (sl_uint32 i = 0; i < nListeners; i++) {
+			paramListener.socket = sockets.getValueAt(i);
+			if (nLoops) {
+				paramListener.ioLoop = group->getLoop(i % nLoops);
+			}
+			if (i == 0) {
+				ret = create(paramListener);
+				if (ret.isNull()) {
+					return sl_null;
+				}
+				WeakRef<AsyncTcpServer> weak = ret;
+				// passes the accepting listener, so that the connection can stay on its loop
+				paramListener.onAccept = [weak](AsyncTcpServer* listener, Socket* socket, const SocketAddress& address) {
+					Ref<AsyncTcpServer> server = weak;
+					if (server.isNotNull()) {
+						server->m_onAccept(listener, socket, address);
+					}
+				};
+				paramListener.onError = [weak](AsyncTcpServer*) {
+					Ref<AsyncTcpServer> server = weak;
+					if (server.isNotNull()) {
+						server->_onError();
+					}
+				};
+			} else {
+				Ref<AsyncTcpServer> listener = create(paramListener);
+				if (listener.isNull()) {
+					ret->close();
+					return sl_null;
+				}
+				ret->m_listenersReusePort.add(listener);
+			}
+		}
+		ret->m_ioLoopGroup = group;
+		return ret;
+	}
+
 
 	void AsyncTcpServer::close()
 	{
 		closeIoInstance();
+		ListLocker< Ref<AsyncTcpServer> > listeners(m_listenersReusePort);
+		for (sl_size i = 0; i < listeners.count; i++) {
+			listeners[i]->close();
+		}
 	}
 
 	sl_bool AsyncTcpServer::isOpened()
@@ -426,6 +779,10 @@ namespace slib
 		if (instance.isNotNull()) {
 			instance->start();
 		}
+		ListLocker< Ref<AsyncTcpServer> > listeners(m_listenersReusePort);
+		for (sl_size i = 0; i < listeners.count; i++) {
+			listeners[i]->start();
+		}
 	}
 
 	sl_bool AsyncTcpServer::isRunning()
@@ -446,6 +803,27 @@ namespace slib
 		return sl_null;
 	}
 
+	sl_uint32 AsyncTcpServer::getListenerCount()
+	{
+		return (sl_uint32)(m_listenersReusePort.getCount()) + 1;
+	}
+
+	Ref<AsyncIoLoopGroup> AsyncTcpServer::getIoLoopGroup()
+	{
+		return m_ioLoopGroup;
+	}
+
+	Ref<AsyncIoLoop> AsyncTcpServer::selectIoLoop()
+	{
+		if (m_ioLoopGroup.isNotNull()) {
+			Ref<AsyncIoLoop> loop = m_ioLoopGroup->selectLoop();
+			if (loop.isNotNull()) {
+				return loop;
+			}
+		}
+		return getIoLoop();
+	}
+
 	Ref<AsyncTcpServerInstance> AsyncTcpServer::_getIoInstance()
 	{
 		return Ref<AsyncTcpServerInstance>::from(AsyncIoObject::getIoInstance());
@@ -469,6 +847,7 @@ namespace slib
 	AsyncUdpSocketInstance::AsyncUdpSocketInstance()
 	{
 		m_flagRunning = sl_false;
+		m_nBatchCount = 1;
 	}
 
 	AsyncUdpSocketInstance::~AsyncUdpSocketInstance()
@@ -503,12 +882,18 @@ namespace slib
 #define UDP_QUEUE_MAX_SIZE 1024000
 
 	sl_bool AsyncUdpSocketInstance::sendTo(const SocketAddress& addressTo, const Memory& data)
+	{
+		return sendToSegmented(addressTo, data, 0);
+	}
+
+	sl_bool AsyncUdpSocketInstance::sendToSegmented(const SocketAddress& addressTo, const Memory& data, sl_uint32 sizeSegment)
 	{
 		if (isOpened()) {
 			if (data.isNotNull()) {
 				SendRequest request;
 				request.addressTo = addressTo;
 				request.data = data;
+				request.sizeSegment = sizeSegment;
 				if (m_queueSendRequests.getCount() < UDP_QUEUE_MAX_SIZE) {
 					if (m_queueSendRequests.push(request)) {
 						return sl_true;
@@ -519,6 +904,46 @@ namespace slib
 		return sl_false;
 	}
 
+	sl_bool AsyncUdpSocketInstance::sendToBatch(const SocketDatagram* datagrams, sl_uint32 count)
+	{
+		if (isOpened()) {
+			if (m_queueSendRequests.getCount() + count > UDP_QUEUE_MAX_SIZE) {
+				return sl_false;
+			}
+			sl_size sizeTotal = 0;
+			sl_uint32 i;
+			for (i = 0; i < count; i++) {
+				sizeTotal += datagrams[i].size;
+			}
+			if (!sizeTotal) {
+				return sl_false;
+			}
+			// copies the datagrams into a block to avoid the allocations per datagram
+			Memory mem = Memory::create(sizeTotal);
+			if (mem.isNull()) {
+				return sl_false;
+			}
+			sl_uint8* buf = (sl_uint8*)(mem.getData());
+			sl_size offset = 0;
+			LinkedQueue<SendRequest> requests;
+			for (i = 0; i < count; i++) {
+				sl_uint32 size = datagrams[i].size;
+				if (size) {
+					Base::copyMemory(buf + offset, datagrams[i].data, size);
+					SendRequest request;
+					request.addressTo = datagrams[i].address;
+					request.data = mem.sub(offset, size);
+					request.sizeSegment = 0;
+					requests.push(request);
+					offset += size;
+				}
+			}
+			m_queueSendRequests.merge(&requests);
+			return sl_true;
+		}
+		return sl_false;
+	}
+
 	void AsyncUdpSocketInstance::_onReceive(const SocketAddress& address, sl_uint32 size)
 	{
 		Ref<AsyncUdpSocket> object = Ref<AsyncUdpSocket>::from(getObject());
@@ -527,6 +952,14 @@ namespace slib
 		}
 	}
 
+	void AsyncUdpSocketInstance::_onReceiveBatch(SocketDatagram* datagrams, sl_uint32 count)
+	{
+		Ref<AsyncUdpSocket> object = Ref<AsyncUdpSocket>::from(getObject());
+		if (object.isNotNull()) {
+			object->_onReceiveBatch(datagrams, count);
+		}
+	}
+
 	
 	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(AsyncUdpSocketParam)
 
@@ -534,9 +967,12 @@ namespace slib
 	{
 		flagIPv6 = sl_false;
 		flagBroadcast = sl_false;
+		flagReusePort = sl_false;
 		flagAutoStart = sl_false;
 		flagLogError = sl_false;
 		packetSize = 65536;
+		batchCount = 1;
+		flagGro = sl_false;
 	}
 
 
@@ -579,6 +1015,14 @@ namespace slib
 			 */
 			socket->setOption_ReuseAddress(sl_true);
 #endif
+			if (param.flagReusePort) {
+				if (!(socket->setOption_ReusePort(sl_true))) {
+					if (param.flagLogError) {
+						LogError(TAG, "AsyncUdpSocket SO_REUSEPORT error: %s", socket->getLastErrorMessage());
+					}
+					return sl_null;
+				}
+			}
 			if (param.bindAddress.ip.isNotNone() || param.bindAddress.port != 0) {
 				if (!(socket->bind(param.bindAddress))) {
 					if (param.flagLogError) {
@@ -592,7 +1036,21 @@ namespace slib
 			socket->setOption_Broadcast(sl_true);
 		}
 		
-		Ref<AsyncUdpSocketInstance> instance = _createInstance(socket, param.packetSize);
+		sl_uint32 packetSize = param.packetSize;
+		sl_uint32 batchCount = param.batchCount;
+		if (batchCount < 1) {
+			batchCount = 1;
+		}
+		if (param.flagGro) {
+			if (socket->setOption_UdpGro(sl_true)) {
+				// a coalesced packet can be up to 64KB
+				if (packetSize < 65536) {
+					packetSize = 65536;
+				}
+				batchCount = 1;
+			}
+		}
+		Ref<AsyncUdpSocketInstance> instance = _createInstance(socket, packetSize, batchCount);
 		if (instance.isNotNull()) {
 			Ref<AsyncIoLoop> loop = param.ioLoop;
 			if (loop.isNull()) {
@@ -604,10 +1062,12 @@ namespace slib
 			Ref<AsyncUdpSocket> ret = new AsyncUdpSocket;
 			if (ret.isNotNull()) {
 				ret->m_onReceiveFrom = param.onReceiveFrom;
+				ret->m_onReceiveBatch = param.onReceiveBatch;
 				instance->setObject(ret.get());
 				ret->setIoInstance(instance.get());
 				ret->setIoLoop(loop);
-				if (loop->attachInstance(instance.get(), AsyncIoMode::In)) {
+				// `Out` event resumes the sending blocked by the full send buffer
+				if (loop->attachInstance(instance.get(), AsyncIoMode::InOut)) {
 					if (param.flagAutoStart) {
 						ret->start();
 					}
@@ -700,6 +1160,43 @@ namespace slib
 		return sl_false;
 	}
 
+	sl_bool AsyncUdpSocket::sendToBatch(const SocketDatagram* datagrams, sl_uint32 count)
+	{
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncUdpSocketInstance> instance = _getIoInstance();
+		if (instance.isNotNull()) {
+			if (instance->sendToBatch(datagrams, count)) {
+				loop->requestOrder(instance.get());
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	sl_bool AsyncUdpSocket::sendToSegmented(const SocketAddress& addressTo, const void* data, sl_uint32 size, sl_uint32 sizeSegment)
+	{
+		return sendToSegmented(addressTo, Memory::create(data, size), sizeSegment);
+	}
+
+	sl_bool AsyncUdpSocket::sendToSegmented(const SocketAddress& addressTo, const Memory& mem, sl_uint32 sizeSegment)
+	{
+		Ref<AsyncIoLoop> loop = getIoLoop();
+		if (loop.isNull()) {
+			return sl_false;
+		}
+		Ref<AsyncUdpSocketInstance> instance = _getIoInstance();
+		if (instance.isNotNull()) {
+			if (instance->sendToSegmented(addressTo, mem, sizeSegment)) {
+				loop->requestOrder(instance.get());
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
 	Ref<AsyncUdpSocketInstance> AsyncUdpSocket::_getIoInstance()
 	{
 		return Ref<AsyncUdpSocketInstance>::from(AsyncIoObject::getIoInstance());
@@ -707,7 +1204,585 @@ namespace slib
 
 	void AsyncUdpSocket::_onReceive(const SocketAddress& address, void* data, sl_uint32 sizeReceived)
 	{
-		m_onReceiveFrom(this, address, data, sizeReceived);
+		if (m_onReceiveBatch.isNotNull()) {
+			SocketDatagram datagram;
+			datagram.address = address;
+			datagram.data = data;
+			datagram.size = sizeReceived;
+			m_onReceiveBatch(this, &datagram, 1);
+		} else {
+			m_onReceiveFrom(this, address, data, sizeReceived);
+		}
+	}
+
+	void AsyncUdpSocket::_onReceiveBatch(SocketDatagram* datagrams, sl_uint32 count)
+	{
+		if (m_onReceiveBatch.isNotNull()) {
+			m_onReceiveBatch(this, datagrams, count);
+		} else {
+			for (sl_uint32 i = 0; i < count; i++) {
+				m_onReceiveFrom(this, datagrams[i].address, datagrams[i].data, datagrams[i].size);
+			}
+		}
+	}
+
+
+/*******************************************
+		AsyncTcpConnectionPool
+********************************************/
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(AsyncTcpConnectionPoolParam)
+
+	AsyncTcpConnectionPoolParam::AsyncTcpConnectionPoolParam()
+	{
+		maxActiveConnections = 64;
+		maxIdleConnections = 8;
+		idleTimeout = 60000;
+		connectTimeout = 10000;
+		waitTimeout = 10000;
+		maxWaiters = 1024;
+		
+		flagCheckOnCheckout = sl_true;
+	}
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(AsyncTcpConnectionPoolStats)
+
+	AsyncTcpConnectionPoolStats::AsyncTcpConnectionPoolStats()
+	{
+		hitCount = 0;
+		missCount = 0;
+		timeoutCount = 0;
+		connectCount = 0;
+		connectFailureCount = 0;
+		totalWaitTime = 0;
+		maxWaitTime = 0;
+		activeConnections = 0;
+		idleConnections = 0;
+		waiters = 0;
+	}
+
+	sl_uint32 AsyncTcpConnectionPoolStats::getAverageWaitTime() const
+	{
+		if (missCount) {
+			return (sl_uint32)(totalWaitTime / missCount);
+		}
+		return 0;
+	}
+
+
+	class AsyncTcpConnectionPool::Endpoint : public Referable
+	{
+	public:
+		String host;
+		sl_uint16 port;
+		
+		struct IdleConnection
+		{
+			Ref<AsyncTcpSocket> socket;
+			sl_uint32 tickIdle;
+		};
+		// the most recently used connection is at back
+		LinkedList<IdleConnection> idles;
+		
+		struct Waiter
+		{
+			Function<void(AsyncTcpSocket*)> callback;
+			sl_uint32 tickStart;
+		};
+		LinkedList<Waiter> waiters;
+		
+		List< Ref<AsyncTcpSocket> > connectings;
+		sl_uint32 nActive;
+		
+		AsyncTcpConnectionPoolStats stats;
+		
+	public:
+		Endpoint()
+		{
+			port = 0;
+			nActive = 0;
+		}
+		
+	public:
+		// called in locking the pool
+		sl_bool popWaiter(Function<void(AsyncTcpSocket*)>& callback)
+		{
+			Waiter waiter;
+			if (waiters.popFront_NoLock(&waiter)) {
+				sl_uint32 t = System::getTickCount() - waiter.tickStart;
+				stats.totalWaitTime += t;
+				if (t > stats.maxWaitTime) {
+					stats.maxWaitTime = t;
+				}
+				callback = waiter.callback;
+				return sl_true;
+			}
+			return sl_false;
+		}
+		
+		// called in locking the pool: a new connection is needed if the waiters are more than the connectings
+		sl_bool isConnectionNeeded(sl_uint32 maxActive)
+		{
+			sl_size nConnecting = connectings.getCount();
+			return waiters.getCount() > nConnecting && nActive + nConnecting < maxActive;
+		}
+		
+	};
+
+	SLIB_DEFINE_OBJECT(AsyncTcpConnectionPool, Object)
+
+	AsyncTcpConnectionPool::AsyncTcpConnectionPool()
+	{
+		m_flagClosed = sl_false;
+	}
+
+	AsyncTcpConnectionPool::~AsyncTcpConnectionPool()
+	{
+		close();
+	}
+
+#define CONNECTION_POOL_TIMER_INTERVAL 250
+
+	Ref<AsyncTcpConnectionPool> AsyncTcpConnectionPool::create(const AsyncTcpConnectionPoolParam& param)
+	{
+		Ref<AsyncTcpConnectionPool> ret = new AsyncTcpConnectionPool;
+		if (ret.isNotNull()) {
+			ret->m_param = param;
+			if (!(ret->m_param.maxActiveConnections)) {
+				ret->m_param.maxActiveConnections = 1;
+			}
+			if (param.idleTimeout || param.waitTimeout) {
+				WeakRef<AsyncTcpConnectionPool> weak = ret;
+				ret->m_timer = Timer::start([weak](Timer*) {
+					Ref<AsyncTcpConnectionPool> pool = weak;
+					if (pool.isNotNull()) {
+						pool->_onTimer();
+					}
+				}, CONNECTION_POOL_TIMER_INTERVAL);
+			}
+			return ret;
+		}
+		return sl_null;
+	}
+
+	void AsyncTcpConnectionPool::close()
+	{
+		List< Ref<AsyncTcpSocket> > sockets;
+		List< Function<void(AsyncTcpSocket*)> > callbacks;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			m_flagClosed = sl_true;
+			if (m_timer.isNotNull()) {
+				m_timer->stop();
+				m_timer.setNull();
+			}
+			for (auto& item : m_endpoints) {
+				Endpoint* endpoint = item.value.get();
+				Endpoint::IdleConnection idle;
+				while (endpoint->idles.popFront_NoLock(&idle)) {
+					sockets.add_NoLock(idle.socket);
+				}
+				sockets.addAll_NoLock(endpoint->connectings);
+				endpoint->connectings.setNull();
+				Endpoint::Waiter waiter;
+				while (endpoint->waiters.popFront_NoLock(&waiter)) {
+					callbacks.add_NoLock(waiter.callback);
+				}
+			}
+		}
+		ListElements< Ref<AsyncTcpSocket> > listSockets(sockets);
+		for (sl_size i = 0; i < listSockets.count; i++) {
+			listSockets[i]->close();
+		}
+		ListElements< Function<void(AsyncTcpSocket*)> > listCallbacks(callbacks);
+		for (sl_size i = 0; i < listCallbacks.count; i++) {
+			listCallbacks[i](sl_null);
+		}
+	}
+
+	void AsyncTcpConnectionPool::acquire(const String& host, sl_uint16 port, const Function<void(AsyncTcpSocket*)>& callback)
+	{
+		Ref<Endpoint> endpoint = _getEndpoint(host, port, sl_true);
+		if (endpoint.isNull()) {
+			callback(sl_null);
+			return;
+		}
+		Ref<AsyncTcpSocket> socket;
+		sl_bool flagConnect = sl_false;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				lock.unlock();
+				callback(sl_null);
+				return;
+			}
+			Endpoint::IdleConnection idle;
+			while (endpoint->idles.popBack_NoLock(&idle)) {
+				if (_checkIdleConnection(idle.socket.get())) {
+					socket = idle.socket;
+					break;
+				}
+				idle.socket->close();
+			}
+			if (socket.isNotNull()) {
+				endpoint->stats.hitCount++;
+				_addActiveConnection(socket.get(), endpoint.get());
+			} else {
+				if (endpoint->waiters.getCount() >= m_param.maxWaiters) {
+					endpoint->stats.timeoutCount++;
+					lock.unlock();
+					callback(sl_null);
+					return;
+				}
+				endpoint->stats.missCount++;
+				Endpoint::Waiter waiter;
+				waiter.callback = callback;
+				waiter.tickStart = System::getTickCount();
+				endpoint->waiters.pushBack_NoLock(waiter);
+				flagConnect = endpoint->isConnectionNeeded(m_param.maxActiveConnections);
+			}
+		}
+		if (socket.isNotNull()) {
+			Ref<AsyncIoLoop> loop = socket->getIoLoop();
+			if (loop.isNull() || !(loop->addTask([socket, callback]() { callback(socket.get()); }))) {
+				callback(socket.get());
+			}
+		} else if (flagConnect) {
+			_connect(endpoint.get(), sl_false);
+		}
+	}
+
+	void AsyncTcpConnectionPool::acquire(const SocketAddress& address, const Function<void(AsyncTcpSocket*)>& callback)
+	{
+		acquire(address.ip.toString(), address.port, callback);
+	}
+
+	void AsyncTcpConnectionPool::release(AsyncTcpSocket* socket, sl_bool flagReusable)
+	{
+		if (!socket) {
+			return;
+		}
+		Ref<AsyncTcpSocket> ref = socket;
+		Ref<Endpoint> endpoint;
+		Function<void(AsyncTcpSocket*)> callback;
+		sl_bool flagConnect = sl_false;
+		{
+			ObjectLocker lock(this);
+			ActiveConnection active;
+			if (!(m_mapActive.remove_NoLock(socket, &active))) {
+				lock.unlock();
+				if (!flagReusable) {
+					socket->close();
+				}
+				return;
+			}
+			endpoint = active.endpoint;
+			endpoint->nActive--;
+			if (flagReusable && !m_flagClosed && socket->isOpened()) {
+				if (endpoint->popWaiter(callback)) {
+					_addActiveConnection(socket, endpoint.get());
+				} else if (endpoint->idles.getCount() < m_param.maxIdleConnections) {
+					Endpoint::IdleConnection idle;
+					idle.socket = socket;
+					idle.tickIdle = System::getTickCount();
+					endpoint->idles.pushBack_NoLock(idle);
+					return;
+				} else {
+					flagReusable = sl_false;
+				}
+			} else {
+				flagReusable = sl_false;
+				flagConnect = !m_flagClosed && endpoint->isConnectionNeeded(m_param.maxActiveConnections);
+			}
+		}
+		if (flagReusable) {
+			Ref<AsyncIoLoop> loop = socket->getIoLoop();
+			if (loop.isNull() || !(loop->addTask([ref, callback]() { callback(ref.get()); }))) {
+				callback(socket);
+			}
+		} else {
+			socket->close();
+			if (flagConnect) {
+				_connect(endpoint.get(), sl_false);
+			}
+		}
+	}
+
+	void AsyncTcpConnectionPool::warmUp(const String& host, sl_uint16 port, sl_uint32 count)
+	{
+		Ref<Endpoint> endpoint = _getEndpoint(host, port, sl_true);
+		if (endpoint.isNull()) {
+			return;
+		}
+		sl_uint32 n = 0;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			if (count > m_param.maxIdleConnections) {
+				count = m_param.maxIdleConnections;
+			}
+			sl_uint32 nCurrent = (sl_uint32)(endpoint->idles.getCount() + endpoint->connectings.getCount());
+			if (count > nCurrent) {
+				n = count - nCurrent;
+			}
+		}
+		for (sl_uint32 i = 0; i < n; i++) {
+			_connect(endpoint.get(), sl_true);
+		}
+	}
+
+	AsyncTcpConnectionPoolStats AsyncTcpConnectionPool::getStats()
+	{
+		AsyncTcpConnectionPoolStats ret;
+		ObjectLocker lock(this);
+		for (auto& item : m_endpoints) {
+			Endpoint* endpoint = item.value.get();
+			AsyncTcpConnectionPoolStats& stats = endpoint->stats;
+			ret.hitCount += stats.hitCount;
+			ret.missCount += stats.missCount;
+			ret.timeoutCount += stats.timeoutCount;
+			ret.connectCount += stats.connectCount;
+			ret.connectFailureCount += stats.connectFailureCount;
+			ret.totalWaitTime += stats.totalWaitTime;
+			if (stats.maxWaitTime > ret.maxWaitTime) {
+				ret.maxWaitTime = stats.maxWaitTime;
+			}
+			ret.activeConnections += endpoint->nActive;
+			ret.idleConnections += (sl_uint32)(endpoint->idles.getCount());
+			ret.waiters += (sl_uint32)(endpoint->waiters.getCount());
+		}
+		return ret;
+	}
+
+	AsyncTcpConnectionPoolStats AsyncTcpConnectionPool::getStats(const String& host, sl_uint16 port)
+	{
+		Ref<Endpoint> endpoint = _getEndpoint(host, port, sl_false);
+		if (endpoint.isNotNull()) {
+			ObjectLocker lock(this);
+			AsyncTcpConnectionPoolStats ret = endpoint->stats;
+			ret.activeConnections = endpoint->nActive;
+			ret.idleConnections = (sl_uint32)(endpoint->idles.getCount());
+			ret.waiters = (sl_uint32)(endpoint->waiters.getCount());
+			return ret;
+		}
+		return AsyncTcpConnectionPoolStats();
+	}
+
+	Ref<AsyncTcpConnectionPool::Endpoint> AsyncTcpConnectionPool::_getEndpoint(const String& _host, sl_uint16 port, sl_bool flagCreate)
+	{
+		String host = _host.toLower();
+		if (host.isEmpty() || !port) {
+			return sl_null;
+		}
+		String key = host + ":" + String::fromUint32(port);
+		ObjectLocker lock(this);
+		Ref<Endpoint> endpoint;
+		if (m_endpoints.get_NoLock(key, &endpoint)) {
+			return endpoint;
+		}
+		if (!flagCreate) {
+			return sl_null;
+		}
+		endpoint = new Endpoint;
+		if (endpoint.isNotNull()) {
+			endpoint->host = host;
+			endpoint->port = port;
+			m_endpoints.put_NoLock(key, endpoint);
+		}
+		return endpoint;
+	}
+
+	void AsyncTcpConnectionPool::_connect(Endpoint* endpoint, sl_bool flagWarmUp)
+	{
+		WeakRef<AsyncTcpConnectionPool> weak = this;
+		Ref<Endpoint> refEndpoint = endpoint;
+		AsyncTcpSocketParam param;
+		param.ioLoop = _selectLoop();
+		param.dnsClient = m_param.dnsClient;
+		param.flagLogError = sl_false;
+		param.onConnect = [weak, refEndpoint, flagWarmUp](AsyncTcpSocket* socket, const SocketAddress&, sl_bool flagError) {
+			Ref<AsyncTcpConnectionPool> pool = weak;
+			if (pool.isNotNull()) {
+				pool->_onConnect(refEndpoint.get(), socket, flagError, flagWarmUp);
+			} else {
+				socket->close();
+			}
+		};
+		Ref<AsyncTcpSocket> socket = AsyncTcpSocket::create(param);
+		if (socket.isNull()) {
+			_onConnect(endpoint, sl_null, sl_true, flagWarmUp);
+			return;
+		}
+		{
+			ObjectLocker lock(this);
+			endpoint->connectings.add_NoLock(socket);
+		}
+		if (!(socket->connectHost(endpoint->host, endpoint->port))) {
+			_onConnect(endpoint, socket.get(), sl_true, flagWarmUp);
+			return;
+		}
+		if (m_param.connectTimeout) {
+			WeakRef<AsyncTcpSocket> weakSocket = socket;
+			Dispatch::setTimeout([weak, refEndpoint, weakSocket, flagWarmUp]() {
+				Ref<AsyncTcpConnectionPool> pool = weak;
+				Ref<AsyncTcpSocket> socket = weakSocket;
+				if (pool.isNotNull() && socket.isNotNull()) {
+					pool->_onConnect(refEndpoint.get(), socket.get(), sl_true, flagWarmUp);
+				}
+			}, m_param.connectTimeout);
+		}
+	}
+
+	void AsyncTcpConnectionPool::_onConnect(Endpoint* endpoint, AsyncTcpSocket* socket, sl_bool flagError, sl_bool flagWarmUp)
+	{
+		Ref<AsyncTcpSocket> ref = socket;
+		Function<void(AsyncTcpSocket*)> callback;
+		sl_bool flagReconnect = sl_false;
+		{
+			ObjectLocker lock(this);
+			if (socket) {
+				// finished by the connection or the timeout, not both
+				if (!(endpoint->connectings.remove_NoLock(ref))) {
+					return;
+				}
+			}
+			if (m_flagClosed) {
+				flagError = sl_true;
+			} else if (flagError) {
+				endpoint->stats.connectFailureCount++;
+				// fails the oldest waiter, instead of keeping it until the wait timeout
+				if (!flagWarmUp && endpoint->waiters.getCount() > endpoint->connectings.getCount()) {
+					if (!(endpoint->popWaiter(callback))) {
+						callback.setNull();
+					}
+				}
+			} else {
+				endpoint->stats.connectCount++;
+				if (endpoint->popWaiter(callback)) {
+					_addActiveConnection(socket, endpoint);
+				} else if (endpoint->idles.getCount() < m_param.maxIdleConnections) {
+					Endpoint::IdleConnection idle;
+					idle.socket = socket;
+					idle.tickIdle = System::getTickCount();
+					endpoint->idles.pushBack_NoLock(idle);
+					return;
+				} else {
+					flagError = sl_true;
+				}
+			}
+			if (flagError && !m_flagClosed) {
+				flagReconnect = endpoint->isConnectionNeeded(m_param.maxActiveConnections);
+			}
+		}
+		if (flagError) {
+			if (socket) {
+				socket->close();
+			}
+			if (callback.isNotNull()) {
+				callback(sl_null);
+			}
+			if (flagReconnect) {
+				_connect(endpoint, sl_false);
+			}
+		} else {
+			callback(socket);
+		}
+	}
+
+	void AsyncTcpConnectionPool::_addActiveConnection(AsyncTcpSocket* socket, Endpoint* endpoint)
+	{
+		ActiveConnection active;
+		active.socket = socket;
+		active.endpoint = endpoint;
+		m_mapActive.put_NoLock(socket, active);
+		endpoint->nActive++;
+	}
+
+	sl_bool AsyncTcpConnectionPool::_checkIdleConnection(AsyncTcpSocket* socket)
+	{
+		if (!(socket->isOpened())) {
+			return sl_false;
+		}
+		if (m_param.flagCheckOnCheckout) {
+			Ref<Socket> s = socket->getSocket();
+			if (s.isNull()) {
+				return sl_false;
+			}
+			// closed by the peer, or unread data left from the previous use
+			char c;
+			if (s->peek(&c, 1) != 0) {
+				return sl_false;
+			}
+		}
+		if (m_param.onCheckConnection.isNotNull()) {
+			return m_param.onCheckConnection(this, socket);
+		}
+		return sl_true;
+	}
+
+	void AsyncTcpConnectionPool::_onTimer()
+	{
+		List< Ref<AsyncTcpSocket> > sockets;
+		List< Function<void(AsyncTcpSocket*)> > callbacks;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			sl_uint32 tickNow = System::getTickCount();
+			for (auto& item : m_endpoints) {
+				Endpoint* endpoint = item.value.get();
+				if (m_param.idleTimeout) {
+					Endpoint::IdleConnection idle;
+					while (endpoint->idles.getFrontValue_NoLock(&idle)) {
+						if (tickNow - idle.tickIdle < m_param.idleTimeout) {
+							break;
+						}
+						endpoint->idles.popFront_NoLock();
+						sockets.add_NoLock(idle.socket);
+					}
+				}
+				if (m_param.waitTimeout) {
+					Endpoint::Waiter waiter;
+					while (endpoint->waiters.getFrontValue_NoLock(&waiter)) {
+						if (tickNow - waiter.tickStart < m_param.waitTimeout) {
+							break;
+						}
+						endpoint->waiters.popFront_NoLock();
+						endpoint->stats.timeoutCount++;
+						callbacks.add_NoLock(waiter.callback);
+					}
+				}
+			}
+		}
+		ListElements< Ref<AsyncTcpSocket> > listSockets(sockets);
+		for (sl_size i = 0; i < listSockets.count; i++) {
+			listSockets[i]->close();
+		}
+		ListElements< Function<void(AsyncTcpSocket*)> > listCallbacks(callbacks);
+		for (sl_size i = 0; i < listCallbacks.count; i++) {
+			listCallbacks[i](sl_null);
+		}
+	}
+
+	Ref<AsyncIoLoop> AsyncTcpConnectionPool::_selectLoop()
+	{
+		if (m_param.ioLoopGroup.isNotNull()) {
+			Ref<AsyncIoLoop> loop = m_param.ioLoopGroup->selectLoop();
+			if (loop.isNotNull()) {
+				return loop;
+			}
+		}
+		if (m_param.ioLoop.isNotNull()) {
+			return m_param.ioLoop;
+		}
+		return AsyncIoLoop::getDefault();
 	}
 
 }
@@ -34,6 +34,27 @@
 namespace slib
 {
 
+	class SLIB_EXPORT AsyncTcpSocketSendFileRequest : public AsyncStreamRequest
+	{
+		SLIB_DECLARE_OBJECT
+		
+	public:
+		Ref<File> file;
+		sl_uint64 offset;
+		sl_uint64 sizeFile;
+		sl_uint64 sizeSent;
+		Function<void(AsyncStream*, sl_uint64 sizeSent, sl_bool flagError)> callbackFile;
+		
+	public:
+		AsyncTcpSocketSendFileRequest(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& callback);
+		
+		~AsyncTcpSocketSendFileRequest();
+		
+	public:
+		sl_uint64 getWriteSize() override;
+		
+	};
+
 	class SLIB_EXPORT AsyncTcpSocketInstance : public AsyncStreamInstance
 	{
 	protected:
@@ -49,11 +70,15 @@ namespace slib
 	public:
 		sl_bool connect(const SocketAddress& address);
 		
+		virtual sl_bool setZeroCopyThreshold(sl_uint32 size);
+		
 	protected:
 		void _onReceive(AsyncStreamRequest* req, sl_uint32 size, sl_bool flagError);
 		
 		void _onSend(AsyncStreamRequest* req, sl_uint32 size, sl_bool flagError);
 		
+		void _onSendFile(AsyncTcpSocketSendFileRequest* req, sl_bool flagError);
+		
 		void _onConnect(sl_bool flagError);
 		
 	protected:
@@ -80,6 +105,8 @@ namespace slib
 		sl_bool isRunning();
 		
 		Ref<Socket> getSocket();
+		
+		void setNonBlockingAccept(sl_bool flag);
 			
 	protected:
 		void _onAccept(const Ref<Socket>& socketAccept, const SocketAddress& address);
@@ -90,6 +117,7 @@ namespace slib
 		AtomicRef<Socket> m_socket;
 		
 		sl_bool m_flagRunning;
+		sl_bool m_flagNonBlockingAccept;
 		
 	};
 
@@ -111,19 +139,27 @@ namespace slib
 		
 		sl_bool sendTo(const SocketAddress& address, const Memory& data);
 		
+		sl_bool sendToBatch(const SocketDatagram* datagrams, sl_uint32 count);
+		
+		sl_bool sendToSegmented(const SocketAddress& address, const Memory& data, sl_uint32 sizeSegment);
+		
 	protected:
 		void _onReceive(const SocketAddress& address, sl_uint32 size);
 		
+		void _onReceiveBatch(SocketDatagram* datagrams, sl_uint32 count);
+		
 	protected:
 		AtomicRef<Socket> m_socket;
 
 		sl_bool m_flagRunning;
 		Memory m_buffer;
+		sl_uint32 m_nBatchCount;
 		
 		struct SendRequest
 		{
 			SocketAddress addressTo;
 			Memory data;
+			sl_uint32 sizeSegment; // 0: not segmented
 		};
 		LinkedQueue<SendRequest> m_queueSendRequests;
 		
@@ -26,6 +26,24 @@
 
 #include "network_async.h"
 
+#if defined(SLIB_PLATFORM_IS_LINUX)
+#	include <sys/sendfile.h>
+#	include <sys/socket.h>
+#	include <netinet/in.h>
+#	include <linux/errqueue.h>
+#	include <errno.h>
+#	ifndef MSG_ZEROCOPY
+#		define MSG_ZEROCOPY 0x4000000
+#	endif
+#	ifndef SO_EE_ORIGIN_ZEROCOPY
+#		define SO_EE_ORIGIN_ZEROCOPY 5
+#	endif
+#endif
+
+#define SEND_FILE_CHUNK_SIZE 0x40000000
+#define UDP_SEND_BATCH_SIZE 64
+#define UDP_GRO_MAX_SEGMENTS 64
+
 namespace slib
 {
 
@@ -38,11 +56,29 @@ namespace slib
 		
 		sl_bool m_flagConnecting;
 		
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		sl_uint32 m_sizeZeroCopyThreshold;
+		sl_uint32 m_idZeroCopyNext;
+		
+		// write requests waiting for the kernel to release the data
+		struct ZeroCopyRequest
+		{
+			Ref<AsyncStreamRequest> request;
+			sl_uint32 size;
+			sl_uint32 idLast;
+		};
+		LinkedList<ZeroCopyRequest> m_listZeroCopyPending;
+#endif
+		
 	public:
 		_priv_Unix_AsyncTcpSocketInstance()
 		{
 			m_sizeWritten = 0;
 			m_flagConnecting = sl_false;
+#if defined(SLIB_PLATFORM_IS_LINUX)
+			m_sizeZeroCopyThreshold = 0;
+			m_idZeroCopyNext = 0;
+#endif
 		}
 		
 		~_priv_Unix_AsyncTcpSocketInstance()
@@ -72,9 +108,164 @@ namespace slib
 		
 		void close()
 		{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+			failZeroCopyPending();
+#endif
 			setHandle(SLIB_FILE_INVALID_HANDLE);
 			m_socket.setNull();
 		}
+
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		sl_bool sendFile(const Ref<File>& file, sl_uint64 offset, sl_uint64 size, const Function<void(AsyncStream*, sl_uint64, sl_bool)>& callback)
+		{
+			Ref<AsyncStreamRequest> request = new AsyncTcpSocketSendFileRequest(file, offset, size, callback);
+			if (request.isNotNull()) {
+				return addWriteRequest(request);
+			}
+			return sl_false;
+		}
+
+		sl_bool setZeroCopyThreshold(sl_uint32 size) override
+		{
+			Ref<Socket> socket = m_socket;
+			if (socket.isNull()) {
+				return sl_false;
+			}
+			if (size) {
+				if (!(socket->setOption_ZeroCopy(sl_true))) {
+					return sl_false;
+				}
+			}
+			m_sizeZeroCopyThreshold = size;
+			return sl_true;
+		}
+		
+		// returns the sent size, 0 if the socket would block, -1 on error
+		sl_int32 sendZeroCopy(Socket* socket, const void* data, sl_uint32 size)
+		{
+			ssize_t n = ::send((int)(socket->getHandle()), data, size, MSG_ZEROCOPY | MSG_NOSIGNAL);
+			if (n > 0) {
+				// every successful call is notified with an incremental id
+				m_idZeroCopyNext++;
+				return (sl_int32)n;
+			}
+			int err = errno;
+			if (err == EAGAIN || err == EWOULDBLOCK) {
+				return 0;
+			}
+			if (err == ENOBUFS) {
+				// exceeded the limit of the pinned pages: copies this part
+				return socket->send(data, size);
+			}
+			return -1;
+		}
+		
+		// keeps the completion order of the write requests while zero-copy writes are in flight
+		sl_bool deferSend(AsyncStreamRequest* request, sl_uint32 size, sl_bool flagZeroCopy)
+		{
+			if (!flagZeroCopy && m_listZeroCopyPending.isEmpty()) {
+				return sl_false;
+			}
+			ZeroCopyRequest item;
+			item.request = request;
+			item.size = size;
+			item.idLast = m_idZeroCopyNext - 1;
+			m_listZeroCopyPending.pushBack(item);
+			return sl_true;
+		}
+		
+		void completeZeroCopy(sl_uint32 idCompleted)
+		{
+			ZeroCopyRequest item;
+			while (m_listZeroCopyPending.getFrontValue(&item)) {
+				if ((sl_int32)(item.idLast - idCompleted) > 0) {
+					break;
+				}
+				m_listZeroCopyPending.popFront();
+				_onSend(item.request.get(), item.size, sl_false);
+			}
+		}
+		
+		// completes the write requests whose zero-copy notifications will not arrive anymore
+		void failZeroCopyPending()
+		{
+			ZeroCopyRequest item;
+			while (m_listZeroCopyPending.popFront(&item)) {
+				_onSend(item.request.get(), item.size, sl_true);
+			}
+		}
+		
+		// reads the completion notifications of the zero-copy writes from the error queue. returns true if any
+		sl_bool processErrorQueue()
+		{
+			Ref<Socket> socket = m_socket;
+			if (socket.isNull()) {
+				return sl_false;
+			}
+			int fd = (int)(socket->getHandle());
+			sl_bool flagNotified = sl_false;
+			for (;;) {
+				char control[128];
+				msghdr msg;
+				Base::zeroMemory(&msg, sizeof(msg));
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+				if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0) {
+					break;
+				}
+				for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+					if ((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)) {
+						sock_extended_err* ee = (sock_extended_err*)(CMSG_DATA(cm));
+						if (ee->ee_errno == 0 && ee->ee_origin == SO_EE_ORIGIN_ZEROCOPY) {
+							// notification covers the range [ee_info, ee_data]
+							completeZeroCopy(ee->ee_data);
+							flagNotified = sl_true;
+						}
+					}
+				}
+			}
+			return flagNotified;
+		}
+		
+		// returns false when the socket is not writable yet
+		sl_bool processSendFile(Socket* socket, AsyncTcpSocketSendFileRequest* request, sl_bool flagError)
+		{
+			Ref<File> file = request->file;
+			if (file.isNull() || !(file->isOpened())) {
+				_onSendFile(request, sl_true);
+				return sl_true;
+			}
+			int fdSocket = (int)(socket->getHandle());
+			int fdFile = (int)(file->getHandle());
+			while (request->sizeSent < request->sizeFile) {
+				sl_uint64 size = request->sizeFile - request->sizeSent;
+				if (size > SEND_FILE_CHUNK_SIZE) {
+					size = SEND_FILE_CHUNK_SIZE;
+				}
+				off_t offset = (off_t)(request->offset + request->sizeSent);
+				ssize_t n = ::sendfile(fdSocket, fdFile, &offset, (size_t)size);
+				if (n > 0) {
+					request->sizeSent += n;
+				} else if (n < 0) {
+					int err = errno;
+					if (err == EINTR) {
+						continue;
+					}
+					if ((err == EAGAIN || err == EWOULDBLOCK) && !flagError) {
+						return sl_false;
+					}
+					_onSendFile(request, sl_true);
+					return sl_true;
+				} else {
+					// file is truncated
+					_onSendFile(request, sl_true);
+					return sl_true;
+				}
+			}
+			_onSendFile(request, sl_false);
+			return sl_true;
+		}
+#endif
 		
 		void processRead(sl_bool flagError)
 		{
@@ -125,13 +316,12 @@ namespace slib
 			if (socket.isNull()) {
 				return;
 			}
-			Ref<AsyncStreamRequest> request = m_requestWriting;
-			m_requestWriting.setNull();
-			sl_size nQueue = getWriteRequestsCount();
-			if (Thread::isNotStoppingCurrent()) {
+			// keeps sending the queued requests until the socket would block
+			while (Thread::isNotStoppingCurrent()) {
+				Ref<AsyncStreamRequest> request = m_requestWriting;
+				m_requestWriting.setNull();
 				if (request.isNull()) {
-					if (nQueue > 0) {
-						nQueue--;
+					if (getWriteRequestsCount() > 0) {
 						popWriteRequest(request);
 						if (request.isNull()) {
 							return;
@@ -142,15 +332,47 @@ namespace slib
 						return;
 					}
 				}
+#if defined(SLIB_PLATFORM_IS_LINUX)
+				AsyncTcpSocketSendFileRequest* requestFile = CastInstance<AsyncTcpSocketSendFileRequest>(request.get());
+				if (requestFile) {
+					if (!(processSendFile(socket.get(), requestFile, flagError))) {
+						m_requestWriting = request;
+						return;
+					}
+					if (flagError) {
+						return;
+					}
+					continue;
+				}
+#endif
 				if (request->data && request->size) {
 					sl_uint32 size = request->size - m_sizeWritten;
+#if defined(SLIB_PLATFORM_IS_LINUX)
+					sl_bool flagZeroCopy = m_sizeZeroCopyThreshold && request->size >= m_sizeZeroCopyThreshold;
+					sl_int32 n;
+					if (flagZeroCopy) {
+						n = sendZeroCopy(socket.get(), (char*)(request->data) + m_sizeWritten, size);
+					} else {
+						n = socket->send((char*)(request->data) + m_sizeWritten, size);
+					}
+#else
 					sl_int32 n = socket->send((char*)(request->data) + m_sizeWritten, size);
+#endif
 					if (n > 0) {
 						m_sizeWritten += n;
 						if (m_sizeWritten >= request->size) {
+#if defined(SLIB_PLATFORM_IS_LINUX)
+							if (!flagError && deferSend(request.get(), request->size, flagZeroCopy)) {
+								continue;
+							}
+#endif
 							_onSend(request.get(), request->size, flagError);
+							if (flagError) {
+								return;
+							}
 						} else {
 							m_requestWriting = request;
+							return;
 						}
 					} else if (n < 0) {
 						_onSend(request.get(), m_sizeWritten, sl_true);
@@ -166,9 +388,29 @@ namespace slib
 				} else {
 					_onSend(request.get(), request->size, sl_false);
 				}
-				request.setNull();
 			}
 		}
+
+		void cancelRequests() override
+		{
+			// every call completes one request at least
+			while (m_requestReading.isNotNull() || getReadRequestsCount() > 0) {
+				if (m_socket.isNull()) {
+					break;
+				}
+				processRead(sl_true);
+			}
+			while (m_requestWriting.isNotNull() || getWriteRequestsCount() > 0) {
+				if (m_socket.isNull()) {
+					break;
+				}
+				processWrite(sl_true);
+			}
+#if defined(SLIB_PLATFORM_IS_LINUX)
+			failZeroCopyPending();
+#endif
+			AsyncTcpSocketInstance::cancelRequests();
+		}
 		
 		void onOrder()
 		{
@@ -194,6 +436,17 @@ namespace slib
 		
 		void onEvent(EventDesc* pev)
 		{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+			if (pev->flagError && m_sizeZeroCopyThreshold) {
+				// completions of the zero-copy writes are reported as the socket errors
+				if (processErrorQueue()) {
+					Ref<Socket> socket = m_socket;
+					if (socket.isNotNull() && !(socket->getOption_Error())) {
+						pev->flagError = sl_false;
+					}
+				}
+			}
+#endif
 			sl_bool flagProcessed = sl_false;
 			if (pev->flagIn) {
 				processRead(pev->flagError);
@@ -208,7 +461,15 @@ namespace slib
 						_onConnect(sl_false);
 					}
 				} else {
-					processWrite(pev->flagError);
+					sl_bool flagError = pev->flagError;
+					if (flagError && pev->flagIn) {
+						// the peer may shut down only its sending side (half-close), which does not fail the writing
+						Ref<Socket> socket = m_socket;
+						if (socket.isNotNull() && !(socket->getOption_Error())) {
+							flagError = sl_false;
+						}
+					}
+					processWrite(flagError);
 				}
 				flagProcessed = sl_true;
 			}
@@ -284,7 +545,13 @@ namespace slib
 			while (Thread::isNotStoppingCurrent()) {
 				Ref<Socket> socketAccept;
 				SocketAddress addr;
-				if (socket->accept(socketAccept, addr)) {
+				sl_bool flagAccepted;
+				if (m_flagNonBlockingAccept) {
+					flagAccepted = socket->acceptNonBlocking(socketAccept, addr);
+				} else {
+					flagAccepted = socket->accept(socketAccept, addr);
+				}
+				if (flagAccepted) {
 					_onAccept(socketAccept, addr);
 				} else {
 					SocketError err = socket->getLastError();
@@ -317,6 +584,7 @@ namespace slib
 	public:
 		_priv_Unix_AsyncUdpSocketInstance()
 		{
+			m_flagGro = sl_false;
 		}
 		
 		~_priv_Unix_AsyncUdpSocketInstance()
@@ -325,7 +593,7 @@ namespace slib
 		}
 		
 	public:
-		static Ref<_priv_Unix_AsyncUdpSocketInstance> create(const Ref<Socket>& socket, const Memory& buffer)
+		static Ref<_priv_Unix_AsyncUdpSocketInstance> create(const Ref<Socket>& socket, const Memory& buffer, sl_uint32 batchCount)
 		{
 			Ref<_priv_Unix_AsyncUdpSocketInstance> ret;
 			if (socket.isNotNull()) {
@@ -337,6 +605,14 @@ namespace slib
 							ret->m_socket = socket;
 							ret->setHandle(handle);
 							ret->m_buffer = buffer;
+							ret->m_flagGro = socket->getOption_UdpGro();
+							if (batchCount > 1) {
+								ret->m_datagrams = Array<SocketDatagram>::create(batchCount);
+								if (ret->m_datagrams.isNull()) {
+									return sl_null;
+								}
+								ret->m_nBatchCount = batchCount;
+							}
 							return ret;
 						}
 					}
@@ -360,6 +636,9 @@ namespace slib
 		
 		void onEvent(EventDesc* pev)
 		{
+			if (pev->flagOut) {
+				processSend();
+			}
 			if (pev->flagIn) {
 				processReceive();
 			}
@@ -374,16 +653,65 @@ namespace slib
 			if (!(socket->isOpened())) {
 				return;
 			}
+			SendRequest requests[UDP_SEND_BATCH_SIZE];
+			SocketDatagram datagrams[UDP_SEND_BATCH_SIZE];
 			while (Thread::isNotStoppingCurrent()) {
-				SendRequest request;
-				if (m_queueSendRequests.pop(&request)) {
-					socket->sendTo(request.addressTo, request.data.getData(), (sl_uint32)(request.data.getSize()));
-				} else {
+				sl_uint32 n = 0;
+				sl_bool flagSegmented = sl_false;
+				while (n < UDP_SEND_BATCH_SIZE && m_queueSendRequests.pop(requests + n)) {
+					datagrams[n].address = requests[n].addressTo;
+					datagrams[n].data = requests[n].data.getData();
+					datagrams[n].size = (sl_uint32)(requests[n].data.getSize());
+					if (requests[n].sizeSegment) {
+						flagSegmented = sl_true;
+						break;
+					}
+					n++;
+				}
+				sl_uint32 nSent = 0;
+				while (nSent < n) {
+					sl_int32 ret;
+					if (n - nSent == 1) {
+						ret = socket->sendTo(datagrams[nSent].address, datagrams[nSent].data, datagrams[nSent].size);
+						if (ret > 0) {
+							ret = 1;
+						}
+					} else {
+						ret = socket->sendToBatch(datagrams + nSent, n - nSent);
+					}
+					if (ret > 0) {
+						nSent += (sl_uint32)ret;
+					} else if (ret == 0) {
+						// would block: the remaining datagrams are sent on the next writable event
+						restoreSendRequests(requests + nSent, (flagSegmented ? n + 1 : n) - nSent);
+						return;
+					} else {
+						// drops the datagram causing the error, and continues with the next ones
+						nSent++;
+					}
+				}
+				if (flagSegmented) {
+					sl_int32 ret = socket->sendToSegmented(datagrams[n].address, datagrams[n].data, datagrams[n].size, requests[n].sizeSegment);
+					if (ret >= 0 && (sl_uint32)ret < datagrams[n].size) {
+						// would block: keeps the unsent segments
+						requests[n].data = requests[n].data.sub(ret);
+						restoreSendRequests(requests + n, 1);
+						return;
+					}
+				} else if (!n) {
 					break;
 				}
 			}
 		}
 		
+		void restoreSendRequests(SendRequest* requests, sl_uint32 count)
+		{
+			ObjectLocker lock(&m_queueSendRequests);
+			for (sl_uint32 i = count; i > 0; i--) {
+				m_queueSendRequests.pushFront_NoLock(requests[i - 1]);
+			}
+		}
+		
 		void processReceive()
 		{
 			Ref<Socket> socket = m_socket;
@@ -395,6 +723,63 @@ namespace slib
 			}
 			void* buf = m_buffer.getData();
 			sl_uint32 sizeBuf = (sl_uint32)(m_buffer.getSize());
+			sl_uint32 nBatch = m_nBatchCount;
+			if (nBatch > 1) {
+				SocketDatagram* datagrams = m_datagrams.getData();
+				sl_uint32 sizePacket = sizeBuf / nBatch;
+				while (Thread::isNotStoppingCurrent()) {
+					for (sl_uint32 i = 0; i < nBatch; i++) {
+						datagrams[i].data = (sl_uint8*)buf + i * sizePacket;
+						datagrams[i].size = sizePacket;
+					}
+					sl_int32 n = socket->receiveFromBatch(datagrams, nBatch);
+					if (n > 0) {
+						_onReceiveBatch(datagrams, n);
+					} else {
+						break;
+					}
+				}
+				return;
+			}
+			if (m_flagGro) {
+				SocketDatagram datagrams[UDP_GRO_MAX_SEGMENTS];
+				while (Thread::isNotStoppingCurrent()) {
+					SocketAddress addr;
+					sl_uint32 sizeSegment = 0;
+					sl_int32 n = socket->receiveFromSegmented(addr, buf, sizeBuf, sizeSegment);
+					if (n > 0) {
+						if (sizeSegment && sizeSegment < (sl_uint32)n) {
+							// splits the coalesced packet into the original datagrams
+							sl_uint32 nDatagrams = 0;
+							sl_uint32 offset = 0;
+							while (offset < (sl_uint32)n) {
+								sl_uint32 size = (sl_uint32)n - offset;
+								if (size > sizeSegment) {
+									size = sizeSegment;
+								}
+								SocketDatagram& datagram = datagrams[nDatagrams];
+								datagram.address = addr;
+								datagram.data = (sl_uint8*)buf + offset;
+								datagram.size = size;
+								offset += size;
+								nDatagrams++;
+								if (nDatagrams == UDP_GRO_MAX_SEGMENTS) {
+									_onReceiveBatch(datagrams, nDatagrams);
+									nDatagrams = 0;
+								}
+							}
+							if (nDatagrams) {
+								_onReceiveBatch(datagrams, nDatagrams);
+							}
+						} else {
+							_onReceive(addr, n);
+						}
+					} else {
+						break;
+					}
+				}
+				return;
+			}
 			while (Thread::isNotStoppingCurrent()) {
 				SocketAddress addr;
 				sl_int32 n = socket->receiveFrom(addr, buf, sizeBuf);
@@ -406,13 +791,17 @@ namespace slib
 			}
 		}
 
+	protected:
+		Array<SocketDatagram> m_datagrams;
+		sl_bool m_flagGro;
+
 	};
 
-	Ref<AsyncUdpSocketInstance> AsyncUdpSocket::_createInstance(const Ref<Socket>& socket, sl_uint32 packetSize)
+	Ref<AsyncUdpSocketInstance> AsyncUdpSocket::_createInstance(const Ref<Socket>& socket, sl_uint32 packetSize, sl_uint32 batchCount)
 	{
-		Memory buffer = Memory::create(packetSize);
+		Memory buffer = Memory::create((sl_size)packetSize * batchCount);
 		if (buffer.isNotNull()) {
-			return _priv_Unix_AsyncUdpSocketInstance::create(socket, buffer);
+			return _priv_Unix_AsyncUdpSocketInstance::create(socket, buffer, batchCount);
 		}
 		return sl_null;
 	}
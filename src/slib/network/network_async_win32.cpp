@@ -565,7 +565,7 @@ namespace slib
 			while (Thread::isNotStoppingCurrent()) {
 				SendRequest request;
 				if (m_queueSendRequests.pop(&request)) {
-					socket->sendTo(request.addressTo, request.data.getData(), (sl_uint32)(request.data.getSize()));
+					socket->sendToSegmented(request.addressTo, request.data.getData(), (sl_uint32)(request.data.getSize()), request.sizeSegment);
 				} else {
 					break;
 				}
@@ -613,7 +613,7 @@ namespace slib
 
 	};
 
-	Ref<AsyncUdpSocketInstance> AsyncUdpSocket::_createInstance(const Ref<Socket>& socket, sl_uint32 packetSize)
+	Ref<AsyncUdpSocketInstance> AsyncUdpSocket::_createInstance(const Ref<Socket>& socket, sl_uint32 packetSize, sl_uint32 batchCount)
 	{
 		Memory buffer = Memory::create(packetSize);
 		if (buffer.isNotNull()) {
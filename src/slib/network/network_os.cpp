@@ -373,6 +373,8 @@ namespace slib
 #include <netdb.h>
 #include <net/if.h>
 
+#include "slib/core/file.h"
+
 #endif
 
 namespace slib
@@ -470,4 +472,47 @@ namespace slib
 		return IPv6Address::zero();
 	}
 
+	List<IPAddress> Network::getDnsServers()
+	{
+		List<IPAddress> ret;
+#if defined(SLIB_PLATFORM_IS_WIN32)
+		ULONG size = 0;
+		if (GetNetworkParams(NULL, &size) == ERROR_BUFFER_OVERFLOW) {
+			FIXED_INFO* info = (FIXED_INFO*)(Base::createMemory(size));
+			if (info) {
+				if (GetNetworkParams(info, &size) == NO_ERROR) {
+					IP_ADDR_STRING* addr = &(info->DnsServerList);
+					while (addr) {
+						IPAddress ip;
+						if (ip.parse(String(addr->IpAddress.String))) {
+							ret.add_NoLock(ip);
+						}
+						addr = addr->Next;
+					}
+				}
+				Base::freeMemory(info);
+			}
+		}
+#elif defined(SLIB_PLATFORM_IS_UNIX)
+		String conf = File::readAllTextUTF8("/etc/resolv.conf", 0x10000);
+		ListElements<String> lines(conf.split("\n"));
+		for (sl_size i = 0; i < lines.count; i++) {
+			String line = lines[i].trim();
+			if (line.startsWith("nameserver")) {
+				String s = line.substring(10).trim();
+				// strips the zone index of the link-local address
+				sl_reg index = s.indexOf('%');
+				if (index >= 0) {
+					s = s.substring(0, index);
+				}
+				IPAddress ip;
+				if (ip.parse(s)) {
+					ret.add_NoLock(ip);
+				}
+			}
+		}
+#endif
+		return ret;
+	}
+
 }
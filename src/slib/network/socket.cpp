@@ -36,8 +36,10 @@
 #	include <sys/socket.h>
 #	if defined(SLIB_PLATFORM_IS_LINUX)
 #		include <linux/tcp.h>
+#		include <netinet/udp.h>
 #		include <linux/if.h>
 #		include <linux/if_packet.h>
+#		include <linux/filter.h>
 #		include <sys/ioctl.h>
 #	else
 #		include <netinet/tcp.h>
@@ -49,6 +51,24 @@ typedef int SOCKET;
 #	define SOCKET_ERROR -1
 #endif
 
+#if defined(SLIB_PLATFORM_IS_LINUX)
+#	ifndef SOL_UDP
+#		define SOL_UDP 17
+#	endif
+#	ifndef UDP_SEGMENT
+#		define UDP_SEGMENT 103
+#	endif
+#	ifndef UDP_GRO
+#		define UDP_GRO 104
+#	endif
+#	ifndef SO_ZEROCOPY
+#		define SO_ZEROCOPY 60
+#	endif
+#	ifndef SO_ATTACH_REUSEPORT_CBPF
+#		define SO_ATTACH_REUSEPORT_CBPF 51
+#	endif
+#endif
+
 namespace slib
 {
 
@@ -477,6 +497,48 @@ namespace slib
 		}
 	}
 
+	sl_bool Socket::acceptNonBlocking(Ref<Socket>& socketClient, SocketAddress& address)
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		if (isOpened()) {
+			if (!(isStream())) {
+				_setError(SocketError::AcceptIsNotSupported);
+				return sl_false;
+			}
+			sockaddr_storage addr;
+			Base::resetMemory(&addr, 0, sizeof(addr));
+			socklen_t len = sizeof(addr);
+			sl_socket client = (sl_socket)(::accept4((SOCKET)(m_socket), (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC));
+			if (client != SLIB_SOCKET_INVALID_HANDLE) {
+				address.setSystemSocketAddress(&addr);
+				Ref<Socket> socket = new Socket();
+				if (socket.isNotNull()) {
+					socket->m_type = m_type;
+					socket->m_socket = client;
+					socketClient = socket;
+				} else {
+					_priv_Socket_close(client);
+				}
+				return sl_true;
+			} else {
+				_checkError();
+				return sl_false;
+			}
+		} else {
+			_setClosedError();
+			return sl_false;
+		}
+#else
+		if (accept(socketClient, address)) {
+			if (socketClient.isNotNull()) {
+				socketClient->setNonBlockingMode(sl_true);
+			}
+			return sl_true;
+		}
+		return sl_false;
+#endif
+	}
+
 	sl_bool Socket::connect(const SocketAddress& address)
 	{
 		if (isOpened()) {
@@ -570,6 +632,35 @@ namespace slib
 		}
 	}
 
+	sl_int32 Socket::peek(void* buf, sl_uint32 size)
+	{
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			if (!(isStream())) {
+				_setError(SocketError::ReceiveIsNotSupported);
+				return -1;
+			}
+			sl_int32 ret = (sl_int32)(::recv((SOCKET)(m_socket), (char*)buf, size, MSG_PEEK));
+			if (ret >= 0) {
+				if (ret == 0) {
+					return -1;
+				}
+				return ret;
+			} else {
+				if (_checkError() == SocketError::WouldBlock) {
+					return 0;
+				} else {
+					return -1;
+				}
+			}
+		} else {
+			_setClosedError();
+			return -1;
+		}
+	}
+
 	sl_int32 Socket::sendTo(const SocketAddress& address, const void* buf, sl_uint32 size)
 	{
 		if (isOpened()) {
@@ -642,6 +733,294 @@ namespace slib
 		}
 	}
 
+#define SOCKET_BATCH_SIZE 64
+
+	sl_int32 Socket::sendToBatch(SocketDatagram* datagrams, sl_uint32 count)
+	{
+		if (!(isOpened())) {
+			_setClosedError();
+			return -1;
+		}
+		if (count == 0) {
+			return 0;
+		}
+		if (!(isDatagram() || isRaw())) {
+			_setError(SocketError::SendToIsNotSupported);
+			return -1;
+		}
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		sl_uint32 nSent = 0;
+		while (nSent < count) {
+			sl_uint32 n = count - nSent;
+			if (n > SOCKET_BATCH_SIZE) {
+				n = SOCKET_BATCH_SIZE;
+			}
+			sockaddr_storage addrs[SOCKET_BATCH_SIZE];
+			iovec iovs[SOCKET_BATCH_SIZE];
+			mmsghdr msgs[SOCKET_BATCH_SIZE];
+			Base::zeroMemory(msgs, sizeof(mmsghdr) * n);
+			for (sl_uint32 i = 0; i < n; i++) {
+				SocketDatagram& datagram = datagrams[nSent + i];
+				sl_uint32 sizeAddr = _priv_Socket_apply_address(m_type, addrs[i], datagram.address);
+				if (!sizeAddr) {
+					if (i) {
+						// sends the preceding datagrams, the invalid one is reported by the next call
+						n = i;
+						break;
+					}
+					_setError(SocketError::SendToInvalidAddress);
+					return nSent ? (sl_int32)nSent : -1;
+				}
+				iovs[i].iov_base = datagram.data;
+				iovs[i].iov_len = datagram.size;
+				msgs[i].msg_hdr.msg_name = addrs + i;
+				msgs[i].msg_hdr.msg_namelen = (socklen_t)sizeAddr;
+				msgs[i].msg_hdr.msg_iov = iovs + i;
+				msgs[i].msg_hdr.msg_iovlen = 1;
+			}
+			int ret = ::sendmmsg((SOCKET)(m_socket), msgs, n, 0);
+			if (ret > 0) {
+				nSent += ret;
+				if ((sl_uint32)ret < n) {
+					break;
+				}
+			} else {
+				if (nSent) {
+					break;
+				}
+				if (_checkError() == SocketError::WouldBlock) {
+					return 0;
+				} else {
+					return -1;
+				}
+			}
+		}
+		return (sl_int32)nSent;
+#else
+		for (sl_uint32 i = 0; i < count; i++) {
+			sl_int32 ret = sendTo(datagrams[i].address, datagrams[i].data, datagrams[i].size);
+			if (ret <= 0) {
+				if (i) {
+					return i;
+				}
+				return ret;
+			}
+		}
+		return count;
+#endif
+	}
+
+	sl_int32 Socket::receiveFromBatch(SocketDatagram* datagrams, sl_uint32 count)
+	{
+		if (!(isOpened())) {
+			_setClosedError();
+			return -1;
+		}
+		if (count == 0) {
+			return 0;
+		}
+		if (!(isDatagram() || isRaw())) {
+			_setError(SocketError::ReceiveFromIsNotSupported);
+			return -1;
+		}
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		if (count > SOCKET_BATCH_SIZE) {
+			count = SOCKET_BATCH_SIZE;
+		}
+		sockaddr_storage addrs[SOCKET_BATCH_SIZE];
+		iovec iovs[SOCKET_BATCH_SIZE];
+		mmsghdr msgs[SOCKET_BATCH_SIZE];
+		Base::zeroMemory(msgs, sizeof(mmsghdr) * count);
+		for (sl_uint32 i = 0; i < count; i++) {
+			iovs[i].iov_base = datagrams[i].data;
+			iovs[i].iov_len = datagrams[i].size;
+			msgs[i].msg_hdr.msg_name = addrs + i;
+			msgs[i].msg_hdr.msg_namelen = sizeof(sockaddr_storage);
+			msgs[i].msg_hdr.msg_iov = iovs + i;
+			msgs[i].msg_hdr.msg_iovlen = 1;
+		}
+		int ret = ::recvmmsg((SOCKET)(m_socket), msgs, count, MSG_DONTWAIT, sl_null);
+		if (ret > 0) {
+			for (int i = 0; i < ret; i++) {
+				datagrams[i].address.setSystemSocketAddress(addrs + i, msgs[i].msg_hdr.msg_namelen);
+				datagrams[i].size = msgs[i].msg_len;
+			}
+			return ret;
+		} else {
+			if (ret == 0 || _checkError() == SocketError::WouldBlock) {
+				return 0;
+			} else {
+				return -1;
+			}
+		}
+#else
+		sl_uint32 n = 0;
+		for (; n < count; n++) {
+			sl_int32 ret = receiveFrom(datagrams[n].address, datagrams[n].data, datagrams[n].size);
+			if (ret > 0) {
+				datagrams[n].size = ret;
+			} else {
+				if (n) {
+					break;
+				}
+				return ret;
+			}
+		}
+		return n;
+#endif
+	}
+
+#define SOCKET_SEGMENT_MAX_COUNT 64
+#define SOCKET_SEGMENT_MAX_TOTAL 65000
+
+	sl_int32 Socket::sendToSegmented(const SocketAddress& address, const void* _buf, sl_uint32 size, sl_uint32 sizeSegment)
+	{
+		if (!sizeSegment || sizeSegment >= size) {
+			return sendTo(address, _buf, size);
+		}
+		if (!(isOpened())) {
+			_setClosedError();
+			return -1;
+		}
+		if (!(isDatagram())) {
+			_setError(SocketError::SendToIsNotSupported);
+			return -1;
+		}
+		const sl_uint8* buf = (const sl_uint8*)_buf;
+		sl_uint32 nSent = 0;
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		sockaddr_storage addr;
+		sl_uint32 sizeAddr = _priv_Socket_apply_address(m_type, addr, address);
+		if (!sizeAddr) {
+			_setError(SocketError::SendToInvalidAddress);
+			return -1;
+		}
+		// the kernel limits the number of the segments and the size of a super-packet
+		sl_uint32 nSegmentsPerCall = SOCKET_SEGMENT_MAX_TOTAL / sizeSegment;
+		if (nSegmentsPerCall > SOCKET_SEGMENT_MAX_COUNT) {
+			nSegmentsPerCall = SOCKET_SEGMENT_MAX_COUNT;
+		}
+		if (nSegmentsPerCall >= 2) {
+			sl_uint32 sizePerCall = nSegmentsPerCall * sizeSegment;
+			while (nSent < size) {
+				sl_uint32 n = size - nSent;
+				if (n > sizePerCall) {
+					n = sizePerCall;
+				}
+				if (n <= sizeSegment) {
+					break;
+				}
+				iovec iov;
+				iov.iov_base = (void*)(buf + nSent);
+				iov.iov_len = n;
+				char control[CMSG_SPACE(sizeof(sl_uint16))];
+				Base::zeroMemory(control, sizeof(control));
+				msghdr msg;
+				Base::zeroMemory(&msg, sizeof(msg));
+				msg.msg_name = &addr;
+				msg.msg_namelen = (socklen_t)sizeAddr;
+				msg.msg_iov = &iov;
+				msg.msg_iovlen = 1;
+				msg.msg_control = control;
+				msg.msg_controllen = sizeof(control);
+				cmsghdr* cm = CMSG_FIRSTHDR(&msg);
+				cm->cmsg_level = SOL_UDP;
+				cm->cmsg_type = UDP_SEGMENT;
+				cm->cmsg_len = CMSG_LEN(sizeof(sl_uint16));
+				*((sl_uint16*)(CMSG_DATA(cm))) = (sl_uint16)sizeSegment;
+				ssize_t ret = ::sendmsg((SOCKET)(m_socket), &msg, 0);
+				if (ret > 0) {
+					nSent += (sl_uint32)ret;
+				} else {
+					int err = errno;
+					if (err == EAGAIN || err == EWOULDBLOCK) {
+						_checkError();
+						return nSent;
+					}
+					// not supported by the kernel or the device: sends the datagrams one by one
+					break;
+				}
+			}
+		}
+#endif
+		while (nSent < size) {
+			sl_uint32 n = size - nSent;
+			if (n > sizeSegment) {
+				n = sizeSegment;
+			}
+			sl_int32 ret = sendTo(address, buf + nSent, n);
+			if (ret <= 0) {
+				if (nSent) {
+					return nSent;
+				}
+				return ret;
+			}
+			nSent += n;
+		}
+		return nSent;
+	}
+
+	sl_int32 Socket::receiveFromSegmented(SocketAddress& address, void* buf, sl_uint32 size, sl_uint32& sizeSegment)
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		if (isOpened()) {
+			if (size == 0) {
+				return 0;
+			}
+			if (!(isDatagram())) {
+				_setError(SocketError::ReceiveFromIsNotSupported);
+				return -1;
+			}
+			sockaddr_storage addr;
+			Base::resetMemory(&addr, 0, sizeof(addr));
+			iovec iov;
+			iov.iov_base = buf;
+			iov.iov_len = size;
+			char control[CMSG_SPACE(sizeof(int))];
+			msghdr msg;
+			Base::zeroMemory(&msg, sizeof(msg));
+			msg.msg_name = &addr;
+			msg.msg_namelen = sizeof(addr);
+			msg.msg_iov = &iov;
+			msg.msg_iovlen = 1;
+			msg.msg_control = control;
+			msg.msg_controllen = sizeof(control);
+			sl_int32 ret = (sl_int32)(::recvmsg((SOCKET)(m_socket), &msg, 0));
+			if (ret > 0) {
+				address.setSystemSocketAddress(&addr);
+				sizeSegment = ret;
+				for (cmsghdr* cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+					if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+						int n = *((int*)(CMSG_DATA(cm)));
+						if (n > 0 && n < ret) {
+							sizeSegment = n;
+						}
+						break;
+					}
+				}
+				return ret;
+			} else if (ret == 0) {
+				return -1;
+			} else {
+				if (_checkError() == SocketError::WouldBlock) {
+					return 0;
+				} else {
+					return -1;
+				}
+			}
+		} else {
+			_setClosedError();
+			return -1;
+		}
+#else
+		sl_int32 ret = receiveFrom(address, buf, size);
+		if (ret > 0) {
+			sizeSegment = ret;
+		}
+		return ret;
+#endif
+	}
+
 	sl_int32 Socket::sendPacket(const void* buf, sl_uint32 size, const L2PacketInfo& info)
 	{
 #if defined(SLIB_PLATFORM_IS_LINUX)
@@ -1025,6 +1404,65 @@ namespace slib
 #endif
 	}
 
+	sl_bool Socket::setOption_UdpGro(sl_bool flagEnable)
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		return setOption(SOL_UDP, UDP_GRO, flagEnable ? 1 : 0);
+#else
+		return sl_false;
+#endif
+	}
+
+	sl_bool Socket::getOption_UdpGro() const
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		return getOption(SOL_UDP, UDP_GRO) != 0;
+#else
+		return sl_false;
+#endif
+	}
+
+	sl_bool Socket::setOption_ReusePortCpuSteering(sl_uint32 count)
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		if (!count) {
+			return sl_false;
+		}
+		sock_filter code[] = {
+			// A = current CPU
+			{ BPF_LD | BPF_W | BPF_ABS, 0, 0, (__u32)(SKF_AD_OFF + SKF_AD_CPU) },
+			// A = A % count
+			{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, count },
+			// returns the index of the socket
+			{ BPF_RET | BPF_A, 0, 0, 0 }
+		};
+		sock_fprog prog;
+		prog.len = sizeof(code) / sizeof(sock_filter);
+		prog.filter = code;
+		return setOption(SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &prog, sizeof(prog));
+#else
+		return sl_false;
+#endif
+	}
+
+	sl_bool Socket::setOption_ZeroCopy(sl_bool flagEnable)
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		return setOption(SOL_SOCKET, SO_ZEROCOPY, flagEnable ? 1 : 0);
+#else
+		return sl_false;
+#endif
+	}
+
+	sl_bool Socket::getOption_ZeroCopy() const
+	{
+#if defined(SLIB_PLATFORM_IS_LINUX)
+		return getOption(SOL_SOCKET, SO_ZEROCOPY) != 0;
+#else
+		return sl_false;
+#endif
+	}
+
 	sl_bool Socket::setOption_IpAddMembership(const IPv4Address& ipMulticast, const IPv4Address& ipInterface)
 	{
 		ip_mreq mreq;
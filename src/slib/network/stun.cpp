@@ -608,6 +608,7 @@ namespace slib
 		port = SLIB_NETWORK_STUN_PORT;
 		flagAutoStart = sl_true;
 		flagLogging = sl_false;
+		batchCount = 32;
 	}
 	
 	
@@ -634,31 +635,56 @@ namespace slib
 		if (ret.isNotNull()) {
 			
 			AsyncUdpSocketParam up;
-			up.onReceiveFrom = SLIB_FUNCTION_WEAKREF(StunServer, _onReceiveFrom, ret);
+			up.onReceiveBatch = SLIB_FUNCTION_WEAKREF(StunServer, _onReceiveBatch, ret);
 			up.packetSize = 4096;
+			up.batchCount = param.batchCount;
 			up.ioLoop = param.ioLoop;
 			up.flagAutoStart = sl_false;
 			
 			up.bindAddress.port = param.port;
-			Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
-			if (socket.isNull()) {
-				LogError(TAG_SERVER, "Failed to bind to port %d", param.port);
-				return sl_null;
-			}
 			
-			if (socket.isNotNull()) {
-				
-				ret->m_flagLogging = param.flagLogging;
-				
-				ret->m_udp = socket;
-				
-				ret->m_flagInit = sl_true;
-				if (param.flagAutoStart) {
-					ret->start();
+			List< Ref<AsyncUdpSocket> > sockets;
+			sl_uint32 nLoops = param.ioLoopGroup.isNotNull() ? param.ioLoopGroup->getCount() : 0;
+			if (nLoops > 1) {
+				up.flagReusePort = sl_true;
+				for (sl_uint32 i = 0; i < nLoops; i++) {
+					up.ioLoop = param.ioLoopGroup->getLoop(i);
+					Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
+					if (socket.isNull()) {
+						break;
+					}
+					sockets.add_NoLock(socket);
 				}
-				return ret;
-				
+				if (sockets.getCount() != nLoops) {
+					// SO_REUSEPORT is not supported: falls back to the single socket
+					for (sl_size i = 0; i < sockets.getCount(); i++) {
+						sockets.getValueAt(i)->close();
+					}
+					sockets.removeAll_NoLock();
+					up.flagReusePort = sl_false;
+					up.ioLoop = param.ioLoopGroup->getLoop(0);
+				}
+			} else if (nLoops == 1) {
+				up.ioLoop = param.ioLoopGroup->getLoop(0);
+			}
+			if (sockets.isEmpty()) {
+				Ref<AsyncUdpSocket> socket = AsyncUdpSocket::create(up);
+				if (socket.isNull()) {
+					LogError(TAG_SERVER, "Failed to bind to port %d", param.port);
+					return sl_null;
+				}
+				sockets.add_NoLock(socket);
+			}
+			
+			ret->m_flagLogging = param.flagLogging;
+			
+			ret->m_udps = sockets;
+			
+			ret->m_flagInit = sl_true;
+			if (param.flagAutoStart) {
+				ret->start();
 			}
+			return ret;
 			
 		}
 		return sl_null;
@@ -673,8 +699,9 @@ namespace slib
 		m_flagInit = sl_false;
 		
 		m_flagRunning = sl_false;
-		if (m_udp.isNotNull()) {
-			m_udp->close();
+		ListElements< Ref<AsyncUdpSocket> > sockets(m_udps);
+		for (sl_size i = 0; i < sockets.count; i++) {
+			sockets[i]->close();
 		}
 	}
 	
@@ -687,8 +714,9 @@ namespace slib
 		if (m_flagRunning) {
 			return;
 		}
-		if (m_udp.isNotNull()) {
-			m_udp->start();
+		ListElements< Ref<AsyncUdpSocket> > sockets(m_udps);
+		for (sl_size i = 0; i < sockets.count; i++) {
+			sockets[i]->start();
 		}
 		m_flagRunning = sl_true;
 	}
@@ -698,7 +726,35 @@ namespace slib
 		return m_flagRunning;
 	}
 	
-	void StunServer::_onReceiveFrom(AsyncUdpSocket* socket, const SocketAddress& addressFrom, void* data, sl_uint32 size)
+#define STUN_SEND_BATCH_SIZE 64
+	
+	void StunServer::_onReceiveBatch(AsyncUdpSocket* socket, SocketDatagram* datagrams, sl_uint32 count)
+	{
+		// responses of a received batch are sent together
+		Memory responses[STUN_SEND_BATCH_SIZE];
+		SocketDatagram datagramsResponse[STUN_SEND_BATCH_SIZE];
+		sl_uint32 nResponses = 0;
+		for (sl_uint32 i = 0; i < count; i++) {
+			Memory mem = _processBindingRequest(datagrams[i].address, datagrams[i].data, datagrams[i].size);
+			if (mem.isNotNull()) {
+				responses[nResponses] = mem;
+				SocketDatagram& datagram = datagramsResponse[nResponses];
+				datagram.address = datagrams[i].address;
+				datagram.data = mem.getData();
+				datagram.size = (sl_uint32)(mem.getSize());
+				nResponses++;
+				if (nResponses == STUN_SEND_BATCH_SIZE) {
+					socket->sendToBatch(datagramsResponse, nResponses);
+					nResponses = 0;
+				}
+			}
+		}
+		if (nResponses) {
+			socket->sendToBatch(datagramsResponse, nResponses);
+		}
+	}
+	
+	Memory StunServer::_processBindingRequest(const SocketAddress& addressFrom, void* data, sl_uint32 size)
 	{
 		StunPacket* packet = (StunPacket*)data;
 		StunAttributes attrs;
@@ -709,12 +765,10 @@ namespace slib
 				}
 				attrs.initialize();
 				attrs.xorMappedAddress = addressFrom;
-				Memory mem = StunPacket::buildPacket(StunMessageClass::Response, StunMethod::Binding, packet->getTransactionID(), attrs);
-				if (mem.isNotNull()) {
-					socket->sendTo(addressFrom, mem);
-				}
+				return StunPacket::buildPacket(StunMessageClass::Response, StunMethod::Binding, packet->getTransactionID(), attrs);
 			}
 		}
+		return sl_null;
 	}
 	
 }
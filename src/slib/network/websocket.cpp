@@ -0,0 +1,1008 @@
+/*
+ *   Copyright (c) 2008-2018 SLIBIO <https://github.com/SLIBIO>
+ *
+ *   Permission is hereby granted, free of charge, to any person obtaining a copy
+ *   of this software and associated documentation files (the "Software"), to deal
+ *   in the Software without restriction, including without limitation the rights
+ *   to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *   copies of the Software, and to permit persons to whom the Software is
+ *   furnished to do so, subject to the following conditions:
+ *
+ *   The above copyright notice and this permission notice shall be included in
+ *   all copies or substantial portions of the Software.
+ *
+ *   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *   IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *   FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *   AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *   LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *   OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ *   THE SOFTWARE.
+ */
+
+#include "slib/network/websocket.h"
+
+#include "slib/crypto/sha1.h"
+#include "slib/crypto/base64.h"
+#include "slib/core/mio.h"
+
+#if defined(SLIB_ARCH_IS_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#	define PRIV_WEBSOCKET_MASK_SSE2
+#	include <emmintrin.h>
+#elif defined(SLIB_ARCH_IS_ARM64) || defined(__ARM_NEON)
+#	define PRIV_WEBSOCKET_MASK_NEON
+#	include <arm_neon.h>
+#endif
+
+#define PRIV_WEBSOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+#define PRIV_WEBSOCKET_INFLATE_CHUNK_SIZE 65536
+#define PRIV_WEBSOCKET_PAYLOAD_CHUNK_SIZE 65536
+
+namespace slib
+{
+
+	String WebSocket::getAcceptKey(const String& key)
+	{
+		SLIB_STATIC_STRING(guid, PRIV_WEBSOCKET_GUID)
+		sl_uint8 hash[SHA1::HashSize];
+		SHA1::hash(key + guid, hash);
+		return Base64::encode(hash, SHA1::HashSize);
+	}
+
+	void WebSocket::mask(const void* _src, void* _dst, sl_size size, const sl_uint8* key, sl_uint64 offset)
+	{
+		const sl_uint8* src = (const sl_uint8*)_src;
+		sl_uint8* dst = (sl_uint8*)_dst;
+		// the key rotated to the position of `src`
+		sl_uint8 k[4];
+		sl_uint32 r = (sl_uint32)(offset & 3);
+		k[0] = key[r];
+		k[1] = key[(r + 1) & 3];
+		k[2] = key[(r + 2) & 3];
+		k[3] = key[(r + 3) & 3];
+		sl_uint32 k32;
+		Base::copyMemory(&k32, k, 4);
+		sl_size i = 0;
+#if defined(PRIV_WEBSOCKET_MASK_SSE2)
+		if (size >= 16) {
+			__m128i m = _mm_set1_epi32((int)k32);
+			for (; i + 64 <= size; i += 64) {
+				__m128i v0 = _mm_loadu_si128((const __m128i*)(src + i));
+				__m128i v1 = _mm_loadu_si128((const __m128i*)(src + i + 16));
+				__m128i v2 = _mm_loadu_si128((const __m128i*)(src + i + 32));
+				__m128i v3 = _mm_loadu_si128((const __m128i*)(src + i + 48));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(v0, m));
+				_mm_storeu_si128((__m128i*)(dst + i + 16), _mm_xor_si128(v1, m));
+				_mm_storeu_si128((__m128i*)(dst + i + 32), _mm_xor_si128(v2, m));
+				_mm_storeu_si128((__m128i*)(dst + i + 48), _mm_xor_si128(v3, m));
+			}
+			for (; i + 16 <= size; i += 16) {
+				__m128i v = _mm_loadu_si128((const __m128i*)(src + i));
+				_mm_storeu_si128((__m128i*)(dst + i), _mm_xor_si128(v, m));
+			}
+		}
+#elif defined(PRIV_WEBSOCKET_MASK_NEON)
+		if (size >= 16) {
+			uint8x16_t m = vreinterpretq_u8_u32(vdupq_n_u32(k32));
+			for (; i + 64 <= size; i += 64) {
+				uint8x16_t v0 = vld1q_u8(src + i);
+				uint8x16_t v1 = vld1q_u8(src + i + 16);
+				uint8x16_t v2 = vld1q_u8(src + i + 32);
+				uint8x16_t v3 = vld1q_u8(src + i + 48);
+				vst1q_u8(dst + i, veorq_u8(v0, m));
+				vst1q_u8(dst + i + 16, veorq_u8(v1, m));
+				vst1q_u8(dst + i + 32, veorq_u8(v2, m));
+				vst1q_u8(dst + i + 48, veorq_u8(v3, m));
+			}
+			for (; i + 16 <= size; i += 16) {
+				vst1q_u8(dst + i, veorq_u8(vld1q_u8(src + i), m));
+			}
+		}
+#else
+		// word by word, when `src` and `dst` can be aligned together
+		if (size >= 16 && !(((sl_size)src ^ (sl_size)dst) & 7)) {
+			for (; ((sl_size)(dst + i)) & 7; i++) {
+				dst[i] = src[i] ^ k[i & 3];
+			}
+			sl_uint8 km[8];
+			for (sl_uint32 j = 0; j < 8; j++) {
+				km[j] = k[(i + j) & 3];
+			}
+			// byte-wise loads and stores (without the type punning), which are combined into the word accesses by the compiler
+			sl_uint64 m = MIO::readUint64LE(km);
+			for (; i + 8 <= size; i += 8) {
+				MIO::writeUint64LE(dst + i, MIO::readUint64LE(src + i) ^ m);
+			}
+		}
+#endif
+		for (; i < size; i++) {
+			dst[i] = src[i] ^ k[i & 3];
+		}
+	}
+
+	void WebSocket::mask(void* data, sl_size size, const sl_uint8* key, sl_uint64 offset)
+	{
+		mask(data, data, size, key, offset);
+	}
+
+	Memory WebSocket::buildFrame(WebSocketOpcode opcode, const void* payload, sl_size size, sl_bool flagFinal, sl_bool flagCompressed)
+	{
+		sl_uint32 sizeHeader;
+		if (size < 126) {
+			sizeHeader = 2;
+		} else if (size < 0x10000) {
+			sizeHeader = 4;
+		} else {
+			sizeHeader = 10;
+		}
+		Memory ret = Memory::create(sizeHeader + size);
+		if (ret.isNull()) {
+			return sl_null;
+		}
+		sl_uint8* p = (sl_uint8*)(ret.getData());
+		p[0] = (sl_uint8)((flagFinal ? 0x80 : 0) | (flagCompressed ? 0x40 : 0) | (int)opcode);
+		if (size < 126) {
+			p[1] = (sl_uint8)size;
+		} else if (size < 0x10000) {
+			p[1] = 126;
+			MIO::writeUint16BE(p + 2, (sl_uint16)size);
+		} else {
+			p[1] = 127;
+			MIO::writeUint64BE(p + 2, size);
+		}
+		if (size) {
+			Base::copyMemory(p + sizeHeader, payload, size);
+		}
+		return ret;
+	}
+
+	Memory WebSocket::buildFrame(WebSocketOpcode opcode, const Memory& payload)
+	{
+		return buildFrame(opcode, payload.getData(), payload.getSize());
+	}
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(WebSocketMessage)
+
+	WebSocketMessage::WebSocketMessage()
+	{
+		flagText = sl_false;
+	}
+
+	String WebSocketMessage::getText() const
+	{
+		return String::fromUtf8(data.getData(), data.getSize());
+	}
+
+
+	SLIB_DEFINE_CLASS_DEFAULT_MEMBERS(WebSocketParam)
+
+	WebSocketParam::WebSocketParam()
+	{
+		flagUsePerMessageDeflate = sl_true;
+		compressionLevel = 6;
+		minimumCompressionSize = 128;
+		maxMessageSize = 16 * 1024 * 1024;
+		closeTimeout = 5000;
+	}
+
+
+	static sl_bool _priv_WebSocket_containsToken(const String& value, const String& token)
+	{
+		ListElements<String> items(value.split(","));
+		for (sl_size i = 0; i < items.count; i++) {
+			if (items[i].trim().equalsIgnoreCase(token)) {
+				return sl_true;
+			}
+		}
+		return sl_false;
+	}
+
+	// returns the accepted `permessage-deflate` offer for `Sec-WebSocket-Extensions` response, or null
+	static String _priv_WebSocket_negotiateDeflate(const String& extensions, sl_bool& flagServerNoContextTakeover)
+	{
+		SLIB_STATIC_STRING(s_deflate, "permessage-deflate")
+		SLIB_STATIC_STRING(s_serverNoContextTakeover, "server_no_context_takeover")
+		SLIB_STATIC_STRING(s_clientNoContextTakeover, "client_no_context_takeover")
+		SLIB_STATIC_STRING(s_serverMaxWindowBits, "server_max_window_bits")
+		SLIB_STATIC_STRING(s_clientMaxWindowBits, "client_max_window_bits")
+		ListElements<String> offers(extensions.split(","));
+		for (sl_size i = 0; i < offers.count; i++) {
+			ListElements<String> params(offers[i].split(";"));
+			if (!(params.count) || !(params[0].trim().equalsIgnoreCase(s_deflate))) {
+				continue;
+			}
+			sl_bool flagValid = sl_true;
+			sl_bool flagServerNoTakeover = sl_false;
+			sl_bool flagClientNoTakeover = sl_false;
+			for (sl_size k = 1; k < params.count; k++) {
+				String param = params[k].trim();
+				String name = param;
+				String value;
+				sl_reg index = param.indexOf('=');
+				if (index >= 0) {
+					name = param.substring(0, index).trim();
+					value = param.substring(index + 1).trim();
+					if (value.getLength() >= 2 && value.startsWith('"') && value.endsWith('"')) {
+						value = value.substring(1, value.getLength() - 1);
+					}
+				}
+				if (name.equalsIgnoreCase(s_serverNoContextTakeover)) {
+					flagServerNoTakeover = sl_true;
+				} else if (name.equalsIgnoreCase(s_clientNoContextTakeover)) {
+					flagClientNoTakeover = sl_true;
+				} else if (name.equalsIgnoreCase(s_serverMaxWindowBits)) {
+					// the deflater always uses the window of 15 bits
+					if (value.parseUint32() != 15) {
+						flagValid = sl_false;
+					}
+				} else if (name.equalsIgnoreCase(s_clientMaxWindowBits)) {
+					// the inflater accepts any window size, so the parameter is not answered
+				} else {
+					flagValid = sl_false;
+				}
+			}
+			if (flagValid) {
+				String ret = s_deflate;
+				if (flagServerNoTakeover) {
+					ret += "; server_no_context_takeover";
+				}
+				if (flagClientNoTakeover) {
+					ret += "; client_no_context_takeover";
+				}
+				flagServerNoContextTakeover = flagServerNoTakeover;
+				return ret;
+			}
+		}
+		return sl_null;
+	}
+
+	static sl_bool _priv_WebSocket_checkUtf8(const sl_uint8* s, sl_size n)
+	{
+		sl_size i = 0;
+		while (i < n) {
+			// skips ASCII by words
+			while (i + 8 <= n) {
+				sl_uint64 v;
+				Base::copyMemory(&v, s + i, 8);
+				if (v & SLIB_UINT64(0x8080808080808080)) {
+					break;
+				}
+				i += 8;
+			}
+			if (i >= n) {
+				break;
+			}
+			sl_uint8 c = s[i];
+			if (c < 0x80) {
+				i++;
+				continue;
+			}
+			sl_uint32 len;
+			sl_uint32 code;
+			sl_uint32 minCode;
+			if ((c & 0xE0) == 0xC0) {
+				len = 2;
+				code = c & 0x1F;
+				minCode = 0x80;
+			} else if ((c & 0xF0) == 0xE0) {
+				len = 3;
+				code = c & 0x0F;
+				minCode = 0x800;
+			} else if ((c & 0xF8) == 0xF0) {
+				len = 4;
+				code = c & 0x07;
+				minCode = 0x10000;
+			} else {
+				return sl_false;
+			}
+			if (i + len > n) {
+				return sl_false;
+			}
+			for (sl_uint32 k = 1; k < len; k++) {
+				sl_uint8 t = s[i + k];
+				if ((t & 0xC0) != 0x80) {
+					return sl_false;
+				}
+				code = (code << 6) | (t & 0x3F);
+			}
+			if (code < minCode || code > 0x10FFFF || (code >= 0xD800 && code <= 0xDFFF)) {
+				return sl_false;
+			}
+			i += len;
+		}
+		return sl_true;
+	}
+
+	static sl_bool _priv_WebSocket_isValidCloseCode(sl_uint32 code)
+	{
+		if (code >= 3000 && code <= 4999) {
+			return sl_true;
+		}
+		if (code >= 1000 && code <= 1011) {
+			return code != 1004 && code != 1005 && code != 1006;
+		}
+		return sl_false;
+	}
+
+
+	SLIB_DEFINE_OBJECT(WebSocketConnection, Object)
+
+	WebSocketConnection::WebSocketConnection()
+	{
+		m_flagStarted = sl_false;
+		m_flagOpenDispatched = sl_false;
+		m_flagCloseSent = sl_false;
+		m_flagCloseReceived = sl_false;
+		m_flagClosed = sl_false;
+		m_codeClose = WebSocketCloseCode::Abnormal;
+
+		m_flagDeflate = sl_false;
+		m_flagServerNoContextTakeover = sl_false;
+
+		m_sizeFrameHeader = 2;
+		m_sizeFrameHeaderReceived = 0;
+		m_opcodeFrame = WebSocketOpcode::Continuation;
+		m_flagFinalFrame = sl_false;
+		m_sizeFramePayload = 0;
+		m_sizeFramePayloadReceived = 0;
+		m_offsetPayloadFrame = 0;
+
+		m_flagMessageStarted = sl_false;
+		m_flagMessageText = sl_false;
+		m_flagMessageCompressed = sl_false;
+	}
+
+	WebSocketConnection::~WebSocketConnection()
+	{
+	}
+
+	Ref<WebSocketConnection> WebSocketConnection::_accept(HttpServerContext* context, const WebSocketParam& param)
+	{
+		SLIB_STATIC_STRING(s_websocket, "websocket")
+		SLIB_STATIC_STRING(s_upgrade, "Upgrade")
+		SLIB_STATIC_STRING(s_version, "13")
+		SLIB_STATIC_STRING(s_headerKey, "Sec-WebSocket-Key")
+		SLIB_STATIC_STRING(s_headerVersion, "Sec-WebSocket-Version")
+		SLIB_STATIC_STRING(s_headerAccept, "Sec-WebSocket-Accept")
+		SLIB_STATIC_STRING(s_headerExtensions, "Sec-WebSocket-Extensions")
+		if (!(context->isWebSocketRequest()) || context->m_http2Stream.isNotNull()) {
+			context->setResponseCode(HttpStatus::BadRequest);
+			return sl_null;
+		}
+		if (context->getRequestHeader(s_headerVersion).trim() != s_version) {
+			context->setResponseCode(HttpStatus::BadRequest);
+			context->setResponseHeader(s_headerVersion, s_version);
+			return sl_null;
+		}
+		String key = context->getRequestHeader(s_headerKey).trim();
+		if (Base64::decode(key).getSize() != 16) {
+			context->setResponseCode(HttpStatus::BadRequest);
+			return sl_null;
+		}
+		Ref<HttpServerConnection> connection = context->getConnection();
+		if (connection.isNull()) {
+			return sl_null;
+		}
+		Ref<WebSocketConnection> ret = new WebSocketConnection;
+		if (ret.isNull()) {
+			return sl_null;
+		}
+		ret->m_connection = connection;
+		ret->m_io = connection->getIO();
+		ret->m_output = connection->m_output;
+		ret->m_param = param;
+		String extensions;
+		if (param.flagUsePerMessageDeflate) {
+			extensions = _priv_WebSocket_negotiateDeflate(context->getRequestHeader(s_headerExtensions), ret->m_flagServerNoContextTakeover);
+			if (extensions.isNotNull()) {
+				if (!(ret->m_deflater.startRaw(param.compressionLevel)) || !(ret->m_inflater.startRaw())) {
+					return sl_null;
+				}
+				ret->m_flagDeflate = sl_true;
+			}
+		}
+		context->setResponseCode(HttpStatus::SwitchingProtocols);
+		context->setResponseHeader(HttpHeaders::Connection, s_upgrade);
+		context->setResponseHeader(s_upgrade, s_websocket);
+		context->setResponseHeader(s_headerAccept, WebSocket::getAcceptKey(key));
+		if (extensions.isNotNull()) {
+			context->setResponseHeader(s_headerExtensions, extensions);
+		}
+		context->m_webSocket = ret;
+		return ret;
+	}
+
+	Ref<HttpServerContext> WebSocketConnection::getContext()
+	{
+		return m_context;
+	}
+
+	Ref<HttpServerConnection> WebSocketConnection::getConnection()
+	{
+		return m_connection;
+	}
+
+	sl_bool WebSocketConnection::isOpened()
+	{
+		return m_flagStarted && !m_flagCloseSent && !m_flagClosed;
+	}
+
+	sl_bool WebSocketConnection::isPerMessageDeflate()
+	{
+		return m_flagDeflate;
+	}
+
+	sl_bool WebSocketConnection::sendText(const String& text)
+	{
+		return _sendMessage(WebSocketOpcode::Text, text.getData(), text.getLength());
+	}
+
+	sl_bool WebSocketConnection::sendBinary(const void* data, sl_size size)
+	{
+		return _sendMessage(WebSocketOpcode::Binary, data, size);
+	}
+
+	sl_bool WebSocketConnection::sendBinary(const Memory& data)
+	{
+		return _sendMessage(WebSocketOpcode::Binary, data.getData(), data.getSize());
+	}
+
+	sl_bool WebSocketConnection::sendFrame(const Memory& frame)
+	{
+		if (frame.isNull()) {
+			return sl_false;
+		}
+		sl_bool flagStarted;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed || m_flagCloseSent) {
+				return sl_false;
+			}
+			if (!(_sendFrame_NoLock(frame))) {
+				return sl_false;
+			}
+			flagStarted = m_flagStarted;
+		}
+		if (flagStarted) {
+			m_output->startWriting();
+		}
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::ping(const Memory& payload)
+	{
+		if (payload.getSize() > WebSocket::MaxControlPayloadSize) {
+			return sl_false;
+		}
+		return sendFrame(WebSocket::buildFrame(WebSocketOpcode::Ping, payload));
+	}
+
+	void WebSocketConnection::close(WebSocketCloseCode code, const String& reason)
+	{
+		sl_bool flagStarted;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed || m_flagCloseSent) {
+				return;
+			}
+			_sendClose_NoLock(code, reason);
+			flagStarted = m_flagStarted;
+		}
+		if (flagStarted) {
+			m_output->startWriting();
+		}
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNotNull()) {
+			connection->_setDeadline(m_param.closeTimeout);
+		}
+	}
+
+	sl_uint64 WebSocketConnection::getBufferedSize()
+	{
+		return m_output->getBufferedSize() + m_queueFramesPending.getSize();
+	}
+
+	sl_size WebSocketConnection::broadcastText(const List< Ref<WebSocketConnection> >& connections, const String& text)
+	{
+		return broadcastFrame(connections, WebSocket::buildFrame(WebSocketOpcode::Text, text.getData(), text.getLength()));
+	}
+
+	sl_size WebSocketConnection::broadcastBinary(const List< Ref<WebSocketConnection> >& connections, const Memory& data)
+	{
+		return broadcastFrame(connections, WebSocket::buildFrame(WebSocketOpcode::Binary, data));
+	}
+
+	sl_size WebSocketConnection::broadcastFrame(const List< Ref<WebSocketConnection> >& connections, const Memory& frame)
+	{
+		if (frame.isNull()) {
+			return 0;
+		}
+		sl_size n = 0;
+		ListLocker< Ref<WebSocketConnection> > items(connections);
+		for (sl_size i = 0; i < items.count; i++) {
+			WebSocketConnection* connection = items[i].get();
+			if (connection && connection->sendFrame(frame)) {
+				n++;
+			}
+		}
+		return n;
+	}
+
+	void WebSocketConnection::_start(HttpServerContext* context)
+	{
+		ObjectLocker lock(this);
+		m_context = context;
+		m_flagStarted = sl_true;
+		MemoryData frame;
+		while (m_queueFramesPending.pop_NoLock(frame)) {
+			if (!(m_output->write(frame.getMemory()))) {
+				break;
+			}
+		}
+		m_queueFramesPending.clear_NoLock();
+	}
+
+	void WebSocketConnection::_dispatchOpen()
+	{
+		{
+			ObjectLocker lock(this);
+			if (m_flagOpenDispatched || !m_flagStarted) {
+				return;
+			}
+			m_flagOpenDispatched = sl_true;
+		}
+		m_param.onOpen(this);
+	}
+
+	sl_bool WebSocketConnection::_sendMessage(WebSocketOpcode opcode, const void* data, sl_size size)
+	{
+		sl_bool flagStarted;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed || m_flagCloseSent) {
+				return sl_false;
+			}
+			Memory frame;
+			// the deflater is shared by the messages in order, so the message is compressed in the lock
+			if (m_flagDeflate && size >= m_param.minimumCompressionSize) {
+				Memory compressed = m_deflater.flush(data, size);
+				sl_size sizeCompressed = compressed.getSize();
+				// removes the tail of the sync flush (00 00 FF FF)
+				if (sizeCompressed < 4) {
+					return sl_false;
+				}
+				frame = WebSocket::buildFrame(opcode, compressed.getData(), sizeCompressed - 4, sl_true, sl_true);
+				if (m_flagServerNoContextTakeover) {
+					m_deflater.startRaw(m_param.compressionLevel);
+				}
+			} else {
+				frame = WebSocket::buildFrame(opcode, data, size);
+			}
+			if (frame.isNull()) {
+				return sl_false;
+			}
+			if (!(_sendFrame_NoLock(frame))) {
+				return sl_false;
+			}
+			flagStarted = m_flagStarted;
+		}
+		if (flagStarted) {
+			m_output->startWriting();
+		}
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_sendFrame_NoLock(const Memory& frame)
+	{
+		if (m_flagStarted) {
+			return m_output->write(frame);
+		} else {
+			return m_queueFramesPending.add_NoLock(frame);
+		}
+	}
+
+	void WebSocketConnection::_sendClose_NoLock(WebSocketCloseCode code, const String& reason)
+	{
+		sl_uint8 payload[WebSocket::MaxControlPayloadSize];
+		sl_size size = 0;
+		if (code != WebSocketCloseCode::NoStatus && code != WebSocketCloseCode::Abnormal) {
+			MIO::writeUint16BE(payload, (sl_uint16)code);
+			size = reason.getLength();
+			if (size > WebSocket::MaxControlPayloadSize - 2) {
+				size = WebSocket::MaxControlPayloadSize - 2;
+			}
+			Base::copyMemory(payload + 2, reason.getData(), size);
+			size += 2;
+		}
+		m_flagCloseSent = sl_true;
+		_sendFrame_NoLock(WebSocket::buildFrame(WebSocketOpcode::Close, payload, size));
+	}
+
+	void WebSocketConnection::_fail(WebSocketCloseCode code)
+	{
+		sl_bool flagStarted;
+		{
+			ObjectLocker lock(this);
+			m_flagCloseReceived = sl_true;
+			if (m_flagCloseSent) {
+				return;
+			}
+			m_codeClose = code;
+			_sendClose_NoLock(code, sl_null);
+			flagStarted = m_flagStarted;
+		}
+		if (flagStarted) {
+			m_output->startWriting();
+		}
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNotNull()) {
+			connection->_setDeadline(m_param.closeTimeout);
+		}
+	}
+
+	void WebSocketConnection::_onOutputEnd(sl_bool flagError)
+	{
+		Ref<HttpServerConnection> connection = m_connection;
+		if (connection.isNull()) {
+			return;
+		}
+		if (!flagError) {
+			ObjectLocker lock(this);
+			// the server closes the TCP connection after the closing handshake
+			if (!(m_flagCloseSent && m_flagCloseReceived)) {
+				return;
+			}
+		}
+		connection->close();
+	}
+
+	void WebSocketConnection::_onClosed()
+	{
+		WebSocketCloseCode code;
+		String reason;
+		{
+			ObjectLocker lock(this);
+			if (m_flagClosed) {
+				return;
+			}
+			m_flagClosed = sl_true;
+			m_queueFramesPending.clear_NoLock();
+			code = m_codeClose;
+			reason = m_reasonClose;
+		}
+		m_param.onClose(this, code, reason);
+	}
+
+	void WebSocketConnection::_processInput(const void* _data, sl_size size)
+	{
+		_dispatchOpen();
+		const sl_uint8* data = (const sl_uint8*)_data;
+		while (size) {
+			if (m_flagCloseReceived || m_flagClosed) {
+				// the input after the close frame is discarded
+				return;
+			}
+			if (m_sizeFrameHeaderReceived < m_sizeFrameHeader) {
+				sl_uint32 n = m_sizeFrameHeader - m_sizeFrameHeaderReceived;
+				if (n > size) {
+					n = (sl_uint32)size;
+				}
+				Base::copyMemory(m_frameHeader + m_sizeFrameHeaderReceived, data, n);
+				m_sizeFrameHeaderReceived += n;
+				data += n;
+				size -= n;
+				if (m_sizeFrameHeaderReceived == 2) {
+					// the size of the extended length and the masking key
+					sl_uint32 len = m_frameHeader[1] & 0x7F;
+					m_sizeFrameHeader = 2 + ((m_frameHeader[1] & 0x80) ? 4 : 0) + (len == 126 ? 2 : (len == 127 ? 8 : 0));
+				}
+				if (m_sizeFrameHeaderReceived < m_sizeFrameHeader) {
+					continue;
+				}
+				if (!(_processFrameHeader())) {
+					return;
+				}
+				if (m_sizeFramePayload) {
+					continue;
+				}
+			} else {
+				sl_uint64 n = m_sizeFramePayload - m_sizeFramePayloadReceived;
+				if (n > size) {
+					n = size;
+				}
+				if (!(_processFramePayload(data, (sl_size)n))) {
+					return;
+				}
+				m_sizeFramePayloadReceived += n;
+				data += n;
+				size -= (sl_size)n;
+				if (m_sizeFramePayloadReceived < m_sizeFramePayload) {
+					continue;
+				}
+			}
+			m_sizeFrameHeader = 2;
+			m_sizeFrameHeaderReceived = 0;
+			if (!(_processFrameEnd())) {
+				return;
+			}
+		}
+	}
+
+	sl_bool WebSocketConnection::_processFrameHeader()
+	{
+		sl_uint8* h = m_frameHeader;
+		sl_bool flagFinal = (h[0] & 0x80) != 0;
+		sl_bool flagRsv1 = (h[0] & 0x40) != 0;
+		sl_uint32 opcode = h[0] & 0x0F;
+		if (h[0] & 0x30) {
+			_fail(WebSocketCloseCode::ProtocolError);
+			return sl_false;
+		}
+		// the frames of the client are always masked
+		if (!(h[1] & 0x80)) {
+			_fail(WebSocketCloseCode::ProtocolError);
+			return sl_false;
+		}
+		sl_uint64 len = h[1] & 0x7F;
+		sl_uint8* p = h + 2;
+		if (len == 126) {
+			len = MIO::readUint16BE(p);
+			p += 2;
+		} else if (len == 127) {
+			len = MIO::readUint64BE(p);
+			p += 8;
+			if (len >> 63) {
+				_fail(WebSocketCloseCode::ProtocolError);
+				return sl_false;
+			}
+		}
+		Base::copyMemory(m_maskFrame, p, 4);
+		if (opcode & 0x08) {
+			// control frame
+			if (opcode > (sl_uint32)(WebSocketOpcode::Pong) || !flagFinal || flagRsv1 || len > WebSocket::MaxControlPayloadSize) {
+				_fail(WebSocketCloseCode::ProtocolError);
+				return sl_false;
+			}
+		} else {
+			if (opcode == (sl_uint32)(WebSocketOpcode::Continuation)) {
+				if (!m_flagMessageStarted || flagRsv1) {
+					_fail(WebSocketCloseCode::ProtocolError);
+					return sl_false;
+				}
+			} else if (opcode == (sl_uint32)(WebSocketOpcode::Text) || opcode == (sl_uint32)(WebSocketOpcode::Binary)) {
+				if (m_flagMessageStarted || (flagRsv1 && !m_flagDeflate)) {
+					_fail(WebSocketCloseCode::ProtocolError);
+					return sl_false;
+				}
+				m_flagMessageStarted = sl_true;
+				m_flagMessageText = opcode == (sl_uint32)(WebSocketOpcode::Text);
+				m_flagMessageCompressed = flagRsv1;
+			} else {
+				_fail(WebSocketCloseCode::ProtocolError);
+				return sl_false;
+			}
+			if (m_bufMessage.getSize() + len > m_param.maxMessageSize) {
+				_fail(WebSocketCloseCode::MessageTooBig);
+				return sl_false;
+			}
+		}
+		m_opcodeFrame = (WebSocketOpcode)opcode;
+		m_flagFinalFrame = flagFinal;
+		m_sizeFramePayload = len;
+		m_sizeFramePayloadReceived = 0;
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_processFramePayload(const sl_uint8* data, sl_size size)
+	{
+		// unmasks while copying from the read buffer
+		if (((sl_uint32)m_opcodeFrame) & 0x08) {
+			WebSocket::mask(data, m_payloadControl + m_sizeFramePayloadReceived, size, m_maskFrame, m_sizeFramePayloadReceived);
+			return sl_true;
+		}
+		// the payload is allocated by the chunks as it arrives, not by the length declared in the header
+		sl_uint64 offset = m_sizeFramePayloadReceived;
+		while (size) {
+			if (m_payloadFrame.isNull()) {
+				sl_uint64 sizeChunk = m_sizeFramePayload - offset;
+				if (sizeChunk > PRIV_WEBSOCKET_PAYLOAD_CHUNK_SIZE) {
+					sizeChunk = PRIV_WEBSOCKET_PAYLOAD_CHUNK_SIZE;
+				}
+				m_payloadFrame = Memory::create((sl_size)sizeChunk);
+				if (m_payloadFrame.isNull()) {
+					_fail(WebSocketCloseCode::MessageTooBig);
+					return sl_false;
+				}
+				m_offsetPayloadFrame = offset;
+			}
+			sl_size sizeChunk = m_payloadFrame.getSize();
+			sl_size pos = (sl_size)(offset - m_offsetPayloadFrame);
+			sl_size n = sizeChunk - pos;
+			if (n > size) {
+				n = size;
+			}
+			WebSocket::mask(data, (sl_uint8*)(m_payloadFrame.getData()) + pos, n, m_maskFrame, offset);
+			data += n;
+			size -= n;
+			offset += n;
+			if (pos + n == sizeChunk) {
+				// the chunks end at the end of the frame
+				m_bufMessage.add(m_payloadFrame);
+				m_payloadFrame.setNull();
+			}
+		}
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_processFrameEnd()
+	{
+		if (((sl_uint32)m_opcodeFrame) & 0x08) {
+			return _processControlFrame();
+		}
+		if (m_flagFinalFrame) {
+			return _processMessage();
+		}
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_processControlFrame()
+	{
+		sl_uint8* payload = m_payloadControl;
+		sl_uint32 size = (sl_uint32)m_sizeFramePayload;
+		if (m_opcodeFrame == WebSocketOpcode::Ping) {
+			sendFrame(WebSocket::buildFrame(WebSocketOpcode::Pong, payload, size));
+		} else if (m_opcodeFrame == WebSocketOpcode::Close) {
+			WebSocketCloseCode code = WebSocketCloseCode::NoStatus;
+			String reason;
+			if (size) {
+				if (size < 2) {
+					_fail(WebSocketCloseCode::ProtocolError);
+					return sl_false;
+				}
+				sl_uint32 n = MIO::readUint16BE(payload);
+				if (!(_priv_WebSocket_isValidCloseCode(n))) {
+					_fail(WebSocketCloseCode::ProtocolError);
+					return sl_false;
+				}
+				if (!(_priv_WebSocket_checkUtf8(payload + 2, size - 2))) {
+					_fail(WebSocketCloseCode::InvalidPayload);
+					return sl_false;
+				}
+				code = (WebSocketCloseCode)n;
+				reason = String::fromUtf8(payload + 2, size - 2);
+			}
+			sl_bool flagStarted;
+			sl_bool flagCloseSent;
+			{
+				ObjectLocker lock(this);
+				m_flagCloseReceived = sl_true;
+				m_codeClose = code;
+				m_reasonClose = reason;
+				flagCloseSent = m_flagCloseSent;
+				if (!flagCloseSent) {
+					// echoes the code
+					_sendClose_NoLock(code, sl_null);
+				}
+				flagStarted = m_flagStarted;
+			}
+			if (flagStarted) {
+				if (flagCloseSent && !(m_output->getBufferedSize())) {
+					// our close frame is already written, so there is no output end to wait for
+					Ref<HttpServerConnection> connection = m_connection;
+					if (connection.isNotNull()) {
+						connection->close();
+					}
+				} else {
+					// the TCP connection is closed when the output is written
+					m_output->startWriting();
+				}
+			}
+			return sl_false;
+		}
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_processMessage()
+	{
+		WebSocketMessage message;
+		message.flagText = m_flagMessageText;
+		message.data = m_bufMessage.merge();
+		m_bufMessage.clear();
+		m_flagMessageStarted = sl_false;
+		if (m_flagMessageCompressed) {
+			Memory input = message.data;
+			if (!(_inflate(input, message.data))) {
+				return sl_false;
+			}
+		}
+		if (message.flagText) {
+			if (!(_priv_WebSocket_checkUtf8((sl_uint8*)(message.data.getData()), message.data.getSize()))) {
+				_fail(WebSocketCloseCode::InvalidPayload);
+				return sl_false;
+			}
+		}
+		m_param.onMessage(this, message);
+		return sl_true;
+	}
+
+	sl_bool WebSocketConnection::_inflate(const Memory& input, Memory& output)
+	{
+		static const sl_uint8 tail[4] = {0x00, 0x00, 0xFF, 0xFF};
+		if (!(m_inflater.isStarted())) {
+			// the previous message ended with a final block
+			if (!(m_inflater.startRaw())) {
+				_fail(WebSocketCloseCode::InternalError);
+				return sl_false;
+			}
+		}
+		Memory memChunk = Memory::create(PRIV_WEBSOCKET_INFLATE_CHUNK_SIZE);
+		if (memChunk.isNull()) {
+			_fail(WebSocketCloseCode::InternalError);
+			return sl_false;
+		}
+		sl_uint8* chunk = (sl_uint8*)(memChunk.getData());
+		MemoryBuffer buffer;
+		sl_uint64 sizeOutput = 0;
+		// the compressed payload, and the tail of the sync flush removed by the sender
+		const sl_uint8* inputs[2] = {(const sl_uint8*)(input.getData()), tail};
+		sl_size sizes[2] = {input.getSize(), 4};
+		for (sl_uint32 k = 0; k < 2; k++) {
+			const sl_uint8* data = inputs[k];
+			sl_size size = sizes[k];
+			for (;;) {
+				sl_uint32 sizeInput = (sl_uint32)(SLIB_MIN(size, 0x40000000));
+				sl_uint32 sizeInputPassed = 0, sizeOutputUsed = 0;
+				sl_int32 iRet = m_inflater.decompress(data, sizeInput, sizeInputPassed, chunk, PRIV_WEBSOCKET_INFLATE_CHUNK_SIZE, sizeOutputUsed);
+				if (iRet < 0) {
+					_fail(WebSocketCloseCode::InvalidPayload);
+					return sl_false;
+				}
+				if (sizeOutputUsed) {
+					sizeOutput += sizeOutputUsed;
+					if (sizeOutput > m_param.maxMessageSize) {
+						_fail(WebSocketCloseCode::MessageTooBig);
+						return sl_false;
+					}
+					if (!(buffer.add(Memory::create(chunk, sizeOutputUsed)))) {
+						_fail(WebSocketCloseCode::InternalError);
+						return sl_false;
+					}
+				}
+				data += sizeInputPassed;
+				size -= sizeInputPassed;
+				if (!iRet) {
+					// final block, the rest is ignored
+					k = 2;
+					break;
+				}
+				if (!size && sizeOutputUsed < PRIV_WEBSOCKET_INFLATE_CHUNK_SIZE) {
+					break;
+				}
+			}
+		}
+		output = buffer.merge();
+		return sl_true;
+	}
+
+
+	sl_bool HttpServerContext::isWebSocketRequest()
+	{
+		SLIB_STATIC_STRING(s_websocket, "websocket")
+		SLIB_STATIC_STRING(s_upgrade, "upgrade")
+		SLIB_STATIC_STRING(s_headerUpgrade, "Upgrade")
+		if (getMethod() != HttpMethod::GET) {
+			return sl_false;
+		}
+		if (!(_priv_WebSocket_containsToken(getRequestHeader(s_headerUpgrade), s_websocket))) {
+			return sl_false;
+		}
+		return _priv_WebSocket_containsToken(getRequestHeader(HttpHeaders::Connection), s_upgrade);
+	}
+
+	Ref<WebSocketConnection> HttpServerContext::acceptWebSocket(const WebSocketParam& param)
+	{
+		return WebSocketConnection::_accept(this, param);
+	}
+
+}
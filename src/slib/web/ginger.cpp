@@ -20,23 +20,1052 @@
  *   THE SOFTWARE.
  */
 
-#define SLIB_SUPPORT_STD_TYPES
-
 #include "slib/web/ginger.h"
 
-#include "ginger/ginger.h"
+#include "slib/core/async.h"
+#include "slib/core/file.h"
+#include "slib/core/hash_map.h"
+#include "slib/core/linked_list.h"
+#include "slib/core/mutex.h"
+#include "slib/core/log.h"
+#include "slib/core/safe_static.h"
+#include "slib/core/system.h"
+
+#define TAG "Ginger"
+
+#define PRIV_GINGER_MAX_INCLUDE_DEPTH 16
+#define PRIV_GINGER_MAX_CACHED_TEMPLATES 1024
+// milliseconds, the cached file is checked by `stat` at most once in this time
+#define PRIV_GINGER_REVALIDATE_INTERVAL 1000
+#define PRIV_GINGER_WRITE_BUFFER_SIZE 4096
+// the longer text is added to the output without being copied
+#define PRIV_GINGER_COPY_TEXT_LIMIT 256
 
 namespace slib
 {
 	
+	class _priv_GingerRenderer;
+	
+	class _priv_GingerNode : public Referable
+	{
+	public:
+		virtual sl_bool render(_priv_GingerRenderer& renderer) = 0;
+		
+	};
+	
+	typedef List< Ref<_priv_GingerNode> > _priv_GingerBlock;
+	
+	class _priv_GingerMember
+	{
+	public:
+		String name;
+		sl_bool flagIndex;
+		sl_uint64 index;
+		
+	};
+	
+	// `name.member.member`
+	class _priv_GingerVariable
+	{
+	public:
+		String name;
+		List<_priv_GingerMember> members;
+		
+	};
+	
+	// loop variable, linked on the stack of the renderer
+	class _priv_GingerLocal
+	{
+	public:
+		const String* name;
+		Json value;
+		_priv_GingerLocal* parent;
+		
+	};
+	
+	class _priv_GingerRenderer
+	{
+	public:
+		StringBuffer* output;
+		const String* source;
+		Json data;
+		JsonMap mapData;
+		_priv_GingerLocal* locals;
+		sl_uint32 depthInclude;
+		String error;
+		
+		// the short pieces are collected here, instead of adding them to `output` one by one
+		sl_char8 buf[PRIV_GINGER_WRITE_BUFFER_SIZE];
+		sl_size sizeBuf;
+		
+	public:
+		_priv_GingerRenderer(StringBuffer* _output, const Json& _data)
+		{
+			output = _output;
+			source = sl_null;
+			data = _data;
+			mapData = _data.getJsonMap();
+			locals = sl_null;
+			depthInclude = 0;
+			sizeBuf = 0;
+		}
+		
+	public:
+		void flush()
+		{
+			if (sizeBuf) {
+				output->add(String(buf, sizeBuf));
+				sizeBuf = 0;
+			}
+		}
+		
+		void write(const sl_char8* text, sl_size length)
+		{
+			if (sizeBuf + length > PRIV_GINGER_WRITE_BUFFER_SIZE) {
+				flush();
+			}
+			Base::copyMemory(buf + sizeBuf, text, length);
+			sizeBuf += length;
+		}
+		
+		// the static text of the template being rendered
+		void addText(const sl_char8* text, sl_size length)
+		{
+			if (length < PRIV_GINGER_COPY_TEXT_LIMIT) {
+				write(text, length);
+			} else {
+				flush();
+				StringData data;
+				data.sz8 = text;
+				data.len = length;
+				data.str8 = *source;
+				output->add(data);
+			}
+		}
+		
+		void addString(const String& str)
+		{
+			sl_size length = str.getLength();
+			if (length < PRIV_GINGER_COPY_TEXT_LIMIT) {
+				write(str.getData(), length);
+			} else {
+				flush();
+				output->add(str);
+			}
+		}
+		
+		sl_bool renderBlock(const _priv_GingerBlock& block)
+		{
+			ListElements< Ref<_priv_GingerNode> > nodes(block);
+			for (sl_size i = 0; i < nodes.count; i++) {
+				if (!(nodes[i]->render(*this))) {
+					return sl_false;
+				}
+			}
+			return sl_true;
+		}
+		
+		sl_bool renderTemplate(GingerTemplate* t)
+		{
+			const String* sourceOld = source;
+			source = &(t->m_source);
+			sl_bool bRet = renderBlock(t->m_nodes);
+			source = sourceOld;
+			return bRet;
+		}
+		
+		sl_bool getVariable(const _priv_GingerVariable& var, Json& _out)
+		{
+			_priv_GingerLocal* local = locals;
+			while (local) {
+				if (*(local->name) == var.name) {
+					_out = local->value;
+					break;
+				}
+				local = local->parent;
+			}
+			if (!local) {
+				if (mapData.isNotNull()) {
+					if (!(mapData.get_NoLock(var.name, &_out))) {
+						error = "Variable \"" + var.name + "\" is not found";
+						return sl_false;
+					}
+				} else {
+					_out = data.getItem(var.name);
+					if (_out.isNull()) {
+						error = "Variable \"" + var.name + "\" is not found";
+						return sl_false;
+					}
+				}
+			}
+			ListElements<_priv_GingerMember> members(var.members);
+			for (sl_size i = 0; i < members.count; i++) {
+				_priv_GingerMember& member = members[i];
+				if (member.flagIndex && !(_out.isJsonMap())) {
+					_out = _out.getElement((sl_size)(member.index));
+				} else {
+					_out = _out.getItem(member.name);
+				}
+			}
+			return sl_true;
+		}
+		
+	};
+	
+	static String _priv_Ginger_toString(const Json& value)
+	{
+		if (value.isNull()) {
+			SLIB_STATIC_STRING(s, "null")
+			return s;
+		}
+		if (value.isString()) {
+			return value.getString();
+		}
+		if (value.isBoolean()) {
+			// same as `std::ostream << bool`
+			if (value.getBoolean()) {
+				SLIB_STATIC_STRING(s, "1")
+				return s;
+			} else {
+				SLIB_STATIC_STRING(s, "0")
+				return s;
+			}
+		}
+		if (value.isInteger()) {
+			return String::fromInt64(value.getInt64());
+		}
+		if (value.isNumber()) {
+			return String::fromDouble(value.getDouble());
+		}
+		return value.toJsonString();
+	}
+	
+	static sl_bool _priv_Ginger_isTrue(const Json& value)
+	{
+		if (value.isNull()) {
+			return sl_false;
+		}
+		if (value.isBoolean()) {
+			return value.getBoolean();
+		}
+		if (value.isInteger()) {
+			return value.getInt64() != 0;
+		}
+		if (value.isNumber()) {
+			return value.getDouble() != 0;
+		}
+		if (value.isString()) {
+			return value.getString().isNotEmpty();
+		}
+		if (value.isJsonMap()) {
+			return value.getJsonMap().getCount() > 0;
+		}
+		return value.getElementsCount() > 0;
+	}
+	
+	class _priv_GingerTextNode : public _priv_GingerNode
+	{
+	public:
+		const sl_char8* text;
+		sl_size length;
+		
+	public:
+		sl_bool render(_priv_GingerRenderer& renderer) override
+		{
+			renderer.addText(text, length);
+			return sl_true;
+		}
+		
+	};
+	
+	class _priv_GingerVariableNode : public _priv_GingerNode
+	{
+	public:
+		_priv_GingerVariable variable;
+		
+	public:
+		sl_bool render(_priv_GingerRenderer& renderer) override
+		{
+			Json value;
+			if (renderer.getVariable(variable, value)) {
+				renderer.addString(_priv_Ginger_toString(value));
+				return sl_true;
+			}
+			return sl_false;
+		}
+		
+	};
+	
+	class _priv_GingerForNode : public _priv_GingerNode
+	{
+	public:
+		String name;
+		_priv_GingerVariable list;
+		_priv_GingerBlock block;
+		
+	public:
+		sl_bool render(_priv_GingerRenderer& renderer) override
+		{
+			Json value;
+			if (!(renderer.getVariable(list, value))) {
+				return sl_false;
+			}
+			if (value.isNull()) {
+				return sl_true;
+			}
+			if (value.isJsonMap() || value.isString()) {
+				renderer.error = "Variable \"" + list.name + "\" is not a list";
+				return sl_false;
+			}
+			_priv_GingerLocal local;
+			local.name = &name;
+			local.parent = renderer.locals;
+			renderer.locals = &local;
+			sl_bool bRet = sl_true;
+			JsonList list = value.getJsonList();
+			if (list.isNotNull()) {
+				ListElements<Json> items(list);
+				for (sl_size i = 0; i < items.count; i++) {
+					local.value = items[i];
+					if (!(renderer.renderBlock(block))) {
+						bRet = sl_false;
+						break;
+					}
+				}
+			} else {
+				sl_size n = value.getElementsCount();
+				for (sl_size i = 0; i < n; i++) {
+					local.value = value.getElement(i);
+					if (!(renderer.renderBlock(block))) {
+						bRet = sl_false;
+						break;
+					}
+				}
+			}
+			renderer.locals = local.parent;
+			return bRet;
+		}
+		
+	};
+	
+	class _priv_GingerCondition
+	{
+	public:
+		_priv_GingerVariable variable;
+		sl_bool flagCompare;
+		String value;
+		_priv_GingerBlock block;
+		
+	};
+	
+	class _priv_GingerIfNode : public _priv_GingerNode
+	{
+	public:
+		// the last one is `$else` when its variable name is empty
+		List<_priv_GingerCondition> conditions;
+		
+	public:
+		sl_bool render(_priv_GingerRenderer& renderer) override
+		{
+			ListElements<_priv_GingerCondition> items(conditions);
+			for (sl_size i = 0; i < items.count; i++) {
+				_priv_GingerCondition& item = items[i];
+				if (item.variable.name.isNotEmpty()) {
+					Json value;
+					if (!(renderer.getVariable(item.variable, value))) {
+						return sl_false;
+					}
+					sl_bool flagTrue;
+					if (item.flagCompare) {
+						if (item.value == "true") {
+							flagTrue = _priv_Ginger_isTrue(value);
+						} else if (item.value == "false") {
+							flagTrue = !(_priv_Ginger_isTrue(value));
+						} else {
+							flagTrue = _priv_Ginger_toString(value) == item.value;
+						}
+					} else {
+						flagTrue = _priv_Ginger_isTrue(value);
+					}
+					if (!flagTrue) {
+						continue;
+					}
+				}
+				return renderer.renderBlock(item.block);
+			}
+			return sl_true;
+		}
+		
+	};
+	
+	class _priv_GingerFile : public Referable
+	{
+	public:
+		Time timeModified;
+		sl_uint64 size;
+		sl_uint32 timeValidated; // tick count of the last `stat`
+		String source;
+		Ref<GingerTemplate> compiled;
+		
+	};
+	
+	// evicts by CLOCK (second chance) when full: the entries accessed since the last sweep are moved to the back once
+	template <class T>
+	class _priv_GingerCacheMap
+	{
+	public:
+		struct Item
+		{
+			T value;
+			sl_bool flagAccessed;
+			Link<String>* link;
+		};
+		
+		HashMap<String, Item> map;
+		LinkedList<String> clock;
+		
+	public:
+		sl_bool get_NoLock(const String& key, T* _out)
+		{
+			Item* item = map.getItemPointer(key);
+			if (item) {
+				item->flagAccessed = sl_true;
+				*_out = item->value;
+				return sl_true;
+			}
+			return sl_false;
+		}
+		
+		void put_NoLock(const String& key, const T& value)
+		{
+			Item* item = map.getItemPointer(key);
+			if (item) {
+				item->value = value;
+				item->flagAccessed = sl_true;
+				return;
+			}
+			_evict_NoLock();
+			Link<String>* link = clock.pushBack_NoLock(key);
+			if (!link) {
+				return;
+			}
+			Item newItem;
+			newItem.value = value;
+			newItem.flagAccessed = sl_false;
+			newItem.link = link;
+			if (!(map.put_NoLock(key, newItem))) {
+				clock.removeAt(link);
+			}
+		}
+		
+		void removeAll_NoLock()
+		{
+			map.removeAll_NoLock();
+			clock.removeAll_NoLock();
+		}
+		
+	private:
+		void _evict_NoLock()
+		{
+			sl_size nSweep = clock.getCount() << 1;
+			while (nSweep && clock.getCount() >= PRIV_GINGER_MAX_CACHED_TEMPLATES) {
+				Link<String>* link = clock.getFront();
+				String key = link->value;
+				clock.removeAt(link);
+				Item* item = map.getItemPointer(key);
+				if (item) {
+					if (item->flagAccessed) {
+						item->flagAccessed = sl_false;
+						item->link = clock.pushBack_NoLock(key);
+						if (!(item->link)) {
+							map.remove_NoLock(key);
+						}
+					} else {
+						map.remove_NoLock(key);
+					}
+				}
+				nSweep--;
+			}
+		}
+		
+	};
+	
+	class _priv_GingerCache
+	{
+	public:
+		Mutex lock;
+		_priv_GingerCacheMap< Ref<GingerTemplate> > templates;
+		_priv_GingerCacheMap< Ref<_priv_GingerFile> > files;
+		
+	};
+	
+	SLIB_SAFE_STATIC_GETTER(_priv_GingerCache, _priv_Ginger_getCache)
+	
+	// returns the cached file, reading again when it is modified
+	static Ref<_priv_GingerFile> _priv_Ginger_getFile(const String& path)
+	{
+		_priv_GingerCache* cache = _priv_Ginger_getCache();
+		if (!cache) {
+			return sl_null;
+		}
+		sl_uint32 now = System::getTickCount();
+		Ref<_priv_GingerFile> file;
+		{
+			MutexLocker lock(&(cache->lock));
+			if (cache->files.get_NoLock(path, &file)) {
+				if (now - file->timeValidated < PRIV_GINGER_REVALIDATE_INTERVAL) {
+					return file;
+				}
+			}
+		}
+		Time time = File::getModifiedTime(path);
+		if (time.isZero()) {
+			return sl_null;
+		}
+		sl_uint64 size = File::getSize(path);
+		if (file.isNotNull() && file->timeModified == time && file->size == size) {
+			MutexLocker lock(&(cache->lock));
+			file->timeValidated = now;
+			return file;
+		}
+		file = new _priv_GingerFile;
+		if (file.isNull()) {
+			return sl_null;
+		}
+		file->timeModified = time;
+		file->size = size;
+		file->timeValidated = now;
+		file->source = File::readAllTextUTF8(path);
+		if (file->source.isNull() && size) {
+			return sl_null;
+		}
+		MutexLocker lock(&(cache->lock));
+		cache->files.put_NoLock(path, file);
+		return file;
+	}
+	
+	class _priv_GingerIncludeNode : public _priv_GingerNode
+	{
+	public:
+		String path;
+		sl_bool flagInline;
+		
+	public:
+		sl_bool render(_priv_GingerRenderer& renderer) override
+		{
+			if (flagInline) {
+				Ref<_priv_GingerFile> file = _priv_Ginger_getFile(path);
+				if (file.isNull()) {
+					renderer.error = "Failed to read the file: " + path;
+					return sl_false;
+				}
+				renderer.addString(file->source);
+				return sl_true;
+			}
+			if (renderer.depthInclude >= PRIV_GINGER_MAX_INCLUDE_DEPTH) {
+				renderer.error = "Too deep includes: " + path;
+				return sl_false;
+			}
+			Ref<GingerTemplate> t = Ginger::getTemplateFile(path);
+			if (t.isNull()) {
+				renderer.error = "Failed to load the template: " + path;
+				return sl_false;
+			}
+			// the included template does not see the loop variables
+			_priv_GingerLocal* locals = renderer.locals;
+			renderer.locals = sl_null;
+			renderer.depthInclude++;
+			sl_bool bRet = renderer.renderTemplate(t.get());
+			renderer.depthInclude--;
+			renderer.locals = locals;
+			return bRet;
+		}
+		
+	};
+	
+	class _priv_GingerCompiler
+	{
+	public:
+		const sl_char8* begin;
+		const sl_char8* current;
+		const sl_char8* end;
+		String error;
+		
+	public:
+		static Ref<GingerTemplate> compile(const String& source)
+		{
+			Ref<GingerTemplate> ret = new GingerTemplate;
+			if (ret.isNull()) {
+				return sl_null;
+			}
+			ret->m_source = source;
+			_priv_GingerCompiler compiler;
+			compiler.begin = source.getData();
+			compiler.current = compiler.begin;
+			compiler.end = compiler.begin + source.getLength();
+			// `}}` out of the blocks ends the template
+			if (compiler.compileBlock(ret->m_nodes)) {
+				return ret;
+			}
+			sl_uint32 line = 1;
+			for (const sl_char8* p = compiler.begin; p < compiler.current && p < compiler.end; p++) {
+				if (*p == '\n') {
+					line++;
+				}
+			}
+			LogError(TAG, "%s (line %d)", compiler.error, line);
+			return sl_null;
+		}
+		
+	public:
+		static sl_bool isWhitespace(sl_char8 c)
+		{
+			return (sl_uint8)c <= 32;
+		}
+		
+		void skipWhitespace()
+		{
+			while (current < end && isWhitespace(*current)) {
+				current++;
+			}
+		}
+		
+		sl_bool eat(const char* s)
+		{
+			while (*s) {
+				if (current >= end || *current != *s) {
+					error = String("Expected \"") + s + "\"";
+					return sl_false;
+				}
+				current++;
+				s++;
+			}
+			return sl_true;
+		}
+		
+		sl_bool eatWithWhitespace(const char* s)
+		{
+			skipWhitespace();
+			return eat(s);
+		}
+		
+		String readIdentifier()
+		{
+			skipWhitespace();
+			const sl_char8* start = current;
+			while (current < end && !(isWhitespace(*current)) && *current != '{' && *current != '}') {
+				current++;
+			}
+			return String(start, current - start);
+		}
+		
+		sl_bool readName(String& name)
+		{
+			const sl_char8* start = current;
+			while (current < end && !(isWhitespace(*current)) && *current != '.' && *current != '{' && *current != '}') {
+				current++;
+			}
+			if (current == start) {
+				error = "Variable is expected";
+				return sl_false;
+			}
+			name = String(start, current - start);
+			return sl_true;
+		}
+		
+		sl_bool readVariable(_priv_GingerVariable& variable)
+		{
+			skipWhitespace();
+			if (!(readName(variable.name))) {
+				return sl_false;
+			}
+			while (current < end && *current == '.') {
+				current++;
+				_priv_GingerMember member;
+				if (!(readName(member.name))) {
+					return sl_false;
+				}
+				member.flagIndex = member.name.parseUint64(10, &(member.index));
+				variable.members.add_NoLock(member);
+			}
+			return sl_true;
+		}
+		
+		// `variable {{` or `variable == value {{`
+		sl_bool readCondition(_priv_GingerCondition& condition)
+		{
+			if (!(readVariable(condition.variable))) {
+				return sl_false;
+			}
+			skipWhitespace();
+			condition.flagCompare = sl_false;
+			if (current + 1 < end && current[0] == '=' && current[1] == '=') {
+				current += 2;
+				skipWhitespace();
+				const sl_char8* start = current;
+				while (current < end && !(*current == '{' && current + 1 < end && current[1] == '{')) {
+					current++;
+				}
+				const sl_char8* last = current;
+				while (last > start && isWhitespace(last[-1])) {
+					last--;
+				}
+				condition.flagCompare = sl_true;
+				condition.value = String(start, last - start);
+			}
+			return eat("{{");
+		}
+		
+		// `{{ path }}`
+		sl_bool readPath(String& path)
+		{
+			if (!(eatWithWhitespace("{{"))) {
+				return sl_false;
+			}
+			skipWhitespace();
+			const sl_char8* start = current;
+			while (current < end && !(isWhitespace(*current)) && *current != '}') {
+				current++;
+			}
+			if (current == start) {
+				error = "File path is expected";
+				return sl_false;
+			}
+			path = String(start, current - start);
+			return eatWithWhitespace("}}");
+		}
+		
+		sl_bool compileNestedBlock(_priv_GingerBlock& block)
+		{
+			if (!(compileBlock(block))) {
+				return sl_false;
+			}
+			return eat("}}");
+		}
+		
+		// `$if` is already read
+		sl_bool compileIf(_priv_GingerBlock& block)
+		{
+			Ref<_priv_GingerIfNode> node = new _priv_GingerIfNode;
+			if (node.isNull()) {
+				return sl_false;
+			}
+			_priv_GingerCondition condition;
+			if (!(readCondition(condition))) {
+				return sl_false;
+			}
+			if (!(compileNestedBlock(condition.block))) {
+				return sl_false;
+			}
+			node->conditions.add_NoLock(condition);
+			for (;;) {
+				const sl_char8* saved = current;
+				skipWhitespace();
+				if (current < end && *current == '$') {
+					current++;
+					String command = readIdentifier();
+					if (command == "elseif") {
+						_priv_GingerCondition condition;
+						if (!(readCondition(condition))) {
+							return sl_false;
+						}
+						if (!(compileNestedBlock(condition.block))) {
+							return sl_false;
+						}
+						node->conditions.add_NoLock(condition);
+						continue;
+					} else if (command == "else") {
+						_priv_GingerCondition condition;
+						if (!(eatWithWhitespace("{{"))) {
+							return sl_false;
+						}
+						if (!(compileNestedBlock(condition.block))) {
+							return sl_false;
+						}
+						node->conditions.add_NoLock(condition);
+						break;
+					}
+				}
+				// the whitespaces are kept when there is no more branch
+				current = saved;
+				break;
+			}
+			block.add_NoLock(node);
+			return sl_true;
+		}
+		
+		void addText(_priv_GingerBlock& block, _priv_GingerTextNode*& last, const sl_char8* text, sl_size length)
+		{
+			if (!length) {
+				return;
+			}
+			if (last && last->text + last->length == text) {
+				last->length += length;
+				return;
+			}
+			Ref<_priv_GingerTextNode> node = new _priv_GingerTextNode;
+			if (node.isNotNull()) {
+				node->text = text;
+				node->length = length;
+				block.add_NoLock(node);
+				last = node.get();
+			}
+		}
+		
+		// stops before `}}` or at the end
+		sl_bool compileBlock(_priv_GingerBlock& block)
+		{
+			_priv_GingerTextNode* text = sl_null;
+			while (current < end) {
+				const sl_char8* start = current;
+				while (current < end && *current != '}' && *current != '$') {
+					current++;
+				}
+				addText(block, text, start, current - start);
+				if (current >= end) {
+					break;
+				}
+				if (*current == '}') {
+					if (current + 1 < end && current[1] == '}') {
+						return sl_true;
+					}
+					addText(block, text, current, 1);
+					current++;
+					continue;
+				}
+				current++;
+				if (current >= end) {
+					error = "Unexpected end after \"$\"";
+					return sl_false;
+				}
+				sl_char8 c = *current;
+				if (c == '$') {
+					addText(block, text, current, 1);
+					current++;
+				} else if (c == '#') {
+					while (current < end && *current != '\n') {
+						current++;
+					}
+				} else if (c == '{') {
+					current++;
+					if (current < end && *current == '{') {
+						addText(block, text, current - 1, 2);
+						current++;
+					} else {
+						Ref<_priv_GingerVariableNode> node = new _priv_GingerVariableNode;
+						if (node.isNull()) {
+							return sl_false;
+						}
+						if (!(readVariable(node->variable))) {
+							return sl_false;
+						}
+						if (!(eatWithWhitespace("}"))) {
+							return sl_false;
+						}
+						block.add_NoLock(node);
+						text = sl_null;
+					}
+				} else if (c == '}') {
+					current++;
+					if (current < end && *current == '}') {
+						addText(block, text, current - 1, 2);
+						current++;
+					} else {
+						error = "Expected \"}\" after \"$}\"";
+						return sl_false;
+					}
+				} else {
+					String command = readIdentifier();
+					if (command == "for") {
+						Ref<_priv_GingerForNode> node = new _priv_GingerForNode;
+						if (node.isNull()) {
+							return sl_false;
+						}
+						node->name = readIdentifier();
+						if (node->name.isEmpty()) {
+							error = "Loop variable is expected";
+							return sl_false;
+						}
+						if (readIdentifier() != "in") {
+							error = "Expected \"in\"";
+							return sl_false;
+						}
+						if (!(readVariable(node->list))) {
+							return sl_false;
+						}
+						if (!(eatWithWhitespace("{{"))) {
+							return sl_false;
+						}
+						if (!(compileNestedBlock(node->block))) {
+							return sl_false;
+						}
+						block.add_NoLock(node);
+					} else if (command == "if") {
+						if (!(compileIf(block))) {
+							return sl_false;
+						}
+					} else if (command == "include" || command == "inline") {
+						Ref<_priv_GingerIncludeNode> node = new _priv_GingerIncludeNode;
+						if (node.isNull()) {
+							return sl_false;
+						}
+						node->flagInline = command == "inline";
+						if (!(readPath(node->path))) {
+							return sl_false;
+						}
+						block.add_NoLock(node);
+					} else {
+						error = "Unexpected command \"" + command + "\"";
+						return sl_false;
+					}
+					text = sl_null;
+				}
+			}
+			return sl_true;
+		}
+		
+	};
+	
+	
+	GingerTemplate::GingerTemplate()
+	{
+	}
+	
+	GingerTemplate::~GingerTemplate()
+	{
+	}
+	
+	Ref<GingerTemplate> GingerTemplate::compile(const String& source)
+	{
+		return _priv_GingerCompiler::compile(source);
+	}
+	
+	const String& GingerTemplate::getSource()
+	{
+		return m_source;
+	}
+	
+	String GingerTemplate::render(const Json& data)
+	{
+		StringBuffer buf;
+		if (render(buf, data)) {
+			return buf.merge();
+		}
+		return sl_null;
+	}
+	
+	sl_bool GingerTemplate::render(StringBuffer& output, const Json& data)
+	{
+		_priv_GingerRenderer renderer(&output, data);
+		sl_bool bRet = renderer.renderTemplate(this);
+		renderer.flush();
+		if (bRet) {
+			return sl_true;
+		}
+		LogError(TAG, "%s", renderer.error);
+		return sl_false;
+	}
+	
+	sl_bool GingerTemplate::render(AsyncOutputBuffer* output, const Json& data)
+	{
+		StringBuffer buf;
+		if (render(buf, data)) {
+			if (buf.getLength()) {
+				return output->write(buf.mergeToMemory());
+			}
+			return sl_true;
+		}
+		return sl_false;
+	}
+	
+	
 	String Ginger::render(const String& _template, const Json& data)
 	{
-		return ginger::render_string(_template.toStd(), data);
+		Ref<GingerTemplate> t = getTemplate(_template);
+		if (t.isNotNull()) {
+			return t->render(data);
+		}
+		return sl_null;
+	}
+	
+	sl_bool Ginger::render(StringBuffer& output, const String& _template, const Json& data)
+	{
+		Ref<GingerTemplate> t = getTemplate(_template);
+		if (t.isNotNull()) {
+			return t->render(output, data);
+		}
+		return sl_false;
 	}
 
 	String Ginger::renderFile(const String& filePath, const Json& data)
 	{
-		return ginger::render_file(filePath.toStd(), data);
+		Ref<GingerTemplate> t = getTemplateFile(filePath);
+		if (t.isNotNull()) {
+			return t->render(data);
+		}
+		return sl_null;
+	}
+	
+	sl_bool Ginger::renderFile(StringBuffer& output, const String& filePath, const Json& data)
+	{
+		Ref<GingerTemplate> t = getTemplateFile(filePath);
+		if (t.isNotNull()) {
+			return t->render(output, data);
+		}
+		return sl_false;
+	}
+	
+	Ref<GingerTemplate> Ginger::getTemplate(const String& _template)
+	{
+		_priv_GingerCache* cache = _priv_Ginger_getCache();
+		if (!cache) {
+			return GingerTemplate::compile(_template);
+		}
+		Ref<GingerTemplate> t;
+		{
+			MutexLocker lock(&(cache->lock));
+			if (cache->templates.get_NoLock(_template, &t)) {
+				return t;
+			}
+		}
+		t = GingerTemplate::compile(_template);
+		if (t.isNotNull()) {
+			MutexLocker lock(&(cache->lock));
+			cache->templates.put_NoLock(_template, t);
+		}
+		return t;
+	}
+	
+	Ref<GingerTemplate> Ginger::getTemplateFile(const String& filePath)
+	{
+		Ref<_priv_GingerFile> file = _priv_Ginger_getFile(filePath);
+		if (file.isNull()) {
+			LogError(TAG, "Failed to read the template file: %s", filePath);
+			return sl_null;
+		}
+		_priv_GingerCache* cache = _priv_Ginger_getCache();
+		{
+			MutexLocker lock(&(cache->lock));
+			if (file->compiled.isNotNull()) {
+				return file->compiled;
+			}
+		}
+		Ref<GingerTemplate> t = GingerTemplate::compile(file->source);
+		if (t.isNotNull()) {
+			MutexLocker lock(&(cache->lock));
+			file->compiled = t;
+		}
+		return t;
+	}
+	
+	void Ginger::clearCache()
+	{
+		_priv_GingerCache* cache = _priv_Ginger_getCache();
+		if (cache) {
+			MutexLocker lock(&(cache->lock));
+			cache->templates.removeAll_NoLock();
+			cache->files.removeAll_NoLock();
+		}
 	}
 
 }
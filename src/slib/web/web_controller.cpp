@@ -24,10 +24,280 @@
 
 #include "slib/web/service.h"
 #include "slib/core/xml.h"
+#include "slib/network/url.h"
 
 namespace slib
 {
 
+	class _priv_WebRouterNode : public Referable
+	{
+	public:
+		// static characters following the parent node
+		String prefix;
+		// first characters of the prefixes of `children`
+		List<sl_char8> indices;
+		List< Ref<_priv_WebRouterNode> > children;
+		
+		String nameParameter;
+		Ref<_priv_WebRouterNode> parameter;
+		
+		String nameWildcard;
+		Ref<_priv_WebRouterNode> wildcard;
+		
+		WebHandler handler;
+		
+	};
+	
+	// returns the node ending with the static characters, splitting the prefixes on the way
+	static _priv_WebRouterNode* _priv_WebRouter_insertStatic(_priv_WebRouterNode* node, const sl_char8* s, sl_size len)
+	{
+		while (len) {
+			sl_char8* indices = node->indices.getData();
+			Ref<_priv_WebRouterNode>* children = node->children.getData();
+			sl_size n = node->children.getCount();
+			sl_size i = 0;
+			for (; i < n; i++) {
+				if (indices[i] == *s) {
+					break;
+				}
+			}
+			if (i == n) {
+				Ref<_priv_WebRouterNode> child = new _priv_WebRouterNode;
+				if (child.isNull()) {
+					return sl_null;
+				}
+				child->prefix = String(s, len);
+				node->indices.add_NoLock(*s);
+				node->children.add_NoLock(child);
+				return child.get();
+			}
+			_priv_WebRouterNode* child = children[i].get();
+			sl_size m = child->prefix.getLength();
+			const sl_char8* prefix = child->prefix.getData();
+			sl_size k = 1;
+			while (k < m && k < len && prefix[k] == s[k]) {
+				k++;
+			}
+			if (k < m) {
+				Ref<_priv_WebRouterNode> parent = new _priv_WebRouterNode;
+				if (parent.isNull()) {
+					return sl_null;
+				}
+				parent->prefix = String(prefix, k);
+				String rest(prefix + k, m - k);
+				child->prefix = rest;
+				parent->indices.add_NoLock(rest.getData()[0]);
+				parent->children.add_NoLock(children[i]);
+				children[i] = parent;
+				child = parent.get();
+			}
+			node = child;
+			s += k;
+			len -= k;
+		}
+		return node;
+	}
+	
+	static sl_bool _priv_WebRouter_isValidName(const String& name)
+	{
+		sl_char8* s = name.getData();
+		sl_size n = name.getLength();
+		for (sl_size i = 0; i < n; i++) {
+			sl_char8 c = s[i];
+			if (c == '/' || c == '{' || c == '}' || c == '*') {
+				return sl_false;
+			}
+		}
+		return sl_true;
+	}
+	
+	static sl_bool _priv_WebRouter_match(_priv_WebRouterNode* node, const sl_char8* path, sl_size len, WebRouteMatch& result)
+	{
+		sl_size n = node->prefix.getLength();
+		if (n) {
+			if (len < n) {
+				return sl_false;
+			}
+			if (!(Base::equalsMemory(node->prefix.getData(), path, n))) {
+				return sl_false;
+			}
+			path += n;
+			len -= n;
+		}
+		if (len) {
+			sl_char8* indices = node->indices.getData();
+			sl_size count = node->children.getCount();
+			for (sl_size i = 0; i < count; i++) {
+				if (indices[i] == *path) {
+					if (_priv_WebRouter_match(node->children.getData()[i].get(), path, len, result)) {
+						return sl_true;
+					}
+					break;
+				}
+			}
+			_priv_WebRouterNode* child = node->parameter.get();
+			if (child) {
+				sl_size k = 0;
+				while (k < len && path[k] != '/') {
+					k++;
+				}
+				if (k) {
+					// the count of the parameters in the pattern is limited when it is added
+					sl_uint32 index = result.countParameters;
+					WebRouteMatch::Parameter& param = result.parameters[index];
+					param.name = &(node->nameParameter);
+					param.value = path;
+					param.length = k;
+					result.countParameters = index + 1;
+					if (_priv_WebRouter_match(child, path + k, len - k, result)) {
+						return sl_true;
+					}
+					result.countParameters = index;
+				}
+			}
+		} else {
+			if (node->handler.isNotNull()) {
+				result.handler = node->handler;
+				return sl_true;
+			}
+		}
+		_priv_WebRouterNode* child = node->wildcard.get();
+		if (child) {
+			WebRouteMatch::Parameter& param = result.parameters[result.countParameters];
+			param.name = &(node->nameWildcard);
+			param.value = path;
+			param.length = len;
+			result.countParameters++;
+			result.handler = child->handler;
+			return sl_true;
+		}
+		return sl_false;
+	}
+	
+	WebRouteMatch::WebRouteMatch()
+	{
+		countParameters = 0;
+	}
+	
+	WebRouteMatch::~WebRouteMatch()
+	{
+	}
+	
+	WebRouter::WebRouter()
+	{
+	}
+	
+	WebRouter::~WebRouter()
+	{
+	}
+	
+	sl_bool WebRouter::add(HttpMethod method, const String& pattern, const WebHandler& handler)
+	{
+		sl_uint32 indexTree = (sl_uint32)method;
+		if (!indexTree || indexTree >= MethodCount) {
+			return sl_false;
+		}
+		if (handler.isNull()) {
+			return sl_false;
+		}
+		sl_char8* s = pattern.getData();
+		sl_size len = pattern.getLength();
+		
+		WriteLocker lock(&m_lock);
+		
+		Ref<_priv_WebRouterNode>& root = m_trees[indexTree];
+		if (root.isNull()) {
+			root = new _priv_WebRouterNode;
+			if (root.isNull()) {
+				return sl_false;
+			}
+		}
+		_priv_WebRouterNode* node = root.get();
+		sl_uint32 countParameters = 0;
+		sl_size pos = 0;
+		while (pos < len) {
+			sl_size start = pos;
+			while (pos < len && s[pos] != '{' && s[pos] != '*') {
+				pos++;
+			}
+			if (pos > start) {
+				node = _priv_WebRouter_insertStatic(node, s + start, pos - start);
+				if (!node) {
+					return sl_false;
+				}
+			}
+			if (pos >= len) {
+				break;
+			}
+			if (countParameters >= WebRouteMatch::MaxParameters) {
+				return sl_false;
+			}
+			countParameters++;
+			if (s[pos] == '*') {
+				// wildcard: the rest of the pattern is the name
+				String name(s + pos + 1, len - pos - 1);
+				if (!(_priv_WebRouter_isValidName(name))) {
+					return sl_false;
+				}
+				if (node->wildcard.isNull()) {
+					node->wildcard = new _priv_WebRouterNode;
+					if (node->wildcard.isNull()) {
+						return sl_false;
+					}
+					node->nameWildcard = name;
+				} else if (node->nameWildcard != name) {
+					return sl_false;
+				}
+				node = node->wildcard.get();
+				break;
+			}
+			sl_size end = pos + 1;
+			while (end < len && s[end] != '}') {
+				end++;
+			}
+			if (end >= len || end == pos + 1) {
+				return sl_false;
+			}
+			// the parameter takes the characters up to the next `/`
+			if (end + 1 < len && s[end + 1] != '/') {
+				return sl_false;
+			}
+			String name(s + pos + 1, end - pos - 1);
+			if (!(_priv_WebRouter_isValidName(name))) {
+				return sl_false;
+			}
+			if (node->parameter.isNull()) {
+				node->parameter = new _priv_WebRouterNode;
+				if (node->parameter.isNull()) {
+					return sl_false;
+				}
+				node->nameParameter = name;
+			} else if (node->nameParameter != name) {
+				return sl_false;
+			}
+			node = node->parameter.get();
+			pos = end + 1;
+		}
+		node->handler = handler;
+		return sl_true;
+	}
+	
+	sl_bool WebRouter::match(HttpMethod method, const sl_char8* path, sl_size length, WebRouteMatch& result) const
+	{
+		sl_uint32 indexTree = (sl_uint32)method;
+		if (!indexTree || indexTree >= MethodCount) {
+			return sl_false;
+		}
+		ReadLocker lock(&m_lock);
+		_priv_WebRouterNode* root = m_trees[indexTree].get();
+		if (root) {
+			result.countParameters = 0;
+			return _priv_WebRouter_match(root, path, length, result);
+		}
+		return sl_false;
+	}
+	
+
 	SLIB_DEFINE_OBJECT(WebController, Object)
 
 	WebController::WebController()
@@ -39,22 +309,22 @@ namespace slib
 		return new WebController;
 	}
 
-	void WebController::registerHandler(HttpMethod method, const String& path, const WebHandler& handler)
+	sl_bool WebController::registerHandler(HttpMethod method, const String& path, const WebHandler& handler)
 	{
-		if (handler.isNotNull()) {
-			String sig = _getHandlerSignature(method, path);
-			m_handlers.put(sig, handler);
-		}
+		return m_router.add(method, path, handler);
 	}
 
 	sl_bool WebController::processHttpRequest(HttpServerContext* context)
 	{
 		HttpMethod method = context->getMethod();
 		String path = context->getPath();
-		String sig = _getHandlerSignature(method, path);
-		WebHandler handler;
-		if (m_handlers.get(sig, &handler)) {
-			Variant ret(handler(context, method, path));
+		WebRouteMatch match;
+		if (m_router.match(method, path.getData(), path.getLength(), match)) {
+			for (sl_uint32 i = 0; i < match.countParameters; i++) {
+				WebRouteMatch::Parameter& param = match.parameters[i];
+				context->setParameter(*(param.name), Url::decodeUriComponentByUTF8(String(param.value, param.length)));
+			}
+			Variant ret(match.handler(context, method, path));
 			if (ret.isNotNull()) {
 				if (ret.isObject()) {
 					Ref<Referable> obj = ret.getObject();
@@ -76,11 +346,6 @@ namespace slib
 		return sl_false;
 	}
 
-	String WebController::_getHandlerSignature(HttpMethod method, const String& path)
-	{
-		return HttpMethods::toString(method) + " " + path;
-	}
-
 
 	WebModule::WebModule(const String& path)
 	: m_path(path)